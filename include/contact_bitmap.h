@@ -0,0 +1,63 @@
+#ifndef CONTACT_BITMAP_H
+#define CONTACT_BITMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONTACT_BITMAP_ARRAY_MAX 4096   // values an array container holds before turning into words
+#define CONTACT_BITMAP_WORDS 1024       // 65536 bits
+
+// Values sharing their high 16 bits. Sparse containers keep the low halves
+// as a sorted array; dense ones, past CONTACT_BITMAP_ARRAY_MAX values, as a
+// 64 Kbit word array. Exactly one of values and words is set.
+typedef struct {
+    uint16_t key;
+    uint32_t cardinality;
+    uint32_t capacity;    // values allocated
+    uint16_t *values;
+    uint64_t *words;
+} ContactContainer;
+
+// Compressed set of 32-bit values (roaring): containers sorted by key, none
+// empty. Zero-initialized is the empty set.
+typedef struct {
+    ContactContainer *containers;
+    size_t count;
+    size_t capacity;
+} ContactBitmap;
+
+// Return false to stop a visit early.
+typedef bool (*ContactBitmapVisitor)(uint32_t value, void *userData);
+
+// False only when memory runs out; adding a member again is not an error.
+// Adding in ascending order appends without moving anything.
+bool contactBitmapAdd(ContactBitmap *bitmap, uint32_t value);
+// False when value was not a member.
+bool contactBitmapRemove(ContactBitmap *bitmap, uint32_t value);
+bool contactBitmapContains(const ContactBitmap *bitmap, uint32_t value);
+size_t contactBitmapCount(const ContactBitmap *bitmap);
+void contactBitmapClear(ContactBitmap *bitmap);
+void contactBitmapFree(ContactBitmap *bitmap);
+bool contactBitmapCopy(ContactBitmap *dest, const ContactBitmap *src);
+size_t contactBitmapBytes(const ContactBitmap *bitmap);
+
+// Set operations replace out, which must not be one of the operands.
+bool contactBitmapAnd(ContactBitmap *out, const ContactBitmap *a, const ContactBitmap *b);
+bool contactBitmapOr(ContactBitmap *out, const ContactBitmap *a, const ContactBitmap *b);
+bool contactBitmapAndNot(ContactBitmap *out, const ContactBitmap *a, const ContactBitmap *b);
+// Size of the intersection, without building it.
+size_t contactBitmapAndCount(const ContactBitmap *a, const ContactBitmap *b);
+
+// Visits members in ascending order; false if the visitor stopped it.
+bool contactBitmapVisit(const ContactBitmap *bitmap, ContactBitmapVisitor visitor, void *userData);
+
+// Serialized form: [container count] then per container [key][cardinality]
+// and the values or words, in host byte order.
+size_t contactBitmapSerializedSize(const ContactBitmap *bitmap);
+unsigned char *contactBitmapSerialize(const ContactBitmap *bitmap, unsigned char *out);
+// Replaces bitmap with the one serialized at data; NULL when the bytes are
+// truncated or not a valid bitmap, else the end of what was read.
+const unsigned char *contactBitmapDeserialize(ContactBitmap *bitmap, const unsigned char *data, size_t size);
+
+#endif
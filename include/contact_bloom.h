@@ -0,0 +1,64 @@
+#ifndef CONTACT_BLOOM_H
+#define CONTACT_BLOOM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONTACT_BLOOM_BITS_PER_NAME 10
+#define CONTACT_BLOOM_MIN_NAMES 1024
+#define CONTACT_BLOOM_STRIPES 16
+
+struct ContactStore;
+
+// Blocked Bloom filter over the contact names in a store. Each name sets
+// all its bits in one 512-bit block (a cache line), so a lookup costs at
+// most one cache miss, and a name the filter rejects is certainly absent.
+// Deleted names cannot be cleared: they are counted as stale and the
+// filter is rebuilt from the live names once too many accumulate. A zeroed
+// filter holds nothing and answers "maybe" until it is first built.
+typedef struct {
+    uint64_t *blocks;
+    size_t blockCount;     // power of two, 8 words each
+    unsigned hashes;       // bits set per name
+    size_t capacity;       // names it was sized for
+    size_t names;          // names added since the last rebuild
+    size_t stale;          // of those, names since deleted or renamed
+} ContactBloom;
+
+// Process-wide counters of name lookups through findContact and
+// findContactHandle.
+typedef struct {
+    uint64_t lookups;
+    uint64_t skipped;          // rejected by the filter, index not consulted
+    uint64_t falsePositives;   // passed the filter but not in the store
+} ContactBloomStats;
+
+// Bits per name for filters built from now on (default
+// CONTACT_BLOOM_BITS_PER_NAME, about 1% false positives); 0 restores the
+// default.
+void contactBloomSetBitsPerName(unsigned bits);
+
+bool contactBloomMayContain(const ContactBloom *filter, const char *name);
+// Records the name's bits, growing the filter when it is full.
+void contactBloomAdd(struct ContactStore *store, const char *name);
+void contactBloomRemove(struct ContactStore *store);
+// Rebuilds the filter from the live names if enough of its names are
+// stale, or unconditionally when force is set.
+void contactBloomCompact(struct ContactStore *store, bool force);
+// Sizes the filter for count names so adding them never rebuilds it.
+bool contactBloomReserve(struct ContactStore *store, size_t count);
+bool contactBloomCopy(ContactBloom *dest, const ContactBloom *src);
+// Ors src into dest. False, leaving dest as it was, when the two filters
+// differ in size or hash count.
+bool contactBloomMerge(ContactBloom *dest, const ContactBloom *src);
+void contactBloomFree(ContactBloom *filter);
+size_t contactBloomBytes(const ContactBloom *filter);
+// Expected false positive rate from the share of bits set.
+double contactBloomFalsePositiveRate(const ContactBloom *filter);
+
+void contactBloomRecord(bool passed, bool found);
+void contactBloomStats(ContactBloomStats *stats);
+void contactBloomResetStats(void);
+
+#endif
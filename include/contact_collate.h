@@ -0,0 +1,18 @@
+#ifndef CONTACT_COLLATE_H
+#define CONTACT_COLLATE_H
+
+#include <stddef.h>
+
+// Collation keys match and order names regardless of case and accents.
+// Each letter of Latin, Greek or Cyrillic script becomes its lowercase base
+// letter: "Émile" and "EMILE" both give "emile", "ß" gives "ss" and "Æ"
+// "ae". Combining accents are dropped, and bytes that are not valid UTF-8
+// are kept as they are. Keys are UTF-8 again, compare with strcmp, and are
+// never longer than the name. The order is the same whatever the locale:
+// no language's own rules (such as Swedish "å" after "z") are applied.
+
+// Writes the NUL-terminated key of the first length bytes of name to key,
+// which has room for length + 1 bytes, and returns the key's length.
+size_t contactCollate(const char *name, size_t length, char *key);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef CONTACT_CURSOR_H
+#define CONTACT_CURSOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+
+// Longest encoded token, including the terminating NUL
+#define CONTACT_CURSOR_TOKEN_SIZE 128
+
+typedef enum {
+    CONTACT_ORDER_NAME,
+    CONTACT_ORDER_INSERTION
+} ContactOrder;
+
+// Position after the last contact returned. A cursor holds no pointers into
+// the store, so it stays valid while contacts are added and deleted between
+// pages: contacts added ahead of it are still returned, and none already
+// returned come back. In name order, contacts sharing the last name are
+// counted, so deleting one of those already returned skips a later one.
+typedef struct {
+    ContactOrder order;
+    bool done;               // no contacts were left after the last page
+    uint64_t sequence;       // insertion order: next sequence to return
+    uint32_t skip;           // name order: contacts named `name` returned
+    char name[50];
+} ContactCursor;
+
+void contactCursorInit(ContactCursor *cursor, ContactOrder order);
+
+// Copies up to limit contacts after the cursor into out and advances it.
+size_t contactPage(const ContactStore *store, ContactCursor *cursor, Contact *out, size_t limit);
+
+// Tokens are short printable strings ([0-9A-Za-z:]) for resuming a cursor
+// elsewhere, such as in a network client.
+bool contactCursorEncode(const ContactCursor *cursor, char *token, size_t size);
+bool contactCursorDecode(ContactCursor *cursor, const char *token);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef CONTACT_DB_H
+#define CONTACT_DB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+
+#define CONTACT_DB_MAGIC "ECHONULL"
+#define CONTACT_DB_VERSION 2
+#define CONTACT_DB_PAGE_SIZE 4096
+
+// Every data page ends with a footer; records fill the rest of the page at
+// a fixed stride of sizeof(Contact).
+typedef struct {
+    uint32_t recordCount;
+    uint32_t checksum;
+} ContactDbPageFooter;
+
+#define CONTACT_DB_RECORDS_PER_PAGE \
+    ((CONTACT_DB_PAGE_SIZE - sizeof(ContactDbPageFooter)) / sizeof(Contact))
+
+// First page of the file. Fields are in host byte order.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t pageSize;
+    uint32_t recordSize;
+    uint32_t recordsPerPage;
+    uint64_t recordCount;
+    uint64_t pageCount;
+    uint64_t walSequence;   // last write-ahead log record folded into this file
+    uint32_t dataChecksum;
+    uint32_t headerChecksum;
+} ContactDbHeader;
+
+typedef enum {
+    CONTACT_DB_OK,
+    CONTACT_DB_MISSING,
+    CONTACT_DB_LEGACY,
+    CONTACT_DB_CORRUPT,
+    CONTACT_DB_PACKED      // a compressed snapshot, see contact_pack.h
+} ContactDbStatus;
+
+// Read-only view of a database file mapped into memory. Records are read
+// in place, so opening costs the same for ten contacts or ten million.
+typedef struct {
+    int fd;
+    const unsigned char *map;
+    size_t mapSize;
+    const ContactDbHeader *header;
+} ContactDb;
+
+ContactDbStatus contactDbOpen(ContactDb *db, const char *filename);
+size_t contactDbCount(const ContactDb *db);
+const Contact *contactDbRecord(const ContactDb *db, size_t index);
+const Contact *contactDbPage(const ContactDb *db, size_t page, size_t *count);
+bool contactDbVerifyPage(const ContactDb *db, size_t page);
+bool contactDbVerify(const ContactDb *db);
+void contactDbClose(ContactDb *db);
+
+// Supplies the records to write, one per call, then NULL.
+typedef const Contact *(*ContactRecordSource)(void *source);
+
+bool contactDbWriteSource(ContactRecordSource next, void *source, const char *filename,
+                          uint64_t walSequence, size_t *written);
+bool contactDbWrite(const ContactStore *store, const char *filename, uint64_t walSequence, size_t *written);
+bool contactDbWriteRecords(const Contact *records, size_t count, const char *filename,
+                           uint64_t walSequence, size_t *written);
+// Makes a rename into filename's directory durable. Writers call it after
+// renaming a finished temp file over the target.
+bool contactDbSyncDirectory(const char *filename);
+
+#endif
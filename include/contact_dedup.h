@@ -0,0 +1,40 @@
+#ifndef CONTACT_DEDUP_H
+#define CONTACT_DEDUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "contact_manager.h"
+
+// Rules that make two contacts duplicates; a cluster holds every contact
+// linked to another by any enabled rule.
+#define CONTACT_DUP_PHONE 0x1u   // same normalized phone number
+#define CONTACT_DUP_EMAIL 0x2u   // same email ignoring case and whitespace
+#define CONTACT_DUP_NAME 0x4u    // similar names (3-gram Jaccard), same digits
+#define CONTACT_DUP_ALL (CONTACT_DUP_PHONE | CONTACT_DUP_EMAIL | CONTACT_DUP_NAME)
+
+#define CONTACT_DUP_NAME_THRESHOLD 0.6
+
+// Clusters are stored back to back: cluster i is
+// members[starts[i]] .. members[starts[i + 1] - 1], each of two or more
+// contacts, and reasons[i] holds the rules that linked them.
+typedef struct {
+    ContactHandle *members;
+    size_t *starts;
+    unsigned *reasons;
+    size_t clusterCount;
+    size_t memberCount;
+} ContactDuplicates;
+
+// Finds duplicate clusters in near-linear time. Exact rules group contacts
+// by sorted keys; names are matched through MinHash signatures bucketed by
+// band (LSH), and only contacts sharing a bucket are compared.
+// nameThreshold is the 3-gram Jaccard similarity names must reach.
+bool contactFindDuplicates(const ContactStore *store, unsigned rules, double nameThreshold,
+                           ContactDuplicates *out);
+void contactDuplicatesFree(ContactDuplicates *duplicates);
+
+// 3-gram Jaccard similarity of two names after normalization (lowercase,
+// punctuation dropped, runs of spaces collapsed).
+double contactNameSimilarity(const char *a, const char *b);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CONTACT_INDEX_H
+#define CONTACT_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONTACT_SLOT_NONE UINT32_MAX
+
+struct ContactStore;
+
+typedef struct {
+    uint64_t hash;
+    uint32_t ref;   // slot + 1, 0 marks an empty entry
+} IndexEntry;
+
+typedef enum {
+    CONTACT_KEY_NAME,
+    CONTACT_KEY_EMAIL,
+    CONTACT_KEY_PHONE    // integer PhoneKey; slots without one are left out
+} ContactKeyField;
+
+// Open-addressing (linear probing) hash index over one field of the
+// contacts in a store, mapping it to slot numbers. A zeroed index is a
+// valid, empty index on the contact name.
+typedef struct {
+    IndexEntry *entries;
+    size_t capacity;
+    size_t count;
+    ContactKeyField field;
+} ContactIndex;
+
+void contactIndexInit(ContactIndex *index, ContactKeyField field);
+bool contactIndexInsert(ContactIndex *index, const struct ContactStore *store, uint32_t slot);
+// Grows the table once so count entries fit without rehashing.
+bool contactIndexReserve(ContactIndex *index, size_t count);
+bool contactIndexInsertBatch(ContactIndex *index, const struct ContactStore *store,
+                             const uint32_t *slots, size_t count);
+// Adds src's entries with their slots moved up by offset, reusing the
+// stored hashes. Both indexes must be on the same field.
+bool contactIndexMerge(ContactIndex *index, const ContactIndex *src, uint32_t offset);
+uint32_t contactIndexFind(const ContactIndex *index, const struct ContactStore *store, const char *key);
+// On a name index: the one slot whose name matches name ignoring case and
+// accents (contact_collate.h), CONTACT_SLOT_NONE when none or several do.
+uint32_t contactIndexFindCollated(const ContactIndex *index, const struct ContactStore *store, const char *name);
+uint32_t contactIndexFindKey(const ContactIndex *index, const struct ContactStore *store, uint64_t key);
+bool contactIndexRemove(ContactIndex *index, const struct ContactStore *store, uint32_t slot);
+void contactIndexClear(ContactIndex *index);
+bool contactIndexCopy(ContactIndex *dest, const ContactIndex *src);
+void contactIndexFree(ContactIndex *index);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef CONTACT_IO_H
+#define CONTACT_IO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "contact_manager.h"
+
+#define CONTACT_IO_BUFFER_SIZE (1 << 20)
+#define CONTACT_IMPORT_BATCH_SIZE 4096
+
+typedef enum {
+    CONTACT_FORMAT_CSV,
+    CONTACT_FORMAT_VCARD
+} ContactFormat;
+
+typedef struct {
+    size_t records;      // records read or written
+    size_t imported;
+    size_t duplicates;   // names already in the store, skipped
+    size_t invalid;      // malformed records or fields too long to store
+    size_t bytes;
+    double seconds;
+    double recordsPerSecond;
+} ContactIoStats;
+
+// CSV is name,phone,email with RFC 4180 quoting and an optional header
+// row; vCard reads FN, the first TEL and the first EMAIL of each card.
+ContactFormat contactFormatForFile(const char *filename);
+bool importContacts(ContactStore *store, const char *filename, ContactFormat format, ContactIoStats *stats);
+bool exportContacts(const ContactStore *store, const char *filename, ContactFormat format, ContactIoStats *stats);
+
+#endif
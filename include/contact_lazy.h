@@ -0,0 +1,65 @@
+#ifndef CONTACT_LAZY_H
+#define CONTACT_LAZY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+#include "contact_pack.h"
+#include "contact_tags.h"
+
+#define CONTACT_LAZY_NAME_SIZE sizeof(((Contact *)0)->name)
+
+// The read-only part of a lazily opened snapshot, shared by the copies of
+// a store: the mapped file, the first name of every block as a name index,
+// where each block starts in the snapshot's name order, and the tags by
+// position in that order. Copies are made and freed by one thread at a
+// time (the writer, for a ContactShared), so the count is not atomic.
+typedef struct {
+    ContactPack pack;
+    char *fences;          // blockCount names of CONTACT_LAZY_NAME_SIZE bytes
+    uint32_t *firstRanks;
+    ContactTags ranks;
+    char filename[256];
+    size_t references;
+} ContactLazyFile;
+
+// A store opened on a packed snapshot without decoding its records. Its
+// contacts are faulted in a block at a time: the block a name falls in is
+// added to the store before a change can touch that name, and the whole
+// file before anything needs every contact (contactLazyLoadAll). Until
+// then the store's count, iteration, searches, indexes and views cover only
+// the blocks faulted in; findContact alone also reads the rest from the
+// file. The store stops being lazy once every block is in.
+typedef struct ContactLazy {
+    ContactLazyFile *file;
+    unsigned char *faulted;   // one flag per block
+    size_t unfaulted;         // blocks not faulted in yet
+    size_t pending;           // contacts in them
+} ContactLazy;
+
+// Whether loadContacts opens packed snapshots lazily; off by default.
+// Only empty stores without a snapshot open are loaded lazily.
+void contactLazySetEnabled(bool enabled);
+bool contactLazyEnabled(void);
+
+// Opens filename on the empty store, reading only the header, the block
+// index, the first name of each block and the tags. False, leaving the
+// store untouched, when the file is not an intact packed snapshot.
+bool contactLazyOpen(ContactStore *store, const char *filename);
+// Faults in the block name would be in. False when memory runs out.
+bool contactLazyFaultName(ContactStore *store, const char *name);
+// Faults in every block holding a name that matches name ignoring case and
+// accents. Such names can be in any block, so this decodes the whole file.
+bool contactLazyFaultCollated(ContactStore *store, const char *name);
+bool contactLazyLoadAll(ContactStore *store);
+// Contacts not faulted in yet; 0 for a store that is not lazy.
+size_t contactLazyPending(const ContactStore *store);
+// Looks an unfaulted name up in the file, without changing the store.
+bool contactLazyFind(const ContactStore *store, const char *name, Contact *out);
+
+bool contactLazyCopy(ContactStore *dest, const ContactStore *src);
+void contactLazyFree(ContactStore *store);
+size_t contactLazyBytes(const ContactStore *store);
+
+#endif
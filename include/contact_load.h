@@ -0,0 +1,23 @@
+#ifndef CONTACT_LOAD_H
+#define CONTACT_LOAD_H
+
+#include <stddef.h>
+#include "contact_manager.h"
+#include "contact_pack.h"
+
+#define CONTACT_LOAD_MAX_THREADS 16
+#define CONTACT_LOAD_PARALLEL_MIN 16384
+
+// Sets the worker threads used to load packed snapshots (0 = one per CPU,
+// at most CONTACT_LOAD_MAX_THREADS). Files under CONTACT_LOAD_PARALLEL_MIN
+// contacts, and stores that already hold contacts or log to a write-ahead
+// log, are loaded on the calling thread.
+void contactLoadSetThreads(unsigned threads);
+
+// Adds the contacts of every intact block of pack to store, in file order,
+// and returns how many blocks were skipped as damaged. In parallel, each
+// worker decodes a contiguous run of blocks into a partial store of its
+// own, with its own indexes, and the parts are merged into store at the end.
+size_t contactLoadPack(ContactStore *store, const ContactPack *pack, const char *filename);
+
+#endif
@@ -2,6 +2,26 @@
 #define CONTACT_MANAGER_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "contact_index.h"
+#include "radix_tree.h"
+#include "contact_bloom.h"
+#include "phone_key.h"
+#include "string_arena.h"
+
+#define CONTACT_SLAB_SIZE 1024
+#define CONTACT_HANDLE_NONE UINT64_MAX
+
+// Optional secondary indexes, see enableContactIndexes
+#define CONTACT_INDEX_PHONE 0x1u
+#define CONTACT_INDEX_EMAIL 0x2u
+
+struct ContactWal;
+struct ContactViews;
+struct ContactHistory;
+struct ContactLazy;
 
 typedef struct {
     char name[50];
@@ -9,17 +29,160 @@ typedef struct {
     char email[50];
 } Contact;
 
-typedef struct ContactNode {
-    Contact contact;
-    struct ContactNode *next;
-} ContactNode;
+// Handles pack a slot number with the slot's generation, so a handle to a
+// deleted contact stays invalid after its slot is reused.
+typedef uint64_t ContactHandle;
+
+// Contact is the exchange format; stores keep each contact as a slot plus a
+// packed record in an arena: name, phone, the email's local part and the
+// name's collation key (contact_collate.h), each as [length][bytes][NUL].
+// Email domains are interned once per store.
+typedef struct {
+    uint32_t record;       // arena reference of the packed strings
+    uint32_t domain;       // interned email domain, 0 if none
+    PhoneKey phoneKey;
+    uint32_t generation;
+    uint32_t nextFree;
+    bool live;
+} ContactSlot;
+
+// One add in insertion order; dead once the handle no longer resolves.
+typedef struct {
+    uint64_t sequence;
+    ContactHandle handle;
+} ContactOrderEntry;
+
+// Contacts live in fixed-size slabs of CONTACT_SLAB_SIZE slots that never
+// move once allocated. Deleted slots are tombstoned and reused through a
+// free list (freeHead/nextFree hold slot + 1, 0 ends the list). A
+// zero-initialized ContactStore is a valid empty store.
+typedef struct ContactStore {
+    ContactSlot **slabs;
+    size_t slabCount;
+    size_t slabCapacity;
+    size_t slotCount;
+    uint32_t freeHead;
+    size_t count;
+    ContactIndex nameIndex;
+    RadixTree nameTree;
+    ContactBloom nameFilter;   // rejects most lookups of absent names
+    unsigned indexFlags;
+    ContactIndex phoneIndex;
+    ContactIndex emailIndex;
+    StringArena records;
+    StringPool domains;
+    ContactOrderEntry *order;  // every add by sequence, dead entries compacted lazily
+    size_t orderCount;
+    size_t orderCapacity;
+    size_t orderDead;
+    uint64_t nextSequence;
+    struct ContactViews *views;  // sorted views, built on first use (contact_view.h)
+    uint64_t version;         // changes committed so far
+    struct ContactHistory *history;  // kept while snapshots are open (contact_version.h)
+    struct ContactTags *tags;  // contact groups, from the first tag on (contact_tags.h)
+    struct ContactLazy *lazy;  // snapshot blocks not faulted in yet (contact_lazy.h)
+    struct ContactWal *wal;   // when set, changes are appended to this log
+} ContactStore;
+
+typedef struct {
+    const ContactStore *store;
+    size_t slot;
+    ContactHandle handle;
+    Contact current;       // unpacked copy returned by contactIteratorNext
+} ContactIterator;
+
+// Return false to stop a search early.
+typedef bool (*ContactVisitor)(const Contact *contact, void *userData);
+
+static inline ContactSlot *contactSlotAt(const ContactStore *store, uint32_t slot) {
+    return &store->slabs[slot / CONTACT_SLAB_SIZE][slot % CONTACT_SLAB_SIZE];
+}
+
+// Bytes taken by a packed record: four [length][bytes][NUL] fields.
+static inline size_t contactRecordLength(const unsigned char *record) {
+    size_t length = 0;
+    for (int field = 0; field < 4; field++) {
+        length += record[length] + 2;
+    }
+    return length;
+}
+
+static inline const char *contactSlotName(const ContactStore *store, uint32_t slot) {
+    return (const char *)stringArenaAt(&store->records, contactSlotAt(store, slot)->record) + 1;
+}
+
+static inline const char *contactSlotPhone(const ContactStore *store, uint32_t slot) {
+    const char *name = contactSlotName(store, slot);
+    return name + (unsigned char)name[-1] + 2;
+}
+
+// Local part of the slot's email; *domain is its interned domain or NULL.
+static inline const char *contactSlotEmail(const ContactStore *store, uint32_t slot, const char **domain) {
+    const char *phone = contactSlotPhone(store, slot);
+    *domain = stringPoolGet(&store->domains, contactSlotAt(store, slot)->domain);
+    return phone + (unsigned char)phone[-1] + 2;
+}
+
+// The name folded for case- and accent-insensitive matching and ordering,
+// computed when the contact was stored
+static inline const char *contactSlotCollation(const ContactStore *store, uint32_t slot) {
+    const char *domain;
+    const char *local = contactSlotEmail(store, slot, &domain);
+    return local + (unsigned char)local[-1] + 2;
+}
+
+static inline bool contactSlotEmailEquals(const ContactStore *store, uint32_t slot, const char *email) {
+    const char *domain;
+    const char *local = contactSlotEmail(store, slot, &domain);
+    size_t length = (unsigned char)local[-1];
+    if (strncmp(local, email, length) != 0) {
+        return false;
+    }
+    return domain != NULL ? email[length] == '@' && strcmp(email + length + 1, domain) == 0
+                          : email[length] == '\0';
+}
+
+ContactHandle addContact(ContactStore *store, const Contact *contact);
+// Batch forms: return how many contacts were added or deleted. handles may
+// be NULL; otherwise it receives one handle per contact.
+size_t addContacts(ContactStore *store, const Contact *contacts, size_t count, ContactHandle *handles);
+size_t deleteContacts(ContactStore *store, const char *const *names, size_t count);
+bool reserveContacts(ContactStore *store, size_t capacity);
+bool findContact(const ContactStore *store, const char *name, Contact *out);
+ContactHandle findContactHandle(const ContactStore *store, const char *name);
+// The contact updateContact and deleteContact would change for name: the
+// exact name, else the one contact matching it ignoring case and accents.
+// Contacts not faulted in yet are only matched exactly.
+bool matchContact(const ContactStore *store, const char *name, Contact *out);
+bool enableContactIndexes(ContactStore *store, unsigned flags);
+bool findByPhone(const ContactStore *store, const char *phone, Contact *out);
+bool findByEmail(const ContactStore *store, const char *email, Contact *out);
+PhoneKey contactPhoneKey(const ContactStore *store, ContactHandle handle);
+bool getContact(const ContactStore *store, ContactHandle handle, Contact *out);
+size_t searchContactsByPrefix(const ContactStore *store, const char *prefix, size_t limit,
+                              ContactVisitor visitor, void *userData);
+size_t searchContactsByRange(const ContactStore *store, const char *from, const char *to, size_t limit,
+                             ContactVisitor visitor, void *userData);
+void displayContacts(const ContactStore *store);
+// Prints contacts as numbered cards, the first one numbered firstNumber.
+void displayContactCards(const Contact *contacts, size_t count, size_t firstNumber);
+bool updateContact(ContactStore *store, const char *name, const Contact *newContact);
+bool deleteContact(ContactStore *store, const char *name);
+void saveContacts(const ContactStore *store, const char *filename);
+void loadContacts(ContactStore *store, const char *filename);
+void freeContacts(ContactStore *store);
+bool copyContacts(ContactStore *dest, const ContactStore *src);
+// Replaces the contacts of store with a copy of src's, keeping store's log
+// and secondary indexes. The replacement is not logged; whoever owns the log
+// checkpoints after it.
+bool replaceContacts(ContactStore *store, const ContactStore *src);
+// Moves the contacts of parts, in order, into store, which must not have
+// held any yet. The parts must keep the secondary indexes store does, and
+// are left empty; on failure so is store.
+bool contactStoreMerge(ContactStore *store, ContactStore *parts, size_t count);
+size_t contactStoreBytes(const ContactStore *store);
 
-void addContact(ContactNode **head, const Contact *contact);
-void displayContacts(const ContactNode *head);
-bool updateContact(ContactNode *head, const char *name, const Contact *newContact);
-bool deleteContact(ContactNode **head, const char *name);
-void saveContacts(const ContactNode *head, const char *filename);
-void loadContacts(ContactNode **head, const char *filename);
-void freeContacts(ContactNode **head);
+void contactIteratorInit(ContactIterator *it, const ContactStore *store);
+const Contact *contactIteratorNext(ContactIterator *it);
 
-#endif
\ No newline at end of file
+#endif
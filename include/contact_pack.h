@@ -0,0 +1,88 @@
+#ifndef CONTACT_PACK_H
+#define CONTACT_PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+#include "contact_db.h"
+
+#define CONTACT_PACK_MAGIC "ECHOPACK"
+#define CONTACT_PACK_VERSION 1
+#define CONTACT_PACK_BLOCK_RECORDS 512
+
+// Compressed snapshot. Contacts are sorted by name and split into blocks of
+// up to CONTACT_PACK_BLOCK_RECORDS, each checksummed and decodable on its
+// own. Inside a block:
+//   name   [shared prefix with the previous name][suffix length][suffix]
+//   phone  [tag] then, for phones of 1-19 digits with an optional '+', the
+//          zigzag varint difference from the block's previous such phone;
+//          otherwise the raw bytes. tag = length << 2 | plus << 1 | numeric
+//   email  [domain id][local part length][local part]
+// Integers are LEB128 varints. Domain ids index a dictionary written once
+// per file, most frequent first so common domains take one byte; 0 means
+// the email has no domain. Fixed-size fields are in host byte order.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockRecords;
+    uint64_t recordCount;
+    uint64_t blockCount;
+    uint64_t walSequence;       // last write-ahead log record folded into this file
+    uint64_t dictionaryOffset;  // domains as [length][bytes]
+    uint64_t dictionarySize;
+    uint64_t indexOffset;       // blockCount ContactPackBlock entries
+    uint32_t domainCount;
+    uint32_t dictionaryChecksum;
+    uint32_t indexChecksum;
+    uint32_t headerChecksum;
+} ContactPackHeader;
+
+typedef struct {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t recordCount;
+    uint32_t checksum;
+    uint32_t reserved;
+} ContactPackBlock;
+
+typedef struct {
+    const char *string;    // in the mapped file, not NUL-terminated
+    uint32_t length;
+} ContactPackDomain;
+
+// Read-only view of a packed snapshot mapped into memory.
+typedef struct {
+    int fd;
+    const unsigned char *map;
+    size_t mapSize;
+    const ContactPackHeader *header;
+    const ContactPackBlock *blocks;
+    ContactPackDomain *domains;
+    size_t domainCount;
+} ContactPack;
+
+// CONTACT_DB_LEGACY when the file is not a packed snapshot.
+ContactDbStatus contactPackOpen(ContactPack *pack, const char *filename);
+size_t contactPackCount(const ContactPack *pack);
+bool contactPackVerifyBlock(const ContactPack *pack, size_t block);
+// Decodes a block into out, which has room for blockRecords contacts.
+// False when the block is damaged.
+bool contactPackDecodeBlock(const ContactPack *pack, size_t block, Contact *out, size_t *count);
+// Looks name up in one block, decoding only up to where it would be.
+// False when it is not there or the block is damaged.
+bool contactPackFindInBlock(const ContactPack *pack, size_t block, const char *name, Contact *out);
+// The block's first name, read without verifying the rest of the block;
+// empty for an empty block. False when it cannot be read.
+bool contactPackFirstName(const ContactPack *pack, size_t block, char *name, size_t size);
+void contactPackClose(ContactPack *pack);
+
+// Both also write the tag sidecar (contact_tags.h), or remove a stale one.
+bool contactPackWrite(const ContactStore *store, const char *filename, uint64_t walSequence, size_t *written);
+// records[i] was copied from slot slots[i] of the store tags belong to;
+// slots may be NULL when tags is NULL.
+bool contactPackWriteRecords(const Contact *records, const uint32_t *slots, size_t count,
+                             const struct ContactTags *tags, const char *filename,
+                             uint64_t walSequence, size_t *written);
+
+#endif
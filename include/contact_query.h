@@ -0,0 +1,87 @@
+#ifndef CONTACT_QUERY_H
+#define CONTACT_QUERY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+
+#define CONTACT_QUERY_MAX_PREDICATES 8
+#define CONTACT_COLUMN_PADDING 64   // readable bytes past the end of every column
+
+typedef enum {
+    CONTACT_FIELD_NAME,
+    CONTACT_FIELD_PHONE,
+    CONTACT_FIELD_EMAIL,
+    CONTACT_FIELD_COUNT
+} ContactField;
+
+typedef enum {
+    CONTACT_MATCH_EQUALS,
+    CONTACT_MATCH_PREFIX,
+    CONTACT_MATCH_CONTAINS,
+    CONTACT_MATCH_DOMAIN     // email domain, ignoring case; the field is ignored
+} ContactMatch;
+
+// Byte comparisons are exact (case-sensitive); values are copied on compile.
+typedef struct {
+    ContactField field;
+    ContactMatch match;
+    const char *value;
+} ContactPredicate;
+
+typedef enum {
+    CONTACT_SIMD_SCALAR,
+    CONTACT_SIMD_SSE2,
+    CONTACT_SIMD_AVX2
+} ContactSimd;
+
+// One field of every row: values back to back, each NUL-terminated, with
+// their offsets and lengths in row order.
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    uint32_t *offsets;
+    uint8_t *lengths;
+} ContactColumn;
+
+// Column-wise copy of a store for filter scans. Rows are the live contacts
+// in slot order; the copy does not follow later changes to the store.
+typedef struct {
+    size_t rows;
+    ContactHandle *handles;
+    ContactColumn columns[CONTACT_FIELD_COUNT];
+    uint32_t *domains;        // email domain id per row, 0 if none
+    StringPool domainNames;   // domain ids as in the store
+} ContactColumns;
+
+typedef struct {
+    ContactField field;
+    ContactMatch match;
+    char value[64];
+    size_t length;
+} ContactQueryStep;
+
+// Predicates are ANDed. Compiling orders them cheapest first (domain ids,
+// then equals, prefix, contains) so each scan only checks rows every
+// earlier step kept.
+typedef struct {
+    ContactQueryStep steps[CONTACT_QUERY_MAX_PREDICATES];
+    size_t count;
+    bool empty;    // a value longer than its field can never match
+} ContactQuery;
+
+// Picks the instruction set for scans; the level is capped at what the CPU
+// supports and the one in effect is returned. The default is the best.
+ContactSimd contactQuerySetSimd(ContactSimd level);
+
+bool contactColumnsBuild(ContactColumns *columns, const ContactStore *store);
+void contactColumnsFree(ContactColumns *columns);
+size_t contactColumnsBytes(const ContactColumns *columns);
+
+bool contactQueryCompile(ContactQuery *query, const ContactPredicate *predicates, size_t count);
+// Rows matching every predicate. Writes up to limit handles to out (which
+// may be NULL) and returns the total number of matches.
+size_t contactQueryRun(const ContactColumns *columns, const ContactQuery *query, ContactHandle *out, size_t limit);
+
+#endif
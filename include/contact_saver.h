@@ -0,0 +1,76 @@
+#ifndef CONTACT_SAVER_H
+#define CONTACT_SAVER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+#include "contact_shared.h"
+
+typedef struct {
+    const char *filename;
+    bool ok;
+    size_t count;
+    uint64_t walSequence;
+    double captureMs;   // time the caller spent copying the store
+    double writeMs;     // time the writer thread spent on the file
+    double totalMs;     // request to completion, including queueing
+} ContactSaveResult;
+
+// Runs on the writer thread once a save has finished or failed.
+typedef void (*ContactSaveCallback)(const ContactSaveResult *result, void *userData);
+
+typedef struct {
+    size_t saves;
+    size_t failures;
+    double lastMs;
+    double maxMs;
+    double totalMs;
+    double lastCaptureMs;
+    double maxCaptureMs;
+} ContactSaveStats;
+
+typedef struct {
+    Contact *records;
+    uint32_t *slots;     // slot each record was copied from
+    size_t count;
+    size_t capacity;
+    ContactTags tags;    // as of the copy, keyed by slot
+    uint64_t walSequence;
+    char filename[256];
+    ContactSaveCallback callback;
+    void *userData;
+    double requestedAt;
+    double captureMs;
+} ContactSaveJob;
+
+// Background snapshot writer. saveContactsAsync copies the live contacts
+// into one of two buffers on the calling thread and hands it to the writer,
+// so the store can keep changing while the file is written. A second save
+// fills the other buffer; a third waits until the writer picks up the
+// queued one. saveSharedContactsAsync copies a shared store as of a
+// snapshot, so writers are not held off while the copy is made either.
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+    ContactSaveJob jobs[2];
+    int queued;    // job index waiting for the writer, -1 if none
+    int writing;   // job index being written, -1 if none
+    bool stopping;
+    bool started;
+    ContactSaveStats stats;
+} ContactSaver;
+
+bool contactSaverStart(ContactSaver *saver);
+bool saveContactsAsync(ContactSaver *saver, const ContactStore *store, const char *filename,
+                       ContactSaveCallback callback, void *userData);
+bool saveSharedContactsAsync(ContactSaver *saver, ContactShared *shared, const char *filename,
+                             ContactSaveCallback callback, void *userData);
+void contactSaverWait(ContactSaver *saver);
+void contactSaverStats(ContactSaver *saver, ContactSaveStats *stats);
+void contactSaverStop(ContactSaver *saver);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef CONTACT_SHARDS_H
+#define CONTACT_SHARDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "contact_manager.h"
+#include "contact_shared.h"
+
+#define CONTACT_SHARD_COUNT 16
+
+// Contacts spread over independent shared stores by a hash of the name, so
+// writers to different shards never wait for each other. Each shard has its
+// own writer lock, indexes and lock-free readers. Sharded stores are not
+// attached to a write-ahead log; they are persisted with contactShardsSave.
+typedef struct {
+    ContactShared *shards;
+    const ContactStore **locked;   // per-shard view while all shards are locked
+    size_t count;
+} ContactShards;
+
+// Walks every shard in turn; only valid between contactShardsLockAll and
+// contactShardsUnlockAll, which makes the walk a consistent snapshot.
+typedef struct {
+    const ContactShards *store;
+    size_t shard;
+    ContactIterator it;
+} ContactShardsIterator;
+
+bool contactShardsInit(ContactShards *store, size_t shardCount);
+void contactShardsFree(ContactShards *store);
+// Names matching ignoring case and accents share a shard.
+size_t contactShardFor(const ContactShards *store, const char *name);
+
+bool contactShardsAdd(ContactShards *store, const Contact *contact);
+bool contactShardsUpdate(ContactShards *store, const char *name, const Contact *newContact);
+bool contactShardsDelete(ContactShards *store, const char *name);
+bool contactShardsFind(ContactShards *store, const char *name, Contact *out);
+size_t contactShardsCount(ContactShards *store);
+
+// Excludes writers on every shard, taking the locks in shard order.
+void contactShardsLockAll(ContactShards *store);
+void contactShardsUnlockAll(ContactShards *store);
+void contactShardsIteratorInit(ContactShardsIterator *it, const ContactShards *store);
+const Contact *contactShardsIteratorNext(ContactShardsIterator *it);
+
+bool contactShardsSave(ContactShards *store, const char *filename, size_t *written);
+bool contactShardsLoad(ContactShards *store, const char *filename, size_t *loaded);
+
+#endif
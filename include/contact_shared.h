@@ -0,0 +1,96 @@
+#ifndef CONTACT_SHARED_H
+#define CONTACT_SHARED_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "contact_manager.h"
+#include "contact_version.h"
+#include "contact_tags.h"
+
+#define CONTACT_READER_STRIPES 64
+#define CONTACT_SHARED_SCAN_CHUNK 1024   // slots per read section
+
+// One cache line per stripe so readers on different cores do not contend
+typedef struct {
+    _Alignas(64) atomic_long readers;
+} ContactReaderStripe;
+
+// A contact store shared between one writer at a time and any number of
+// readers that never lock or wait (left-right). Two copies of the store are
+// kept: readers are directed to one while the writer changes the other,
+// then the copies swap roles and the writer waits for readers still on the
+// old copy to leave before applying the same change to it. Readers always
+// see a complete store, and nothing they can reach is modified or freed
+// while they hold it.
+typedef struct {
+    ContactStore stores[2];
+    atomic_int active;         // copy new readers are directed to
+    atomic_int version;        // read indicator new readers arrive on
+    ContactReaderStripe indicators[2][CONTACT_READER_STRIPES];
+    pthread_mutex_t writeLock;
+    size_t writes;
+} ContactShared;
+
+typedef struct {
+    int version;
+    unsigned stripe;
+} ContactReadToken;
+
+// Changes a store; must behave the same when repeated on an identical copy.
+typedef bool (*ContactWriteFn)(ContactStore *store, void *arg);
+
+void contactSharedInit(ContactShared *shared);
+void contactSharedFree(ContactShared *shared);
+
+// The returned store stays unchanged until contactReadEnd.
+const ContactStore *contactReadBegin(ContactShared *shared, ContactReadToken *token);
+void contactReadEnd(ContactShared *shared, const ContactReadToken *token);
+
+// Applies write to both copies; only the first application is logged.
+bool contactSharedWrite(ContactShared *shared, ContactWriteFn write, void *arg);
+// Applies write once and copies the result, for bulk changes (loading,
+// importing) that are expensive or not repeatable.
+bool contactSharedReplace(ContactShared *shared, ContactWriteFn write, void *arg);
+
+// Excludes writers (not readers) while the store is saved or its log
+// maintained, or while several writes must land together.
+const ContactStore *contactSharedLock(ContactShared *shared);
+void contactSharedUnlock(ContactShared *shared);
+// contactSharedLock for refreshing the sorted views cached on the active
+// copy (contact_view.h). Readers never touch the view cache, so it may be
+// rebuilt while they use the copy; release with contactSharedUnlock.
+ContactStore *contactSharedLockViews(ContactShared *shared);
+// contactSharedWrite for a caller already holding contactSharedLock.
+bool contactSharedWriteLocked(ContactShared *shared, ContactWriteFn write, void *arg);
+
+ContactHandle contactSharedAdd(ContactShared *shared, const Contact *contact);
+bool contactSharedUpdate(ContactShared *shared, const char *name, const Contact *newContact);
+bool contactSharedDelete(ContactShared *shared, const char *name);
+// One write, and one log record, per batch
+size_t contactSharedAddBatch(ContactShared *shared, const Contact *contacts, size_t count, ContactHandle *handles);
+size_t contactSharedDeleteBatch(ContactShared *shared, const char *const *names, size_t count);
+// Tags the contact named name (contact_tags.h); tags are not logged.
+bool contactSharedTag(ContactShared *shared, const char *name, const char *tag);
+bool contactSharedUntag(ContactShared *shared, const char *name, const char *tag);
+bool contactSharedFind(ContactShared *shared, const char *name, Contact *out);
+size_t contactSharedCount(ContactShared *shared);
+// Faults in every contact of a lazily opened store (contact_lazy.h), as a
+// write; readers keep the part loaded so far meanwhile. Called before
+// anything that reads the whole store.
+bool contactSharedLoadAll(ContactShared *shared);
+
+// Snapshots of a shared store (contact_version.h), opened and released as
+// writes. A scan visits the contacts as of the snapshot a chunk of slots
+// per read, so a long scan neither blocks writers nor sees their changes.
+bool contactSharedSnapshot(ContactShared *shared, ContactSnapshot *snapshot);
+// Also copies the tags into tags. Tags are not versioned, so this is the
+// only way to read them as of the snapshot.
+bool contactSharedSnapshotTags(ContactShared *shared, ContactSnapshot *snapshot, ContactTags *tags);
+void contactSharedRelease(ContactShared *shared, const ContactSnapshot *snapshot);
+size_t contactSharedScan(ContactShared *shared, const ContactSnapshot *snapshot, ContactVisitor visitor, void *userData);
+size_t contactSharedScanSlots(ContactShared *shared, const ContactSnapshot *snapshot, ContactSlotVisitor visitor,
+                              void *userData);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef CONTACT_TAGS_H
+#define CONTACT_TAGS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+#include "contact_bitmap.h"
+
+#define CONTACT_TAG_NAME_MAX 32
+#define CONTACT_TAGS_MAGIC "ECHOTAGS"
+#define CONTACT_TAGS_VERSION 1
+
+typedef struct {
+    char name[CONTACT_TAG_NAME_MAX];
+    ContactBitmap members;   // slots of the tagged contacts
+} ContactTag;
+
+// Named groups of contacts, kept on the store from the first tag on. A
+// contact keeps its tags through updates and loses them when deleted.
+// Tags are not logged; they are saved with snapshots, in a sidecar next to
+// the snapshot file (contactTagsPath).
+typedef struct ContactTags {
+    ContactTag *tags;
+    size_t count;
+    size_t capacity;
+} ContactTags;
+
+// Sidecar layout: this header, then per tag [name length][name] and its
+// members as a serialized bitmap of positions in the snapshot's name order.
+// The snapshot's header checksum ties the two files together, so tags are
+// never applied to a snapshot they were not saved with.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t tagCount;
+    uint64_t recordCount;
+    uint32_t packChecksum;
+    uint32_t bodyChecksum;
+    uint64_t bodySize;
+} ContactTagsHeader;
+
+// Creates the tag on first use. False for a stale handle or a name that is
+// empty or too long.
+bool contactTag(ContactStore *store, ContactHandle handle, const char *tag);
+// False when the contact did not have the tag.
+bool contactUntag(ContactStore *store, ContactHandle handle, const char *tag);
+bool contactHasTag(const ContactStore *store, ContactHandle handle, const char *tag);
+// Members of a tag, for the set operations of contact_bitmap.h; NULL for an
+// unknown tag.
+const ContactBitmap *contactTagged(const ContactStore *store, const char *tag);
+size_t contactTagCount(const ContactStore *store, const char *tag);
+bool contactDropTag(ContactStore *store, const char *tag);
+// Visits the contacts whose slots are in members, in slot order; members no
+// longer live are skipped. Returns the number visited.
+size_t contactTagVisit(const ContactStore *store, const ContactBitmap *members, ContactVisitor visitor, void *userData);
+
+// Called by the store when a slot's contact is deleted.
+void contactTagsForget(ContactStore *store, uint32_t slot);
+bool contactTagsCopy(ContactStore *dest, const ContactStore *src);
+void contactTagsFree(ContactStore *store);
+size_t contactTagsBytes(const ContactStore *store);
+
+bool contactTagSetCopy(ContactTags *dest, const ContactTags *src);
+// Adds the tags of src to dest, each member moved up by base, so the tags
+// of several stores can share one numbering. Merging in increasing base
+// order appends.
+bool contactTagSetMerge(ContactTags *dest, const ContactTags *src, uint32_t base);
+void contactTagSetFree(ContactTags *tags);
+
+// Writes the sidecar of the snapshot just written to snapshot, whose header
+// checksum is packChecksum; slots[rank] is the slot of its rank-th contact.
+// Without tags the sidecar is removed instead.
+bool contactTagsSave(const ContactTags *tags, const uint32_t *slots, size_t count,
+                     const char *snapshot, uint32_t packChecksum);
+// Applies the sidecar of a snapshot just loaded into an empty store. False,
+// leaving the store untagged, when there is none or it does not match.
+bool contactTagsLoad(ContactStore *store, const char *snapshot, uint32_t packChecksum);
+// contactTagsLoad in two steps, for stores that take in a snapshot's
+// contacts a part at a time: reads the sidecar into ranks, whose members
+// are positions in the snapshot's name order...
+bool contactTagsRead(const char *snapshot, uint32_t packChecksum, size_t recordCount, ContactTags *ranks);
+// ...then tags slots[i] with the tags of position firstRank + i.
+bool contactTagsApply(ContactStore *store, const ContactTags *ranks, uint32_t firstRank,
+                      const uint32_t *slots, size_t count);
+void contactTagsPath(const char *snapshot, char *path, size_t size);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef CONTACT_VERSION_H
+#define CONTACT_VERSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+
+// A consistent point-in-time view of a store. Every change (an add, update
+// or delete, or a whole batch) commits the next store version; a snapshot
+// sees the contacts as of the version current when it was opened, however
+// the store changes afterwards, until it is closed.
+typedef struct {
+    uint64_t version;
+    size_t count;          // contacts visible at version
+    uint64_t walSequence;  // last logged change included, 0 without a log
+} ContactSnapshot;
+
+// Contents a change replaced or deleted while a snapshot could still see
+// them. Kept in change order; older links the slot's previous kept contents.
+typedef struct {
+    uint64_t begin;     // version that wrote them, 0 if before any snapshot
+    uint64_t end;       // version that replaced or deleted them
+    uint32_t record;
+    uint32_t domain;
+    uint32_t slot;
+    uint32_t older;     // index + 1, 0 ends the chain
+} ContactVersion;
+
+// Version stamp and newest kept contents of a slot written while a
+// snapshot was open. Slots without one were last written before every open
+// snapshot.
+typedef struct {
+    uint32_t ref;       // slot + 1, 0 marks an empty entry
+    uint32_t newest;    // index + 1 into versions, 0 if none kept
+    uint64_t stamp;
+} ContactStamp;
+
+// Multi-version state of a store, allocated by the first open snapshot and
+// freed with the last, so stores without snapshots pay nothing. When the
+// oldest snapshot closes, contents no remaining snapshot can see are
+// collected and their arena space released.
+typedef struct ContactHistory {
+    uint64_t *snapshots;       // open snapshot versions, ascending
+    size_t snapshotCount;
+    size_t snapshotCapacity;
+    ContactVersion *versions;
+    size_t versionCount;
+    size_t versionCapacity;
+    ContactStamp *stamps;      // open addressing on slot
+    size_t stampCount;
+    size_t stampCapacity;
+} ContactHistory;
+
+bool contactSnapshotOpen(ContactStore *store, ContactSnapshot *snapshot);
+void contactSnapshotClose(ContactStore *store, const ContactSnapshot *snapshot);
+
+// Contact named name as of the snapshot; out may be NULL.
+bool contactGetAt(const ContactStore *store, const ContactSnapshot *snapshot, const char *name, Contact *out);
+// Visits the contacts visible at the snapshot in slots [*slot, *slot +
+// slots), in slot order, and moves *slot past them. Returns the number
+// visited; *slot is CONTACT_SLOT_NONE once the scan has covered the store
+// or the visitor stopped it.
+size_t contactScanAt(const ContactStore *store, const ContactSnapshot *snapshot, uint32_t *slot, size_t slots,
+                     ContactVisitor visitor, void *userData);
+// contactScanAt that also passes each contact's slot.
+typedef bool (*ContactSlotVisitor)(uint32_t slot, const Contact *contact, void *userData);
+size_t contactScanSlotsAt(const ContactStore *store, const ContactSnapshot *snapshot, uint32_t *slot, size_t slots,
+                          ContactSlotVisitor visitor, void *userData);
+// Old contents kept for open snapshots.
+size_t contactVersionCount(const ContactStore *store);
+
+// Called by the store for the change being committed (version + 1).
+// Reserve makes room for a change writing slots slots, replaced of which
+// held contents, so it cannot fail half way. Retire keeps contents the
+// change replaces or deletes, returning false when no open snapshot can see
+// them so the caller releases the record; Stamp then records that the
+// change wrote the slot.
+bool contactVersionReserve(ContactStore *store, size_t slots, size_t replaced);
+void contactVersionStamp(ContactStore *store, uint32_t slot);
+bool contactVersionRetire(ContactStore *store, uint32_t slot, uint32_t record, uint32_t domain);
+bool contactHistoryCopy(ContactStore *dest, const ContactStore *src);
+void contactHistoryFree(ContactStore *store);
+size_t contactHistoryBytes(const ContactStore *store);
+
+#endif
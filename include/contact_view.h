@@ -0,0 +1,67 @@
+#ifndef CONTACT_VIEW_H
+#define CONTACT_VIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+
+#define CONTACT_SORT_KEYS 3
+#define CONTACT_SORT_MAX_THREADS 8
+#define CONTACT_SORT_PARALLEL_MIN 32768
+#define CONTACT_VIEW_PREFIX_MAX 32
+
+typedef enum {
+    CONTACT_SORT_NAME,
+    CONTACT_SORT_PHONE,
+    CONTACT_SORT_EMAIL
+} ContactSortKey;
+
+// key holds 8 bytes of the sort field as an integer (the name's collation
+// key or the case-folded email, big-endian, read after the prefix every
+// entry of the view shares; the phone's PhoneKey), so most comparisons are
+// a single integer compare and only ties look at the strings.
+typedef struct {
+    uint64_t key;
+    ContactHandle handle;
+} ContactViewEntry;
+
+typedef struct {
+    ContactViewEntry *entries;
+    size_t count;
+    size_t capacity;
+    size_t seen;          // changes already merged into entries
+    bool built;
+    unsigned char prefix[CONTACT_VIEW_PREFIX_MAX];   // case-folded, skipped by keys
+    size_t prefixLength;
+} ContactView;
+
+// Sorted views are built on first use and kept on the store. Every change
+// after that records the slot it touched; the next read of a view drops the
+// entries for those slots and merges their sorted replacements in, instead
+// of sorting the whole store again.
+typedef struct ContactViews {
+    ContactView views[CONTACT_SORT_KEYS];
+    uint32_t *changes;
+    size_t changeCount;
+    size_t changeCapacity;
+} ContactViews;
+
+// Sets the worker threads used for full sorts (0 = one per CPU, at most
+// CONTACT_SORT_MAX_THREADS). Stores under CONTACT_SORT_PARALLEL_MIN
+// contacts are always sorted on the calling thread.
+void contactSortSetThreads(unsigned threads);
+
+// Every live contact ordered by key (then by the full field, then slot).
+// The view is cached on the store and valid until the store next changes;
+// NULL when the store is empty or the view cannot be allocated.
+const ContactViewEntry *contactSortedView(ContactStore *store, ContactSortKey key, size_t *count);
+// Copies up to limit contacts starting at position offset of a view.
+size_t contactViewPage(ContactStore *store, ContactSortKey key, size_t offset, Contact *out, size_t limit);
+
+// Called by the store on every add, update and delete.
+void contactViewsNoteChange(ContactStore *store, uint32_t slot);
+void contactViewsFree(ContactStore *store);
+size_t contactViewsBytes(const ContactStore *store);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef CONTACT_WAL_H
+#define CONTACT_WAL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "contact_manager.h"
+
+#define CONTACT_WAL_GROUP_SIZE 32            // records per fsync
+#define CONTACT_WAL_GROUP_INTERVAL_MS 100    // max age of an unsynced record
+#define CONTACT_WAL_CHECKPOINT_RECORDS 4096  // log length that triggers a checkpoint
+
+typedef enum {
+    CONTACT_WAL_ADD = 1,
+    CONTACT_WAL_UPDATE,
+    CONTACT_WAL_DELETE,
+    CONTACT_WAL_ADD_BATCH,
+    CONTACT_WAL_DELETE_BATCH
+} ContactWalOp;
+
+// One logged change. key names the contact an update or delete applies to;
+// contact holds the new contents for adds and updates. A batch record is
+// followed by count contacts (adds) or count key-sized names (deletes), and
+// its checksum covers them too.
+typedef struct {
+    uint32_t checksum;   // CRC-32 of everything after this field
+    uint32_t op;
+    uint64_t sequence;
+    char key[50];
+    Contact contact;
+    uint32_t count;      // batch records only; occupies former padding
+} ContactWalRecord;
+
+// Append-only change log layered over a snapshot file. Records are written
+// as they happen and fsync'd in groups; a checkpoint folds the log into the
+// snapshot and truncates it. Once an append fails the log takes no more
+// records, as replaying later ones without it would be wrong, until a
+// checkpoint writes the whole store out.
+typedef struct ContactWal {
+    int fd;
+    char logPath[256];
+    char snapshotPath[256];
+    uint64_t sequence;       // last sequence number written or replayed
+    uint64_t end;            // log offset just past the last whole record
+    bool broken;             // an append or sync failed; a checkpoint repairs it
+    size_t logged;           // changes in the log since the last checkpoint
+    size_t pending;          // records written but not yet fsync'd
+    double pendingSince;
+    size_t groupSize;
+    unsigned groupIntervalMs;
+    size_t checkpointRecords;
+    size_t syncs;
+    size_t checkpoints;
+    pthread_cond_t *flushWake;  // signalled when a record starts waiting for a sync
+} ContactWal;
+
+// Background group commit. The thread runs under lock, which every append to
+// the log must hold, and fsyncs the log once its oldest unsynced record is
+// groupIntervalMs old, so records are not left unsynced while the process
+// sits idle. contactWalRecover starts the log afresh, so a log reopened under
+// a running flusher is handed back to it with contactWalFlusherAttach.
+typedef struct {
+    ContactWal *wal;
+    pthread_mutex_t *lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    bool stopping;
+    bool started;
+} ContactWalFlusher;
+
+bool contactWalRecover(ContactWal *wal, ContactStore *store, const char *snapshotPath, const char *logPath);
+bool contactWalAppend(ContactWal *wal, ContactWalOp op, const char *key, const Contact *contact);
+// Logs a whole batch as one record: contacts for CONTACT_WAL_ADD_BATCH,
+// names for CONTACT_WAL_DELETE_BATCH.
+bool contactWalAppendBatch(ContactWal *wal, ContactWalOp op, const Contact *contacts,
+                           const char *const *names, size_t count);
+bool contactWalSync(ContactWal *wal);
+bool contactWalCheckpoint(ContactWal *wal, const ContactStore *store);
+bool contactWalMaintain(ContactWal *wal, const ContactStore *store);
+void contactWalClose(ContactWal *wal, ContactStore *store);
+
+bool contactWalFlusherStart(ContactWalFlusher *flusher, ContactWal *wal, pthread_mutex_t *lock);
+// Caller holds the flusher's lock
+void contactWalFlusherAttach(ContactWalFlusher *flusher);
+void contactWalFlusherStop(ContactWalFlusher *flusher);
+
+#endif
@@ -5,15 +5,29 @@
 #include <stddef.h>
 
 typedef struct MemoryBlock {
-    size_t size;
+    size_t size;                 // data bytes after the header
     bool free;
+    struct MemoryBlock *prev;    // neighbours in address order, within one arena
     struct MemoryBlock *next;
 } MemoryBlock;
 
+// A region mapped from the OS and carved into blocks. Arenas are mapped as
+// allocations need them, each new one larger up to a cap (or as large as
+// one big allocation), and unmapped once every block in them is free; the
+// first is kept for the life of the process.
+typedef struct MemoryArena {
+    size_t size;                 // bytes mapped, this header included
+    size_t largestFree;          // no free block in the arena is larger
+    MemoryBlock *freeList;       // linked through the free blocks' data
+    struct MemoryArena *next;
+} MemoryArena;
+
 void initializeMemory(void);
 void *myMalloc(size_t size);
 void myFree(void *ptr);
 void visualizeMemory(void);
 void analyzeMemory(size_t *totalFree, size_t *largestBlock, int *fragmentCount);
+// Arenas currently mapped and the bytes they take
+void memoryArenaStats(size_t *arenaCount, size_t *mappedBytes);
 
-#endif
\ No newline at end of file
+#endif
@@ -6,6 +6,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "contact_manager.h"
+#include "contact_shared.h"
 
 typedef struct ClientInfo {
     int socket;
@@ -13,8 +14,8 @@ typedef struct ClientInfo {
     struct ClientInfo *next;
 } ClientInfo;
 
-void startServer(int port);
-bool syncContacts(const char *serverIP, int port, ContactNode **localContacts);
+void startServer(int port, ContactShared *contacts);
+bool syncContacts(const char *serverIP, int port, ContactStore *localContacts);
 void stopServer(void);
 bool isServerRunning(void);
 
@@ -0,0 +1,21 @@
+#ifndef PHONE_KEY_H
+#define PHONE_KEY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PHONE_KEY_NONE 0
+#define PHONE_KEY_MAX_DIGITS 15
+#define PHONE_DEFAULT_COUNTRY_CODE "1"
+#define PHONE_NATIONAL_DIGITS 10
+
+// Canonical E.164 phone number packed into an integer: one nibble per digit
+// (digit + 1), left-aligned from the top nibble, zero-filled after the last
+// digit. Equal numbers get equal keys and integer order matches the digit
+// string's lexicographic order. Unparseable input yields PHONE_KEY_NONE.
+typedef uint64_t PhoneKey;
+
+PhoneKey normalizePhone(const char *phone);
+size_t formatPhoneKey(PhoneKey key, char *out, size_t size);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef RADIX_TREE_H
+#define RADIX_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Compressed radix tree mapping NUL-terminated keys to store slots. Children
+// are kept sorted by their first byte, so traversal yields keys in strcmp
+// order. Duplicate keys keep every slot, in insertion order.
+typedef struct RadixNode {
+    char *label;              // stored just past the node unless it outgrew it
+    struct RadixNode **children;
+    uint32_t *slots;          // only used once a node holds more than one slot
+    uint32_t slot;            // the slot while slotCapacity is at most 1
+    uint32_t labelLen;
+    uint32_t childCount;
+    uint32_t childCapacity;
+    uint32_t slotCount;
+    uint32_t slotCapacity;
+} RadixNode;
+
+// A zero-initialized RadixTree is a valid empty tree.
+typedef struct {
+    RadixNode root;
+    size_t count;
+} RadixTree;
+
+// Return false to stop the traversal.
+typedef bool (*RadixVisitor)(uint32_t slot, void *userData);
+
+bool radixTreeInsert(RadixTree *tree, const char *key, uint32_t slot);
+bool radixTreeRemove(RadixTree *tree, const char *key, uint32_t slot);
+void radixTreeVisitPrefix(const RadixTree *tree, const char *prefix, RadixVisitor visitor, void *userData);
+void radixTreeVisitRange(const RadixTree *tree, const char *from, const char *to, RadixVisitor visitor, void *userData);
+bool radixTreeCopy(RadixTree *dest, const RadixTree *src);
+// Moves every key of src into dest with its slots moved up by offset,
+// relinking src's nodes rather than copying them; src is left empty. Cheapest
+// when src's keys sort after dest's. On failure dest keeps part of src.
+bool radixTreeMerge(RadixTree *dest, RadixTree *src, uint32_t offset);
+void radixTreeFree(RadixTree *tree);
+
+#endif
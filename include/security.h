@@ -2,10 +2,12 @@
 #define SECURITY_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #define ENCRYPTION_KEY "echonull_secure_key_2024"
 
 void encryptData(const char *input, char *output, size_t length);
 void decryptData(const char *input, char *output, size_t length);
+uint32_t checksumData(uint32_t crc, const void *data, size_t length);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STRING_ARENA_CHUNK_SIZE (16 * 1024)
+#define STRING_REF_NONE UINT32_MAX
+#define STRING_MAX_LENGTH 255
+
+// Bump allocator over fixed-size chunks. Allocations are addressed by a
+// 32-bit reference (chunk * STRING_ARENA_CHUNK_SIZE + offset) and never
+// straddle chunks. Released space is only counted; owners reclaim it by
+// copying live data into a fresh arena. A zeroed arena is empty.
+typedef struct {
+    unsigned char **chunks;
+    size_t chunkCount;
+    size_t chunkCapacity;
+    size_t used;           // bytes used in the last chunk
+    size_t liveBytes;
+    size_t garbageBytes;
+} StringArena;
+
+// Interned strings, each stored once as [length][bytes][NUL] and numbered
+// from 1 (0 means none). A zeroed pool is empty.
+typedef struct {
+    StringArena arena;
+    uint32_t *refs;        // id - 1 -> arena reference
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *table;       // open-addressing hash of ids, 0 marks empty
+    size_t tableCapacity;
+} StringPool;
+
+static inline unsigned char *stringArenaAt(const StringArena *arena, uint32_t ref) {
+    return arena->chunks[ref / STRING_ARENA_CHUNK_SIZE] + ref % STRING_ARENA_CHUNK_SIZE;
+}
+
+uint32_t stringArenaAlloc(StringArena *arena, size_t size);
+void stringArenaRelease(StringArena *arena, size_t size);
+size_t stringArenaCapacity(const StringArena *arena);
+bool stringArenaCopy(StringArena *dest, const StringArena *src);
+// Moves src's chunks after dest's, leaving src empty. Returns what to add to
+// src's references to address the same bytes in dest, STRING_REF_NONE on failure.
+uint32_t stringArenaAppend(StringArena *dest, StringArena *src);
+void stringArenaFree(StringArena *arena);
+
+uint32_t stringPoolIntern(StringPool *pool, const char *string, size_t length);
+uint32_t stringPoolFind(const StringPool *pool, const char *string, size_t length);
+const char *stringPoolGet(const StringPool *pool, uint32_t id);
+size_t stringPoolBytes(const StringPool *pool);
+bool stringPoolCopy(StringPool *dest, const StringPool *src);
+void stringPoolFree(StringPool *pool);
+
+#endif
@@ -61,7 +61,7 @@ echo -e "\n${BLUE}🧪 Step 3: Running Unit Tests${NC}"
 echo "----------------------------------------"
 
 echo "Compiling unit tests..."
-gcc -Wall -Wextra -std=c11 -Iinclude tests/unit_tests.c src/contact_manager.c src/memory_allocator.c src/security.c -o "$TEST_RESULTS_DIR/unit_tests" > /dev/null 2>&1
+gcc -Wall -Wextra -std=c11 -Iinclude tests/unit_tests.c src/contact_manager.c src/contact_index.c src/contact_bloom.c src/radix_tree.c src/phone_key.c src/string_arena.c src/contact_db.c src/contact_pack.c src/contact_load.c src/contact_version.c src/contact_wal.c src/contact_saver.c src/contact_io.c src/contact_shared.c src/contact_shards.c src/contact_cursor.c src/contact_view.c src/contact_dedup.c src/contact_query.c src/contact_bitmap.c src/contact_tags.c src/contact_lazy.c src/contact_collate.c src/memory_allocator.c src/security.c -o "$TEST_RESULTS_DIR/unit_tests" -lpthread > /dev/null 2>&1
 
 if "$TEST_RESULTS_DIR/unit_tests" > "$TEST_RESULTS_DIR/unit_test_results.log" 2>&1; then
     echo -e "${GREEN}✓ Unit tests passed${NC}"
@@ -74,7 +74,7 @@ echo -e "\n${BLUE}🧪 Step 4: Running Comprehensive Test Suite${NC}"
 echo "----------------------------------------"
 
 echo "Compiling comprehensive tests..."
-gcc -Wall -Wextra -std=c11 -Iinclude tests/comprehensive_tests.c src/contact_manager.c src/memory_allocator.c src/security.c src/ui_utils.c src/test_framework.c -o "$TEST_RESULTS_DIR/comprehensive_tests" -lpthread > /dev/null 2>&1
+gcc -Wall -Wextra -std=c11 -Iinclude tests/comprehensive_tests.c src/contact_manager.c src/contact_index.c src/contact_bloom.c src/radix_tree.c src/phone_key.c src/string_arena.c src/contact_db.c src/contact_pack.c src/contact_load.c src/contact_version.c src/contact_wal.c src/contact_saver.c src/contact_io.c src/contact_shared.c src/contact_shards.c src/contact_cursor.c src/contact_view.c src/contact_dedup.c src/contact_query.c src/contact_bitmap.c src/contact_tags.c src/contact_lazy.c src/contact_collate.c src/memory_allocator.c src/security.c src/ui_utils.c src/test_framework.c -o "$TEST_RESULTS_DIR/comprehensive_tests" -lpthread > /dev/null 2>&1
 
 if "$TEST_RESULTS_DIR/comprehensive_tests" > "$TEST_RESULTS_DIR/comprehensive_test_results.log" 2>&1; then
     echo -e "${GREEN}✓ Comprehensive tests passed${NC}"
@@ -104,13 +104,30 @@ echo "Running performance benchmarks..."
 # Create a simple performance test
 cat > "$TEST_RESULTS_DIR/perf_test.c" << 'EOF'
 #include "../src/contact_manager.c"
+#include "../src/contact_index.c"
+#include "../src/contact_bloom.c"
+#include "../src/radix_tree.c"
+#include "../src/phone_key.c"
+#include "../src/string_arena.c"
+#include "../src/contact_db.c"
+#include "../src/contact_pack.c"
+#include "../src/contact_load.c"
+#include "../src/contact_version.c"
+#include "../src/contact_wal.c"
+#include "../src/contact_view.c"
+#include "../src/contact_bitmap.c"
+#include "../src/contact_tags.c"
+#include "../src/contact_lazy.c"
+#include "../src/contact_collate.c"
+#include "../src/security.c"
+#include "../src/ui_utils.c"
 #include "../src/memory_allocator.c"
 #include <stdio.h>
 #include <time.h>
 
 int main() {
     initializeMemory();
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
 
     clock_t start = clock();
     for (int i = 0; i < 1000; i++) {
@@ -128,7 +145,7 @@ int main() {
 }
 EOF
 
-gcc -Iinclude "$TEST_RESULTS_DIR/perf_test.c" -o "$TEST_RESULTS_DIR/perf_test" > /dev/null 2>&1
+gcc -Iinclude "$TEST_RESULTS_DIR/perf_test.c" -o "$TEST_RESULTS_DIR/perf_test" -lpthread > /dev/null 2>&1
 "$TEST_RESULTS_DIR/perf_test" > "$TEST_RESULTS_DIR/performance_results.log" 2>&1
 
 # Step 7: Memory Analysis
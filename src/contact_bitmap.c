@@ -0,0 +1,674 @@
+#include "../include/contact_bitmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONTAINER_HEADER_BYTES (2 * sizeof(uint32_t))   // [key][cardinality]
+
+// Index of the first value >= low
+static uint32_t lowerBound(const uint16_t *values, uint32_t count, uint16_t low) {
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (values[mid] < low) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static uint32_t popcountWords(const uint64_t *words) {
+    uint32_t count = 0;
+    for (int i = 0; i < CONTACT_BITMAP_WORDS; i++) {
+        count += (uint32_t)__builtin_popcountll(words[i]);
+    }
+    return count;
+}
+
+static bool containerContains(const ContactContainer *c, uint16_t low) {
+    if (c->words != NULL) {
+        return (c->words[low >> 6] >> (low & 63)) & 1;
+    }
+    uint32_t i = lowerBound(c->values, c->cardinality, low);
+    return i < c->cardinality && c->values[i] == low;
+}
+
+static void freeContainer(ContactContainer *c) {
+    free(c->values);
+    free(c->words);
+    memset(c, 0, sizeof(*c));
+}
+
+static bool toWords(ContactContainer *c) {
+    uint64_t *words = (uint64_t *)calloc(CONTACT_BITMAP_WORDS, sizeof(uint64_t));
+    if (words == NULL) {
+        perror("Failed to allocate bitmap container");
+        return false;
+    }
+    for (uint32_t i = 0; i < c->cardinality; i++) {
+        words[c->values[i] >> 6] |= 1ULL << (c->values[i] & 63);
+    }
+    free(c->values);
+    c->values = NULL;
+    c->capacity = 0;
+    c->words = words;
+    return true;
+}
+
+static bool toArray(ContactContainer *c) {
+    uint16_t *values = (uint16_t *)malloc((c->cardinality ? c->cardinality : 1) * sizeof(uint16_t));
+    if (values == NULL) {
+        perror("Failed to allocate bitmap container");
+        return false;
+    }
+    uint32_t n = 0;
+    for (int i = 0; i < CONTACT_BITMAP_WORDS; i++) {
+        for (uint64_t word = c->words[i]; word != 0; word &= word - 1) {
+            values[n++] = (uint16_t)(i * 64 + __builtin_ctzll(word));
+        }
+    }
+    free(c->words);
+    c->words = NULL;
+    c->values = values;
+    c->capacity = c->cardinality ? c->cardinality : 1;
+    return true;
+}
+
+// Words exactly when there are more values than an array holds
+static bool normalizeContainer(ContactContainer *c) {
+    if (c->words != NULL && c->cardinality <= CONTACT_BITMAP_ARRAY_MAX) {
+        return toArray(c);
+    }
+    if (c->words == NULL && c->cardinality > CONTACT_BITMAP_ARRAY_MAX) {
+        return toWords(c);
+    }
+    return true;
+}
+
+static bool containerAdd(ContactContainer *c, uint16_t low) {
+    if (c->words == NULL) {
+        uint32_t i = c->cardinality > 0 && c->values[c->cardinality - 1] < low
+                         ? c->cardinality
+                         : lowerBound(c->values, c->cardinality, low);
+        if (i < c->cardinality && c->values[i] == low) {
+            return true;
+        }
+        if (c->cardinality < CONTACT_BITMAP_ARRAY_MAX) {
+            if (c->cardinality == c->capacity) {
+                uint32_t capacity = c->capacity ? c->capacity * 2 : 4;
+                if (capacity > CONTACT_BITMAP_ARRAY_MAX) {
+                    capacity = CONTACT_BITMAP_ARRAY_MAX;
+                }
+                uint16_t *values = (uint16_t *)realloc(c->values, capacity * sizeof(uint16_t));
+                if (values == NULL) {
+                    perror("Failed to grow bitmap container");
+                    return false;
+                }
+                c->values = values;
+                c->capacity = capacity;
+            }
+            memmove(&c->values[i + 1], &c->values[i], (c->cardinality - i) * sizeof(uint16_t));
+            c->values[i] = low;
+            c->cardinality++;
+            return true;
+        }
+        if (!toWords(c)) {
+            return false;
+        }
+    }
+    uint64_t bit = 1ULL << (low & 63);
+    if (!(c->words[low >> 6] & bit)) {
+        c->words[low >> 6] |= bit;
+        c->cardinality++;
+    }
+    return true;
+}
+
+static bool containerRemove(ContactContainer *c, uint16_t low) {
+    if (c->words != NULL) {
+        uint64_t bit = 1ULL << (low & 63);
+        if (!(c->words[low >> 6] & bit)) {
+            return false;
+        }
+        c->words[low >> 6] &= ~bit;
+        c->cardinality--;
+        // Staying in words is still correct if the array cannot be allocated
+        normalizeContainer(c);
+        return true;
+    }
+    uint32_t i = lowerBound(c->values, c->cardinality, low);
+    if (i >= c->cardinality || c->values[i] != low) {
+        return false;
+    }
+    memmove(&c->values[i], &c->values[i + 1], (c->cardinality - i - 1) * sizeof(uint16_t));
+    c->cardinality--;
+    return true;
+}
+
+static bool copyContainer(ContactContainer *dest, const ContactContainer *src) {
+    *dest = *src;
+    if (src->words != NULL) {
+        dest->words = (uint64_t *)malloc(CONTACT_BITMAP_WORDS * sizeof(uint64_t));
+        if (dest->words != NULL) {
+            memcpy(dest->words, src->words, CONTACT_BITMAP_WORDS * sizeof(uint64_t));
+            return true;
+        }
+    } else {
+        dest->capacity = src->cardinality;
+        dest->values = (uint16_t *)malloc(dest->capacity * sizeof(uint16_t));
+        if (dest->values != NULL) {
+            memcpy(dest->values, src->values, src->cardinality * sizeof(uint16_t));
+            return true;
+        }
+    }
+    perror("Failed to copy bitmap container");
+    memset(dest, 0, sizeof(*dest));
+    return false;
+}
+
+// Index of key's container, or -1 with *position where it would go
+static long findContainer(const ContactBitmap *bitmap, uint16_t key, size_t *position) {
+    size_t lo = 0, hi = bitmap->count;
+    // Values often arrive in order, so try the last container first
+    if (hi > 0 && bitmap->containers[hi - 1].key <= key) {
+        lo = hi - 1;
+    }
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (bitmap->containers[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *position = lo;
+    return lo < bitmap->count && bitmap->containers[lo].key == key ? (long)lo : -1;
+}
+
+static bool reserveContainers(ContactBitmap *bitmap, size_t count) {
+    if (count <= bitmap->capacity) {
+        return true;
+    }
+    size_t capacity = bitmap->capacity ? bitmap->capacity * 2 : 4;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    ContactContainer *containers = (ContactContainer *)realloc(bitmap->containers, capacity * sizeof(ContactContainer));
+    if (containers == NULL) {
+        perror("Failed to grow bitmap");
+        return false;
+    }
+    bitmap->containers = containers;
+    bitmap->capacity = capacity;
+    return true;
+}
+
+// Takes c over, dropping it if empty; keys must arrive in ascending order
+static bool appendContainer(ContactBitmap *bitmap, ContactContainer *c) {
+    if (c->cardinality == 0) {
+        freeContainer(c);
+        return true;
+    }
+    if (!normalizeContainer(c) || !reserveContainers(bitmap, bitmap->count + 1)) {
+        freeContainer(c);
+        return false;
+    }
+    bitmap->containers[bitmap->count++] = *c;
+    return true;
+}
+
+bool contactBitmapAdd(ContactBitmap *bitmap, uint32_t value) {
+    uint16_t key = (uint16_t)(value >> 16);
+    size_t position;
+    long index = findContainer(bitmap, key, &position);
+    if (index < 0) {
+        if (!reserveContainers(bitmap, bitmap->count + 1)) {
+            return false;
+        }
+        memmove(&bitmap->containers[position + 1], &bitmap->containers[position],
+                (bitmap->count - position) * sizeof(ContactContainer));
+        memset(&bitmap->containers[position], 0, sizeof(ContactContainer));
+        bitmap->containers[position].key = key;
+        bitmap->count++;
+        index = (long)position;
+    }
+    ContactContainer *c = &bitmap->containers[index];
+    if (!containerAdd(c, (uint16_t)value)) {
+        if (c->cardinality == 0) {
+            freeContainer(c);
+            memmove(c, c + 1, (bitmap->count - (size_t)index - 1) * sizeof(ContactContainer));
+            bitmap->count--;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool contactBitmapRemove(ContactBitmap *bitmap, uint32_t value) {
+    size_t position;
+    long index = findContainer(bitmap, (uint16_t)(value >> 16), &position);
+    if (index < 0) {
+        return false;
+    }
+    ContactContainer *c = &bitmap->containers[index];
+    if (!containerRemove(c, (uint16_t)value)) {
+        return false;
+    }
+    if (c->cardinality == 0) {
+        freeContainer(c);
+        memmove(c, c + 1, (bitmap->count - (size_t)index - 1) * sizeof(ContactContainer));
+        bitmap->count--;
+    }
+    return true;
+}
+
+bool contactBitmapContains(const ContactBitmap *bitmap, uint32_t value) {
+    size_t position;
+    long index = findContainer(bitmap, (uint16_t)(value >> 16), &position);
+    return index >= 0 && containerContains(&bitmap->containers[index], (uint16_t)value);
+}
+
+size_t contactBitmapCount(const ContactBitmap *bitmap) {
+    size_t count = 0;
+    for (size_t i = 0; i < bitmap->count; i++) {
+        count += bitmap->containers[i].cardinality;
+    }
+    return count;
+}
+
+void contactBitmapClear(ContactBitmap *bitmap) {
+    for (size_t i = 0; i < bitmap->count; i++) {
+        freeContainer(&bitmap->containers[i]);
+    }
+    bitmap->count = 0;
+}
+
+void contactBitmapFree(ContactBitmap *bitmap) {
+    contactBitmapClear(bitmap);
+    free(bitmap->containers);
+    memset(bitmap, 0, sizeof(*bitmap));
+}
+
+bool contactBitmapCopy(ContactBitmap *dest, const ContactBitmap *src) {
+    contactBitmapClear(dest);
+    if (!reserveContainers(dest, src->count)) {
+        return false;
+    }
+    for (size_t i = 0; i < src->count; i++) {
+        if (!copyContainer(&dest->containers[i], &src->containers[i])) {
+            contactBitmapClear(dest);
+            return false;
+        }
+        dest->count++;
+    }
+    return true;
+}
+
+size_t contactBitmapBytes(const ContactBitmap *bitmap) {
+    size_t bytes = bitmap->capacity * sizeof(ContactContainer);
+    for (size_t i = 0; i < bitmap->count; i++) {
+        const ContactContainer *c = &bitmap->containers[i];
+        bytes += c->words != NULL ? CONTACT_BITMAP_WORDS * sizeof(uint64_t) : c->capacity * sizeof(uint16_t);
+    }
+    return bytes;
+}
+
+static bool allocValues(ContactContainer *c, uint16_t key, uint32_t capacity) {
+    memset(c, 0, sizeof(*c));
+    c->key = key;
+    c->capacity = capacity ? capacity : 1;
+    c->values = (uint16_t *)malloc(c->capacity * sizeof(uint16_t));
+    if (c->values == NULL) {
+        perror("Failed to allocate bitmap container");
+        return false;
+    }
+    return true;
+}
+
+// Words holding x's members, for or-ing or clearing others into
+static bool wordsOf(ContactContainer *c, const ContactContainer *x) {
+    memset(c, 0, sizeof(*c));
+    c->key = x->key;
+    c->words = (uint64_t *)calloc(CONTACT_BITMAP_WORDS, sizeof(uint64_t));
+    if (c->words == NULL) {
+        perror("Failed to allocate bitmap container");
+        return false;
+    }
+    if (x->words != NULL) {
+        memcpy(c->words, x->words, CONTACT_BITMAP_WORDS * sizeof(uint64_t));
+    } else {
+        for (uint32_t i = 0; i < x->cardinality; i++) {
+            c->words[x->values[i] >> 6] |= 1ULL << (x->values[i] & 63);
+        }
+    }
+    c->cardinality = x->cardinality;
+    return true;
+}
+
+static bool andContainers(ContactContainer *c, const ContactContainer *x, const ContactContainer *y) {
+    if (x->words != NULL && y->words != NULL) {
+        if (!wordsOf(c, x)) {
+            return false;
+        }
+        for (int i = 0; i < CONTACT_BITMAP_WORDS; i++) {
+            c->words[i] &= y->words[i];
+        }
+        c->cardinality = popcountWords(c->words);
+        return true;
+    }
+    if (x->words != NULL) {
+        const ContactContainer *t = x;
+        x = y;
+        y = t;
+    }
+    // x is an array: keep the values y also holds
+    if (!allocValues(c, x->key, x->cardinality)) {
+        return false;
+    }
+    if (y->words != NULL) {
+        for (uint32_t i = 0; i < x->cardinality; i++) {
+            if (containerContains(y, x->values[i])) {
+                c->values[c->cardinality++] = x->values[i];
+            }
+        }
+        return true;
+    }
+    uint32_t i = 0, j = 0;
+    while (i < x->cardinality && j < y->cardinality) {
+        if (x->values[i] < y->values[j]) {
+            i++;
+        } else if (x->values[i] > y->values[j]) {
+            j++;
+        } else {
+            c->values[c->cardinality++] = x->values[i];
+            i++;
+            j++;
+        }
+    }
+    return true;
+}
+
+static bool orContainers(ContactContainer *c, const ContactContainer *x, const ContactContainer *y) {
+    if (x->words == NULL && y->words == NULL && x->cardinality + y->cardinality <= CONTACT_BITMAP_ARRAY_MAX) {
+        if (!allocValues(c, x->key, x->cardinality + y->cardinality)) {
+            return false;
+        }
+        uint32_t i = 0, j = 0;
+        while (i < x->cardinality || j < y->cardinality) {
+            if (j >= y->cardinality || (i < x->cardinality && x->values[i] < y->values[j])) {
+                c->values[c->cardinality++] = x->values[i++];
+            } else if (i >= x->cardinality || y->values[j] < x->values[i]) {
+                c->values[c->cardinality++] = y->values[j++];
+            } else {
+                c->values[c->cardinality++] = x->values[i];
+                i++;
+                j++;
+            }
+        }
+        return true;
+    }
+    if (!wordsOf(c, x)) {
+        return false;
+    }
+    if (y->words != NULL) {
+        for (int i = 0; i < CONTACT_BITMAP_WORDS; i++) {
+            c->words[i] |= y->words[i];
+        }
+    } else {
+        for (uint32_t i = 0; i < y->cardinality; i++) {
+            c->words[y->values[i] >> 6] |= 1ULL << (y->values[i] & 63);
+        }
+    }
+    c->cardinality = popcountWords(c->words);
+    return true;
+}
+
+static bool andNotContainers(ContactContainer *c, const ContactContainer *x, const ContactContainer *y) {
+    if (x->words == NULL) {
+        if (!allocValues(c, x->key, x->cardinality)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < x->cardinality; i++) {
+            if (!containerContains(y, x->values[i])) {
+                c->values[c->cardinality++] = x->values[i];
+            }
+        }
+        return true;
+    }
+    if (!wordsOf(c, x)) {
+        return false;
+    }
+    if (y->words != NULL) {
+        for (int i = 0; i < CONTACT_BITMAP_WORDS; i++) {
+            c->words[i] &= ~y->words[i];
+        }
+    } else {
+        for (uint32_t i = 0; i < y->cardinality; i++) {
+            c->words[y->values[i] >> 6] &= ~(1ULL << (y->values[i] & 63));
+        }
+    }
+    c->cardinality = popcountWords(c->words);
+    return true;
+}
+
+typedef bool (*ContainerOp)(ContactContainer *c, const ContactContainer *x, const ContactContainer *y);
+
+// Walks both bitmaps by key. Containers only in a or only in b are copied
+// when keepA or keepB is set; those in both are combined by op.
+static bool combine(ContactBitmap *out, const ContactBitmap *a, const ContactBitmap *b,
+                    ContainerOp op, bool keepA, bool keepB) {
+    contactBitmapClear(out);
+    size_t i = 0, j = 0;
+    bool ok = true;
+    while (ok && (i < a->count || j < b->count)) {
+        ContactContainer c;
+        if (j >= b->count || (i < a->count && a->containers[i].key < b->containers[j].key)) {
+            const ContactContainer *x = &a->containers[i++];
+            if (!keepA) {
+                continue;
+            }
+            ok = copyContainer(&c, x);
+        } else if (i >= a->count || b->containers[j].key < a->containers[i].key) {
+            const ContactContainer *y = &b->containers[j++];
+            if (!keepB) {
+                continue;
+            }
+            ok = copyContainer(&c, y);
+        } else {
+            ok = op(&c, &a->containers[i++], &b->containers[j++]);
+        }
+        ok = ok && appendContainer(out, &c);
+    }
+    if (!ok) {
+        contactBitmapClear(out);
+    }
+    return ok;
+}
+
+bool contactBitmapAnd(ContactBitmap *out, const ContactBitmap *a, const ContactBitmap *b) {
+    return combine(out, a, b, andContainers, false, false);
+}
+
+bool contactBitmapOr(ContactBitmap *out, const ContactBitmap *a, const ContactBitmap *b) {
+    return combine(out, a, b, orContainers, true, true);
+}
+
+bool contactBitmapAndNot(ContactBitmap *out, const ContactBitmap *a, const ContactBitmap *b) {
+    return combine(out, a, b, andNotContainers, true, false);
+}
+
+static size_t andCount(const ContactContainer *x, const ContactContainer *y) {
+    size_t count = 0;
+    if (x->words != NULL && y->words != NULL) {
+        for (int i = 0; i < CONTACT_BITMAP_WORDS; i++) {
+            count += (size_t)__builtin_popcountll(x->words[i] & y->words[i]);
+        }
+        return count;
+    }
+    if (x->words != NULL) {
+        const ContactContainer *t = x;
+        x = y;
+        y = t;
+    }
+    if (y->words != NULL) {
+        for (uint32_t i = 0; i < x->cardinality; i++) {
+            count += containerContains(y, x->values[i]);
+        }
+        return count;
+    }
+    uint32_t i = 0, j = 0;
+    while (i < x->cardinality && j < y->cardinality) {
+        if (x->values[i] < y->values[j]) {
+            i++;
+        } else if (x->values[i] > y->values[j]) {
+            j++;
+        } else {
+            count++;
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+size_t contactBitmapAndCount(const ContactBitmap *a, const ContactBitmap *b) {
+    size_t count = 0;
+    size_t i = 0, j = 0;
+    while (i < a->count && j < b->count) {
+        if (a->containers[i].key < b->containers[j].key) {
+            i++;
+        } else if (a->containers[i].key > b->containers[j].key) {
+            j++;
+        } else {
+            count += andCount(&a->containers[i++], &b->containers[j++]);
+        }
+    }
+    return count;
+}
+
+bool contactBitmapVisit(const ContactBitmap *bitmap, ContactBitmapVisitor visitor, void *userData) {
+    for (size_t k = 0; k < bitmap->count; k++) {
+        const ContactContainer *c = &bitmap->containers[k];
+        uint32_t high = (uint32_t)c->key << 16;
+        if (c->words == NULL) {
+            for (uint32_t i = 0; i < c->cardinality; i++) {
+                if (!visitor(high | c->values[i], userData)) {
+                    return false;
+                }
+            }
+            continue;
+        }
+        for (int i = 0; i < CONTACT_BITMAP_WORDS; i++) {
+            for (uint64_t word = c->words[i]; word != 0; word &= word - 1) {
+                if (!visitor(high | (uint32_t)(i * 64 + __builtin_ctzll(word)), userData)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static size_t containerPayload(const ContactContainer *c) {
+    return c->words != NULL ? CONTACT_BITMAP_WORDS * sizeof(uint64_t) : c->cardinality * sizeof(uint16_t);
+}
+
+size_t contactBitmapSerializedSize(const ContactBitmap *bitmap) {
+    size_t size = sizeof(uint32_t);
+    for (size_t i = 0; i < bitmap->count; i++) {
+        size += CONTAINER_HEADER_BYTES + containerPayload(&bitmap->containers[i]);
+    }
+    return size;
+}
+
+unsigned char *contactBitmapSerialize(const ContactBitmap *bitmap, unsigned char *out) {
+    uint32_t count = (uint32_t)bitmap->count;
+    memcpy(out, &count, sizeof(count));
+    out += sizeof(count);
+    for (size_t i = 0; i < bitmap->count; i++) {
+        const ContactContainer *c = &bitmap->containers[i];
+        uint32_t key = c->key;
+        memcpy(out, &key, sizeof(key));
+        memcpy(out + sizeof(key), &c->cardinality, sizeof(c->cardinality));
+        out += CONTAINER_HEADER_BYTES;
+        memcpy(out, c->words != NULL ? (const void *)c->words : (const void *)c->values, containerPayload(c));
+        out += containerPayload(c);
+    }
+    return out;
+}
+
+// Checks what the rest of the code relies on: keys ascending, containers
+// non-empty, arrays strictly ascending and word counts matching
+static bool validContainer(const ContactContainer *c) {
+    if (c->words != NULL) {
+        return popcountWords(c->words) == c->cardinality;
+    }
+    for (uint32_t i = 1; i < c->cardinality; i++) {
+        if (c->values[i - 1] >= c->values[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const unsigned char *contactBitmapDeserialize(ContactBitmap *bitmap, const unsigned char *data, size_t size) {
+    contactBitmapClear(bitmap);
+    const unsigned char *p = data;
+    const unsigned char *end = data + size;
+    uint32_t count;
+    if (size < sizeof(count)) {
+        return NULL;
+    }
+    memcpy(&count, p, sizeof(count));
+    p += sizeof(count);
+    if (count > 65536 || !reserveContainers(bitmap, count)) {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t key, cardinality;
+        if ((size_t)(end - p) < CONTAINER_HEADER_BYTES) {
+            break;
+        }
+        memcpy(&key, p, sizeof(key));
+        memcpy(&cardinality, p + sizeof(key), sizeof(cardinality));
+        p += CONTAINER_HEADER_BYTES;
+        if (key > UINT16_MAX || cardinality == 0 || cardinality > 65536 ||
+            (i > 0 && key <= bitmap->containers[i - 1].key)) {
+            break;
+        }
+
+        ContactContainer c = {0};
+        c.key = (uint16_t)key;
+        c.cardinality = cardinality;
+        size_t bytes = cardinality > CONTACT_BITMAP_ARRAY_MAX ? CONTACT_BITMAP_WORDS * sizeof(uint64_t)
+                                                              : cardinality * sizeof(uint16_t);
+        if ((size_t)(end - p) < bytes) {
+            break;
+        }
+        if (cardinality > CONTACT_BITMAP_ARRAY_MAX) {
+            c.words = (uint64_t *)malloc(bytes);
+        } else {
+            c.values = (uint16_t *)malloc(bytes);
+            c.capacity = cardinality;
+        }
+        if (c.words == NULL && c.values == NULL) {
+            perror("Failed to allocate bitmap container");
+            break;
+        }
+        memcpy(c.words != NULL ? (void *)c.words : (void *)c.values, p, bytes);
+        p += bytes;
+        if (!validContainer(&c)) {
+            freeContainer(&c);
+            break;
+        }
+        bitmap->containers[bitmap->count++] = c;
+    }
+    if (bitmap->count != count) {
+        contactBitmapClear(bitmap);
+        return NULL;
+    }
+    return p;
+}
@@ -0,0 +1,247 @@
+#include "../include/contact_bloom.h"
+#include "../include/contact_manager.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOOM_BLOCK_BITS 512
+#define BLOOM_BLOCK_WORDS (BLOOM_BLOCK_BITS / 64)
+#define BLOOM_MAX_HASHES 16
+
+// One cache line per stripe so lookups on different threads do not contend
+typedef struct {
+    _Alignas(64) atomic_ullong lookups;
+    atomic_ullong skipped;
+    atomic_ullong falsePositives;
+} BloomStripe;
+
+static BloomStripe stripes[CONTACT_BLOOM_STRIPES];
+static atomic_uint nextStripe;
+static _Thread_local unsigned threadStripe;   // stripe + 1, 0 until first lookup
+static unsigned bitsPerName = CONTACT_BLOOM_BITS_PER_NAME;
+
+void contactBloomSetBitsPerName(unsigned bits) {
+    bitsPerName = bits != 0 ? bits : CONTACT_BLOOM_BITS_PER_NAME;
+}
+
+static uint64_t hashName(const char *name) {
+    // FNV-1a, then the splitmix64 finalizer so every bit depends on the name
+    uint64_t hash = 14695981039346656037ULL;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+// The low bits pick the block; the high bits seed the positions inside it
+// (double hashing with an odd step, so the positions are distinct).
+static uint64_t *blockOf(const ContactBloom *filter, uint64_t hash) {
+    return filter->blocks + (hash & (filter->blockCount - 1)) * BLOOM_BLOCK_WORDS;
+}
+
+static void setBits(ContactBloom *filter, uint64_t hash) {
+    uint64_t *block = blockOf(filter, hash);
+    unsigned position = (unsigned)(hash >> 32) % BLOOM_BLOCK_BITS;
+    unsigned step = (unsigned)(hash >> 48) | 1;
+    for (unsigned i = 0; i < filter->hashes; i++) {
+        block[position / 64] |= 1ULL << (position % 64);
+        position = (position + step) % BLOOM_BLOCK_BITS;
+    }
+}
+
+bool contactBloomMayContain(const ContactBloom *filter, const char *name) {
+    if (filter->blocks == NULL) {
+        return true;
+    }
+    uint64_t hash = hashName(name);
+    const uint64_t *block = blockOf(filter, hash);
+    unsigned position = (unsigned)(hash >> 32) % BLOOM_BLOCK_BITS;
+    unsigned step = (unsigned)(hash >> 48) | 1;
+    for (unsigned i = 0; i < filter->hashes; i++) {
+        if (!(block[position / 64] & (1ULL << (position % 64)))) {
+            return false;
+        }
+        position = (position + step) % BLOOM_BLOCK_BITS;
+    }
+    return true;
+}
+
+// Replaces the filter with one sized for capacity names holding every live
+// name. On allocation failure the old filter is kept.
+static bool rebuild(ContactStore *store, size_t capacity) {
+    if (capacity < CONTACT_BLOOM_MIN_NAMES) {
+        capacity = CONTACT_BLOOM_MIN_NAMES;
+    }
+    size_t blocks = 1;
+    while (blocks * BLOOM_BLOCK_BITS < capacity * bitsPerName) {
+        blocks *= 2;
+    }
+    size_t bytes = blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+    uint64_t *words = (uint64_t *)aligned_alloc(64, bytes);
+    if (words == NULL) {
+        perror("Failed to allocate name filter");
+        return false;
+    }
+    memset(words, 0, bytes);
+
+    ContactBloom *filter = &store->nameFilter;
+    free(filter->blocks);
+    filter->blocks = words;
+    filter->blockCount = blocks;
+    filter->capacity = capacity;
+    filter->names = 0;
+    filter->stale = 0;
+    // k = bits per name * ln 2 minimizes false positives
+    filter->hashes = (bitsPerName * 693 + 500) / 1000;
+    if (filter->hashes == 0) {
+        filter->hashes = 1;
+    } else if (filter->hashes > BLOOM_MAX_HASHES) {
+        filter->hashes = BLOOM_MAX_HASHES;
+    }
+
+    for (uint32_t slot = 0; slot < store->slotCount; slot++) {
+        if (contactSlotAt(store, slot)->live) {
+            setBits(filter, hashName(contactSlotName(store, slot)));
+            filter->names++;
+        }
+    }
+    return true;
+}
+
+void contactBloomAdd(ContactStore *store, const char *name) {
+    ContactBloom *filter = &store->nameFilter;
+    // The name's slot is live already, so a rebuild picks it up
+    if (filter->names >= filter->capacity && rebuild(store, filter->names * 2)) {
+        return;
+    }
+    if (filter->blocks != NULL) {
+        setBits(filter, hashName(name));
+        filter->names++;
+    }
+}
+
+void contactBloomRemove(ContactStore *store) {
+    if (store->nameFilter.blocks != NULL) {
+        store->nameFilter.stale++;
+    }
+}
+
+void contactBloomCompact(ContactStore *store, bool force) {
+    ContactBloom *filter = &store->nameFilter;
+    if (filter->blocks == NULL || filter->stale == 0) {
+        return;
+    }
+    // A quarter of the names stale keeps rebuilds to O(1) per delete
+    if (force || filter->stale * 4 >= filter->names) {
+        rebuild(store, store->count * 2);
+    }
+}
+
+bool contactBloomReserve(ContactStore *store, size_t count) {
+    const ContactBloom *filter = &store->nameFilter;
+    if (filter->blocks != NULL && count <= filter->capacity) {
+        return true;
+    }
+    return rebuild(store, count);
+}
+
+bool contactBloomCopy(ContactBloom *dest, const ContactBloom *src) {
+    contactBloomFree(dest);
+    if (src->blocks == NULL) {
+        return true;
+    }
+    size_t bytes = src->blockCount * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+    dest->blocks = (uint64_t *)aligned_alloc(64, bytes);
+    if (dest->blocks == NULL) {
+        perror("Failed to copy name filter");
+        return false;
+    }
+    memcpy(dest->blocks, src->blocks, bytes);
+    dest->blockCount = src->blockCount;
+    dest->hashes = src->hashes;
+    dest->capacity = src->capacity;
+    dest->names = src->names;
+    dest->stale = src->stale;
+    return true;
+}
+
+bool contactBloomMerge(ContactBloom *dest, const ContactBloom *src) {
+    if (dest->blocks == NULL) {
+        return contactBloomCopy(dest, src);
+    }
+    if (src->blocks == NULL) {
+        return true;
+    }
+    if (src->blockCount != dest->blockCount || src->hashes != dest->hashes) {
+        return false;
+    }
+    size_t words = dest->blockCount * BLOOM_BLOCK_WORDS;
+    for (size_t i = 0; i < words; i++) {
+        dest->blocks[i] |= src->blocks[i];
+    }
+    dest->names += src->names;
+    dest->stale += src->stale;
+    return true;
+}
+
+void contactBloomFree(ContactBloom *filter) {
+    free(filter->blocks);
+    memset(filter, 0, sizeof(*filter));
+}
+
+size_t contactBloomBytes(const ContactBloom *filter) {
+    return filter->blockCount * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+}
+
+double contactBloomFalsePositiveRate(const ContactBloom *filter) {
+    if (filter->blocks == NULL) {
+        return 1.0;
+    }
+    size_t words = filter->blockCount * BLOOM_BLOCK_WORDS;
+    size_t set = 0;
+    for (size_t i = 0; i < words; i++) {
+        set += (size_t)__builtin_popcountll(filter->blocks[i]);
+    }
+    double fill = (double)set / (double)(words * 64);
+    double rate = 1.0;
+    for (unsigned i = 0; i < filter->hashes; i++) {
+        rate *= fill;
+    }
+    return rate;
+}
+
+void contactBloomRecord(bool passed, bool found) {
+    if (threadStripe == 0) {
+        threadStripe = atomic_fetch_add(&nextStripe, 1) % CONTACT_BLOOM_STRIPES + 1;
+    }
+    BloomStripe *stripe = &stripes[threadStripe - 1];
+    atomic_fetch_add_explicit(&stripe->lookups, 1, memory_order_relaxed);
+    if (!passed) {
+        atomic_fetch_add_explicit(&stripe->skipped, 1, memory_order_relaxed);
+    } else if (!found) {
+        atomic_fetch_add_explicit(&stripe->falsePositives, 1, memory_order_relaxed);
+    }
+}
+
+void contactBloomStats(ContactBloomStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < CONTACT_BLOOM_STRIPES; i++) {
+        stats->lookups += atomic_load_explicit(&stripes[i].lookups, memory_order_relaxed);
+        stats->skipped += atomic_load_explicit(&stripes[i].skipped, memory_order_relaxed);
+        stats->falsePositives += atomic_load_explicit(&stripes[i].falsePositives, memory_order_relaxed);
+    }
+}
+
+void contactBloomResetStats(void) {
+    for (int i = 0; i < CONTACT_BLOOM_STRIPES; i++) {
+        atomic_store_explicit(&stripes[i].lookups, 0, memory_order_relaxed);
+        atomic_store_explicit(&stripes[i].skipped, 0, memory_order_relaxed);
+        atomic_store_explicit(&stripes[i].falsePositives, 0, memory_order_relaxed);
+    }
+}
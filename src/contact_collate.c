@@ -0,0 +1,267 @@
+#include "../include/contact_collate.h"
+#include <stdint.h>
+
+// Lowercase base letter of each code point, 0 where it is unchanged or
+// expands to two letters (see expansion). Generated from the Unicode
+// canonical decompositions and lowercase mappings, keeping only folds no
+// longer in UTF-8 than the letter they replace.
+// U+00C0-U+024F: Latin-1 letters, Latin Extended-A and -B
+static const uint16_t latinFolds[0x190] = {
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0000, 0x0063,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x0064, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x0000,
+    0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0079, 0x0000, 0x0000,
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0000, 0x0063,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x0064, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x0000,
+    0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0079, 0x0000, 0x0079,
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0063, 0x0063,
+    0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0064, 0x0064,
+    0x0064, 0x0064, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0067, 0x0067, 0x0067, 0x0067,
+    0x0067, 0x0067, 0x0067, 0x0067, 0x0068, 0x0068, 0x0068, 0x0068,
+    0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x0069, 0x0069, 0x0000, 0x0000, 0x006A, 0x006A, 0x006B, 0x006B,
+    0x006B, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C,
+    0x006C, 0x006C, 0x006C, 0x006E, 0x006E, 0x006E, 0x006E, 0x006E,
+    0x006E, 0x006E, 0x014B, 0x0000, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x0000, 0x0000, 0x0072, 0x0072, 0x0072, 0x0072,
+    0x0072, 0x0072, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073,
+    0x0073, 0x0073, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0077, 0x0077, 0x0079, 0x0079,
+    0x0079, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x0073,
+    0x0000, 0x0253, 0x0183, 0x0000, 0x0185, 0x0000, 0x0254, 0x0188,
+    0x0000, 0x0256, 0x0257, 0x018C, 0x0000, 0x0000, 0x01DD, 0x0259,
+    0x025B, 0x0192, 0x0000, 0x0260, 0x0263, 0x0000, 0x0269, 0x0268,
+    0x0199, 0x0000, 0x0000, 0x0000, 0x026F, 0x0272, 0x0000, 0x0275,
+    0x006F, 0x006F, 0x01A3, 0x0000, 0x01A5, 0x0000, 0x0280, 0x01A8,
+    0x0000, 0x0283, 0x0000, 0x0000, 0x01AD, 0x0000, 0x0288, 0x0075,
+    0x0075, 0x028A, 0x028B, 0x01B4, 0x0000, 0x01B6, 0x0000, 0x0292,
+    0x01B9, 0x0000, 0x0000, 0x0000, 0x01BD, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x01C6, 0x01C6, 0x0000, 0x01C9,
+    0x01C9, 0x0000, 0x01CC, 0x01CC, 0x0000, 0x0061, 0x0061, 0x0069,
+    0x0069, 0x006F, 0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0000, 0x0061, 0x0061,
+    0x0061, 0x0061, 0x00E6, 0x00E6, 0x01E5, 0x0000, 0x0067, 0x0067,
+    0x006B, 0x006B, 0x006F, 0x006F, 0x006F, 0x006F, 0x0292, 0x0292,
+    0x006A, 0x01F3, 0x01F3, 0x0000, 0x0067, 0x0067, 0x0195, 0x01BF,
+    0x006E, 0x006E, 0x0061, 0x0061, 0x00E6, 0x00E6, 0x00F8, 0x00F8,
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0069, 0x0069, 0x0069, 0x0069, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x0072, 0x0072, 0x0072, 0x0072, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0073, 0x0073, 0x0074, 0x0074, 0x021D, 0x0000, 0x0068, 0x0068,
+    0x019E, 0x0000, 0x0223, 0x0000, 0x0225, 0x0000, 0x0061, 0x0061,
+    0x0065, 0x0065, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x0079, 0x0079, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x023C, 0x0000, 0x019A, 0x0000, 0x0000,
+    0x0000, 0x0242, 0x0000, 0x0180, 0x0289, 0x028C, 0x0247, 0x0000,
+    0x0249, 0x0000, 0x024B, 0x0000, 0x024D, 0x0000, 0x024F, 0x0000,
+};
+
+// U+0370-U+052F: Greek and Cyrillic
+static const uint16_t greekCyrillicFolds[0x1C0] = {
+    0x0371, 0x0000, 0x0373, 0x0000, 0x02B9, 0x0000, 0x0377, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x03F3,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x03B1, 0x0000,
+    0x03B5, 0x03B7, 0x03B9, 0x0000, 0x03BF, 0x0000, 0x03C5, 0x03C9,
+    0x03B9, 0x03B1, 0x03B2, 0x03B3, 0x03B4, 0x03B5, 0x03B6, 0x03B7,
+    0x03B8, 0x03B9, 0x03BA, 0x03BB, 0x03BC, 0x03BD, 0x03BE, 0x03BF,
+    0x03C0, 0x03C1, 0x0000, 0x03C3, 0x03C4, 0x03C5, 0x03C6, 0x03C7,
+    0x03C8, 0x03C9, 0x03B9, 0x03C5, 0x03B1, 0x03B5, 0x03B7, 0x03B9,
+    0x03C5, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x03C3, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x03B9, 0x03C5, 0x03BF, 0x03C5, 0x03C9, 0x03D7,
+    0x0000, 0x0000, 0x0000, 0x03D2, 0x03D2, 0x0000, 0x0000, 0x0000,
+    0x03D9, 0x0000, 0x03DB, 0x0000, 0x03DD, 0x0000, 0x03DF, 0x0000,
+    0x03E1, 0x0000, 0x03E3, 0x0000, 0x03E5, 0x0000, 0x03E7, 0x0000,
+    0x03E9, 0x0000, 0x03EB, 0x0000, 0x03ED, 0x0000, 0x03EF, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x03B8, 0x0000, 0x0000, 0x03F8,
+    0x0000, 0x03F2, 0x03FB, 0x0000, 0x0000, 0x037B, 0x037C, 0x037D,
+    0x0435, 0x0435, 0x0452, 0x0433, 0x0454, 0x0455, 0x0456, 0x0456,
+    0x0458, 0x0459, 0x045A, 0x045B, 0x043A, 0x0438, 0x0443, 0x045F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0438, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0438, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0435, 0x0435, 0x0000, 0x0433, 0x0000, 0x0000, 0x0000, 0x0456,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x043A, 0x0438, 0x0443, 0x0000,
+    0x0461, 0x0000, 0x0463, 0x0000, 0x0465, 0x0000, 0x0467, 0x0000,
+    0x0469, 0x0000, 0x046B, 0x0000, 0x046D, 0x0000, 0x046F, 0x0000,
+    0x0471, 0x0000, 0x0473, 0x0000, 0x0475, 0x0000, 0x0475, 0x0475,
+    0x0479, 0x0000, 0x047B, 0x0000, 0x047D, 0x0000, 0x047F, 0x0000,
+    0x0481, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x048B, 0x0000, 0x048D, 0x0000, 0x048F, 0x0000,
+    0x0491, 0x0000, 0x0493, 0x0000, 0x0495, 0x0000, 0x0497, 0x0000,
+    0x0499, 0x0000, 0x049B, 0x0000, 0x049D, 0x0000, 0x049F, 0x0000,
+    0x04A1, 0x0000, 0x04A3, 0x0000, 0x04A5, 0x0000, 0x04A7, 0x0000,
+    0x04A9, 0x0000, 0x04AB, 0x0000, 0x04AD, 0x0000, 0x04AF, 0x0000,
+    0x04B1, 0x0000, 0x04B3, 0x0000, 0x04B5, 0x0000, 0x04B7, 0x0000,
+    0x04B9, 0x0000, 0x04BB, 0x0000, 0x04BD, 0x0000, 0x04BF, 0x0000,
+    0x04CF, 0x0436, 0x0436, 0x04C4, 0x0000, 0x04C6, 0x0000, 0x04C8,
+    0x0000, 0x04CA, 0x0000, 0x04CC, 0x0000, 0x04CE, 0x0000, 0x0000,
+    0x0430, 0x0430, 0x0430, 0x0430, 0x04D5, 0x0000, 0x0435, 0x0435,
+    0x04D9, 0x0000, 0x04D9, 0x04D9, 0x0436, 0x0436, 0x0437, 0x0437,
+    0x04E1, 0x0000, 0x0438, 0x0438, 0x0438, 0x0438, 0x043E, 0x043E,
+    0x04E9, 0x0000, 0x04E9, 0x04E9, 0x044D, 0x044D, 0x0443, 0x0443,
+    0x0443, 0x0443, 0x0443, 0x0443, 0x0447, 0x0447, 0x04F7, 0x0000,
+    0x044B, 0x044B, 0x04FB, 0x0000, 0x04FD, 0x0000, 0x04FF, 0x0000,
+    0x0501, 0x0000, 0x0503, 0x0000, 0x0505, 0x0000, 0x0507, 0x0000,
+    0x0509, 0x0000, 0x050B, 0x0000, 0x050D, 0x0000, 0x050F, 0x0000,
+    0x0511, 0x0000, 0x0513, 0x0000, 0x0515, 0x0000, 0x0517, 0x0000,
+    0x0519, 0x0000, 0x051B, 0x0000, 0x051D, 0x0000, 0x051F, 0x0000,
+    0x0521, 0x0000, 0x0523, 0x0000, 0x0525, 0x0000, 0x0527, 0x0000,
+    0x0529, 0x0000, 0x052B, 0x0000, 0x052D, 0x0000, 0x052F, 0x0000,
+};
+
+// U+1E00-U+1EFF: Latin Extended Additional
+static const uint16_t latinAdditionalFolds[0x100] = {
+    0x0061, 0x0061, 0x0062, 0x0062, 0x0062, 0x0062, 0x0062, 0x0062,
+    0x0063, 0x0063, 0x0064, 0x0064, 0x0064, 0x0064, 0x0064, 0x0064,
+    0x0064, 0x0064, 0x0064, 0x0064, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0066, 0x0066,
+    0x0067, 0x0067, 0x0068, 0x0068, 0x0068, 0x0068, 0x0068, 0x0068,
+    0x0068, 0x0068, 0x0068, 0x0068, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x006B, 0x006B, 0x006B, 0x006B, 0x006B, 0x006B, 0x006C, 0x006C,
+    0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006D, 0x006D,
+    0x006D, 0x006D, 0x006D, 0x006D, 0x006E, 0x006E, 0x006E, 0x006E,
+    0x006E, 0x006E, 0x006E, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x006F, 0x006F, 0x0070, 0x0070, 0x0070, 0x0070,
+    0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072,
+    0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073,
+    0x0073, 0x0073, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074,
+    0x0074, 0x0074, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0076, 0x0076, 0x0076, 0x0076,
+    0x0077, 0x0077, 0x0077, 0x0077, 0x0077, 0x0077, 0x0077, 0x0077,
+    0x0077, 0x0077, 0x0078, 0x0078, 0x0078, 0x0078, 0x0079, 0x0079,
+    0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x0068, 0x0074,
+    0x0077, 0x0079, 0x0000, 0x017F, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061,
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061,
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0069, 0x0069, 0x0069, 0x0069, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x006F, 0x006F, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0075, 0x0079, 0x0079, 0x0079, 0x0079, 0x0079, 0x0079,
+    0x0079, 0x0079, 0x1EFB, 0x0000, 0x1EFD, 0x0000, 0x1EFF, 0x0000,
+};
+
+// Letters that fold to two
+static const char *expansion(uint32_t cp) {
+    switch (cp) {
+    case 0x00C6: case 0x00E6: return "ae";
+    case 0x00DE: case 0x00FE: return "th";
+    case 0x00DF: case 0x1E9E: return "ss";
+    case 0x0132: case 0x0133: return "ij";
+    case 0x0152: case 0x0153: return "oe";
+    default: return NULL;
+    }
+}
+
+static uint32_t foldCodePoint(uint32_t cp) {
+    uint16_t folded = 0;
+    if (cp >= 0x00C0 && cp < 0x0250) {
+        folded = latinFolds[cp - 0x00C0];
+    } else if (cp >= 0x0370 && cp < 0x0530) {
+        folded = greekCyrillicFolds[cp - 0x0370];
+    } else if (cp >= 0x1E00 && cp < 0x1F00) {
+        folded = latinAdditionalFolds[cp - 0x1E00];
+    }
+    return folded != 0 ? folded : cp;
+}
+
+// Length of the UTF-8 sequence at p, 0 if it is not a valid one
+static size_t decodeUtf8(const unsigned char *p, size_t length, uint32_t *cp) {
+    size_t size;
+    uint32_t value;
+    if (p[0] >= 0xC2 && p[0] <= 0xDF) {
+        size = 2;
+        value = p[0] & 0x1F;
+    } else if (p[0] >= 0xE0 && p[0] <= 0xEF) {
+        size = 3;
+        value = p[0] & 0x0F;
+    } else if (p[0] >= 0xF0 && p[0] <= 0xF4) {
+        size = 4;
+        value = p[0] & 0x07;
+    } else {
+        return 0;
+    }
+    if (size > length) {
+        return 0;
+    }
+    for (size_t i = 1; i < size; i++) {
+        if ((p[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+        value = value << 6 | (p[i] & 0x3F);
+    }
+    // Overlong forms, surrogates and values past U+10FFFF
+    if ((size == 3 && value < 0x800) || (size == 4 && (value < 0x10000 || value > 0x10FFFF)) ||
+        (value >= 0xD800 && value <= 0xDFFF)) {
+        return 0;
+    }
+    *cp = value;
+    return size;
+}
+
+static size_t encodeUtf8(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | cp >> 6);
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | cp >> 12);
+        out[1] = (char)(0x80 | (cp >> 6 & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | cp >> 18);
+    out[1] = (char)(0x80 | (cp >> 12 & 0x3F));
+    out[2] = (char)(0x80 | (cp >> 6 & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+size_t contactCollate(const char *name, size_t length, char *key) {
+    const unsigned char *p = (const unsigned char *)name;
+    const unsigned char *end = p + length;
+    size_t out = 0;
+    while (p < end && *p != '\0') {
+        if (*p < 0x80) {
+            key[out++] = (char)(*p >= 'A' && *p <= 'Z' ? *p + 'a' - 'A' : *p);
+            p++;
+            continue;
+        }
+
+        uint32_t cp;
+        size_t size = decodeUtf8(p, (size_t)(end - p), &cp);
+        if (size == 0) {
+            key[out++] = (char)*p++;
+            continue;
+        }
+        p += size;
+        const char *pair = expansion(cp);
+        if (pair != NULL) {
+            key[out++] = pair[0];
+            key[out++] = pair[1];
+        } else if (cp < 0x0300 || cp > 0x036F) {   // combining accents are dropped
+            out += encodeUtf8(foldCodePoint(cp), key + out);
+        }
+    }
+    key[out] = '\0';
+    return out;
+}
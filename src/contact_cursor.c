@@ -0,0 +1,162 @@
+#include "../include/contact_cursor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void contactCursorInit(ContactCursor *cursor, ContactOrder order) {
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->order = order;
+}
+
+// First order entry with a sequence at or after `sequence`
+static size_t orderPosition(const ContactStore *store, uint64_t sequence) {
+    size_t lo = 0;
+    size_t hi = store->orderCount;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (store->order[mid].sequence < sequence) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static size_t insertionPage(const ContactStore *store, ContactCursor *cursor, Contact *out, size_t limit) {
+    size_t count = 0;
+    size_t pos = orderPosition(store, cursor->sequence);
+    for (; pos < store->orderCount; pos++) {
+        const ContactOrderEntry *entry = &store->order[pos];
+        if (!getContact(store, entry->handle, NULL)) {
+            continue;
+        }
+        // A live contact past the page: more remain
+        if (count == limit) {
+            break;
+        }
+        getContact(store, entry->handle, &out[count++]);
+        cursor->sequence = entry->sequence + 1;
+    }
+    cursor->done = pos == store->orderCount;
+    return count;
+}
+
+typedef struct {
+    ContactCursor *cursor;
+    Contact *out;
+    size_t limit;
+    size_t count;
+    uint32_t skipped;
+    bool more;
+} NamePage;
+
+static bool collectPage(const Contact *contact, void *userData) {
+    NamePage *page = (NamePage *)userData;
+    ContactCursor *cursor = page->cursor;
+
+    // The walk starts at the last name returned; step over the contacts
+    // with that name that earlier pages already returned
+    bool sameName = strcmp(contact->name, cursor->name) == 0;
+    if (sameName && page->skipped < cursor->skip) {
+        page->skipped++;
+        return true;
+    }
+    if (page->count == page->limit) {
+        page->more = true;
+        return false;
+    }
+
+    page->out[page->count++] = *contact;
+    if (sameName) {
+        cursor->skip++;
+    } else {
+        strcpy(cursor->name, contact->name);
+        cursor->skip = 1;
+    }
+    page->skipped = cursor->skip;
+    return true;
+}
+
+static size_t namePage(const ContactStore *store, ContactCursor *cursor, Contact *out, size_t limit) {
+    NamePage page = {cursor, out, limit, 0, 0, false};
+    searchContactsByRange(store, cursor->name, NULL, 0, collectPage, &page);
+    cursor->done = !page.more;
+    return page.count;
+}
+
+size_t contactPage(const ContactStore *store, ContactCursor *cursor, Contact *out, size_t limit) {
+    if (cursor->order == CONTACT_ORDER_INSERTION) {
+        return insertionPage(store, cursor, out, limit);
+    }
+    return namePage(store, cursor, out, limit);
+}
+
+bool contactCursorEncode(const ContactCursor *cursor, char *token, size_t size) {
+    if (cursor->order == CONTACT_ORDER_INSERTION) {
+        int length = snprintf(token, size, "I%llx", (unsigned long long)cursor->sequence);
+        return length >= 0 && (size_t)length < size;
+    }
+
+    // Names are hex-encoded so tokens never contain protocol separators
+    int length = snprintf(token, size, "N%x:", (unsigned)cursor->skip);
+    if (length < 0 || (size_t)length + strlen(cursor->name) * 2 >= size) {
+        return false;
+    }
+    static const char digits[] = "0123456789abcdef";
+    char *p = token + length;
+    for (const char *c = cursor->name; *c != '\0'; c++) {
+        *p++ = digits[(unsigned char)*c >> 4];
+        *p++ = digits[(unsigned char)*c & 0xF];
+    }
+    *p = '\0';
+    return true;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool contactCursorDecode(ContactCursor *cursor, const char *token) {
+    char *end;
+    if (token[0] == 'I') {
+        contactCursorInit(cursor, CONTACT_ORDER_INSERTION);
+        cursor->sequence = strtoull(token + 1, &end, 16);
+        return end != token + 1 && *end == '\0';
+    }
+    if (token[0] != 'N') {
+        return false;
+    }
+
+    contactCursorInit(cursor, CONTACT_ORDER_NAME);
+    unsigned long skip = strtoul(token + 1, &end, 16);
+    if (end == token + 1 || *end != ':' || skip > UINT32_MAX) {
+        return false;
+    }
+    cursor->skip = (uint32_t)skip;
+
+    const char *hex = end + 1;
+    size_t length = strlen(hex);
+    if (length % 2 != 0 || length / 2 >= sizeof(cursor->name)) {
+        return false;
+    }
+    for (size_t i = 0; i < length / 2; i++) {
+        int high = hexValue(hex[2 * i]);
+        int low = hexValue(hex[2 * i + 1]);
+        if (high < 0 || low < 0 || (high == 0 && low == 0)) {
+            return false;
+        }
+        cursor->name[i] = (char)(high << 4 | low);
+    }
+    cursor->name[length / 2] = '\0';
+    return true;
+}
@@ -0,0 +1,283 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_db.h"
+#include "../include/contact_pack.h"
+#include "../include/security.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static uint32_t headerChecksum(const ContactDbHeader *header) {
+    return checksumData(0, header, offsetof(ContactDbHeader, headerChecksum));
+}
+
+static const unsigned char *pageAt(const ContactDb *db, size_t page) {
+    // Page 0 holds the header; data pages follow
+    return db->map + (page + 1) * CONTACT_DB_PAGE_SIZE;
+}
+
+static const ContactDbPageFooter *pageFooter(const unsigned char *page) {
+    return (const ContactDbPageFooter *)(page + CONTACT_DB_PAGE_SIZE - sizeof(ContactDbPageFooter));
+}
+
+static bool validHeader(const ContactDbHeader *header, size_t fileSize) {
+    if (header->version != CONTACT_DB_VERSION ||
+        header->pageSize != CONTACT_DB_PAGE_SIZE ||
+        header->recordSize != sizeof(Contact) ||
+        header->recordsPerPage != CONTACT_DB_RECORDS_PER_PAGE ||
+        header->headerChecksum != headerChecksum(header)) {
+        return false;
+    }
+
+    if (header->recordCount > header->pageCount * CONTACT_DB_RECORDS_PER_PAGE ||
+        header->pageCount > fileSize / CONTACT_DB_PAGE_SIZE ||
+        (header->pageCount + 1) * CONTACT_DB_PAGE_SIZE > fileSize) {
+        return false;
+    }
+    return true;
+}
+
+ContactDbStatus contactDbOpen(ContactDb *db, const char *filename) {
+    memset(db, 0, sizeof(*db));
+    db->fd = -1;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return CONTACT_DB_MISSING;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return CONTACT_DB_CORRUPT;
+    }
+
+    // Files too short to hold a magic (an empty baseline contacts.dat) are
+    // legacy text
+    char magic[sizeof(((ContactDbHeader *)0)->magic)] = {0};
+    if ((size_t)st.st_size < sizeof(magic) ||
+        pread(fd, magic, sizeof(magic), 0) != (ssize_t)sizeof(magic)) {
+        close(fd);
+        return CONTACT_DB_LEGACY;
+    }
+    if (memcmp(magic, CONTACT_DB_MAGIC, sizeof(magic)) != 0) {
+        close(fd);
+        return memcmp(magic, CONTACT_PACK_MAGIC, sizeof(magic)) == 0 ? CONTACT_DB_PACKED : CONTACT_DB_LEGACY;
+    }
+
+    if ((size_t)st.st_size < CONTACT_DB_PAGE_SIZE) {
+        close(fd);
+        return CONTACT_DB_CORRUPT;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("Failed to map contact database");
+        close(fd);
+        return CONTACT_DB_CORRUPT;
+    }
+
+    db->fd = fd;
+    db->map = (const unsigned char *)map;
+    db->mapSize = (size_t)st.st_size;
+    db->header = (const ContactDbHeader *)map;
+
+    if (!validHeader(db->header, db->mapSize)) {
+        contactDbClose(db);
+        return CONTACT_DB_CORRUPT;
+    }
+    return CONTACT_DB_OK;
+}
+
+size_t contactDbCount(const ContactDb *db) {
+    return db->header != NULL ? (size_t)db->header->recordCount : 0;
+}
+
+const Contact *contactDbRecord(const ContactDb *db, size_t index) {
+    if (index >= contactDbCount(db)) {
+        return NULL;
+    }
+    const unsigned char *page = pageAt(db, index / CONTACT_DB_RECORDS_PER_PAGE);
+    return (const Contact *)page + index % CONTACT_DB_RECORDS_PER_PAGE;
+}
+
+const Contact *contactDbPage(const ContactDb *db, size_t page, size_t *count) {
+    if (db->header == NULL || page >= db->header->pageCount) {
+        *count = 0;
+        return NULL;
+    }
+
+    const unsigned char *data = pageAt(db, page);
+    size_t records = pageFooter(data)->recordCount;
+    *count = records <= CONTACT_DB_RECORDS_PER_PAGE ? records : 0;
+    return (const Contact *)data;
+}
+
+bool contactDbVerifyPage(const ContactDb *db, size_t page) {
+    if (db->header == NULL || page >= db->header->pageCount) {
+        return false;
+    }
+
+    const unsigned char *data = pageAt(db, page);
+    const ContactDbPageFooter *footer = pageFooter(data);
+    if (footer->recordCount > CONTACT_DB_RECORDS_PER_PAGE) {
+        return false;
+    }
+    return footer->checksum == checksumData(0, data, footer->recordCount * sizeof(Contact));
+}
+
+bool contactDbVerify(const ContactDb *db) {
+    if (db->header == NULL) {
+        return false;
+    }
+
+    uint32_t crc = 0;
+    size_t records = 0;
+    for (size_t page = 0; page < db->header->pageCount; page++) {
+        if (!contactDbVerifyPage(db, page)) {
+            return false;
+        }
+        const ContactDbPageFooter *footer = pageFooter(pageAt(db, page));
+        crc = checksumData(crc, &footer->checksum, sizeof(footer->checksum));
+        records += footer->recordCount;
+    }
+    return crc == db->header->dataChecksum && records == db->header->recordCount;
+}
+
+void contactDbClose(ContactDb *db) {
+    if (db->map != NULL) {
+        munmap((void *)db->map, db->mapSize);
+    }
+    if (db->fd >= 0) {
+        close(db->fd);
+    }
+    memset(db, 0, sizeof(*db));
+    db->fd = -1;
+}
+
+bool contactDbSyncDirectory(const char *filename) {
+    char directory[512];
+    const char *slash = strrchr(filename, '/');
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else if (slash == filename) {
+        strcpy(directory, "/");
+    } else {
+        snprintf(directory, sizeof(directory), "%.*s", (int)(slash - filename), filename);
+    }
+
+    int fd = open(directory, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+bool contactDbWriteSource(ContactRecordSource next, void *source, const char *filename,
+                          uint64_t walSequence, size_t *written) {
+    // Write beside the target and rename over it, so a crash mid-save
+    // leaves the previous file intact
+    char tempName[512];
+    snprintf(tempName, sizeof(tempName), "%s.tmp", filename);
+
+    FILE *file = fopen(tempName, "wb");
+    if (file == NULL) {
+        perror("Failed to open file for saving");
+        return false;
+    }
+
+    unsigned char *page = (unsigned char *)calloc(1, CONTACT_DB_PAGE_SIZE);
+    if (page == NULL) {
+        fclose(file);
+        remove(tempName);
+        return false;
+    }
+
+    ContactDbHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CONTACT_DB_MAGIC, sizeof(header.magic));
+    header.version = CONTACT_DB_VERSION;
+    header.pageSize = CONTACT_DB_PAGE_SIZE;
+    header.recordSize = sizeof(Contact);
+    header.recordsPerPage = CONTACT_DB_RECORDS_PER_PAGE;
+    header.walSequence = walSequence;
+
+    // Reserve the header page; it is rewritten once the counts are known
+    bool ok = fwrite(page, CONTACT_DB_PAGE_SIZE, 1, file) == 1;
+
+    const Contact *contact;
+    ContactDbPageFooter *footer = (ContactDbPageFooter *)(page + CONTACT_DB_PAGE_SIZE - sizeof(ContactDbPageFooter));
+    Contact *records = (Contact *)page;
+    size_t filled = 0;
+
+    do {
+        contact = next(source);
+        if (contact != NULL) {
+            records[filled++] = *contact;
+            header.recordCount++;
+        }
+
+        if (filled == CONTACT_DB_RECORDS_PER_PAGE || (contact == NULL && filled > 0)) {
+            footer->recordCount = (uint32_t)filled;
+            footer->checksum = checksumData(0, records, filled * sizeof(Contact));
+            header.dataChecksum = checksumData(header.dataChecksum, &footer->checksum, sizeof(footer->checksum));
+            ok = ok && fwrite(page, CONTACT_DB_PAGE_SIZE, 1, file) == 1;
+            header.pageCount++;
+            memset(page, 0, CONTACT_DB_PAGE_SIZE);
+            filled = 0;
+        }
+    } while (contact != NULL && ok);
+
+    header.headerChecksum = headerChecksum(&header);
+    memcpy(page, &header, sizeof(header));
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(page, CONTACT_DB_PAGE_SIZE, 1, file) == 1;
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+
+    free(page);
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tempName, filename) != 0 || !contactDbSyncDirectory(filename)) {
+        perror("Failed to write contact database");
+        remove(tempName);
+        return false;
+    }
+
+    if (written != NULL) {
+        *written = (size_t)header.recordCount;
+    }
+    return true;
+}
+
+static const Contact *nextStoreRecord(void *source) {
+    return contactIteratorNext((ContactIterator *)source);
+}
+
+bool contactDbWrite(const ContactStore *store, const char *filename, uint64_t walSequence, size_t *written) {
+    ContactIterator it;
+    contactIteratorInit(&it, store);
+    return contactDbWriteSource(nextStoreRecord, &it, filename, walSequence, written);
+}
+
+typedef struct {
+    const Contact *records;
+    size_t count;
+    size_t position;
+} RecordArray;
+
+static const Contact *nextArrayRecord(void *source) {
+    RecordArray *array = (RecordArray *)source;
+    return array->position < array->count ? &array->records[array->position++] : NULL;
+}
+
+bool contactDbWriteRecords(const Contact *records, size_t count, const char *filename,
+                           uint64_t walSequence, size_t *written) {
+    RecordArray array = {records, count, 0};
+    return contactDbWriteSource(nextArrayRecord, &array, filename, walSequence, written);
+}
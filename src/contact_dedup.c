@@ -0,0 +1,520 @@
+#include "../include/contact_dedup.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MINHASH_BANDS 10
+#define MINHASH_ROWS 3
+#define MINHASH_SIZE (MINHASH_BANDS * MINHASH_ROWS)
+#define BUCKET_WINDOW 8
+#define SKETCH_SLACK 0.25
+#define NAME_BUFFER_SIZE 64
+#define CLUSTER_NONE UINT32_MAX
+
+typedef struct {
+    uint64_t key;
+    uint32_t index;
+} DedupPair;
+
+typedef struct {
+    uint32_t values[NAME_BUFFER_SIZE];
+    size_t count;
+    char digits[NAME_BUFFER_SIZE];
+} NameShingles;
+
+typedef struct {
+    const ContactStore *store;
+    uint32_t *slots;          // live slots; contacts are numbered by position here
+    size_t count;
+    uint32_t *parent;
+    uint32_t *size;
+    unsigned char *reasons;
+    DedupPair *pairs;
+    DedupPair *scratch;
+    double nameThreshold;
+} DedupState;
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Lowercase letters and digits with single spaces between words and one
+// at each end, so 3-grams mark where words start and stop. Apostrophes are
+// dropped ("O'Brien" = "OBrien"); other punctuation separates words. Bytes
+// of multi-byte UTF-8 characters are kept as they are.
+static size_t normalizeName(const char *name, char *out) {
+    size_t length = 0;
+    out[length++] = ' ';
+    for (const char *p = name; *p != '\0' && length < NAME_BUFFER_SIZE - 2; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (isalnum(c) || c >= 0x80) {
+            out[length++] = (char)tolower(c);
+        } else if (c != '\'' && out[length - 1] != ' ') {
+            out[length++] = ' ';
+        }
+    }
+    if (out[length - 1] != ' ') {
+        out[length++] = ' ';
+    }
+    out[length] = '\0';
+    return length;
+}
+
+static void sortValues(uint32_t *values, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        uint32_t value = values[i];
+        size_t j = i;
+        while (j > 0 && values[j - 1] > value) {
+            values[j] = values[j - 1];
+            j--;
+        }
+        values[j] = value;
+    }
+}
+
+// The distinct 3-grams of a name, sorted, plus its digits in order
+static void nameShingles(const char *name, NameShingles *shingles) {
+    char normalized[NAME_BUFFER_SIZE];
+    size_t length = normalizeName(name, normalized);
+
+    size_t digits = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (isdigit((unsigned char)normalized[i])) {
+            shingles->digits[digits++] = normalized[i];
+        }
+    }
+    shingles->digits[digits] = '\0';
+
+    shingles->count = 0;
+    for (size_t i = 0; length > 2 && i + 3 <= length; i++) {
+        shingles->values[shingles->count++] = (uint32_t)(unsigned char)normalized[i] << 16 |
+                                              (uint32_t)(unsigned char)normalized[i + 1] << 8 |
+                                              (unsigned char)normalized[i + 2];
+    }
+    sortValues(shingles->values, shingles->count);
+
+    size_t unique = 0;
+    for (size_t i = 0; i < shingles->count; i++) {
+        if (unique == 0 || shingles->values[unique - 1] != shingles->values[i]) {
+            shingles->values[unique++] = shingles->values[i];
+        }
+    }
+    shingles->count = unique;
+}
+
+static double jaccard(const NameShingles *a, const NameShingles *b) {
+    if (a->count == 0 || b->count == 0) {
+        return 0.0;
+    }
+    size_t i = 0;
+    size_t j = 0;
+    size_t shared = 0;
+    while (i < a->count && j < b->count) {
+        if (a->values[i] == b->values[j]) {
+            shared++;
+            i++;
+            j++;
+        } else if (a->values[i] < b->values[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return (double)shared / (double)(a->count + b->count - shared);
+}
+
+double contactNameSimilarity(const char *a, const char *b) {
+    NameShingles left;
+    NameShingles right;
+    nameShingles(a, &left);
+    nameShingles(b, &right);
+    return jaccard(&left, &right);
+}
+
+// LSD radix sort on the key, a byte at a time; bytes every key shares are
+// skipped, so 32-bit keys cost four passes and not eight.
+static void sortPairs(DedupPair *pairs, DedupPair *scratch, size_t count) {
+    if (count < 2) {
+        return;
+    }
+    DedupPair *from = pairs;
+    DedupPair *to = scratch;
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {0};
+        for (size_t i = 0; i < count; i++) {
+            counts[(from[i].key >> shift) & 0xFF]++;
+        }
+        if (counts[(from[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            size_t digitCount = counts[digit];
+            counts[digit] = offset;
+            offset += digitCount;
+        }
+        for (size_t i = 0; i < count; i++) {
+            to[counts[(from[i].key >> shift) & 0xFF]++] = from[i];
+        }
+        DedupPair *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != pairs) {
+        memcpy(pairs, from, count * sizeof(DedupPair));
+    }
+}
+
+static uint32_t findRoot(uint32_t *parent, uint32_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void unite(DedupState *state, uint32_t a, uint32_t b, unsigned reason) {
+    a = findRoot(state->parent, a);
+    b = findRoot(state->parent, b);
+    if (a != b) {
+        if (state->size[a] < state->size[b]) {
+            uint32_t swap = a;
+            a = b;
+            b = swap;
+        }
+        state->parent[b] = a;
+        state->size[a] += state->size[b];
+        state->reasons[a] |= state->reasons[b];
+    }
+    state->reasons[a] |= (unsigned char)reason;
+}
+
+// Links neighbours in the sorted pairs whose keys are equal
+static void linkEqualKeys(DedupState *state, size_t count, unsigned reason) {
+    sortPairs(state->pairs, state->scratch, count);
+    for (size_t i = 1; i < count; i++) {
+        if (state->pairs[i].key == state->pairs[i - 1].key) {
+            unite(state, state->pairs[i].index, state->pairs[i - 1].index, reason);
+        }
+    }
+}
+
+static void linkPhones(DedupState *state) {
+    size_t count = 0;
+    for (uint32_t i = 0; i < state->count; i++) {
+        PhoneKey key = contactSlotAt(state->store, state->slots[i])->phoneKey;
+        if (key != PHONE_KEY_NONE) {
+            state->pairs[count++] = (DedupPair){key, i};
+        }
+    }
+    linkEqualKeys(state, count, CONTACT_DUP_PHONE);
+}
+
+// The email folded to lowercase with all whitespace removed
+static size_t normalizeEmail(const ContactStore *store, uint32_t slot, char *out) {
+    const char *domain;
+    const char *local = contactSlotEmail(store, slot, &domain);
+    const char *pieces[3] = {local, "@", domain};
+    int count = domain != NULL ? 3 : 1;
+    size_t length = 0;
+    for (int piece = 0; piece < count; piece++) {
+        for (const char *p = pieces[piece]; *p != '\0' && length < NAME_BUFFER_SIZE - 1; p++) {
+            unsigned char c = (unsigned char)*p;
+            if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+                out[length++] = (char)(c >= 'A' && c <= 'Z' ? c + 'a' - 'A' : c);
+            }
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+static void linkEmails(DedupState *state) {
+    size_t count = 0;
+    for (uint32_t i = 0; i < state->count; i++) {
+        char email[NAME_BUFFER_SIZE];
+        size_t length = normalizeEmail(state->store, state->slots[i], email);
+        if (length == 0) {
+            continue;
+        }
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t j = 0; j < length; j++) {
+            hash ^= (unsigned char)email[j];
+            hash *= 1099511628211ULL;
+        }
+        state->pairs[count++] = (DedupPair){mix64(hash), i};
+    }
+
+    // Equal hashes are checked against the emails themselves
+    sortPairs(state->pairs, state->scratch, count);
+    for (size_t i = 1; i < count; i++) {
+        if (state->pairs[i].key != state->pairs[i - 1].key) {
+            continue;
+        }
+        char a[NAME_BUFFER_SIZE];
+        char b[NAME_BUFFER_SIZE];
+        normalizeEmail(state->store, state->slots[state->pairs[i].index], a);
+        normalizeEmail(state->store, state->slots[state->pairs[i - 1].index], b);
+        if (strcmp(a, b) == 0) {
+            unite(state, state->pairs[i].index, state->pairs[i - 1].index, CONTACT_DUP_EMAIL);
+        }
+    }
+}
+
+// One hash per band of the name's MinHash signature. Each signature value
+// is the minimum over the 3-grams of a multiply-shift hash; names with
+// Jaccard similarity s share a band with probability 1 - (1 - s^3)^10.
+// Names must have the same digits to match, so the digits are hashed into
+// every band. sketch keeps the low byte of each signature value.
+static bool nameBands(const char *name, const uint64_t *multipliers, const uint64_t *offsets,
+                      uint32_t *bands, unsigned char *sketch) {
+    NameShingles shingles;
+    nameShingles(name, &shingles);
+    if (shingles.count == 0) {
+        return false;
+    }
+
+    uint32_t signature[MINHASH_SIZE];
+    for (int k = 0; k < MINHASH_SIZE; k++) {
+        signature[k] = UINT32_MAX;
+    }
+    for (size_t i = 0; i < shingles.count; i++) {
+        uint64_t hash = mix64(shingles.values[i]);
+        for (int k = 0; k < MINHASH_SIZE; k++) {
+            uint32_t value = (uint32_t)((hash * multipliers[k] + offsets[k]) >> 32);
+            if (value < signature[k]) {
+                signature[k] = value;
+            }
+        }
+    }
+
+    uint64_t digits = 14695981039346656037ULL;
+    for (const char *p = shingles.digits; *p != '\0'; p++) {
+        digits ^= (unsigned char)*p;
+        digits *= 1099511628211ULL;
+    }
+    for (int k = 0; k < MINHASH_SIZE; k++) {
+        sketch[k] = (unsigned char)signature[k];
+    }
+    for (int band = 0; band < MINHASH_BANDS; band++) {
+        const uint32_t *rows = &signature[band * MINHASH_ROWS];
+        uint64_t hash = digits ^ (uint64_t)band;
+        for (int row = 0; row < MINHASH_ROWS; row++) {
+            hash = mix64(hash ^ rows[row]);
+        }
+        bands[band] = (uint32_t)hash;
+    }
+    return true;
+}
+
+// The share of equal sketch bytes estimates the similarity, so clearly
+// different names are rejected before their 3-grams are computed
+static bool similarSketches(const unsigned char *a, const unsigned char *b, double threshold) {
+    int equal = 0;
+    for (int k = 0; k < MINHASH_SIZE; k++) {
+        equal += a[k] == b[k];
+    }
+    return equal >= (threshold - SKETCH_SLACK) * MINHASH_SIZE;
+}
+
+static bool similarNames(const DedupState *state, const NameShingles *a, uint32_t other) {
+    NameShingles b;
+    nameShingles(contactSlotName(state->store, state->slots[other]), &b);
+    // Numbers in names ("Flat 2", "Team 7") tell contacts apart
+    return strcmp(a->digits, b.digits) == 0 && jaccard(a, &b) >= state->nameThreshold;
+}
+
+// Contacts sharing a band bucket are candidates. Each is compared with at
+// most BUCKET_WINDOW earlier members of the bucket, which bounds the work
+// on huge buckets (many copies of one name) while still chaining them.
+static bool linkNames(DedupState *state) {
+    uint32_t *bands = (uint32_t *)malloc((state->count ? state->count : 1) * MINHASH_BANDS * sizeof(uint32_t));
+    unsigned char *named = (unsigned char *)malloc(state->count ? state->count : 1);
+    unsigned char *sketches = (unsigned char *)malloc((state->count ? state->count : 1) * MINHASH_SIZE);
+    if (bands == NULL || named == NULL || sketches == NULL) {
+        perror("Failed to allocate name signatures");
+        free(bands);
+        free(named);
+        free(sketches);
+        return false;
+    }
+
+    uint64_t multipliers[MINHASH_SIZE];
+    uint64_t offsets[MINHASH_SIZE];
+    for (int k = 0; k < MINHASH_SIZE; k++) {
+        multipliers[k] = mix64((uint64_t)k + 1) | 1;
+        offsets[k] = mix64((uint64_t)k + MINHASH_SIZE + 1);
+    }
+    for (uint32_t i = 0; i < state->count; i++) {
+        named[i] = nameBands(contactSlotName(state->store, state->slots[i]), multipliers, offsets,
+                             &bands[(size_t)i * MINHASH_BANDS], &sketches[(size_t)i * MINHASH_SIZE]);
+    }
+
+    for (int band = 0; band < MINHASH_BANDS; band++) {
+        size_t count = 0;
+        for (uint32_t i = 0; i < state->count; i++) {
+            if (named[i]) {
+                state->pairs[count++] = (DedupPair){bands[(size_t)i * MINHASH_BANDS + band], i};
+            }
+        }
+        sortPairs(state->pairs, state->scratch, count);
+
+        size_t bucket = 0;
+        for (size_t j = 1; j < count; j++) {
+            if (state->pairs[j].key != state->pairs[j - 1].key) {
+                bucket = j;
+                continue;
+            }
+            uint32_t index = state->pairs[j].index;
+            const unsigned char *sketch = &sketches[(size_t)index * MINHASH_SIZE];
+            NameShingles shingles;
+            shingles.count = 0;
+            size_t first = j - bucket > BUCKET_WINDOW ? j - BUCKET_WINDOW : bucket;
+            for (size_t w = j; w > first; w--) {
+                uint32_t other = state->pairs[w - 1].index;
+                if (findRoot(state->parent, index) == findRoot(state->parent, other) ||
+                    !similarSketches(sketch, &sketches[(size_t)other * MINHASH_SIZE], state->nameThreshold)) {
+                    continue;
+                }
+                if (shingles.count == 0) {
+                    nameShingles(contactSlotName(state->store, state->slots[index]), &shingles);
+                }
+                if (similarNames(state, &shingles, other)) {
+                    unite(state, index, other, CONTACT_DUP_NAME);
+                    break;
+                }
+            }
+        }
+    }
+
+    free(bands);
+    free(named);
+    free(sketches);
+    return true;
+}
+
+static bool collectClusters(DedupState *state, ContactDuplicates *out) {
+    uint32_t *clusterOf = (uint32_t *)malloc((state->count ? state->count : 1) * sizeof(uint32_t));
+    if (clusterOf == NULL) {
+        perror("Failed to collect duplicate clusters");
+        return false;
+    }
+
+    // Clusters are numbered by their first member in slot order
+    size_t clusters = 0;
+    size_t members = 0;
+    for (uint32_t i = 0; i < state->count; i++) {
+        clusterOf[i] = CLUSTER_NONE;
+    }
+    for (uint32_t i = 0; i < state->count; i++) {
+        uint32_t root = findRoot(state->parent, i);
+        if (state->size[root] < 2) {
+            continue;
+        }
+        if (clusterOf[root] == CLUSTER_NONE) {
+            clusterOf[root] = (uint32_t)clusters++;
+        }
+        members++;
+    }
+
+    out->members = (ContactHandle *)malloc((members ? members : 1) * sizeof(ContactHandle));
+    out->starts = (size_t *)calloc(clusters + 1, sizeof(size_t));
+    out->reasons = (unsigned *)malloc((clusters ? clusters : 1) * sizeof(unsigned));
+    if (out->members == NULL || out->starts == NULL || out->reasons == NULL) {
+        perror("Failed to collect duplicate clusters");
+        free(clusterOf);
+        contactDuplicatesFree(out);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < state->count; i++) {
+        uint32_t root = findRoot(state->parent, i);
+        if (clusterOf[root] != CLUSTER_NONE) {
+            out->starts[clusterOf[root] + 1]++;
+            out->reasons[clusterOf[root]] = state->reasons[root];
+        }
+    }
+    for (size_t c = 0; c < clusters; c++) {
+        out->starts[c + 1] += out->starts[c];
+    }
+
+    // Fill each cluster from its start, then shift the starts back
+    for (uint32_t i = 0; i < state->count; i++) {
+        uint32_t root = findRoot(state->parent, i);
+        if (clusterOf[root] != CLUSTER_NONE) {
+            uint32_t slot = state->slots[i];
+            ContactHandle handle = (ContactHandle)contactSlotAt(state->store, slot)->generation << 32 | slot;
+            out->members[out->starts[clusterOf[root]]++] = handle;
+        }
+    }
+    for (size_t c = clusters; c > 0; c--) {
+        out->starts[c] = out->starts[c - 1];
+    }
+    out->starts[0] = 0;
+
+    out->clusterCount = clusters;
+    out->memberCount = members;
+    free(clusterOf);
+    return true;
+}
+
+bool contactFindDuplicates(const ContactStore *store, unsigned rules, double nameThreshold,
+                           ContactDuplicates *out) {
+    memset(out, 0, sizeof(*out));
+
+    DedupState state = {0};
+    state.store = store;
+    state.nameThreshold = nameThreshold;
+    size_t entries = store->count ? store->count : 1;
+    state.slots = (uint32_t *)malloc(entries * sizeof(uint32_t));
+    state.parent = (uint32_t *)malloc(entries * sizeof(uint32_t));
+    state.size = (uint32_t *)malloc(entries * sizeof(uint32_t));
+    state.reasons = (unsigned char *)calloc(entries, 1);
+    state.pairs = (DedupPair *)malloc(entries * sizeof(DedupPair));
+    state.scratch = (DedupPair *)malloc(entries * sizeof(DedupPair));
+
+    bool ok = state.slots != NULL && state.parent != NULL && state.size != NULL &&
+              state.reasons != NULL && state.pairs != NULL && state.scratch != NULL;
+    if (!ok) {
+        perror("Failed to allocate duplicate search");
+    } else {
+        for (uint32_t slot = 0; slot < store->slotCount; slot++) {
+            if (contactSlotAt(store, slot)->live) {
+                state.parent[state.count] = (uint32_t)state.count;
+                state.size[state.count] = 1;
+                state.slots[state.count++] = slot;
+            }
+        }
+        if (rules & CONTACT_DUP_PHONE) {
+            linkPhones(&state);
+        }
+        if (rules & CONTACT_DUP_EMAIL) {
+            linkEmails(&state);
+        }
+        if (rules & CONTACT_DUP_NAME) {
+            ok = linkNames(&state);
+        }
+        ok = ok && collectClusters(&state, out);
+    }
+
+    free(state.slots);
+    free(state.parent);
+    free(state.size);
+    free(state.reasons);
+    free(state.pairs);
+    free(state.scratch);
+    return ok;
+}
+
+void contactDuplicatesFree(ContactDuplicates *duplicates) {
+    free(duplicates->members);
+    free(duplicates->starts);
+    free(duplicates->reasons);
+    memset(duplicates, 0, sizeof(*duplicates));
+}
@@ -0,0 +1,340 @@
+#include "../include/contact_index.h"
+#include "../include/contact_manager.h"
+#include "../include/contact_collate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_INITIAL_CAPACITY 64
+#define INDEX_BATCH_GROUP 16
+
+#define FNV_OFFSET 14695981039346656037ULL
+
+#define INDEX_NAME_SIZE sizeof(((Contact *)0)->name)
+
+static uint64_t hashBytes(uint64_t hash, const char *key) {
+    // FNV-1a, resumable so split keys hash like the joined string
+    while (*key) {
+        hash ^= (unsigned char)*key++;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hashInteger(uint64_t key) {
+    // splitmix64 finalizer
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    return key ^ (key >> 31);
+}
+
+// Hash of the slot's key; false when it has no phone key (not indexed).
+// Names are hashed by their collation key, so names differing only in case
+// or accents share a probe run and can be matched either way.
+static bool slotHash(const ContactIndex *index, const ContactStore *store, uint32_t slot, uint64_t *hash) {
+    switch (index->field) {
+    case CONTACT_KEY_PHONE: {
+        PhoneKey key = contactSlotAt(store, slot)->phoneKey;
+        *hash = hashInteger(key);
+        return key != PHONE_KEY_NONE;
+    }
+    case CONTACT_KEY_EMAIL: {
+        const char *domain;
+        *hash = hashBytes(FNV_OFFSET, contactSlotEmail(store, slot, &domain));
+        if (domain != NULL) {
+            *hash = hashBytes(hashBytes(*hash, "@"), domain);
+        }
+        return true;
+    }
+    default:
+        *hash = hashBytes(FNV_OFFSET, contactSlotCollation(store, slot));
+        return true;
+    }
+}
+
+static bool slotKeyEquals(const ContactIndex *index, const ContactStore *store, uint32_t slot, const char *key) {
+    if (index->field == CONTACT_KEY_EMAIL) {
+        return contactSlotEmailEquals(store, slot, key);
+    }
+    return strcmp(contactSlotName(store, slot), key) == 0;
+}
+
+static bool resizeIndex(ContactIndex *index, size_t newCapacity) {
+    IndexEntry *newEntries = (IndexEntry *)calloc(newCapacity, sizeof(IndexEntry));
+    if (newEntries == NULL) {
+        perror("Failed to grow contact index");
+        return false;
+    }
+
+    size_t mask = newCapacity - 1;
+    for (size_t i = 0; i < index->capacity; i++) {
+        IndexEntry *entry = &index->entries[i];
+        if (entry->ref == 0) {
+            continue;
+        }
+        size_t pos = entry->hash & mask;
+        while (newEntries[pos].ref != 0) {
+            pos = (pos + 1) & mask;
+        }
+        newEntries[pos] = *entry;
+    }
+
+    free(index->entries);
+    index->entries = newEntries;
+    index->capacity = newCapacity;
+    return true;
+}
+
+static bool growIndex(ContactIndex *index) {
+    return resizeIndex(index, index->capacity ? index->capacity * 2 : INDEX_INITIAL_CAPACITY);
+}
+
+void contactIndexInit(ContactIndex *index, ContactKeyField field) {
+    index->entries = NULL;
+    index->capacity = 0;
+    index->count = 0;
+    index->field = field;
+}
+
+bool contactIndexInsert(ContactIndex *index, const ContactStore *store, uint32_t slot) {
+    // Keep the load factor at or below 3/4 so probe runs stay short
+    if ((index->count + 1) * 4 > index->capacity * 3 && !growIndex(index)) {
+        return false;
+    }
+
+    uint64_t hash;
+    if (!slotHash(index, store, slot, &hash)) {
+        return true;
+    }
+
+    size_t mask = index->capacity - 1;
+    size_t pos = hash & mask;
+    while (index->entries[pos].ref != 0) {
+        pos = (pos + 1) & mask;
+    }
+
+    index->entries[pos].hash = hash;
+    index->entries[pos].ref = slot + 1;
+    index->count++;
+    return true;
+}
+
+bool contactIndexReserve(ContactIndex *index, size_t count) {
+    if (count * 4 <= index->capacity * 3) {
+        return true;
+    }
+    size_t capacity = index->capacity ? index->capacity : INDEX_INITIAL_CAPACITY;
+    while (count * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    return resizeIndex(index, capacity);
+}
+
+bool contactIndexInsertBatch(ContactIndex *index, const ContactStore *store, const uint32_t *slots, size_t count) {
+    if (!contactIndexReserve(index, index->count + count)) {
+        return false;
+    }
+
+    // Hash a group of keys and prefetch their home entries before probing,
+    // so the cache misses of a large table overlap instead of queueing
+    uint64_t hashes[INDEX_BATCH_GROUP];
+    bool keyed[INDEX_BATCH_GROUP];
+    size_t mask = index->capacity - 1;
+    for (size_t start = 0; start < count; start += INDEX_BATCH_GROUP) {
+        size_t group = count - start < INDEX_BATCH_GROUP ? count - start : INDEX_BATCH_GROUP;
+        for (size_t i = 0; i < group; i++) {
+            keyed[i] = slotHash(index, store, slots[start + i], &hashes[i]);
+            __builtin_prefetch(&index->entries[hashes[i] & mask], 1);
+        }
+
+        for (size_t i = 0; i < group; i++) {
+            if (!keyed[i]) {
+                continue;
+            }
+            size_t pos = hashes[i] & mask;
+            while (index->entries[pos].ref != 0) {
+                pos = (pos + 1) & mask;
+            }
+            index->entries[pos].hash = hashes[i];
+            index->entries[pos].ref = slots[start + i] + 1;
+            index->count++;
+        }
+    }
+    return true;
+}
+
+bool contactIndexMerge(ContactIndex *index, const ContactIndex *src, uint32_t offset) {
+    if (!contactIndexReserve(index, index->count + src->count)) {
+        return false;
+    }
+
+    // The stored hashes are reused; grouping overlaps the misses as above
+    const IndexEntry *group[INDEX_BATCH_GROUP];
+    size_t mask = index->capacity - 1;
+    size_t next = 0;
+    while (next < src->capacity) {
+        size_t size = 0;
+        for (; next < src->capacity && size < INDEX_BATCH_GROUP; next++) {
+            if (src->entries[next].ref != 0) {
+                group[size++] = &src->entries[next];
+                __builtin_prefetch(&index->entries[src->entries[next].hash & mask], 1);
+            }
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            size_t pos = group[i]->hash & mask;
+            while (index->entries[pos].ref != 0) {
+                pos = (pos + 1) & mask;
+            }
+            index->entries[pos].hash = group[i]->hash;
+            index->entries[pos].ref = group[i]->ref + offset;
+            index->count++;
+        }
+    }
+    return true;
+}
+
+// Collation key of a looked-up name; false when the name is longer than
+// any stored one, so nothing can match it
+static bool collateName(const char *name, char *key) {
+    size_t length = strlen(name);
+    if (length >= INDEX_NAME_SIZE) {
+        return false;
+    }
+    contactCollate(name, length, key);
+    return true;
+}
+
+uint32_t contactIndexFind(const ContactIndex *index, const ContactStore *store, const char *key) {
+    if (index->count == 0) {
+        return CONTACT_SLOT_NONE;
+    }
+
+    char collated[INDEX_NAME_SIZE];
+    if (index->field == CONTACT_KEY_NAME && !collateName(key, collated)) {
+        return CONTACT_SLOT_NONE;
+    }
+    uint64_t hash = hashBytes(FNV_OFFSET, index->field == CONTACT_KEY_NAME ? collated : key);
+    size_t mask = index->capacity - 1;
+    size_t pos = hash & mask;
+    while (index->entries[pos].ref != 0) {
+        const IndexEntry *entry = &index->entries[pos];
+        if (entry->hash == hash && slotKeyEquals(index, store, entry->ref - 1, key)) {
+            return entry->ref - 1;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    return CONTACT_SLOT_NONE;
+}
+
+uint32_t contactIndexFindCollated(const ContactIndex *index, const ContactStore *store, const char *name) {
+    char key[INDEX_NAME_SIZE];
+    if (index->count == 0 || !collateName(name, key)) {
+        return CONTACT_SLOT_NONE;
+    }
+
+    // The probe run holds every name with this key, so walk all of it
+    uint64_t hash = hashBytes(FNV_OFFSET, key);
+    uint32_t found = CONTACT_SLOT_NONE;
+    size_t mask = index->capacity - 1;
+    size_t pos = hash & mask;
+    while (index->entries[pos].ref != 0) {
+        const IndexEntry *entry = &index->entries[pos];
+        if (entry->hash == hash && strcmp(contactSlotCollation(store, entry->ref - 1), key) == 0) {
+            if (found != CONTACT_SLOT_NONE) {
+                return CONTACT_SLOT_NONE;
+            }
+            found = entry->ref - 1;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return found;
+}
+
+uint32_t contactIndexFindKey(const ContactIndex *index, const ContactStore *store, uint64_t key) {
+    if (index->count == 0 || key == 0) {
+        return CONTACT_SLOT_NONE;
+    }
+
+    uint64_t hash = hashInteger(key);
+    size_t mask = index->capacity - 1;
+    size_t pos = hash & mask;
+    while (index->entries[pos].ref != 0) {
+        const IndexEntry *entry = &index->entries[pos];
+        if (entry->hash == hash && contactSlotAt(store, entry->ref - 1)->phoneKey == key) {
+            return entry->ref - 1;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    return CONTACT_SLOT_NONE;
+}
+
+bool contactIndexRemove(ContactIndex *index, const ContactStore *store, uint32_t slot) {
+    if (index->count == 0) {
+        return false;
+    }
+
+    uint64_t hash;
+    if (!slotHash(index, store, slot, &hash)) {
+        return false;
+    }
+
+    size_t mask = index->capacity - 1;
+    size_t pos = hash & mask;
+    while (index->entries[pos].ref != slot + 1) {
+        if (index->entries[pos].ref == 0) {
+            return false;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // hole so lookups never need tombstones.
+    size_t hole = pos;
+    size_t next = (hole + 1) & mask;
+    while (index->entries[next].ref != 0) {
+        size_t home = index->entries[next].hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index->entries[hole] = index->entries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    index->entries[hole].ref = 0;
+    index->entries[hole].hash = 0;
+    index->count--;
+    return true;
+}
+
+void contactIndexClear(ContactIndex *index) {
+    if (index->entries != NULL) {
+        memset(index->entries, 0, index->capacity * sizeof(IndexEntry));
+    }
+    index->count = 0;
+}
+
+bool contactIndexCopy(ContactIndex *dest, const ContactIndex *src) {
+    *dest = *src;
+    if (src->entries == NULL) {
+        return true;
+    }
+    dest->entries = (IndexEntry *)malloc(src->capacity * sizeof(IndexEntry));
+    if (dest->entries == NULL) {
+        perror("Failed to copy contact index");
+        contactIndexInit(dest, src->field);
+        return false;
+    }
+    memcpy(dest->entries, src->entries, src->capacity * sizeof(IndexEntry));
+    return true;
+}
+
+void contactIndexFree(ContactIndex *index) {
+    free(index->entries);
+    index->entries = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
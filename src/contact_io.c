@@ -0,0 +1,384 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t start;
+    size_t end;
+    bool eof;
+    bool discarding;   // skipping the rest of a line longer than the buffer
+    size_t overlong;
+    size_t bytes;
+} LineReader;
+
+typedef struct {
+    ContactStore *store;
+    Contact *contacts;
+    size_t count;
+    ContactIoStats *stats;
+} ImportBatch;
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Returns the next line without its terminator, NUL-terminated in place,
+// or NULL at end of input. Lines stay valid until the next call.
+static char *readLine(LineReader *reader) {
+    for (;;) {
+        char *begin = reader->buffer + reader->start;
+        char *newline = (char *)memchr(begin, '\n', reader->end - reader->start);
+
+        if (newline != NULL || (reader->eof && reader->start < reader->end)) {
+            char *stop = newline != NULL ? newline : reader->buffer + reader->end;
+            reader->start = (size_t)(stop - reader->buffer) + (newline != NULL);
+            if (reader->discarding) {
+                reader->discarding = false;
+                reader->overlong++;
+                continue;
+            }
+            if (stop > begin && stop[-1] == '\r') {
+                stop--;
+            }
+            *stop = '\0';
+            return begin;
+        }
+        if (reader->eof) {
+            return NULL;
+        }
+
+        // Keep the partial line and refill behind it
+        memmove(reader->buffer, begin, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+        if (reader->end == CONTACT_IO_BUFFER_SIZE) {
+            reader->discarding = true;
+            reader->end = 0;
+        }
+
+        ssize_t got = read(reader->fd, reader->buffer + reader->end, CONTACT_IO_BUFFER_SIZE - reader->end);
+        if (got <= 0) {
+            reader->eof = true;
+        } else {
+            reader->end += (size_t)got;
+            reader->bytes += (size_t)got;
+        }
+    }
+}
+
+static bool copyField(char *dest, size_t size, const char *src, size_t length) {
+    if (length >= size) {
+        return false;
+    }
+    memcpy(dest, src, length);
+    dest[length] = '\0';
+    return true;
+}
+
+static bool parseCsvLine(const char *line, Contact *contact) {
+    char *fields[3] = {contact->name, contact->phone, contact->email};
+    size_t sizes[3] = {sizeof(contact->name), sizeof(contact->phone), sizeof(contact->email)};
+    const char *p = line;
+
+    for (int f = 0; f < 3; f++) {
+        if (*p == '"') {
+            size_t length = 0;
+            p++;
+            for (;;) {
+                char c;
+                if (*p == '\0') {
+                    return false;
+                } else if (*p == '"' && p[1] == '"') {
+                    c = '"';
+                    p += 2;
+                } else if (*p == '"') {
+                    p++;
+                    break;
+                } else {
+                    c = *p++;
+                }
+                if (length + 1 >= sizes[f]) {
+                    return false;
+                }
+                fields[f][length++] = c;
+            }
+            fields[f][length] = '\0';
+        } else {
+            size_t length = strcspn(p, ",");
+            if (!copyField(fields[f], sizes[f], p, length)) {
+                return false;
+            }
+            p += length;
+        }
+
+        if (f < 2) {
+            if (*p != ',') {
+                return false;
+            }
+            p++;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+    return contact->name[0] != '\0';
+}
+
+// Copies a vCard value, undoing \, \; \\ and \n escapes
+static bool copyVcardValue(char *dest, size_t size, const char *src) {
+    size_t length = 0;
+    for (const char *p = src; *p != '\0'; p++) {
+        char c = *p;
+        if (c == '\\' && p[1] != '\0') {
+            p++;
+            c = (*p == 'n' || *p == 'N') ? ' ' : *p;
+        }
+        if (length + 1 >= size) {
+            return false;
+        }
+        dest[length++] = c;
+    }
+    dest[length] = '\0';
+    return true;
+}
+
+static void flushBatch(ImportBatch *batch) {
+    ContactStore *store = batch->store;
+    reserveContacts(store, store->count + batch->count);
+
+    for (size_t i = 0; i < batch->count; i++) {
+        const Contact *contact = &batch->contacts[i];
+        if (findContactHandle(store, contact->name) != CONTACT_HANDLE_NONE) {
+            batch->stats->duplicates++;
+        } else if (addContact(store, contact) != CONTACT_HANDLE_NONE) {
+            batch->stats->imported++;
+        } else {
+            batch->stats->invalid++;
+        }
+    }
+    batch->count = 0;
+}
+
+static void queueContact(ImportBatch *batch, const Contact *contact) {
+    batch->stats->records++;
+    batch->contacts[batch->count++] = *contact;
+    if (batch->count == CONTACT_IMPORT_BATCH_SIZE) {
+        flushBatch(batch);
+    }
+}
+
+static void importCsv(LineReader *reader, ImportBatch *batch) {
+    char *line;
+    bool first = true;
+    while ((line = readLine(reader)) != NULL) {
+        if (line[0] == '\0') {
+            continue;
+        }
+
+        Contact contact;
+        bool valid = parseCsvLine(line, &contact);
+        if (first && valid && strcasecmp(contact.name, "name") == 0) {
+            first = false;
+            continue;
+        }
+        first = false;
+
+        if (valid) {
+            queueContact(batch, &contact);
+        } else {
+            batch->stats->invalid++;
+        }
+    }
+}
+
+static void importVcard(LineReader *reader, ImportBatch *batch) {
+    Contact contact;
+    bool inCard = false;
+    bool valid = false;
+    char *line;
+
+    while ((line = readLine(reader)) != NULL) {
+        if (strcasecmp(line, "BEGIN:VCARD") == 0) {
+            memset(&contact, 0, sizeof(contact));
+            inCard = true;
+            valid = true;
+            continue;
+        }
+        if (!inCard) {
+            continue;
+        }
+        if (strcasecmp(line, "END:VCARD") == 0) {
+            if (valid && contact.name[0] != '\0') {
+                queueContact(batch, &contact);
+            } else {
+                batch->stats->invalid++;
+            }
+            inCard = false;
+            continue;
+        }
+
+        // Property names may carry a group prefix (item1.EMAIL) and
+        // parameters (TEL;TYPE=cell); folded continuation lines are ignored
+        char *colon = strchr(line, ':');
+        if (colon == NULL || line[0] == ' ' || line[0] == '\t') {
+            continue;
+        }
+        *colon = '\0';
+        line[strcspn(line, ";")] = '\0';
+        char *dot = strrchr(line, '.');
+        const char *property = dot != NULL ? dot + 1 : line;
+        const char *value = colon + 1;
+
+        if (strcasecmp(property, "FN") == 0) {
+            valid = copyVcardValue(contact.name, sizeof(contact.name), value) && valid;
+        } else if (strcasecmp(property, "TEL") == 0 && contact.phone[0] == '\0') {
+            valid = copyVcardValue(contact.phone, sizeof(contact.phone), value) && valid;
+        } else if (strcasecmp(property, "EMAIL") == 0 && contact.email[0] == '\0') {
+            valid = copyVcardValue(contact.email, sizeof(contact.email), value) && valid;
+        }
+    }
+}
+
+ContactFormat contactFormatForFile(const char *filename) {
+    const char *extension = strrchr(filename, '.');
+    if (extension != NULL && (strcasecmp(extension, ".vcf") == 0 || strcasecmp(extension, ".vcard") == 0)) {
+        return CONTACT_FORMAT_VCARD;
+    }
+    return CONTACT_FORMAT_CSV;
+}
+
+bool importContacts(ContactStore *store, const char *filename, ContactFormat format, ContactIoStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open file for import");
+        return false;
+    }
+
+    // One spare byte so the last line can always be terminated in place
+    LineReader reader = {.fd = fd};
+    reader.buffer = (char *)malloc(CONTACT_IO_BUFFER_SIZE + 1);
+    ImportBatch batch = {store, (Contact *)malloc(CONTACT_IMPORT_BATCH_SIZE * sizeof(Contact)), 0, stats};
+    if (reader.buffer == NULL || batch.contacts == NULL) {
+        perror("Failed to allocate import buffers");
+        free(reader.buffer);
+        free(batch.contacts);
+        close(fd);
+        return false;
+    }
+
+    double start = nowSeconds();
+    if (format == CONTACT_FORMAT_VCARD) {
+        importVcard(&reader, &batch);
+    } else {
+        importCsv(&reader, &batch);
+    }
+    flushBatch(&batch);
+
+    stats->invalid += reader.overlong;
+    stats->bytes = reader.bytes;
+    stats->seconds = nowSeconds() - start;
+    stats->recordsPerSecond = stats->seconds > 0 ? stats->records / stats->seconds : 0;
+
+    free(reader.buffer);
+    free(batch.contacts);
+    close(fd);
+    return true;
+}
+
+static void writeCsvField(FILE *file, const char *field) {
+    if (strpbrk(field, ",\"\r\n") == NULL) {
+        fputs(field, file);
+        return;
+    }
+    fputc('"', file);
+    for (const char *p = field; *p != '\0'; p++) {
+        if (*p == '"') {
+            fputc('"', file);
+        }
+        fputc(*p, file);
+    }
+    fputc('"', file);
+}
+
+static void writeVcardValue(FILE *file, const char *value) {
+    if (strpbrk(value, ",;\\\n") == NULL) {
+        fputs(value, file);
+        return;
+    }
+    for (const char *p = value; *p != '\0'; p++) {
+        if (*p == ',' || *p == ';' || *p == '\\') {
+            fputc('\\', file);
+        } else if (*p == '\n') {
+            fputs("\\n", file);
+            continue;
+        }
+        fputc(*p, file);
+    }
+}
+
+bool exportContacts(const ContactStore *store, const char *filename, ContactFormat format, ContactIoStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        perror("Failed to open file for export");
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, CONTACT_IO_BUFFER_SIZE);
+
+    double start = nowSeconds();
+    if (format == CONTACT_FORMAT_CSV) {
+        fputs("name,phone,email\n", file);
+    }
+
+    ContactIterator it;
+    const Contact *contact;
+    contactIteratorInit(&it, store);
+    while ((contact = contactIteratorNext(&it)) != NULL) {
+        if (format == CONTACT_FORMAT_VCARD) {
+            fputs("BEGIN:VCARD\r\nVERSION:3.0\r\nFN:", file);
+            writeVcardValue(file, contact->name);
+            if (contact->phone[0] != '\0') {
+                fputs("\r\nTEL:", file);
+                writeVcardValue(file, contact->phone);
+            }
+            if (contact->email[0] != '\0') {
+                fputs("\r\nEMAIL:", file);
+                writeVcardValue(file, contact->email);
+            }
+            fputs("\r\nEND:VCARD\r\n", file);
+        } else {
+            writeCsvField(file, contact->name);
+            fputc(',', file);
+            writeCsvField(file, contact->phone);
+            fputc(',', file);
+            writeCsvField(file, contact->email);
+            fputc('\n', file);
+        }
+        stats->records++;
+    }
+
+    long size = ftell(file);
+    bool ok = !ferror(file);
+    if (fclose(file) != 0 || !ok) {
+        perror("Failed to write export file");
+        return false;
+    }
+
+    stats->bytes = size > 0 ? (size_t)size : 0;
+    stats->seconds = nowSeconds() - start;
+    stats->recordsPerSecond = stats->seconds > 0 ? stats->records / stats->seconds : 0;
+    return true;
+}
@@ -0,0 +1,298 @@
+#include "../include/contact_lazy.h"
+#include "../include/contact_collate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool lazyLoading;
+
+void contactLazySetEnabled(bool enabled) {
+    lazyLoading = enabled;
+}
+
+bool contactLazyEnabled(void) {
+    return lazyLoading;
+}
+
+static void releaseFile(ContactLazyFile *file) {
+    if (file == NULL || --file->references > 0) {
+        return;
+    }
+    contactPackClose(&file->pack);
+    contactTagSetFree(&file->ranks);
+    free(file->fences);
+    free(file->firstRanks);
+    free(file);
+}
+
+static const char *fenceAt(const ContactLazyFile *file, size_t block) {
+    return file->fences + block * CONTACT_LAZY_NAME_SIZE;
+}
+
+// The last block whose first name is not past name: blocks are in name
+// order, so name can only be there. Names before the first block's map to it.
+static size_t fenceBlock(const ContactLazyFile *file, const char *name) {
+    size_t low = 0;
+    size_t high = (size_t)file->pack.header->blockCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (strcmp(fenceAt(file, middle), name) <= 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low > 0 ? low - 1 : 0;
+}
+
+static ContactLazyFile *openFile(const char *filename) {
+    ContactLazyFile *file = (ContactLazyFile *)calloc(1, sizeof(ContactLazyFile));
+    if (file == NULL) {
+        perror("Failed to open contacts lazily");
+        return NULL;
+    }
+    file->references = 1;
+    if (contactPackOpen(&file->pack, filename) != CONTACT_DB_OK || contactPackCount(&file->pack) == 0) {
+        releaseFile(file);
+        return NULL;
+    }
+    snprintf(file->filename, sizeof(file->filename), "%s", filename);
+
+    size_t blocks = (size_t)file->pack.header->blockCount;
+    file->fences = (char *)malloc(blocks * CONTACT_LAZY_NAME_SIZE);
+    file->firstRanks = (uint32_t *)malloc(blocks * sizeof(uint32_t));
+    if (file->fences == NULL || file->firstRanks == NULL) {
+        perror("Failed to open contacts lazily");
+        releaseFile(file);
+        return NULL;
+    }
+
+    // Reading the first record of every block touches one page per block,
+    // not the whole file; the blocks are only verified when faulted in
+    uint64_t rank = 0;
+    for (size_t block = 0; block < blocks; block++) {
+        if (!contactPackFirstName(&file->pack, block, file->fences + block * CONTACT_LAZY_NAME_SIZE,
+                                  CONTACT_LAZY_NAME_SIZE) ||
+            (block > 0 && strcmp(fenceAt(file, block - 1), fenceAt(file, block)) > 0)) {
+            releaseFile(file);
+            return NULL;
+        }
+        file->firstRanks[block] = (uint32_t)rank;
+        rank += file->pack.blocks[block].recordCount;
+    }
+    if (rank != contactPackCount(&file->pack)) {
+        releaseFile(file);
+        return NULL;
+    }
+
+    contactTagsRead(filename, file->pack.header->headerChecksum, (size_t)rank, &file->ranks);
+    return file;
+}
+
+bool contactLazyOpen(ContactStore *store, const char *filename) {
+    if (store->slotCount != 0 || store->history != NULL || store->lazy != NULL) {
+        return false;
+    }
+    ContactLazyFile *file = openFile(filename);
+    if (file == NULL) {
+        return false;
+    }
+
+    size_t blocks = (size_t)file->pack.header->blockCount;
+    ContactLazy *lazy = (ContactLazy *)malloc(sizeof(ContactLazy));
+    unsigned char *faulted = (unsigned char *)calloc(blocks, 1);
+    if (lazy == NULL || faulted == NULL) {
+        perror("Failed to open contacts lazily");
+        free(lazy);
+        free(faulted);
+        releaseFile(file);
+        return false;
+    }
+    lazy->file = file;
+    lazy->faulted = faulted;
+    lazy->unfaulted = blocks;
+    lazy->pending = contactPackCount(&file->pack);
+    store->lazy = lazy;
+    return true;
+}
+
+// Adds the block's contacts as if they had always been there: nothing is
+// logged, and the store is detached from its lazy state meanwhile, so the
+// adds do not fault anything in themselves.
+static bool faultBlock(ContactStore *store, size_t block) {
+    ContactLazy *lazy = store->lazy;
+    ContactLazyFile *file = lazy->file;
+    if (lazy->faulted[block]) {
+        return true;
+    }
+
+    size_t capacity = file->pack.header->blockRecords;
+    Contact *records = (Contact *)malloc(capacity * sizeof(Contact));
+    ContactHandle *handles = (ContactHandle *)malloc(capacity * sizeof(ContactHandle));
+    uint32_t *slots = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    if (records == NULL || handles == NULL || slots == NULL) {
+        perror("Failed to fault in contacts");
+        free(records);
+        free(handles);
+        free(slots);
+        return false;
+    }
+
+    size_t count;
+    if (!contactPackDecodeBlock(&file->pack, block, records, &count)) {
+        fprintf(stderr, "Skipping damaged block %zu in %s\n", block, file->filename);
+        count = 0;
+    }
+    struct ContactWal *wal = store->wal;
+    store->wal = NULL;
+    store->lazy = NULL;
+    size_t added = addContacts(store, records, count, handles);
+    for (size_t i = 0; i < added; i++) {
+        slots[i] = (uint32_t)handles[i];
+    }
+    bool ok = added == count && contactTagsApply(store, &file->ranks, file->firstRanks[block], slots, added);
+    store->lazy = lazy;
+    store->wal = wal;
+
+    // Even a block that did not fit is not retried, which would add its
+    // first contacts twice
+    lazy->faulted[block] = 1;
+    lazy->unfaulted--;
+    lazy->pending -= file->pack.blocks[block].recordCount;
+    free(records);
+    free(handles);
+    free(slots);
+    return ok;
+}
+
+bool contactLazyFaultName(ContactStore *store, const char *name) {
+    if (store->lazy == NULL) {
+        return true;
+    }
+    if (!faultBlock(store, fenceBlock(store->lazy->file, name))) {
+        return false;
+    }
+    if (store->lazy->unfaulted == 0) {
+        contactLazyFree(store);
+    }
+    return true;
+}
+
+bool contactLazyFaultCollated(ContactStore *store, const char *name) {
+    ContactLazy *lazy = store->lazy;
+    size_t length = strlen(name);
+    if (lazy == NULL || length >= CONTACT_LAZY_NAME_SIZE) {
+        return true;
+    }
+    char key[CONTACT_LAZY_NAME_SIZE];
+    char other[CONTACT_LAZY_NAME_SIZE];
+    contactCollate(name, length, key);
+
+    ContactLazyFile *file = lazy->file;
+    size_t blocks = (size_t)file->pack.header->blockCount;
+    Contact *records = (Contact *)malloc(file->pack.header->blockRecords * sizeof(Contact));
+    if (records == NULL) {
+        perror("Failed to fault in contacts");
+        return false;
+    }
+    bool ok = true;
+    for (size_t block = 0; block < blocks && ok; block++) {
+        size_t count;
+        if (lazy->faulted[block] || !contactPackDecodeBlock(&file->pack, block, records, &count)) {
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            contactCollate(records[i].name, strlen(records[i].name), other);
+            if (strcmp(key, other) == 0) {
+                ok = faultBlock(store, block);
+                break;
+            }
+        }
+    }
+    free(records);
+    if (ok && lazy->unfaulted == 0) {
+        contactLazyFree(store);
+    }
+    return ok;
+}
+
+bool contactLazyLoadAll(ContactStore *store) {
+    if (store->lazy == NULL) {
+        return true;
+    }
+    ContactLazy *lazy = store->lazy;
+    size_t blocks = (size_t)lazy->file->pack.header->blockCount;
+    reserveContacts(store, store->count + lazy->pending);
+    for (size_t block = 0; block < blocks; block++) {
+        if (!faultBlock(store, block)) {
+            return false;
+        }
+    }
+    contactLazyFree(store);
+    return true;
+}
+
+size_t contactLazyPending(const ContactStore *store) {
+    return store->lazy != NULL ? store->lazy->pending : 0;
+}
+
+bool contactLazyFind(const ContactStore *store, const char *name, Contact *out) {
+    const ContactLazy *lazy = store->lazy;
+    if (lazy == NULL) {
+        return false;
+    }
+    size_t block = fenceBlock(lazy->file, name);
+    return !lazy->faulted[block] && contactPackFindInBlock(&lazy->file->pack, block, name, out);
+}
+
+bool contactLazyCopy(ContactStore *dest, const ContactStore *src) {
+    const ContactLazy *lazy = src->lazy;
+    if (lazy == NULL) {
+        return true;
+    }
+    size_t blocks = (size_t)lazy->file->pack.header->blockCount;
+    ContactLazy *copy = (ContactLazy *)malloc(sizeof(ContactLazy));
+    unsigned char *faulted = (unsigned char *)malloc(blocks);
+    if (copy == NULL || faulted == NULL) {
+        perror("Failed to copy lazy contacts");
+        free(copy);
+        free(faulted);
+        return false;
+    }
+    memcpy(faulted, lazy->faulted, blocks);
+    *copy = *lazy;
+    copy->faulted = faulted;
+    copy->file->references++;
+    dest->lazy = copy;
+    return true;
+}
+
+void contactLazyFree(ContactStore *store) {
+    ContactLazy *lazy = store->lazy;
+    if (lazy == NULL) {
+        return;
+    }
+    releaseFile(lazy->file);
+    free(lazy->faulted);
+    free(lazy);
+    store->lazy = NULL;
+}
+
+// The file part is counted whole in every store sharing it; the mapping
+// itself is not, the OS pages it in and out.
+size_t contactLazyBytes(const ContactStore *store) {
+    const ContactLazy *lazy = store->lazy;
+    if (lazy == NULL) {
+        return 0;
+    }
+    const ContactLazyFile *file = lazy->file;
+    size_t blocks = (size_t)file->pack.header->blockCount;
+    size_t bytes = sizeof(ContactLazy) + blocks + sizeof(ContactLazyFile) +
+                   blocks * (CONTACT_LAZY_NAME_SIZE + sizeof(uint32_t)) +
+                   file->pack.domainCount * sizeof(ContactPackDomain) +
+                   file->ranks.capacity * sizeof(ContactTag);
+    for (size_t i = 0; i < file->ranks.count; i++) {
+        bytes += contactBitmapBytes(&file->ranks.tags[i].members);
+    }
+    return bytes;
+}
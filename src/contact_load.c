@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_load.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static unsigned loadThreads;
+
+void contactLoadSetThreads(unsigned threads) {
+    loadThreads = threads;
+}
+
+static unsigned loadWorkers(const ContactStore *store, const ContactPack *pack) {
+    if (store->slotCount != 0 || store->wal != NULL || store->history != NULL ||
+        contactPackCount(pack) < CONTACT_LOAD_PARALLEL_MIN) {
+        return 1;
+    }
+    unsigned threads = loadThreads;
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    if (threads > CONTACT_LOAD_MAX_THREADS) {
+        threads = CONTACT_LOAD_MAX_THREADS;
+    }
+    return threads < pack->header->blockCount ? threads : (unsigned)pack->header->blockCount;
+}
+
+typedef struct {
+    const ContactPack *pack;
+    const char *filename;
+    size_t firstBlock;
+    size_t endBlock;
+    ContactStore *store;
+    size_t damaged;
+    bool failed;
+} LoadTask;
+
+// Adds blocks [firstBlock, endBlock) to the task's store.
+static void *loadBlocks(void *arg) {
+    LoadTask *task = (LoadTask *)arg;
+    const ContactPack *pack = task->pack;
+    Contact *batch = (Contact *)malloc(pack->header->blockRecords * sizeof(Contact));
+    if (batch == NULL) {
+        perror("Failed to allocate load buffer");
+        task->failed = true;
+        return NULL;
+    }
+
+    size_t records = 0;
+    for (size_t block = task->firstBlock; block < task->endBlock; block++) {
+        records += pack->blocks[block].recordCount;
+    }
+    reserveContacts(task->store, task->store->count + records);
+    for (size_t block = task->firstBlock; block < task->endBlock && !task->failed; block++) {
+        size_t count;
+        if (!contactPackDecodeBlock(pack, block, batch, &count)) {
+            fprintf(stderr, "Skipping damaged block %zu in %s\n", block, task->filename);
+            task->damaged++;
+            continue;
+        }
+        task->failed = addContacts(task->store, batch, count, NULL) < count;
+    }
+    free(batch);
+    return NULL;
+}
+
+// Every worker starts with the store's secondary indexes and a name filter
+// sized for the whole file, so the parts' filters can be or-ed together.
+static bool initPart(ContactStore *part, const ContactStore *store, size_t total) {
+    memset(part, 0, sizeof(*part));
+    return enableContactIndexes(part, store->indexFlags) && contactBloomReserve(part, total);
+}
+
+static bool loadParallel(ContactStore *store, const ContactPack *pack, const char *filename, unsigned workers,
+                         size_t *damaged) {
+    ContactStore parts[CONTACT_LOAD_MAX_THREADS];
+    LoadTask tasks[CONTACT_LOAD_MAX_THREADS];
+    pthread_t threads[CONTACT_LOAD_MAX_THREADS];
+    bool started[CONTACT_LOAD_MAX_THREADS];
+    size_t total = contactPackCount(pack);
+    size_t blocks = pack->header->blockCount;
+
+    bool ready = true;
+    for (unsigned i = 0; i < workers; i++) {
+        ready = initPart(&parts[i], store, total) && ready;
+        tasks[i] = (LoadTask){pack, filename, blocks * i / workers, blocks * (i + 1) / workers, &parts[i], 0, false};
+    }
+    for (unsigned i = 0; ready && i < workers; i++) {
+        started[i] = pthread_create(&threads[i], NULL, loadBlocks, &tasks[i]) == 0;
+        if (!started[i]) {
+            loadBlocks(&tasks[i]);
+        }
+    }
+
+    *damaged = 0;
+    bool failed = !ready;
+    for (unsigned i = 0; ready && i < workers; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+        *damaged += tasks[i].damaged;
+        failed = failed || tasks[i].failed;
+    }
+
+    if (!failed && contactStoreMerge(store, parts, workers)) {
+        return true;
+    }
+    for (unsigned i = 0; i < workers; i++) {
+        freeContacts(&parts[i]);
+    }
+    fprintf(stderr, "Failed to load %s in parallel, loading it serially\n", filename);
+    return false;
+}
+
+size_t contactLoadPack(ContactStore *store, const ContactPack *pack, const char *filename) {
+    unsigned workers = loadWorkers(store, pack);
+    size_t damaged;
+    if (workers > 1 && loadParallel(store, pack, filename, workers, &damaged)) {
+        return damaged;
+    }
+
+    LoadTask task = {pack, filename, 0, pack->header->blockCount, store, 0, false};
+    loadBlocks(&task);
+    return task.damaged;
+}
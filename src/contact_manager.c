@@ -1,24 +1,705 @@
 #include "../include/contact_manager.h"
+#include "../include/contact_db.h"
+#include "../include/contact_pack.h"
+#include "../include/contact_load.h"
+#include "../include/contact_wal.h"
+#include "../include/contact_view.h"
+#include "../include/contact_version.h"
+#include "../include/contact_tags.h"
+#include "../include/contact_lazy.h"
+#include "../include/contact_collate.h"
 #include "../include/ui_utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
-void addContact(ContactNode **head, const Contact *contact) {
-    ContactNode *newNode = (ContactNode *)malloc(sizeof(ContactNode));
-    if (newNode == NULL) {
-        perror("Failed to allocate memory for new contact");
+#define LOAD_BATCH_SIZE 256
+#define ADD_BATCH_GROUP 256
+#define ORDER_COMPACT_MIN 1024
+
+static ContactHandle makeHandle(uint32_t slot, uint32_t generation) {
+    return ((ContactHandle)generation << 32) | slot;
+}
+
+static bool growSlabs(ContactStore *store) {
+    if (store->slabCount == store->slabCapacity) {
+        size_t newCapacity = store->slabCapacity ? store->slabCapacity * 2 : 4;
+        ContactSlot **newSlabs = (ContactSlot **)realloc(store->slabs, newCapacity * sizeof(ContactSlot *));
+        if (newSlabs == NULL) {
+            perror("Failed to grow contact slab directory");
+            return false;
+        }
+        store->slabs = newSlabs;
+        store->slabCapacity = newCapacity;
+    }
+
+    ContactSlot *slab = (ContactSlot *)calloc(CONTACT_SLAB_SIZE, sizeof(ContactSlot));
+    if (slab == NULL) {
+        perror("Failed to allocate contact slab");
+        return false;
+    }
+
+    store->slabs[store->slabCount++] = slab;
+    return true;
+}
+
+static uint32_t takeSlot(ContactStore *store) {
+    if (store->freeHead != 0) {
+        uint32_t slot = store->freeHead - 1;
+        store->freeHead = contactSlotAt(store, slot)->nextFree;
+        return slot;
+    }
+
+    if (store->slotCount == store->slabCount * CONTACT_SLAB_SIZE && !growSlabs(store)) {
+        return CONTACT_SLOT_NONE;
+    }
+    return (uint32_t)store->slotCount++;
+}
+
+static size_t boundedLength(const char *field, size_t size) {
+    const char *end = (const char *)memchr(field, '\0', size - 1);
+    return end != NULL ? (size_t)(end - field) : size - 1;
+}
+
+// Pack a contact's strings into a new arena record, splitting the email at
+// its first '@', interning the domain and adding the name's collation key.
+static uint32_t packContact(ContactStore *store, const Contact *contact, uint32_t *domain) {
+    char key[sizeof(contact->name)];
+    const char *fields[4] = {contact->name, contact->phone, contact->email, key};
+    size_t lengths[4] = {
+        boundedLength(contact->name, sizeof(contact->name)),
+        boundedLength(contact->phone, sizeof(contact->phone)),
+        boundedLength(contact->email, sizeof(contact->email)),
+        0
+    };
+    lengths[3] = contactCollate(contact->name, lengths[0], key);
+
+    *domain = 0;
+    const char *at = (const char *)memchr(contact->email, '@', lengths[2]);
+    if (at != NULL && at + 1 < contact->email + lengths[2]) {
+        size_t local = (size_t)(at - contact->email);
+        *domain = stringPoolIntern(&store->domains, at + 1, lengths[2] - local - 1);
+        if (*domain == 0) {
+            return STRING_REF_NONE;
+        }
+        lengths[2] = local;
+    }
+
+    uint32_t ref = stringArenaAlloc(&store->records, lengths[0] + lengths[1] + lengths[2] + lengths[3] + 8);
+    if (ref == STRING_REF_NONE) {
+        return STRING_REF_NONE;
+    }
+
+    unsigned char *p = stringArenaAt(&store->records, ref);
+    for (int field = 0; field < 4; field++) {
+        *p++ = (unsigned char)lengths[field];
+        memcpy(p, fields[field], lengths[field]);
+        p += lengths[field];
+        *p++ = '\0';
+    }
+    return ref;
+}
+
+static const Contact emptyContact;
+
+static void unpackContact(const ContactStore *store, uint32_t slot, Contact *out) {
+    const char *name = contactSlotName(store, slot);
+    const char *phone = contactSlotPhone(store, slot);
+    const char *domain;
+    const char *local = contactSlotEmail(store, slot, &domain);
+
+    // Fields are short: plain byte loops beat the block moves the compiler
+    // would inline for memset/memcpy here
+    *out = emptyContact;
+    for (size_t i = 0; name[i] != '\0'; i++) {
+        out->name[i] = name[i];
+    }
+    for (size_t i = 0; phone[i] != '\0'; i++) {
+        out->phone[i] = phone[i];
+    }
+    size_t length = 0;
+    for (; local[length] != '\0'; length++) {
+        out->email[length] = local[length];
+    }
+    if (domain != NULL) {
+        out->email[length++] = '@';
+        for (size_t i = 0; domain[i] != '\0'; i++) {
+            out->email[length + i] = domain[i];
+        }
+    }
+}
+
+static void releaseRecord(ContactStore *store, uint32_t record) {
+    stringArenaRelease(&store->records, contactRecordLength(stringArenaAt(&store->records, record)));
+}
+
+static uint32_t moveRecord(StringArena *fresh, const StringArena *records, uint32_t ref) {
+    const unsigned char *record = stringArenaAt(records, ref);
+    size_t length = contactRecordLength(record);
+    uint32_t moved = stringArenaAlloc(fresh, length);
+    if (moved != STRING_REF_NONE) {
+        memcpy(stringArenaAt(fresh, moved), record, length);
+    }
+    return moved;
+}
+
+// Once most of the arena is dead records, copy the live ones, and those
+// kept for snapshots, into a fresh arena. Only record references change, so
+// indexes are unaffected.
+static void compactRecords(ContactStore *store) {
+    StringArena *records = &store->records;
+    if (records->garbageBytes < STRING_ARENA_CHUNK_SIZE || records->garbageBytes < records->liveBytes) {
+        return;
+    }
+
+    ContactHistory *history = store->history;
+    size_t kept = history != NULL ? history->versionCount : 0;
+    StringArena fresh = {0};
+    uint32_t *refs = (uint32_t *)malloc((store->slotCount + kept) * sizeof(uint32_t));
+    if (refs == NULL) {
         return;
     }
 
-    newNode->contact = *contact;
-    newNode->next = *head;
-    *head = newNode;
+    // refs holds the slots' new references, then the kept versions'
+    for (size_t i = 0; i < store->slotCount + kept; i++) {
+        uint32_t ref;
+        if (i < store->slotCount) {
+            const ContactSlot *entry = contactSlotAt(store, (uint32_t)i);
+            if (!entry->live) {
+                continue;
+            }
+            ref = entry->record;
+        } else {
+            ref = history->versions[i - store->slotCount].record;
+        }
+        refs[i] = moveRecord(&fresh, records, ref);
+        if (refs[i] == STRING_REF_NONE) {
+            stringArenaFree(&fresh);
+            free(refs);
+            return;
+        }
+    }
+
+    for (uint32_t slot = 0; slot < store->slotCount; slot++) {
+        ContactSlot *entry = contactSlotAt(store, slot);
+        if (entry->live) {
+            entry->record = refs[slot];
+        }
+    }
+    for (size_t i = 0; i < kept; i++) {
+        history->versions[i].record = refs[store->slotCount + i];
+    }
+    free(refs);
+    stringArenaFree(records);
+    *records = fresh;
+    contactBloomCompact(store, true);
+}
+
+static void releaseSlot(ContactStore *store, uint32_t slot) {
+    ContactSlot *entry = contactSlotAt(store, slot);
+    entry->live = false;
+    entry->generation++;
+    entry->nextFree = store->freeHead;
+    store->freeHead = slot + 1;
 }
 
-void displayContacts(const ContactNode *head) {
-    if (head == NULL) {
+static bool reserveOrder(ContactStore *store, size_t entries) {
+    if (entries <= store->orderCapacity) {
+        return true;
+    }
+    size_t newCapacity = store->orderCapacity ? store->orderCapacity : 64;
+    while (newCapacity < entries) {
+        newCapacity *= 2;
+    }
+    ContactOrderEntry *order = (ContactOrderEntry *)realloc(store->order, newCapacity * sizeof(ContactOrderEntry));
+    if (order == NULL) {
+        perror("Failed to grow contact order");
+        return false;
+    }
+    store->order = order;
+    store->orderCapacity = newCapacity;
+    return true;
+}
+
+// Room must have been reserved
+static void appendOrder(ContactStore *store, uint32_t slot) {
+    ContactOrderEntry *entry = &store->order[store->orderCount++];
+    entry->sequence = store->nextSequence++;
+    entry->handle = makeHandle(slot, contactSlotAt(store, slot)->generation);
+}
+
+// Drop dead entries once they make up half the order. Sequences are kept,
+// so cursors into the order stay valid.
+static void compactOrder(ContactStore *store) {
+    if (store->orderDead < ORDER_COMPACT_MIN || store->orderDead * 2 < store->orderCount) {
+        return;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < store->orderCount; i++) {
+        if (getContact(store, store->order[i].handle, NULL)) {
+            store->order[kept++] = store->order[i];
+        }
+    }
+    store->orderCount = kept;
+    store->orderDead = 0;
+}
+
+// Add a slot to every index the store maintains, undoing partial work on
+// allocation failure.
+// The hash indexes and the bloom filter; the name tree is keyed separately
+static bool indexKeys(ContactStore *store, uint32_t slot) {
+    if (!contactIndexInsert(&store->nameIndex, store, slot)) {
+        return false;
+    }
+    if ((store->indexFlags & CONTACT_INDEX_PHONE) &&
+        !contactIndexInsert(&store->phoneIndex, store, slot)) {
+        contactIndexRemove(&store->nameIndex, store, slot);
+        return false;
+    }
+    if ((store->indexFlags & CONTACT_INDEX_EMAIL) &&
+        !contactIndexInsert(&store->emailIndex, store, slot)) {
+        if (store->indexFlags & CONTACT_INDEX_PHONE) {
+            contactIndexRemove(&store->phoneIndex, store, slot);
+        }
+        contactIndexRemove(&store->nameIndex, store, slot);
+        return false;
+    }
+    contactBloomAdd(store, contactSlotName(store, slot));
+    return true;
+}
+
+static void unindexKeys(ContactStore *store, uint32_t slot) {
+    contactIndexRemove(&store->nameIndex, store, slot);
+    contactBloomRemove(store);
+    if (store->indexFlags & CONTACT_INDEX_PHONE) {
+        contactIndexRemove(&store->phoneIndex, store, slot);
+    }
+    if (store->indexFlags & CONTACT_INDEX_EMAIL) {
+        contactIndexRemove(&store->emailIndex, store, slot);
+    }
+}
+
+static bool indexSlot(ContactStore *store, uint32_t slot) {
+    if (!radixTreeInsert(&store->nameTree, contactSlotName(store, slot), slot)) {
+        return false;
+    }
+    if (!indexKeys(store, slot)) {
+        radixTreeRemove(&store->nameTree, contactSlotName(store, slot), slot);
+        return false;
+    }
+    return true;
+}
+
+static void unindexSlot(ContactStore *store, uint32_t slot) {
+    unindexKeys(store, slot);
+    radixTreeRemove(&store->nameTree, contactSlotName(store, slot), slot);
+}
+
+static bool buildIndex(ContactStore *store, ContactIndex *index, ContactKeyField field) {
+    contactIndexInit(index, field);
+    for (uint32_t slot = 0; slot < store->slotCount; slot++) {
+        if (contactSlotAt(store, slot)->live && !contactIndexInsert(index, store, slot)) {
+            contactIndexFree(index);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool enableContactIndexes(ContactStore *store, unsigned flags) {
+    unsigned added = flags & ~store->indexFlags;
+
+    if ((added & CONTACT_INDEX_PHONE) &&
+        !buildIndex(store, &store->phoneIndex, CONTACT_KEY_PHONE)) {
+        return false;
+    }
+    if ((added & CONTACT_INDEX_EMAIL) &&
+        !buildIndex(store, &store->emailIndex, CONTACT_KEY_EMAIL)) {
+        if (added & CONTACT_INDEX_PHONE) {
+            contactIndexFree(&store->phoneIndex);
+        }
+        return false;
+    }
+
+    store->indexFlags |= added;
+    return true;
+}
+
+// Puts a slot's hash keys back after a failed update. They go into the room
+// they just left, so this should not need to allocate; if it does and
+// fails, the indexes are rebuilt from the slots rather than left missing it.
+static void restoreKeys(ContactStore *store, uint32_t slot) {
+    if (indexKeys(store, slot)) {
+        return;
+    }
+    unsigned flags = store->indexFlags;
+    contactIndexFree(&store->nameIndex);
+    contactIndexFree(&store->phoneIndex);
+    contactIndexFree(&store->emailIndex);
+    store->indexFlags = 0;
+    if (!buildIndex(store, &store->nameIndex, CONTACT_KEY_NAME) || !enableContactIndexes(store, flags)) {
+        perror("Failed to rebuild contact indexes");
+    }
+}
+
+// Sizes the slabs, the insertion order and every hash index for capacity
+// contacts, so adding up to that many allocates no slots and rehashes nothing.
+bool reserveContacts(ContactStore *store, size_t capacity) {
+    while (store->slabCount * CONTACT_SLAB_SIZE < capacity) {
+        if (!growSlabs(store)) {
+            return false;
+        }
+    }
+    return reserveOrder(store, store->orderDead + capacity) &&
+           contactIndexReserve(&store->nameIndex, capacity) &&
+           contactBloomReserve(store, capacity) &&
+           (!(store->indexFlags & CONTACT_INDEX_PHONE) || contactIndexReserve(&store->phoneIndex, capacity)) &&
+           (!(store->indexFlags & CONTACT_INDEX_EMAIL) || contactIndexReserve(&store->emailIndex, capacity));
+}
+
+// A failed append leaves the log broken, which the owner of the log repairs
+// with a checkpoint; the change itself stands.
+static void logChange(ContactStore *store, ContactWalOp op, const char *key, const Contact *contact) {
+    if (store->wal != NULL) {
+        contactWalAppend(store->wal, op, key, contact);
+    }
+}
+
+// Pack a contact into a newly taken slot, not yet indexed.
+static uint32_t placeContact(ContactStore *store, const Contact *contact) {
+    uint32_t domain;
+    uint32_t record = packContact(store, contact, &domain);
+    uint32_t slot = record != STRING_REF_NONE ? takeSlot(store) : CONTACT_SLOT_NONE;
+    if (slot == CONTACT_SLOT_NONE) {
+        perror("Failed to allocate memory for new contact");
+        if (record != STRING_REF_NONE) {
+            releaseRecord(store, record);
+        }
+        return CONTACT_SLOT_NONE;
+    }
+
+    ContactSlot *entry = contactSlotAt(store, slot);
+    entry->record = record;
+    entry->domain = domain;
+    entry->phoneKey = normalizePhone(contactSlotPhone(store, slot));
+    entry->live = true;
+    return slot;
+}
+
+// A lazily opened store first faults in the blocks the contacts' names
+// fall in, so a change sees the snapshot's contact of the same name
+static bool faultContacts(ContactStore *store, const Contact *contacts, size_t count) {
+    for (size_t i = 0; i < count && store->lazy != NULL; i++) {
+        char name[sizeof(contacts[i].name)];
+        size_t length = boundedLength(contacts[i].name, sizeof(name));
+        memcpy(name, contacts[i].name, length);
+        name[length] = '\0';
+        if (!contactLazyFaultName(store, name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void discardSlot(ContactStore *store, uint32_t slot) {
+    releaseRecord(store, contactSlotAt(store, slot)->record);
+    releaseSlot(store, slot);
+}
+
+// Deletes a committed contact, keeping its record while a snapshot can see it.
+static void retireSlot(ContactStore *store, uint32_t slot) {
+    const ContactSlot *entry = contactSlotAt(store, slot);
+    if (!contactVersionRetire(store, slot, entry->record, entry->domain)) {
+        releaseRecord(store, entry->record);
+    }
+    contactVersionStamp(store, slot);
+    contactTagsForget(store, slot);
+    releaseSlot(store, slot);
+}
+
+ContactHandle addContact(ContactStore *store, const Contact *contact) {
+    if (!faultContacts(store, contact, 1) || !reserveOrder(store, store->orderCount + 1) || !contactVersionReserve(store, 1, 0)) {
+        return CONTACT_HANDLE_NONE;
+    }
+    uint32_t slot = placeContact(store, contact);
+    if (slot == CONTACT_SLOT_NONE) {
+        return CONTACT_HANDLE_NONE;
+    }
+
+    if (!indexSlot(store, slot)) {
+        discardSlot(store, slot);
+        return CONTACT_HANDLE_NONE;
+    }
+
+    appendOrder(store, slot);
+    contactViewsNoteChange(store, slot);
+    contactVersionStamp(store, slot);
+    store->count++;
+    store->version++;
+    logChange(store, CONTACT_WAL_ADD, NULL, contact);
+    return makeHandle(slot, contactSlotAt(store, slot)->generation);
+}
+
+// The store is reserved for the whole batch first, so nothing is rehashed
+// along the way. Contacts then go in by groups: each is packed and put in
+// the name tree, after which the group is added to the hash indexes
+// together. Stops at the first contact that cannot be stored; the added
+// prefix is logged as a single record.
+size_t addContacts(ContactStore *store, const Contact *contacts, size_t count, ContactHandle *handles) {
+    size_t added = 0;
+    if (faultContacts(store, contacts, count) && reserveContacts(store, store->count + count) && contactVersionReserve(store, count, 0)) {
+        uint32_t slots[ADD_BATCH_GROUP];
+        bool failed = false;
+        while (added < count && !failed) {
+            size_t group = 0;
+            while (group < ADD_BATCH_GROUP && added + group < count) {
+                uint32_t slot = placeContact(store, &contacts[added + group]);
+                if (slot == CONTACT_SLOT_NONE) {
+                    failed = true;
+                    break;
+                }
+                if (!radixTreeInsert(&store->nameTree, contactSlotName(store, slot), slot)) {
+                    discardSlot(store, slot);
+                    failed = true;
+                    break;
+                }
+                contactBloomAdd(store, contactSlotName(store, slot));
+                slots[group++] = slot;
+            }
+
+            // Reserved above, so these cannot fail
+            contactIndexInsertBatch(&store->nameIndex, store, slots, group);
+            if (store->indexFlags & CONTACT_INDEX_PHONE) {
+                contactIndexInsertBatch(&store->phoneIndex, store, slots, group);
+            }
+            if (store->indexFlags & CONTACT_INDEX_EMAIL) {
+                contactIndexInsertBatch(&store->emailIndex, store, slots, group);
+            }
+            for (size_t i = 0; i < group; i++) {
+                appendOrder(store, slots[i]);
+                contactViewsNoteChange(store, slots[i]);
+                contactVersionStamp(store, slots[i]);
+            }
+            for (size_t i = 0; handles != NULL && i < group; i++) {
+                handles[added + i] = makeHandle(slots[i], contactSlotAt(store, slots[i])->generation);
+            }
+            added += group;
+            store->count += group;
+        }
+    }
+
+    for (size_t i = added; handles != NULL && i < count; i++) {
+        handles[i] = CONTACT_HANDLE_NONE;
+    }
+    if (added > 0) {
+        store->version++;
+    }
+    if (added > 0 && store->wal != NULL) {
+        contactWalAppendBatch(store->wal, CONTACT_WAL_ADD_BATCH, contacts, NULL, added);
+    }
+    return added;
+}
+
+// The name index behind the filter: names it rejects are certainly absent
+static uint32_t findName(const ContactStore *store, const char *name) {
+    if (!contactBloomMayContain(&store->nameFilter, name)) {
+        return CONTACT_SLOT_NONE;
+    }
+    return contactIndexFind(&store->nameIndex, store, name);
+}
+
+// findName for lookups made by callers, counted in contactBloomStats
+static uint32_t lookupName(const ContactStore *store, const char *name) {
+    bool passed = contactBloomMayContain(&store->nameFilter, name);
+    uint32_t slot = passed ? contactIndexFind(&store->nameIndex, store, name) : CONTACT_SLOT_NONE;
+    contactBloomRecord(passed, slot != CONTACT_SLOT_NONE);
+    return slot;
+}
+
+// The contact a change names: the exact name if there is one, otherwise
+// the only contact matching it ignoring case and accents. Several such
+// matches are ambiguous and match nothing. A lazy store first faults in
+// the blocks holding other spellings of the name.
+static uint32_t matchName(ContactStore *store, const char *name) {
+    uint32_t slot = findName(store, name);
+    if (slot != CONTACT_SLOT_NONE || !contactLazyFaultCollated(store, name)) {
+        return slot;
+    }
+    return contactIndexFindCollated(&store->nameIndex, store, name);
+}
+
+bool matchContact(const ContactStore *store, const char *name, Contact *out) {
+    uint32_t slot = findName(store, name);
+    if (slot == CONTACT_SLOT_NONE && contactLazyFind(store, name, out)) {
+        return true;
+    }
+    if (slot == CONTACT_SLOT_NONE) {
+        slot = contactIndexFindCollated(&store->nameIndex, store, name);
+    }
+    if (slot == CONTACT_SLOT_NONE) {
+        return false;
+    }
+    if (out != NULL) {
+        unpackContact(store, slot, out);
+    }
+    return true;
+}
+
+ContactHandle findContactHandle(const ContactStore *store, const char *name) {
+    uint32_t slot = lookupName(store, name);
+    if (slot == CONTACT_SLOT_NONE) {
+        return CONTACT_HANDLE_NONE;
+    }
+    return makeHandle(slot, contactSlotAt(store, slot)->generation);
+}
+
+bool findContact(const ContactStore *store, const char *name, Contact *out) {
+    uint32_t slot = lookupName(store, name);
+    if (slot == CONTACT_SLOT_NONE) {
+        // Not faulted in, or not there at all: the snapshot knows which
+        return contactLazyFind(store, name, out);
+    }
+
+    if (out != NULL) {
+        unpackContact(store, slot, out);
+    }
+    return true;
+}
+
+static bool copyOut(const ContactStore *store, uint32_t slot, Contact *out) {
+    if (slot == CONTACT_SLOT_NONE) {
+        return false;
+    }
+    if (out != NULL) {
+        unpackContact(store, slot, out);
+    }
+    return true;
+}
+
+bool findByPhone(const ContactStore *store, const char *phone, Contact *out) {
+    PhoneKey key = normalizePhone(phone);
+
+    if (key != PHONE_KEY_NONE && (store->indexFlags & CONTACT_INDEX_PHONE)) {
+        return copyOut(store, contactIndexFindKey(&store->phoneIndex, store, key), out);
+    }
+
+    // Index not enabled or query not a parseable number: fall back to a scan
+    for (uint32_t i = 0; i < store->slotCount; i++) {
+        const ContactSlot *entry = contactSlotAt(store, i);
+        if (entry->live && (key != PHONE_KEY_NONE ? entry->phoneKey == key
+                                                  : strcmp(contactSlotPhone(store, i), phone) == 0)) {
+            return copyOut(store, i, out);
+        }
+    }
+    return false;
+}
+
+bool findByEmail(const ContactStore *store, const char *email, Contact *out) {
+    if (store->indexFlags & CONTACT_INDEX_EMAIL) {
+        return copyOut(store, contactIndexFind(&store->emailIndex, store, email), out);
+    }
+
+    for (uint32_t i = 0; i < store->slotCount; i++) {
+        const ContactSlot *entry = contactSlotAt(store, i);
+        if (entry->live && contactSlotEmailEquals(store, i, email)) {
+            return copyOut(store, i, out);
+        }
+    }
+    return false;
+}
+
+PhoneKey contactPhoneKey(const ContactStore *store, ContactHandle handle) {
+    if (!getContact(store, handle, NULL)) {
+        return PHONE_KEY_NONE;
+    }
+    return contactSlotAt(store, (uint32_t)handle)->phoneKey;
+}
+
+bool getContact(const ContactStore *store, ContactHandle handle, Contact *out) {
+    uint32_t slot = (uint32_t)handle;
+    if (handle == CONTACT_HANDLE_NONE || slot >= store->slotCount) {
+        return false;
+    }
+
+    const ContactSlot *entry = contactSlotAt(store, slot);
+    if (!entry->live || entry->generation != (uint32_t)(handle >> 32)) {
+        return false;
+    }
+
+    if (out != NULL) {
+        unpackContact(store, slot, out);
+    }
+    return true;
+}
+
+void contactIteratorInit(ContactIterator *it, const ContactStore *store) {
+    it->store = store;
+    it->slot = 0;
+    it->handle = CONTACT_HANDLE_NONE;
+}
+
+const Contact *contactIteratorNext(ContactIterator *it) {
+    const ContactStore *store = it->store;
+
+    while (it->slot < store->slotCount) {
+        const ContactSlot *slab = store->slabs[it->slot / CONTACT_SLAB_SIZE];
+        size_t end = (it->slot / CONTACT_SLAB_SIZE + 1) * CONTACT_SLAB_SIZE;
+        if (end > store->slotCount) {
+            end = store->slotCount;
+        }
+
+        // Walk the slab sequentially, skipping tombstones
+        while (it->slot < end) {
+            const ContactSlot *entry = &slab[it->slot % CONTACT_SLAB_SIZE];
+            uint32_t slot = (uint32_t)it->slot++;
+            if (entry->live) {
+                it->handle = makeHandle(slot, entry->generation);
+                unpackContact(store, slot, &it->current);
+                return &it->current;
+            }
+        }
+    }
+
+    it->handle = CONTACT_HANDLE_NONE;
+    return NULL;
+}
+
+typedef struct {
+    const ContactStore *store;
+    size_t limit;
+    size_t visited;
+    ContactVisitor visitor;
+    void *userData;
+    Contact current;
+} SearchContext;
+
+static bool visitSlot(uint32_t slot, void *userData) {
+    SearchContext *ctx = (SearchContext *)userData;
+    ctx->visited++;
+    unpackContact(ctx->store, slot, &ctx->current);
+    if (!ctx->visitor(&ctx->current, ctx->userData)) {
+        return false;
+    }
+    return ctx->limit == 0 || ctx->visited < ctx->limit;
+}
+
+size_t searchContactsByPrefix(const ContactStore *store, const char *prefix, size_t limit,
+                              ContactVisitor visitor, void *userData) {
+    SearchContext ctx = {.store = store, .limit = limit, .visitor = visitor, .userData = userData};
+    radixTreeVisitPrefix(&store->nameTree, prefix, visitSlot, &ctx);
+    return ctx.visited;
+}
+
+size_t searchContactsByRange(const ContactStore *store, const char *from, const char *to, size_t limit,
+                             ContactVisitor visitor, void *userData) {
+    SearchContext ctx = {.store = store, .limit = limit, .visitor = visitor, .userData = userData};
+    radixTreeVisitRange(&store->nameTree, from, to, visitSlot, &ctx);
+    return ctx.visited;
+}
+
+void displayContacts(const ContactStore *store) {
+    if (store->count == 0) {
         printf("\n");
         setColor(COLOR_YELLOW);
         printf("    📭 No contacts found in the database.\n");
@@ -34,120 +715,511 @@ void displayContacts(const ContactNode *head) {
     printf("    └─────────────────────────────────────────────────────────────────┘\n\n");
     resetColor();
 
-    const ContactNode *current = head;
-    int count = 1;
+    ContactIterator it;
+    const Contact *current;
+    size_t count = 0;
+
+    contactIteratorInit(&it, store);
+    while ((current = contactIteratorNext(&it)) != NULL) {
+        displayContactCards(current, 1, ++count);
+    }
+
+    setColor(COLOR_BLUE);
+    printf("    📊 Total Contacts: %zu\n", count);
+    resetColor();
+}
 
-    while (current != NULL) {
+void displayContactCards(const Contact *contacts, size_t count, size_t firstNumber) {
+    for (size_t i = 0; i < count; i++) {
+        const Contact *current = &contacts[i];
         setColor(COLOR_GREEN);
         printf("    ╔═══════════════════════════════════════════════════════════════╗\n");
-        printf("    ║                     📇 CONTACT #%d                          ║\n", count);
+        printf("    ║                     📇 CONTACT #%zu                          ║\n", firstNumber + i);
         printf("    ╠═══════════════════════════════════════════════════════════════╣\n");
         resetColor();
 
         setColor(COLOR_WHITE);
-        printf("    ║  👤 Name:    %-45s ║\n", current->contact.name);
-        printf("    ║  📞 Phone:   %-45s ║\n", current->contact.phone);
-        printf("    ║  📧 Email:   %-45s ║\n", current->contact.email);
+        printf("    ║  👤 Name:    %-45s ║\n", current->name);
+        printf("    ║  📞 Phone:   %-45s ║\n", current->phone);
+        printf("    ║  📧 Email:   %-45s ║\n", current->email);
         setColor(COLOR_GREEN);
         printf("    ╚═══════════════════════════════════════════════════════════════╝\n\n");
         resetColor();
+    }
+}
 
-        current = current->next;
-        count++;
+bool updateContact(ContactStore *store, const char *name, const Contact *newContact) {
+    if (!contactLazyFaultName(store, name) || !faultContacts(store, newContact, 1)) {
+        return false;
+    }
+    uint32_t slot = matchName(store, name);
+    if (slot == CONTACT_SLOT_NONE || !contactVersionReserve(store, 1, 1)) {
+        return false;
     }
 
-    setColor(COLOR_BLUE);
-    printf("    📊 Total Contacts: %d\n", count - 1);
-    resetColor();
-}
+    uint32_t domain;
+    uint32_t record = packContact(store, newContact, &domain);
+    if (record == STRING_REF_NONE) {
+        perror("Failed to allocate memory for updated contact");
+        return false;
+    }
 
-bool updateContact(ContactNode *head, const char *name, const Contact *newContact) {
-    ContactNode *current = head;
+    ContactSlot *entry = contactSlotAt(store, slot);
+    uint32_t oldRecord = entry->record;
+    uint32_t oldDomain = entry->domain;
+    PhoneKey oldPhoneKey = entry->phoneKey;
+    const char *newName = (const char *)stringArenaAt(&store->records, record) + 1;
 
-    while (current != NULL) {
-        if (strcmp(current->contact.name, name) == 0) {
-            current->contact = *newContact;
-            return true;
+    if (store->indexFlags == 0 && strcmp(contactSlotName(store, slot), newName) == 0) {
+        entry->record = record;
+        entry->domain = domain;
+        entry->phoneKey = normalizePhone(contactSlotPhone(store, slot));
+    } else {
+        // Indexed fields may change: re-key every index under the new values.
+        // The old name leaves the tree only once the new keys are in, so
+        // undoing a failed update never has to put it back.
+        const char *oldName = contactSlotName(store, slot);
+        unindexKeys(store, slot);
+        entry->record = record;
+        entry->domain = domain;
+        entry->phoneKey = normalizePhone(contactSlotPhone(store, slot));
+        bool inTree = radixTreeInsert(&store->nameTree, newName, slot);
+        if (!inTree || !indexKeys(store, slot)) {
+            if (inTree) {
+                radixTreeRemove(&store->nameTree, newName, slot);
+            }
+            entry->record = oldRecord;
+            entry->domain = oldDomain;
+            entry->phoneKey = oldPhoneKey;
+            restoreKeys(store, slot);
+            releaseRecord(store, record);
+            return false;
         }
-        current = current->next;
+        radixTreeRemove(&store->nameTree, oldName, slot);
     }
 
-    return false;
+    // Open snapshots may still need the old contents
+    if (!contactVersionRetire(store, slot, oldRecord, oldDomain)) {
+        releaseRecord(store, oldRecord);
+    }
+    contactVersionStamp(store, slot);
+    store->version++;
+    contactViewsNoteChange(store, slot);
+    logChange(store, CONTACT_WAL_UPDATE, name, newContact);
+    compactRecords(store);
+    contactBloomCompact(store, false);
+    return true;
 }
 
-bool deleteContact(ContactNode **head, const char *name) {
-    if (*head == NULL) {
+bool deleteContact(ContactStore *store, const char *name) {
+    if (!contactLazyFaultName(store, name)) {
+        return false;
+    }
+    uint32_t slot = matchName(store, name);
+    if (slot == CONTACT_SLOT_NONE || !contactVersionReserve(store, 1, 1)) {
         return false;
     }
 
-    ContactNode *current = *head;
-    ContactNode *prev = NULL;
+    unindexSlot(store, slot);
+    retireSlot(store, slot);
+    store->version++;
+    contactViewsNoteChange(store, slot);
+    store->count--;
+    store->orderDead++;
+    logChange(store, CONTACT_WAL_DELETE, name, NULL);
+    compactRecords(store);
+    compactOrder(store);
+    contactBloomCompact(store, false);
+    return true;
+}
 
-    while (current != NULL) {
-        if (strcmp(current->contact.name, name) == 0) {
-            if (prev == NULL) {
-                *head = current->next;
-            } else {
-                prev->next = current->next;
-            }
-            free(current);
-            return true;
+// Names that are not found are skipped. The batch is logged as one record
+// and the arena compacted at most once.
+size_t deleteContacts(ContactStore *store, const char *const *names, size_t count) {
+    size_t deleted = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!contactLazyFaultName(store, names[i])) {
+            return 0;
+        }
+    }
+    if (!contactVersionReserve(store, count, count)) {
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint32_t slot = matchName(store, names[i]);
+        if (slot == CONTACT_SLOT_NONE) {
+            continue;
         }
-        prev = current;
-        current = current->next;
+        unindexSlot(store, slot);
+        retireSlot(store, slot);
+        contactViewsNoteChange(store, slot);
+        store->count--;
+        store->orderDead++;
+        deleted++;
     }
 
-    return false;
+    if (deleted > 0) {
+        store->version++;
+        if (store->wal != NULL) {
+            contactWalAppendBatch(store->wal, CONTACT_WAL_DELETE_BATCH, NULL, names, count);
+        }
+        compactRecords(store);
+        compactOrder(store);
+        contactBloomCompact(store, false);
+    }
+    return deleted;
 }
 
-void saveContacts(const ContactNode *head, const char *filename) {
-    FILE *file = fopen(filename, "wb");
+void saveContacts(const ContactStore *store, const char *filename) {
+    size_t count = 0;
+    uint64_t sequence = store->wal != NULL ? store->wal->sequence : 0;
+    if (contactPackWrite(store, filename, sequence, &count)) {
+        printf("Saved %zu contacts to %s\n", count, filename);
+    }
+}
+
+// Pre-versioning files are a bare array of Contact records
+static void loadLegacyContacts(ContactStore *store, const char *filename) {
+    FILE *file = fopen(filename, "rb");
     if (file == NULL) {
-        perror("Failed to open file for saving");
+        printf("No existing contact file found. Starting with empty list.\n");
         return;
     }
 
-    const ContactNode *current = head;
-    int count = 0;
-
-    while (current != NULL) {
-        if (fwrite(&current->contact, sizeof(Contact), 1, file) != 1) {
-            perror("Failed to write contact to file");
-            fclose(file);
-            return;
+    // Size the store for the whole file up front, then read in batches
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long size = ftell(file);
+        if (size > 0) {
+            reserveContacts(store, store->count + (size_t)size / sizeof(Contact));
         }
-        count++;
-        current = current->next;
+        rewind(file);
+    }
+
+    Contact batch[LOAD_BATCH_SIZE];
+    size_t read;
+    while ((read = fread(batch, sizeof(Contact), LOAD_BATCH_SIZE, file)) > 0) {
+        addContacts(store, batch, read, NULL);
     }
 
     fclose(file);
-    printf("Saved %d contacts to %s\n", count, filename);
 }
 
-void loadContacts(ContactNode **head, const char *filename) {
-    FILE *file = fopen(filename, "rb");
-    if (file == NULL) {
+static void loadPackedContacts(ContactStore *store, const char *filename) {
+    if (contactLazyEnabled() && contactLazyOpen(store, filename)) {
+        return;
+    }
+
+    ContactPack pack;
+    if (contactPackOpen(&pack, filename) != CONTACT_DB_OK) {
+        fprintf(stderr, "Contact file %s is corrupt or from an unsupported version\n", filename);
+        return;
+    }
+
+    // Tags are kept by position in the snapshot, so they only apply when
+    // the store ends up holding exactly its contacts
+    bool empty = store->slotCount == 0;
+    if (contactLoadPack(store, &pack, filename) == 0 && empty && store->count == contactPackCount(&pack)) {
+        contactTagsLoad(store, filename, pack.header->headerChecksum);
+    }
+    contactPackClose(&pack);
+}
+
+void loadContacts(ContactStore *store, const char *filename) {
+    // A lazy store is loaded whole before another file is added to it
+    if (!contactLazyLoadAll(store)) {
+        return;
+    }
+
+    ContactDb db;
+    switch (contactDbOpen(&db, filename)) {
+    case CONTACT_DB_MISSING:
         printf("No existing contact file found. Starting with empty list.\n");
         return;
+    case CONTACT_DB_LEGACY:
+        loadLegacyContacts(store, filename);
+        return;
+    case CONTACT_DB_PACKED:
+        loadPackedContacts(store, filename);
+        return;
+    case CONTACT_DB_CORRUPT:
+        fprintf(stderr, "Contact file %s is corrupt or from an unsupported version\n", filename);
+        return;
+    case CONTACT_DB_OK:
+        break;
     }
 
-    Contact tempContact;
-    while (fread(&tempContact, sizeof(Contact), 1, file) == 1) {
-        addContact(head, &tempContact);
+    reserveContacts(store, store->count + contactDbCount(&db));
+    for (size_t page = 0; page < db.header->pageCount; page++) {
+        if (!contactDbVerifyPage(&db, page)) {
+            fprintf(stderr, "Skipping damaged page %zu in %s\n", page, filename);
+            continue;
+        }
+
+        size_t records;
+        const Contact *stored = contactDbPage(&db, page, &records);
+        Contact batch[CONTACT_DB_RECORDS_PER_PAGE];
+        for (size_t i = 0; i < records; i++) {
+            batch[i] = stored[i];
+            batch[i].name[sizeof(batch[i].name) - 1] = '\0';
+            batch[i].phone[sizeof(batch[i].phone) - 1] = '\0';
+            batch[i].email[sizeof(batch[i].email) - 1] = '\0';
+        }
+        addContacts(store, batch, records, NULL);
     }
 
-    fclose(file);
+    contactDbClose(&db);
 }
 
-void freeContacts(ContactNode **head) {
-    ContactNode *current = *head;
-    ContactNode *next;
+void freeContacts(ContactStore *store) {
+    for (size_t i = 0; i < store->slabCount; i++) {
+        free(store->slabs[i]);
+    }
+    free(store->slabs);
+
+    store->slabs = NULL;
+    store->slabCount = 0;
+    store->slabCapacity = 0;
+    store->slotCount = 0;
+    store->freeHead = 0;
+    store->count = 0;
+    contactIndexFree(&store->nameIndex);
+    radixTreeFree(&store->nameTree);
+    contactBloomFree(&store->nameFilter);
+    contactIndexFree(&store->phoneIndex);
+    contactIndexFree(&store->emailIndex);
+    contactHistoryFree(store);
+    contactTagsFree(store);
+    contactLazyFree(store);
+    stringArenaFree(&store->records);
+    stringPoolFree(&store->domains);
+    free(store->order);
+    store->order = NULL;
+    store->orderCount = 0;
+    store->orderCapacity = 0;
+    store->orderDead = 0;
+    store->nextSequence = 0;
+    store->version = 0;
+    contactViewsFree(store);
+    store->indexFlags = 0;
+    store->wal = NULL;
+}
 
-    while (current != NULL) {
-        next = current->next;
-        free(current);
-        current = next;
+// Slot numbers, generations and the free list are copied as they are, so
+// handles from src are valid in dest.
+bool copyContacts(ContactStore *dest, const ContactStore *src) {
+    freeContacts(dest);
+
+    if (src->slabCapacity > 0) {
+        dest->slabs = (ContactSlot **)calloc(src->slabCapacity, sizeof(ContactSlot *));
+        if (dest->slabs == NULL) {
+            perror("Failed to copy contact store");
+            return false;
+        }
+        dest->slabCapacity = src->slabCapacity;
+    }
+    for (size_t i = 0; i < src->slabCount; i++) {
+        dest->slabs[i] = (ContactSlot *)malloc(CONTACT_SLAB_SIZE * sizeof(ContactSlot));
+        if (dest->slabs[i] == NULL) {
+            perror("Failed to copy contact store");
+            freeContacts(dest);
+            return false;
+        }
+        dest->slabCount++;
+        memcpy(dest->slabs[i], src->slabs[i], CONTACT_SLAB_SIZE * sizeof(ContactSlot));
+    }
+
+    bool ok = contactIndexCopy(&dest->nameIndex, &src->nameIndex) &&
+              radixTreeCopy(&dest->nameTree, &src->nameTree) &&
+              contactBloomCopy(&dest->nameFilter, &src->nameFilter) &&
+              contactIndexCopy(&dest->phoneIndex, &src->phoneIndex) &&
+              contactIndexCopy(&dest->emailIndex, &src->emailIndex) &&
+              stringArenaCopy(&dest->records, &src->records) &&
+              stringPoolCopy(&dest->domains, &src->domains) &&
+              contactHistoryCopy(dest, src) &&
+              contactTagsCopy(dest, src) &&
+              contactLazyCopy(dest, src) &&
+              reserveOrder(dest, src->orderCount);
+    if (!ok) {
+        freeContacts(dest);
+        return false;
     }
 
-    *head = NULL;
-}
\ No newline at end of file
+    if (src->orderCount > 0) {
+        memcpy(dest->order, src->order, src->orderCount * sizeof(ContactOrderEntry));
+    }
+    dest->orderCount = src->orderCount;
+    dest->orderDead = src->orderDead;
+    dest->nextSequence = src->nextSequence;
+    dest->slotCount = src->slotCount;
+    dest->freeHead = src->freeHead;
+    dest->count = src->count;
+    dest->version = src->version;
+    dest->indexFlags = src->indexFlags;
+    dest->wal = src->wal;
+    return true;
+}
+
+bool replaceContacts(ContactStore *store, const ContactStore *src) {
+    ContactWal *wal = store->wal;
+    unsigned flags = store->indexFlags;
+    bool ok = copyContacts(store, src);
+    store->wal = wal;
+    return ok && enableContactIndexes(store, flags);
+}
+
+// Empties the store after a merge fails part way, keeping its index flags.
+static void abandonMerge(ContactStore *store, ContactStore *parts, size_t count) {
+    unsigned flags = store->indexFlags;
+    freeContacts(store);
+    store->indexFlags = flags;
+    for (size_t i = 0; i < count; i++) {
+        freeContacts(&parts[i]);
+    }
+}
+
+// Moves one part's slabs and records to the end of the store, starting at
+// slot base. *span receives the number of slots it takes up.
+static bool adoptPart(ContactStore *store, ContactStore *part, uint32_t base, bool last, size_t *span) {
+    uint32_t recordOffset = stringArenaAppend(&store->records, &part->records);
+    uint32_t *domainIds = (uint32_t *)malloc((part->domains.count + 1) * sizeof(uint32_t));
+    if (recordOffset == STRING_REF_NONE || domainIds == NULL) {
+        perror("Failed to merge contact stores");
+        free(domainIds);
+        return false;
+    }
+    domainIds[0] = 0;
+    for (uint32_t id = 1; id <= part->domains.count; id++) {
+        const char *domain = stringPoolGet(&part->domains, id);
+        domainIds[id] = stringPoolIntern(&store->domains, domain, (unsigned char)domain[-1]);
+        if (domainIds[id] == 0) {
+            free(domainIds);
+            return false;
+        }
+    }
+
+    memcpy(store->slabs + store->slabCount, part->slabs, part->slabCount * sizeof(ContactSlot *));
+    store->slabCount += part->slabCount;
+    *span = part->slabCount * CONTACT_SLAB_SIZE;
+    free(part->slabs);
+    part->slabs = NULL;
+    part->slabCount = 0;
+
+    // Slots the part never used are free in the store, unless they are at
+    // its end, where they are simply not handed out yet
+    for (uint32_t i = 0; i < *span; i++) {
+        ContactSlot *entry = contactSlotAt(store, base + i);
+        if (i < part->slotCount && entry->live) {
+            entry->record += recordOffset;
+            entry->domain = domainIds[entry->domain];
+        } else if (i < part->slotCount || !last) {
+            entry->live = false;
+            entry->nextFree = store->freeHead;
+            store->freeHead = base + i + 1;
+        }
+    }
+    store->slotCount = base + (last ? part->slotCount : *span);
+    free(domainIds);
+    return true;
+}
+
+// Handles change with the slot numbers; sequences restart after the store's.
+static void adoptOrder(ContactStore *store, const ContactStore *part, uint32_t base) {
+    for (size_t i = 0; i < part->orderCount; i++) {
+        uint32_t slot = base + (uint32_t)part->order[i].handle;
+        uint32_t generation = (uint32_t)(part->order[i].handle >> 32);
+        const ContactSlot *entry = contactSlotAt(store, slot);
+        if (entry->live && entry->generation == generation) {
+            appendOrder(store, slot);
+        }
+    }
+}
+
+// Each part's slots follow the previous part's from the next whole slab.
+// Indexes are merged rather than rebuilt: hash tables reuse the stored
+// hashes, name trees are relinked and name filters or-ed together.
+bool contactStoreMerge(ContactStore *store, ContactStore *parts, size_t count) {
+    if (store->slotCount != 0 || store->history != NULL || store->lazy != NULL) {
+        return false;
+    }
+    size_t slabs = 0;
+    size_t contacts = 0;
+    for (size_t i = 0; i < count; i++) {
+        slabs += parts[i].slabCount;
+        contacts += parts[i].count;
+    }
+    if ((uint64_t)slabs * CONTACT_SLAB_SIZE >= CONTACT_SLOT_NONE) {
+        return false;
+    }
+
+    // Slabs the store reserved are still empty; the parts' replace them
+    for (size_t i = 0; i < store->slabCount; i++) {
+        free(store->slabs[i]);
+    }
+    store->slabCount = 0;
+    if (slabs > store->slabCapacity) {
+        ContactSlot **newSlabs = (ContactSlot **)realloc(store->slabs, slabs * sizeof(ContactSlot *));
+        if (newSlabs == NULL) {
+            perror("Failed to grow contact slab directory");
+            abandonMerge(store, parts, count);
+            return false;
+        }
+        store->slabs = newSlabs;
+        store->slabCapacity = slabs;
+    }
+    if (!reserveOrder(store, contacts) || !contactIndexReserve(&store->nameIndex, contacts) ||
+        ((store->indexFlags & CONTACT_INDEX_PHONE) && !contactIndexReserve(&store->phoneIndex, contacts)) ||
+        ((store->indexFlags & CONTACT_INDEX_EMAIL) && !contactIndexReserve(&store->emailIndex, contacts))) {
+        abandonMerge(store, parts, count);
+        return false;
+    }
+
+    bool filterMerged = true;
+    uint32_t base = 0;
+    for (size_t i = 0; i < count; i++) {
+        ContactStore *part = &parts[i];
+        size_t span = 0;
+        if (!adoptPart(store, part, base, i + 1 == count, &span)) {
+            abandonMerge(store, parts + i, count - i);
+            return false;
+        }
+
+        // Reserved above, so these cannot fail
+        contactIndexMerge(&store->nameIndex, &part->nameIndex, base);
+        if (store->indexFlags & CONTACT_INDEX_PHONE) {
+            contactIndexMerge(&store->phoneIndex, &part->phoneIndex, base);
+        }
+        if (store->indexFlags & CONTACT_INDEX_EMAIL) {
+            contactIndexMerge(&store->emailIndex, &part->emailIndex, base);
+        }
+        if (!radixTreeMerge(&store->nameTree, &part->nameTree, base)) {
+            abandonMerge(store, parts + i, count - i);
+            return false;
+        }
+        filterMerged = filterMerged && contactBloomMerge(&store->nameFilter, &part->nameFilter);
+        adoptOrder(store, part, base);
+        store->count += part->count;
+        base += (uint32_t)span;
+        freeContacts(part);
+    }
+
+    if (!filterMerged) {
+        contactBloomFree(&store->nameFilter);
+        contactBloomReserve(store, store->count);
+    }
+    contactViewsFree(store);
+    store->version++;
+    return true;
+}
+
+size_t contactStoreBytes(const ContactStore *store) {
+    return store->slabCapacity * sizeof(ContactSlot *) +
+           store->slabCount * CONTACT_SLAB_SIZE * sizeof(ContactSlot) +
+           stringArenaCapacity(&store->records) +
+           stringPoolBytes(&store->domains) +
+           store->orderCapacity * sizeof(ContactOrderEntry) +
+           contactBloomBytes(&store->nameFilter) +
+           contactViewsBytes(store) +
+           contactHistoryBytes(store) +
+           contactTagsBytes(store) +
+           contactLazyBytes(store);
+}
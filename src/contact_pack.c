@@ -0,0 +1,662 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_pack.h"
+#include "../include/contact_db.h"
+#include "../include/contact_tags.h"
+#include "../include/security.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define VARINT_MAX_BYTES 10
+#define PHONE_MAX_DIGITS 19
+// Worst case per record: three fields of at most 49 bytes, their lengths,
+// the name's shared prefix and the domain id
+#define RECORD_MAX_BYTES (3 * 50 + 6 * VARINT_MAX_BYTES)
+
+static uint32_t packHeaderChecksum(const ContactPackHeader *header) {
+    return checksumData(0, header, offsetof(ContactPackHeader, headerChecksum));
+}
+
+static unsigned char *putVarint(unsigned char *p, uint64_t value) {
+    while (value >= 0x80) {
+        *p++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (unsigned char)value;
+    return p;
+}
+
+// NULL on a truncated or overlong varint
+static const unsigned char *getVarint(const unsigned char *p, const unsigned char *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char byte = *p++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Digits of a phone that is an optional '+' and 1-19 digits, else false
+static bool numericPhone(const char *phone, size_t length, bool *plus, uint64_t *value) {
+    *plus = length > 0 && phone[0] == '+';
+    size_t digits = length - *plus;
+    if (digits == 0 || digits > PHONE_MAX_DIGITS) {
+        return false;
+    }
+    uint64_t number = 0;
+    for (size_t i = *plus; i < length; i++) {
+        if (phone[i] < '0' || phone[i] > '9') {
+            return false;
+        }
+        number = number * 10 + (uint64_t)(phone[i] - '0');
+    }
+    *value = number;
+    return true;
+}
+
+// One contact's fields as the writer sees them; none NUL-terminated
+typedef struct {
+    const char *name;
+    const char *phone;
+    const char *local;
+    const char *domain;
+    size_t nameLength;
+    size_t phoneLength;
+    size_t localLength;
+    size_t domainLength;   // 0 if none
+} PackFields;
+
+typedef void (*PackFieldsFn)(const void *source, size_t position, PackFields *fields);
+
+typedef struct {
+    unsigned char *block;
+    unsigned char *p;
+    size_t records;
+    char previousName[50];
+    size_t previousLength;
+    uint64_t previousPhone;
+} BlockEncoder;
+
+static void encodeRecord(BlockEncoder *encoder, const PackFields *fields, uint32_t domainId) {
+    unsigned char *p = encoder->p;
+
+    size_t shared = 0;
+    while (shared < encoder->previousLength && shared < fields->nameLength &&
+           encoder->previousName[shared] == fields->name[shared]) {
+        shared++;
+    }
+    p = putVarint(p, shared);
+    p = putVarint(p, fields->nameLength - shared);
+    memcpy(p, fields->name + shared, fields->nameLength - shared);
+    p += fields->nameLength - shared;
+    memcpy(encoder->previousName, fields->name, fields->nameLength);
+    encoder->previousLength = fields->nameLength;
+
+    bool plus;
+    uint64_t number;
+    if (numericPhone(fields->phone, fields->phoneLength, &plus, &number)) {
+        p = putVarint(p, (uint64_t)(fields->phoneLength - plus) << 2 | (uint64_t)plus << 1 | 1);
+        p = putVarint(p, zigzag((int64_t)(number - encoder->previousPhone)));
+        encoder->previousPhone = number;
+    } else {
+        p = putVarint(p, (uint64_t)fields->phoneLength << 2);
+        memcpy(p, fields->phone, fields->phoneLength);
+        p += fields->phoneLength;
+    }
+
+    p = putVarint(p, domainId);
+    p = putVarint(p, fields->localLength);
+    memcpy(p, fields->local, fields->localLength);
+    p += fields->localLength;
+
+    encoder->p = p;
+    encoder->records++;
+}
+
+typedef struct {
+    uint32_t count;
+    uint32_t id;
+} DomainRank;
+
+static int compareRanks(const void *a, const void *b) {
+    const DomainRank *x = (const DomainRank *)a;
+    const DomainRank *y = (const DomainRank *)b;
+    if (x->count != y->count) {
+        return x->count > y->count ? -1 : 1;
+    }
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+static bool writeAll(FILE *file, const void *data, size_t size, uint32_t *checksum) {
+    if (checksum != NULL) {
+        *checksum = checksumData(*checksum, data, size);
+    }
+    return size == 0 || fwrite(data, size, 1, file) == 1;
+}
+
+// Writes count contacts, fetched in name order through fields. Domains are
+// interned in a first pass so the dictionary can be ranked and written
+// ahead of the blocks. *checksum receives the header checksum.
+static bool writePack(PackFieldsFn fieldsOf, const void *source, size_t count, const char *filename,
+                      uint64_t walSequence, uint32_t *checksum) {
+    StringPool pool = {0};
+    uint32_t *domainIds = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+    if (domainIds == NULL) {
+        perror("Failed to allocate snapshot domains");
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        PackFields fields;
+        fieldsOf(source, i, &fields);
+        domainIds[i] = fields.domainLength > 0 ? stringPoolIntern(&pool, fields.domain, fields.domainLength) : 0;
+        if (fields.domainLength > 0 && domainIds[i] == 0) {
+            free(domainIds);
+            stringPoolFree(&pool);
+            return false;
+        }
+    }
+
+    // Rank domains by use; rank[pool id] is the id written to the file
+    DomainRank *ranks = (DomainRank *)calloc(pool.count + 1, sizeof(DomainRank));
+    uint32_t *rank = (uint32_t *)malloc((pool.count + 1) * sizeof(uint32_t));
+    size_t blockCount = (count + CONTACT_PACK_BLOCK_RECORDS - 1) / CONTACT_PACK_BLOCK_RECORDS;
+    ContactPackBlock *index = (ContactPackBlock *)calloc(blockCount ? blockCount : 1, sizeof(ContactPackBlock));
+    unsigned char *block = (unsigned char *)malloc(CONTACT_PACK_BLOCK_RECORDS * RECORD_MAX_BYTES);
+    char tempName[512];
+    snprintf(tempName, sizeof(tempName), "%s.tmp", filename);
+    FILE *file = ranks && rank && index && block ? fopen(tempName, "wb") : NULL;
+    if (file == NULL) {
+        perror("Failed to open file for saving");
+        free(ranks);
+        free(rank);
+        free(index);
+        free(block);
+        free(domainIds);
+        stringPoolFree(&pool);
+        return false;
+    }
+
+    for (uint32_t id = 1; id <= pool.count; id++) {
+        ranks[id - 1].id = id;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (domainIds[i] != 0) {
+            ranks[domainIds[i] - 1].count++;
+        }
+    }
+    qsort(ranks, pool.count, sizeof(DomainRank), compareRanks);
+    rank[0] = 0;
+    for (uint32_t r = 0; r < pool.count; r++) {
+        rank[ranks[r].id] = r + 1;
+    }
+
+    ContactPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CONTACT_PACK_MAGIC, sizeof(header.magic));
+    header.version = CONTACT_PACK_VERSION;
+    header.blockRecords = CONTACT_PACK_BLOCK_RECORDS;
+    header.recordCount = count;
+    header.blockCount = blockCount;
+    header.walSequence = walSequence;
+    header.domainCount = pool.count;
+
+    // Reserve the header; it is rewritten once the offsets are known
+    bool ok = writeAll(file, &header, sizeof(header), NULL);
+    uint64_t offset = sizeof(header);
+
+    header.dictionaryOffset = offset;
+    for (uint32_t r = 0; r < pool.count && ok; r++) {
+        const char *domain = stringPoolGet(&pool, ranks[r].id);
+        unsigned char length = (unsigned char)domain[-1];
+        ok = writeAll(file, &length, 1, &header.dictionaryChecksum) &&
+             writeAll(file, domain, length, &header.dictionaryChecksum);
+        header.dictionarySize += 1 + length;
+    }
+    offset += header.dictionarySize;
+
+    BlockEncoder encoder;
+    for (size_t b = 0; b < blockCount && ok; b++) {
+        memset(&encoder, 0, sizeof(encoder));
+        encoder.block = encoder.p = block;
+        size_t end = (b + 1) * CONTACT_PACK_BLOCK_RECORDS;
+        for (size_t i = b * CONTACT_PACK_BLOCK_RECORDS; i < end && i < count; i++) {
+            PackFields fields;
+            fieldsOf(source, i, &fields);
+            encodeRecord(&encoder, &fields, rank[domainIds[i]]);
+        }
+
+        ContactPackBlock *entry = &index[b];
+        entry->offset = offset;
+        entry->size = (uint32_t)(encoder.p - block);
+        entry->recordCount = (uint32_t)encoder.records;
+        entry->checksum = checksumData(0, block, entry->size);
+        ok = writeAll(file, block, entry->size, NULL);
+        offset += entry->size;
+    }
+
+    // The index is read in place from the map, so align it
+    static const unsigned char padding[sizeof(uint64_t)];
+    size_t pad = (sizeof(uint64_t) - offset % sizeof(uint64_t)) % sizeof(uint64_t);
+    ok = ok && writeAll(file, padding, pad, NULL);
+    header.indexOffset = offset + pad;
+    ok = ok && writeAll(file, index, blockCount * sizeof(ContactPackBlock), &header.indexChecksum);
+    header.headerChecksum = packHeaderChecksum(&header);
+    *checksum = header.headerChecksum;
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && writeAll(file, &header, sizeof(header), NULL);
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+
+    free(ranks);
+    free(rank);
+    free(index);
+    free(block);
+    free(domainIds);
+    stringPoolFree(&pool);
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tempName, filename) != 0 || !contactDbSyncDirectory(filename)) {
+        perror("Failed to write contact snapshot");
+        remove(tempName);
+        return false;
+    }
+    return true;
+}
+
+typedef struct {
+    const ContactStore *store;
+    uint32_t *slots;
+    size_t count;
+} StoreOrder;
+
+static bool collectSlot(uint32_t slot, void *userData) {
+    StoreOrder *order = (StoreOrder *)userData;
+    order->slots[order->count++] = slot;
+    return true;
+}
+
+static void storeFields(const void *source, size_t position, PackFields *fields) {
+    const StoreOrder *order = (const StoreOrder *)source;
+    const ContactStore *store = order->store;
+    uint32_t slot = order->slots[position];
+    fields->name = contactSlotName(store, slot);
+    fields->nameLength = (unsigned char)fields->name[-1];
+    fields->phone = contactSlotPhone(store, slot);
+    fields->phoneLength = (unsigned char)fields->phone[-1];
+    fields->local = contactSlotEmail(store, slot, &fields->domain);
+    fields->localLength = (unsigned char)fields->local[-1];
+    fields->domainLength = fields->domain != NULL ? (unsigned char)fields->domain[-1] : 0;
+}
+
+bool contactPackWrite(const ContactStore *store, const char *filename, uint64_t walSequence, size_t *written) {
+    // Writing only the contacts faulted in would lose the others
+    if (store->lazy != NULL) {
+        fprintf(stderr, "Cannot save %s before every contact is loaded\n", filename);
+        return false;
+    }
+
+    // The name tree already holds the slots in name order
+    StoreOrder order = {store, (uint32_t *)malloc((store->count ? store->count : 1) * sizeof(uint32_t)), 0};
+    if (order.slots == NULL) {
+        perror("Failed to allocate snapshot order");
+        return false;
+    }
+    radixTreeVisitRange(&store->nameTree, NULL, NULL, collectSlot, &order);
+
+    uint32_t checksum;
+    bool ok = writePack(storeFields, &order, order.count, filename, walSequence, &checksum) &&
+              contactTagsSave(store->tags, order.slots, order.count, filename, checksum);
+    if (ok && written != NULL) {
+        *written = order.count;
+    }
+    free(order.slots);
+    return ok;
+}
+
+static size_t fieldLength(const char *field, size_t size) {
+    const char *end = (const char *)memchr(field, '\0', size - 1);
+    return end != NULL ? (size_t)(end - field) : size - 1;
+}
+
+static void recordFields(const void *source, size_t position, PackFields *fields) {
+    const Contact *contact = ((const Contact *const *)source)[position];
+    fields->name = contact->name;
+    fields->nameLength = fieldLength(contact->name, sizeof(contact->name));
+    fields->phone = contact->phone;
+    fields->phoneLength = fieldLength(contact->phone, sizeof(contact->phone));
+
+    // Split like the store does: at the first '@', if a domain follows
+    size_t length = fieldLength(contact->email, sizeof(contact->email));
+    const char *at = (const char *)memchr(contact->email, '@', length);
+    fields->local = contact->email;
+    if (at != NULL && at + 1 < contact->email + length) {
+        fields->localLength = (size_t)(at - contact->email);
+        fields->domain = at + 1;
+        fields->domainLength = length - fields->localLength - 1;
+    } else {
+        fields->localLength = length;
+        fields->domain = NULL;
+        fields->domainLength = 0;
+    }
+}
+
+static int compareRecordNames(const void *a, const void *b) {
+    const Contact *x = *(const Contact *const *)a;
+    const Contact *y = *(const Contact *const *)b;
+    return strncmp(x->name, y->name, sizeof(x->name) - 1);
+}
+
+bool contactPackWriteRecords(const Contact *records, const uint32_t *slots, size_t count,
+                             const struct ContactTags *tags, const char *filename,
+                             uint64_t walSequence, size_t *written) {
+    const Contact **sorted = (const Contact **)malloc((count ? count : 1) * sizeof(Contact *));
+    if (sorted == NULL) {
+        perror("Failed to allocate snapshot order");
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        sorted[i] = &records[i];
+    }
+    qsort(sorted, count, sizeof(Contact *), compareRecordNames);
+
+    uint32_t checksum;
+    bool ok = writePack(recordFields, sorted, count, filename, walSequence, &checksum);
+    uint32_t *order = NULL;
+    if (ok && tags != NULL && tags->count > 0) {
+        order = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+        if (order == NULL) {
+            perror("Failed to allocate snapshot order");
+            ok = false;
+        }
+        for (size_t i = 0; ok && i < count; i++) {
+            order[i] = slots[sorted[i] - records];
+        }
+    }
+    ok = ok && contactTagsSave(order != NULL ? tags : NULL, order, count, filename, checksum);
+    free(order);
+    if (ok && written != NULL) {
+        *written = count;
+    }
+    free(sorted);
+    return ok;
+}
+
+static bool validPackHeader(const ContactPackHeader *header, size_t fileSize) {
+    if (header->version != CONTACT_PACK_VERSION ||
+        header->blockRecords == 0 || header->blockRecords > CONTACT_PACK_BLOCK_RECORDS ||
+        header->headerChecksum != packHeaderChecksum(header)) {
+        return false;
+    }
+    if (header->dictionaryOffset > fileSize || header->dictionarySize > fileSize - header->dictionaryOffset ||
+        header->indexOffset > fileSize || header->indexOffset % sizeof(uint64_t) != 0 ||
+        header->blockCount > (fileSize - header->indexOffset) / sizeof(ContactPackBlock) ||
+        header->recordCount > header->blockCount * header->blockRecords) {
+        return false;
+    }
+    return true;
+}
+
+// Points the dictionary entries into the map
+static bool readDictionary(ContactPack *pack) {
+    const ContactPackHeader *header = pack->header;
+    const unsigned char *p = pack->map + header->dictionaryOffset;
+    const unsigned char *end = p + header->dictionarySize;
+    if (checksumData(0, p, header->dictionarySize) != header->dictionaryChecksum) {
+        return false;
+    }
+
+    pack->domains = (ContactPackDomain *)malloc((header->domainCount ? header->domainCount : 1) *
+                                                sizeof(ContactPackDomain));
+    if (pack->domains == NULL) {
+        perror("Failed to allocate snapshot dictionary");
+        return false;
+    }
+    for (uint32_t i = 0; i < header->domainCount; i++) {
+        if (p >= end || *p > end - p - 1) {
+            return false;
+        }
+        pack->domains[i].length = *p;
+        pack->domains[i].string = (const char *)p + 1;
+        p += 1 + *p;
+    }
+    pack->domainCount = header->domainCount;
+    return p == end;
+}
+
+ContactDbStatus contactPackOpen(ContactPack *pack, const char *filename) {
+    memset(pack, 0, sizeof(*pack));
+    pack->fd = -1;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return CONTACT_DB_MISSING;
+    }
+
+    struct stat st;
+    char magic[sizeof(((ContactPackHeader *)0)->magic)];
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(magic) ||
+        pread(fd, magic, sizeof(magic), 0) != (ssize_t)sizeof(magic) ||
+        memcmp(magic, CONTACT_PACK_MAGIC, sizeof(magic)) != 0) {
+        close(fd);
+        return CONTACT_DB_LEGACY;
+    }
+    if ((size_t)st.st_size < sizeof(ContactPackHeader)) {
+        close(fd);
+        return CONTACT_DB_CORRUPT;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("Failed to map contact snapshot");
+        close(fd);
+        return CONTACT_DB_CORRUPT;
+    }
+
+    pack->fd = fd;
+    pack->map = (const unsigned char *)map;
+    pack->mapSize = (size_t)st.st_size;
+    pack->header = (const ContactPackHeader *)map;
+    if (!validPackHeader(pack->header, pack->mapSize) || !readDictionary(pack) ||
+        checksumData(0, pack->map + pack->header->indexOffset, pack->header->blockCount * sizeof(ContactPackBlock)) !=
+            pack->header->indexChecksum) {
+        contactPackClose(pack);
+        return CONTACT_DB_CORRUPT;
+    }
+    pack->blocks = (const ContactPackBlock *)(pack->map + pack->header->indexOffset);
+    return CONTACT_DB_OK;
+}
+
+size_t contactPackCount(const ContactPack *pack) {
+    return pack->header != NULL ? (size_t)pack->header->recordCount : 0;
+}
+
+bool contactPackVerifyBlock(const ContactPack *pack, size_t block) {
+    if (pack->header == NULL || block >= pack->header->blockCount) {
+        return false;
+    }
+    const ContactPackBlock *entry = &pack->blocks[block];
+    if (entry->offset > pack->mapSize || entry->size > pack->mapSize - entry->offset ||
+        entry->recordCount > pack->header->blockRecords) {
+        return false;
+    }
+    return checksumData(0, pack->map + entry->offset, entry->size) == entry->checksum;
+}
+
+// Writes value as exactly digits decimal digits
+static void putDigits(char *out, uint64_t value, size_t digits) {
+    for (size_t i = digits; i > 0; i--) {
+        out[i - 1] = (char)('0' + value % 10);
+        value /= 10;
+    }
+}
+
+// Decodes the record at p into contact, following the block's previous
+// name (*nameLength bytes) and its last numeric phone, both updated to this
+// record's. NULL when the record is malformed, else the end of what was read.
+static const unsigned char *decodeRecord(const ContactPack *pack, const unsigned char *p, const unsigned char *end,
+                                         const char *previous, uint64_t *nameLength, uint64_t *previousPhone,
+                                         Contact *contact) {
+    memset(contact, 0, sizeof(*contact));
+    uint64_t shared, suffix, tag, domainId, local;
+
+    if ((p = getVarint(p, end, &shared)) == NULL || (p = getVarint(p, end, &suffix)) == NULL ||
+        shared + suffix >= sizeof(contact->name) || suffix > (uint64_t)(end - p) ||
+        shared > *nameLength) {
+        return NULL;
+    }
+    if (shared > 0) {
+        memcpy(contact->name, previous, shared);
+    }
+    memcpy(contact->name + shared, p, suffix);
+    p += suffix;
+    *nameLength = shared + suffix;
+
+    if ((p = getVarint(p, end, &tag)) == NULL) {
+        return NULL;
+    }
+    uint64_t length = tag >> 2;
+    if (tag & 1) {
+        uint64_t delta;
+        bool plus = (tag & 2) != 0;
+        if (length == 0 || length > PHONE_MAX_DIGITS || length + plus >= sizeof(contact->phone) ||
+            (p = getVarint(p, end, &delta)) == NULL) {
+            return NULL;
+        }
+        *previousPhone += (uint64_t)unzigzag(delta);
+        if (plus) {
+            contact->phone[0] = '+';
+        }
+        putDigits(contact->phone + plus, *previousPhone, (size_t)length);
+    } else {
+        if (length >= sizeof(contact->phone) || length > (uint64_t)(end - p)) {
+            return NULL;
+        }
+        memcpy(contact->phone, p, length);
+        p += length;
+    }
+
+    if ((p = getVarint(p, end, &domainId)) == NULL || (p = getVarint(p, end, &local)) == NULL ||
+        domainId > pack->domainCount || local > (uint64_t)(end - p)) {
+        return NULL;
+    }
+    size_t domainLength = domainId > 0 ? pack->domains[domainId - 1].length + 1 : 0;
+    if (local + domainLength >= sizeof(contact->email)) {
+        return NULL;
+    }
+    memcpy(contact->email, p, local);
+    p += local;
+    if (domainId > 0) {
+        contact->email[local] = '@';
+        memcpy(contact->email + local + 1, pack->domains[domainId - 1].string, domainLength - 1);
+    }
+    return p;
+}
+
+bool contactPackDecodeBlock(const ContactPack *pack, size_t block, Contact *out, size_t *count) {
+    *count = 0;
+    if (!contactPackVerifyBlock(pack, block)) {
+        return false;
+    }
+
+    const ContactPackBlock *entry = &pack->blocks[block];
+    const unsigned char *p = pack->map + entry->offset;
+    const unsigned char *end = p + entry->size;
+    uint64_t nameLength = 0;
+    uint64_t previousPhone = 0;
+
+    for (uint32_t i = 0; i < entry->recordCount; i++) {
+        const char *previous = i > 0 ? out[i - 1].name : NULL;
+        if ((p = decodeRecord(pack, p, end, previous, &nameLength, &previousPhone, &out[i])) == NULL) {
+            return false;
+        }
+    }
+
+    *count = entry->recordCount;
+    return p == end;
+}
+
+bool contactPackFindInBlock(const ContactPack *pack, size_t block, const char *name, Contact *out) {
+    if (!contactPackVerifyBlock(pack, block)) {
+        return false;
+    }
+
+    // Names are sorted, so the search stops at the first one past name;
+    // two records are enough to follow the front coding
+    const ContactPackBlock *entry = &pack->blocks[block];
+    const unsigned char *p = pack->map + entry->offset;
+    const unsigned char *end = p + entry->size;
+    uint64_t nameLength = 0;
+    uint64_t previousPhone = 0;
+    Contact records[2];
+    for (uint32_t i = 0; i < entry->recordCount; i++) {
+        Contact *current = &records[i % 2];
+        const char *previous = i > 0 ? records[(i + 1) % 2].name : NULL;
+        if ((p = decodeRecord(pack, p, end, previous, &nameLength, &previousPhone, current)) == NULL) {
+            return false;
+        }
+        int order = strcmp(current->name, name);
+        if (order == 0) {
+            if (out != NULL) {
+                *out = *current;
+            }
+            return true;
+        }
+        if (order > 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool contactPackFirstName(const ContactPack *pack, size_t block, char *name, size_t size) {
+    name[0] = '\0';
+    if (pack->header == NULL || block >= pack->header->blockCount) {
+        return false;
+    }
+    const ContactPackBlock *entry = &pack->blocks[block];
+    if (entry->offset > pack->mapSize || entry->size > pack->mapSize - entry->offset) {
+        return false;
+    }
+    if (entry->recordCount == 0) {
+        return true;
+    }
+
+    const unsigned char *p = pack->map + entry->offset;
+    const unsigned char *end = p + entry->size;
+    uint64_t shared, suffix;
+    if ((p = getVarint(p, end, &shared)) == NULL || (p = getVarint(p, end, &suffix)) == NULL ||
+        shared != 0 || suffix >= size || suffix > (uint64_t)(end - p)) {
+        return false;
+    }
+    memcpy(name, p, suffix);
+    name[suffix] = '\0';
+    return true;
+}
+
+void contactPackClose(ContactPack *pack) {
+    free(pack->domains);
+    if (pack->map != NULL) {
+        munmap((void *)pack->map, pack->mapSize);
+    }
+    if (pack->fd >= 0) {
+        close(pack->fd);
+    }
+    memset(pack, 0, sizeof(*pack));
+    pack->fd = -1;
+}
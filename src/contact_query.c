@@ -0,0 +1,577 @@
+#include "../include/contact_query.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define QUERY_AVX2 __attribute__((target("avx2")))
+#endif
+
+static ContactSimd requestedSimd = CONTACT_SIMD_AVX2;
+
+static ContactSimd supportedSimd(void) {
+#ifdef QUERY_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return CONTACT_SIMD_AVX2;
+    }
+#endif
+#if defined(__SSE2__)
+    return CONTACT_SIMD_SSE2;
+#else
+    return CONTACT_SIMD_SCALAR;
+#endif
+}
+
+static ContactSimd currentSimd(void) {
+    ContactSimd supported = supportedSimd();
+    return requestedSimd < supported ? requestedSimd : supported;
+}
+
+ContactSimd contactQuerySetSimd(ContactSimd level) {
+    requestedSimd = level;
+    return currentSimd();
+}
+
+// Kernels. Each mask covers 64 rows, bit i for row i; columns are padded
+// so whole blocks can always be loaded.
+
+static uint64_t lengthMaskScalar(const uint8_t *lengths, uint8_t length, bool atLeast) {
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i++) {
+        bool hit = atLeast ? lengths[i] >= length : lengths[i] == length;
+        mask |= (uint64_t)hit << i;
+    }
+    return mask;
+}
+
+static uint64_t domainMaskScalar(const uint32_t *domains, uint32_t id) {
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i++) {
+        mask |= (uint64_t)(domains[i] == id) << i;
+    }
+    return mask;
+}
+
+static bool bytesEqualScalar(const unsigned char *value, const char *pattern, size_t length) {
+    return memcmp(value, pattern, length) == 0;
+}
+
+static long findScalar(const unsigned char *hay, size_t size, const char *needle, size_t length) {
+    for (size_t i = 0; i + length <= size; i++) {
+        if (hay[i] == (unsigned char)needle[0] && memcmp(hay + i, needle, length) == 0) {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+#if defined(__SSE2__)
+static uint64_t lengthMaskSse2(const uint8_t *lengths, uint8_t length, bool atLeast) {
+    __m128i target = _mm_set1_epi8((char)length);
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(lengths + i));
+        // block >= target exactly where max(block, target) == block
+        __m128i hit = atLeast ? _mm_cmpeq_epi8(_mm_max_epu8(block, target), block) : _mm_cmpeq_epi8(block, target);
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(hit) << i;
+    }
+    return mask;
+}
+
+static uint64_t domainMaskSse2(const uint32_t *domains, uint32_t id) {
+    __m128i target = _mm_set1_epi32((int)id);
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i += 4) {
+        __m128i hit = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(domains + i)), target);
+        mask |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(hit)) << i;
+    }
+    return mask;
+}
+
+static bool bytesEqualSse2(const unsigned char *value, const char *pattern, size_t length) {
+    for (size_t i = 0; i < length; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(value + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(pattern + i));
+        unsigned differ = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFFu;
+        if (length - i < 16) {
+            differ &= (1u << (length - i)) - 1;
+        }
+        if (differ != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Candidates are the positions where the needle's first and last bytes
+// both match, found 16 at a time; only those compare the bytes between.
+static long findSse2(const unsigned char *hay, size_t size, const char *needle, size_t length) {
+    if (size < length) {
+        return -1;
+    }
+    size_t last = size - length;
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i final = _mm_set1_epi8(needle[length - 1]);
+    for (size_t i = 0; i <= last; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i + length - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, final)));
+        if (last - i < 15) {
+            mask &= (1u << (last - i + 1)) - 1;
+        }
+        while (mask != 0) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (length <= 2 || memcmp(hay + at + 1, needle + 1, length - 2) == 0) {
+                return (long)at;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return -1;
+}
+#endif
+
+#ifdef QUERY_AVX2
+QUERY_AVX2 static uint64_t lengthMaskAvx2(const uint8_t *lengths, uint8_t length, bool atLeast) {
+    __m256i target = _mm256_set1_epi8((char)length);
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(lengths + i));
+        __m256i hit = atLeast ? _mm256_cmpeq_epi8(_mm256_max_epu8(block, target), block)
+                              : _mm256_cmpeq_epi8(block, target);
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(hit) << i;
+    }
+    return mask;
+}
+
+QUERY_AVX2 static uint64_t domainMaskAvx2(const uint32_t *domains, uint32_t id) {
+    __m256i target = _mm256_set1_epi32((int)id);
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i += 8) {
+        __m256i hit = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(domains + i)), target);
+        mask |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(hit)) << i;
+    }
+    return mask;
+}
+
+QUERY_AVX2 static bool bytesEqualAvx2(const unsigned char *value, const char *pattern, size_t length) {
+    for (size_t i = 0; i < length; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(value + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(pattern + i));
+        uint32_t differ = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+        if (length - i < 32) {
+            differ &= (1u << (length - i)) - 1;
+        }
+        if (differ != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QUERY_AVX2 static long findAvx2(const unsigned char *hay, size_t size, const char *needle, size_t length) {
+    if (size < length) {
+        return -1;
+    }
+    size_t last = size - length;
+    __m256i first = _mm256_set1_epi8(needle[0]);
+    __m256i final = _mm256_set1_epi8(needle[length - 1]);
+    for (size_t i = 0; i <= last; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(hay + i + length - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                                        _mm256_cmpeq_epi8(b, final)));
+        if (last - i < 31) {
+            mask &= (1u << (last - i + 1)) - 1;
+        }
+        while (mask != 0) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (length <= 2 || memcmp(hay + at + 1, needle + 1, length - 2) == 0) {
+                return (long)at;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return -1;
+}
+#endif
+
+// The kernels for one instruction set
+typedef struct {
+    uint64_t (*lengthMask)(const uint8_t *lengths, uint8_t length, bool atLeast);
+    uint64_t (*domainMask)(const uint32_t *domains, uint32_t id);
+    bool (*bytesEqual)(const unsigned char *value, const char *pattern, size_t length);
+    long (*find)(const unsigned char *hay, size_t size, const char *needle, size_t length);
+} QueryKernels;
+
+static QueryKernels kernelsFor(ContactSimd level) {
+    QueryKernels kernels = {lengthMaskScalar, domainMaskScalar, bytesEqualScalar, findScalar};
+#if defined(__SSE2__)
+    if (level >= CONTACT_SIMD_SSE2) {
+        kernels = (QueryKernels){lengthMaskSse2, domainMaskSse2, bytesEqualSse2, findSse2};
+    }
+#endif
+#ifdef QUERY_AVX2
+    if (level >= CONTACT_SIMD_AVX2) {
+        kernels = (QueryKernels){lengthMaskAvx2, domainMaskAvx2, bytesEqualAvx2, findAvx2};
+    }
+#endif
+    (void)level;
+    return kernels;
+}
+
+static size_t fieldLimit(ContactField field) {
+    Contact contact;
+    switch (field) {
+        case CONTACT_FIELD_NAME: return sizeof(contact.name) - 1;
+        case CONTACT_FIELD_PHONE: return sizeof(contact.phone) - 1;
+        default: return sizeof(contact.email) - 1;
+    }
+}
+
+// Email value of a slot as local@domain
+static size_t slotEmail(const ContactStore *store, uint32_t slot, unsigned char *out) {
+    const char *domain;
+    const char *local = contactSlotEmail(store, slot, &domain);
+    size_t length = (unsigned char)local[-1];
+    if (out != NULL) {
+        memcpy(out, local, length);
+    }
+    if (domain != NULL) {
+        size_t domainLength = (unsigned char)domain[-1];
+        if (out != NULL) {
+            out[length] = '@';
+            memcpy(out + length + 1, domain, domainLength);
+        }
+        length += domainLength + 1;
+    }
+    return length;
+}
+
+static size_t slotValue(const ContactStore *store, uint32_t slot, ContactField field, unsigned char *out) {
+    const char *value;
+    switch (field) {
+        case CONTACT_FIELD_NAME: value = contactSlotName(store, slot); break;
+        case CONTACT_FIELD_PHONE: value = contactSlotPhone(store, slot); break;
+        default: return slotEmail(store, slot, out);
+    }
+    size_t length = (unsigned char)value[-1];
+    if (out != NULL) {
+        memcpy(out, value, length);
+    }
+    return length;
+}
+
+bool contactColumnsBuild(ContactColumns *columns, const ContactStore *store) {
+    memset(columns, 0, sizeof(*columns));
+    size_t rows = store->count;
+    size_t padded = (rows + 63) / 64 * 64;
+
+    size_t sizes[CONTACT_FIELD_COUNT] = {0};
+    for (uint32_t slot = 0; slot < store->slotCount; slot++) {
+        if (contactSlotAt(store, slot)->live) {
+            for (int field = 0; field < CONTACT_FIELD_COUNT; field++) {
+                sizes[field] += slotValue(store, slot, (ContactField)field, NULL) + 1;
+            }
+        }
+    }
+
+    bool ok = true;
+    columns->handles = (ContactHandle *)malloc((rows ? rows : 1) * sizeof(ContactHandle));
+    columns->domains = (uint32_t *)calloc(padded + CONTACT_COLUMN_PADDING, sizeof(uint32_t));
+    ok = columns->handles != NULL && columns->domains != NULL;
+    for (int field = 0; ok && field < CONTACT_FIELD_COUNT; field++) {
+        ContactColumn *column = &columns->columns[field];
+        column->data = (unsigned char *)calloc(sizes[field] + CONTACT_COLUMN_PADDING, 1);
+        column->offsets = (uint32_t *)malloc((rows + 1) * sizeof(uint32_t));
+        column->lengths = (uint8_t *)calloc(padded + CONTACT_COLUMN_PADDING, 1);
+        ok = column->data != NULL && column->offsets != NULL && column->lengths != NULL && sizes[field] < UINT32_MAX;
+    }
+    if (!ok || !stringPoolCopy(&columns->domainNames, &store->domains)) {
+        perror("Failed to build contact columns");
+        contactColumnsFree(columns);
+        return false;
+    }
+
+    size_t row = 0;
+    for (uint32_t slot = 0; slot < store->slotCount; slot++) {
+        const ContactSlot *entry = contactSlotAt(store, slot);
+        if (!entry->live) {
+            continue;
+        }
+        columns->handles[row] = (ContactHandle)entry->generation << 32 | slot;
+        columns->domains[row] = entry->domain;
+        for (int field = 0; field < CONTACT_FIELD_COUNT; field++) {
+            ContactColumn *column = &columns->columns[field];
+            size_t length = slotValue(store, slot, (ContactField)field, column->data + column->size);
+            column->offsets[row] = (uint32_t)column->size;
+            column->lengths[row] = (uint8_t)length;
+            column->size += length + 1;
+        }
+        row++;
+    }
+    for (int field = 0; field < CONTACT_FIELD_COUNT; field++) {
+        columns->columns[field].offsets[rows] = (uint32_t)columns->columns[field].size;
+    }
+    columns->rows = rows;
+    return true;
+}
+
+void contactColumnsFree(ContactColumns *columns) {
+    free(columns->handles);
+    free(columns->domains);
+    for (int field = 0; field < CONTACT_FIELD_COUNT; field++) {
+        free(columns->columns[field].data);
+        free(columns->columns[field].offsets);
+        free(columns->columns[field].lengths);
+    }
+    stringPoolFree(&columns->domainNames);
+    memset(columns, 0, sizeof(*columns));
+}
+
+size_t contactColumnsBytes(const ContactColumns *columns) {
+    size_t padded = (columns->rows + 63) / 64 * 64;
+    size_t bytes = columns->rows * sizeof(ContactHandle) + (padded + CONTACT_COLUMN_PADDING) * sizeof(uint32_t) +
+                   stringPoolBytes(&columns->domainNames);
+    for (int field = 0; field < CONTACT_FIELD_COUNT; field++) {
+        bytes += columns->columns[field].size + CONTACT_COLUMN_PADDING + (columns->rows + 1) * sizeof(uint32_t) +
+                 padded + CONTACT_COLUMN_PADDING;
+    }
+    return bytes;
+}
+
+static int stepCost(const ContactQueryStep *step) {
+    switch (step->match) {
+        case CONTACT_MATCH_DOMAIN: return 0;
+        case CONTACT_MATCH_EQUALS: return 1;
+        case CONTACT_MATCH_PREFIX: return 2;
+        default: return 3;
+    }
+}
+
+bool contactQueryCompile(ContactQuery *query, const ContactPredicate *predicates, size_t count) {
+    memset(query, 0, sizeof(*query));
+    if (count > CONTACT_QUERY_MAX_PREDICATES) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const ContactPredicate *predicate = &predicates[i];
+        if (predicate->value == NULL) {
+            return false;
+        }
+        const char *value = predicate->value;
+        ContactField field = predicate->field;
+        if (predicate->match == CONTACT_MATCH_DOMAIN) {
+            field = CONTACT_FIELD_EMAIL;
+            value += value[0] == '@';
+        }
+        size_t length = strlen(value);
+        if (length > fieldLimit(field)) {
+            query->empty = true;
+            continue;
+        }
+        // An empty prefix or substring matches every row
+        if (length == 0 && (predicate->match == CONTACT_MATCH_PREFIX || predicate->match == CONTACT_MATCH_CONTAINS)) {
+            continue;
+        }
+
+        // Insertion keeps equal costs in the order given
+        ContactQueryStep step = {field, predicate->match, "", length};
+        memcpy(step.value, value, length);
+        size_t at = query->count;
+        while (at > 0 && stepCost(&query->steps[at - 1]) > stepCost(&step)) {
+            query->steps[at] = query->steps[at - 1];
+            at--;
+        }
+        query->steps[at] = step;
+        query->count++;
+    }
+    return true;
+}
+
+static bool sameDomain(const char *domain, const char *value, size_t length) {
+    if ((unsigned char)domain[-1] != length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        unsigned char a = (unsigned char)domain[i];
+        unsigned char b = (unsigned char)value[i];
+        if ((a >= 'A' && a <= 'Z' ? a + 32 : a) != (b >= 'A' && b <= 'Z' ? b + 32 : b)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Domain ids spelled like the step's value
+static uint32_t *matchingDomains(const ContactColumns *columns, const ContactQueryStep *step, size_t *count) {
+    const StringPool *pool = &columns->domainNames;
+    *count = 0;
+    for (uint32_t id = 1; id <= pool->count; id++) {
+        *count += sameDomain(stringPoolGet(pool, id), step->value, step->length);
+    }
+    uint32_t *ids = (uint32_t *)malloc((*count ? *count : 1) * sizeof(uint32_t));
+    if (ids == NULL) {
+        perror("Failed to run contact query");
+        return NULL;
+    }
+    size_t found = 0;
+    for (uint32_t id = 1; id <= pool->count; id++) {
+        if (sameDomain(stringPoolGet(pool, id), step->value, step->length)) {
+            ids[found++] = id;
+        }
+    }
+    return ids;
+}
+
+static bool applyDomain(const ContactColumns *columns, const ContactQueryStep *step, const QueryKernels *kernels,
+                        uint64_t *selection, size_t words) {
+    size_t idCount;
+    uint32_t *ids = matchingDomains(columns, step, &idCount);
+    if (ids == NULL) {
+        return false;
+    }
+    for (size_t w = 0; w < words; w++) {
+        if (selection[w] == 0) {
+            continue;
+        }
+        uint64_t mask = 0;
+        for (size_t i = 0; i < idCount; i++) {
+            mask |= kernels->domainMask(columns->domains + w * 64, ids[i]);
+        }
+        selection[w] &= mask;
+    }
+    free(ids);
+    return true;
+}
+
+// Equals and prefix: the lengths column rules out most rows 64 at a time,
+// then the remaining candidates compare their leading bytes.
+static void applyLeading(const ContactColumns *columns, const ContactQueryStep *step, const QueryKernels *kernels,
+                         uint64_t *selection, size_t words) {
+    const ContactColumn *column = &columns->columns[step->field];
+    bool atLeast = step->match == CONTACT_MATCH_PREFIX;
+    for (size_t w = 0; w < words; w++) {
+        if (selection[w] == 0) {
+            continue;
+        }
+        uint64_t candidates = selection[w] & kernels->lengthMask(column->lengths + w * 64, (uint8_t)step->length, atLeast);
+        uint64_t mask = 0;
+        while (candidates != 0) {
+            int bit = __builtin_ctzll(candidates);
+            size_t row = w * 64 + (size_t)bit;
+            if (kernels->bytesEqual(column->data + column->offsets[row], step->value, step->length)) {
+                mask |= (uint64_t)1 << bit;
+            }
+            candidates &= candidates - 1;
+        }
+        selection[w] = mask;
+    }
+}
+
+static size_t selectedRows(const uint64_t *selection, size_t words) {
+    size_t count = 0;
+    for (size_t w = 0; w < words; w++) {
+        count += (size_t)__builtin_popcountll(selection[w]);
+    }
+    return count;
+}
+
+// Substrings: when most rows are still selected the whole column is
+// searched in one pass (no match can span rows, as values are separated by
+// NULs); otherwise each selected row is searched on its own.
+static bool applyContains(const ContactColumns *columns, const ContactQueryStep *step, const QueryKernels *kernels,
+                          uint64_t *selection, size_t words) {
+    const ContactColumn *column = &columns->columns[step->field];
+    if (selectedRows(selection, words) < columns->rows / 8) {
+        for (size_t w = 0; w < words; w++) {
+            uint64_t candidates = selection[w] & kernels->lengthMask(column->lengths + w * 64, (uint8_t)step->length, true);
+            uint64_t mask = 0;
+            while (candidates != 0) {
+                int bit = __builtin_ctzll(candidates);
+                size_t row = w * 64 + (size_t)bit;
+                if (kernels->find(column->data + column->offsets[row], column->lengths[row], step->value, step->length) >= 0) {
+                    mask |= (uint64_t)1 << bit;
+                }
+                candidates &= candidates - 1;
+            }
+            selection[w] = mask;
+        }
+        return true;
+    }
+
+    uint64_t *found = (uint64_t *)calloc(words, sizeof(uint64_t));
+    if (found == NULL) {
+        perror("Failed to run contact query");
+        return false;
+    }
+    size_t position = 0;
+    size_t row = 0;
+    long at;
+    while (position < column->size &&
+           (at = kernels->find(column->data + position, column->size - position, step->value, step->length)) >= 0) {
+        size_t match = position + (size_t)at;
+        while (column->offsets[row + 1] <= match) {
+            row++;
+        }
+        found[row / 64] |= (uint64_t)1 << (row % 64);
+        position = column->offsets[row + 1];
+    }
+    for (size_t w = 0; w < words; w++) {
+        selection[w] &= found[w];
+    }
+    free(found);
+    return true;
+}
+
+size_t contactQueryRun(const ContactColumns *columns, const ContactQuery *query, ContactHandle *out, size_t limit) {
+    if (query->empty || columns->rows == 0) {
+        return 0;
+    }
+    size_t words = (columns->rows + 63) / 64;
+    uint64_t *selection = (uint64_t *)malloc(words * sizeof(uint64_t));
+    if (selection == NULL) {
+        perror("Failed to run contact query");
+        return 0;
+    }
+    memset(selection, 0xFF, words * sizeof(uint64_t));
+    if (columns->rows % 64 != 0) {
+        selection[words - 1] = ((uint64_t)1 << (columns->rows % 64)) - 1;
+    }
+
+    QueryKernels kernels = kernelsFor(currentSimd());
+    bool ok = true;
+    for (size_t i = 0; ok && i < query->count; i++) {
+        const ContactQueryStep *step = &query->steps[i];
+        switch (step->match) {
+            case CONTACT_MATCH_DOMAIN:
+                ok = applyDomain(columns, step, &kernels, selection, words);
+                break;
+            case CONTACT_MATCH_EQUALS:
+            case CONTACT_MATCH_PREFIX:
+                applyLeading(columns, step, &kernels, selection, words);
+                break;
+            case CONTACT_MATCH_CONTAINS:
+                ok = applyContains(columns, step, &kernels, selection, words);
+                break;
+        }
+    }
+
+    size_t matches = 0;
+    for (size_t w = 0; ok && w < words; w++) {
+        uint64_t bits = selection[w];
+        while (bits != 0) {
+            if (out != NULL && matches < limit) {
+                out[matches] = columns->handles[w * 64 + (size_t)__builtin_ctzll(bits)];
+            }
+            matches++;
+            bits &= bits - 1;
+        }
+    }
+    free(selection);
+    return matches;
+}
@@ -0,0 +1,257 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_saver.h"
+#include "../include/contact_pack.h"
+#include "../include/contact_wal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void recordResult(ContactSaver *saver, const ContactSaveResult *result) {
+    ContactSaveStats *stats = &saver->stats;
+    if (!result->ok) {
+        stats->failures++;
+        return;
+    }
+    stats->saves++;
+    stats->lastMs = result->totalMs;
+    stats->totalMs += result->totalMs;
+    if (result->totalMs > stats->maxMs) {
+        stats->maxMs = result->totalMs;
+    }
+    stats->lastCaptureMs = result->captureMs;
+    if (result->captureMs > stats->maxCaptureMs) {
+        stats->maxCaptureMs = result->captureMs;
+    }
+}
+
+static void *writerThread(void *arg) {
+    ContactSaver *saver = (ContactSaver *)arg;
+
+    pthread_mutex_lock(&saver->lock);
+    for (;;) {
+        while (saver->queued < 0 && !saver->stopping) {
+            pthread_cond_wait(&saver->wake, &saver->lock);
+        }
+        if (saver->queued < 0) {
+            break;
+        }
+
+        saver->writing = saver->queued;
+        saver->queued = -1;
+        pthread_cond_broadcast(&saver->idle);
+        pthread_mutex_unlock(&saver->lock);
+
+        ContactSaveJob *job = &saver->jobs[saver->writing];
+        double start = nowSeconds();
+        size_t written = 0;
+        bool ok = contactPackWriteRecords(job->records, job->slots, job->count, &job->tags, job->filename,
+                                          job->walSequence, &written);
+        double end = nowSeconds();
+
+        ContactSaveResult result = {
+            .filename = job->filename,
+            .ok = ok,
+            .count = written,
+            .walSequence = job->walSequence,
+            .captureMs = job->captureMs,
+            .writeMs = (end - start) * 1e3,
+            .totalMs = (end - job->requestedAt) * 1e3
+        };
+
+        pthread_mutex_lock(&saver->lock);
+        recordResult(saver, &result);
+        pthread_mutex_unlock(&saver->lock);
+
+        if (job->callback != NULL) {
+            job->callback(&result, job->userData);
+        }
+
+        pthread_mutex_lock(&saver->lock);
+        saver->writing = -1;
+        pthread_cond_broadcast(&saver->idle);
+    }
+    pthread_mutex_unlock(&saver->lock);
+    return NULL;
+}
+
+bool contactSaverStart(ContactSaver *saver) {
+    memset(saver, 0, sizeof(*saver));
+    saver->queued = -1;
+    saver->writing = -1;
+    pthread_mutex_init(&saver->lock, NULL);
+    pthread_cond_init(&saver->wake, NULL);
+    pthread_cond_init(&saver->idle, NULL);
+
+    if (pthread_create(&saver->thread, NULL, writerThread, saver) != 0) {
+        perror("Failed to start snapshot writer");
+        pthread_mutex_destroy(&saver->lock);
+        pthread_cond_destroy(&saver->wake);
+        pthread_cond_destroy(&saver->idle);
+        return false;
+    }
+    saver->started = true;
+    return true;
+}
+
+// Waits for a free buffer and makes sure it holds count contacts. The
+// writer never touches the buffer until it is queued.
+static ContactSaveJob *claimJob(ContactSaver *saver, size_t count, int *index) {
+    // At most one save waits behind the one being written
+    pthread_mutex_lock(&saver->lock);
+    while (saver->queued >= 0) {
+        pthread_cond_wait(&saver->idle, &saver->lock);
+    }
+    *index = saver->writing == 0 ? 1 : 0;
+    pthread_mutex_unlock(&saver->lock);
+
+    ContactSaveJob *job = &saver->jobs[*index];
+    if (count > job->capacity) {
+        Contact *records = (Contact *)realloc(job->records, count * sizeof(Contact));
+        if (records != NULL) {
+            job->records = records;
+        }
+        uint32_t *slots = (uint32_t *)realloc(job->slots, count * sizeof(uint32_t));
+        if (slots != NULL) {
+            job->slots = slots;
+        }
+        if (records == NULL || slots == NULL) {
+            perror("Failed to allocate snapshot buffer");
+            return NULL;
+        }
+        job->capacity = count;
+    }
+    return job;
+}
+
+static void queueJob(ContactSaver *saver, int index, const char *filename,
+                     ContactSaveCallback callback, void *userData, double start) {
+    ContactSaveJob *job = &saver->jobs[index];
+    snprintf(job->filename, sizeof(job->filename), "%s", filename);
+    job->callback = callback;
+    job->userData = userData;
+    job->requestedAt = start;
+    job->captureMs = (nowSeconds() - start) * 1e3;
+
+    pthread_mutex_lock(&saver->lock);
+    saver->queued = index;
+    pthread_cond_signal(&saver->wake);
+    pthread_mutex_unlock(&saver->lock);
+}
+
+bool saveContactsAsync(ContactSaver *saver, const ContactStore *store, const char *filename,
+                       ContactSaveCallback callback, void *userData) {
+    double start = nowSeconds();
+    int index;
+    ContactSaveJob *job = claimJob(saver, store->count, &index);
+    if (job == NULL) {
+        return false;
+    }
+
+    static const ContactTags none;
+    if (!contactTagSetCopy(&job->tags, store->tags != NULL ? store->tags : &none)) {
+        return false;
+    }
+
+    ContactIterator it;
+    const Contact *contact;
+    size_t count = 0;
+    contactIteratorInit(&it, store);
+    while ((contact = contactIteratorNext(&it)) != NULL) {
+        job->slots[count] = (uint32_t)it.handle;
+        job->records[count++] = *contact;
+    }
+
+    job->count = count;
+    job->walSequence = store->wal != NULL ? store->wal->sequence : 0;
+    queueJob(saver, index, filename, callback, userData, start);
+    return true;
+}
+
+static bool captureContact(uint32_t slot, const Contact *contact, void *userData) {
+    ContactSaveJob *job = (ContactSaveJob *)userData;
+    job->slots[job->count] = slot;
+    job->records[job->count++] = *contact;
+    return true;
+}
+
+bool saveSharedContactsAsync(ContactSaver *saver, ContactShared *shared, const char *filename,
+                             ContactSaveCallback callback, void *userData) {
+    double start = nowSeconds();
+    // The tags go into a spare set until a buffer is free to hold them
+    ContactTags tags = {0};
+    ContactSnapshot snapshot;
+    if (!contactSharedSnapshotTags(shared, &snapshot, &tags)) {
+        contactTagSetFree(&tags);
+        return false;
+    }
+    int index;
+    ContactSaveJob *job = claimJob(saver, snapshot.count, &index);
+    if (job != NULL) {
+        job->count = 0;
+        contactSharedScanSlots(shared, &snapshot, captureContact, job);
+        job->walSequence = snapshot.walSequence;
+        contactTagSetFree(&job->tags);
+        job->tags = tags;
+    } else {
+        contactTagSetFree(&tags);
+    }
+    contactSharedRelease(shared, &snapshot);
+    if (job == NULL) {
+        return false;
+    }
+    queueJob(saver, index, filename, callback, userData, start);
+    return true;
+}
+
+void contactSaverWait(ContactSaver *saver) {
+    pthread_mutex_lock(&saver->lock);
+    while (saver->queued >= 0 || saver->writing >= 0) {
+        pthread_cond_wait(&saver->idle, &saver->lock);
+    }
+    pthread_mutex_unlock(&saver->lock);
+}
+
+void contactSaverStats(ContactSaver *saver, ContactSaveStats *stats) {
+    // Stats stay readable after contactSaverStop
+    if (!saver->started) {
+        *stats = saver->stats;
+        return;
+    }
+    pthread_mutex_lock(&saver->lock);
+    *stats = saver->stats;
+    pthread_mutex_unlock(&saver->lock);
+}
+
+void contactSaverStop(ContactSaver *saver) {
+    if (!saver->started) {
+        return;
+    }
+
+    // Anything already queued is still written before the thread exits
+    pthread_mutex_lock(&saver->lock);
+    saver->stopping = true;
+    pthread_cond_signal(&saver->wake);
+    pthread_mutex_unlock(&saver->lock);
+    pthread_join(saver->thread, NULL);
+
+    pthread_mutex_destroy(&saver->lock);
+    pthread_cond_destroy(&saver->wake);
+    pthread_cond_destroy(&saver->idle);
+    for (int i = 0; i < 2; i++) {
+        free(saver->jobs[i].records);
+        free(saver->jobs[i].slots);
+        contactTagSetFree(&saver->jobs[i].tags);
+        saver->jobs[i].records = NULL;
+        saver->jobs[i].slots = NULL;
+        saver->jobs[i].capacity = 0;
+    }
+    saver->started = false;
+}
@@ -0,0 +1,418 @@
+#include "../include/contact_shards.h"
+#include "../include/contact_db.h"
+#include "../include/contact_pack.h"
+#include "../include/contact_tags.h"
+#include "../include/contact_collate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHARD_NONE UINT16_MAX
+#define SHARD_LOAD_BATCH 256
+
+bool contactShardsInit(ContactShards *store, size_t shardCount) {
+    memset(store, 0, sizeof(*store));
+    if (shardCount == 0 || shardCount >= SHARD_NONE) {
+        return false;
+    }
+
+    store->shards = (ContactShared *)calloc(shardCount, sizeof(ContactShared));
+    store->locked = (const ContactStore **)calloc(shardCount, sizeof(ContactStore *));
+    if (store->shards == NULL || store->locked == NULL) {
+        perror("Failed to allocate contact shards");
+        free(store->shards);
+        free(store->locked);
+        return false;
+    }
+    for (size_t i = 0; i < shardCount; i++) {
+        contactSharedInit(&store->shards[i]);
+    }
+    store->count = shardCount;
+    return true;
+}
+
+void contactShardsFree(ContactShards *store) {
+    for (size_t i = 0; i < store->count; i++) {
+        contactSharedFree(&store->shards[i]);
+    }
+    free(store->shards);
+    free(store->locked);
+    memset(store, 0, sizeof(*store));
+}
+
+size_t contactShardFor(const ContactShards *store, const char *name) {
+    // By collation key, so every spelling update and delete accept for a
+    // name leads to its shard. Longer names than a contact holds are hashed
+    // as they are; they match nothing anyway.
+    char key[sizeof(((Contact *)0)->name)];
+    size_t length = strlen(name);
+    if (length < sizeof(key)) {
+        contactCollate(name, length, key);
+        name = key;
+    }
+
+    // FNV-1a, remixed so names that share a shard still spread over the
+    // shard index, which buckets by the low bits of plain FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *p = name; *p != '\0'; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return (size_t)(hash % store->count);
+}
+
+bool contactShardsAdd(ContactShards *store, const Contact *contact) {
+    ContactShared *shard = &store->shards[contactShardFor(store, contact->name)];
+    return contactSharedAdd(shard, contact) != CONTACT_HANDLE_NONE;
+}
+
+static bool applyAdd(ContactStore *store, void *arg) {
+    return addContact(store, (const Contact *)arg) != CONTACT_HANDLE_NONE;
+}
+
+static bool applyDelete(ContactStore *store, void *arg) {
+    return deleteContact(store, (const char *)arg);
+}
+
+bool contactShardsUpdate(ContactShards *store, const char *name, const Contact *newContact) {
+    size_t from = contactShardFor(store, name);
+    size_t to = contactShardFor(store, newContact->name);
+    if (from == to) {
+        return contactSharedUpdate(&store->shards[from], name, newContact);
+    }
+
+    // A rename can move the contact to another shard. Both writers are held
+    // so a locked snapshot never sees it in both shards or in neither.
+    size_t first = from < to ? from : to;
+    size_t second = from < to ? to : from;
+    const ContactStore *firstView = contactSharedLock(&store->shards[first]);
+    const ContactStore *secondView = contactSharedLock(&store->shards[second]);
+
+    bool moved = false;
+    if (matchContact(from == first ? firstView : secondView, name, NULL)) {
+        Contact copy = *newContact;
+        moved = contactSharedWriteLocked(&store->shards[to], applyAdd, &copy) &&
+                contactSharedWriteLocked(&store->shards[from], applyDelete, (void *)name);
+    }
+
+    contactSharedUnlock(&store->shards[second]);
+    contactSharedUnlock(&store->shards[first]);
+    return moved;
+}
+
+bool contactShardsDelete(ContactShards *store, const char *name) {
+    return contactSharedDelete(&store->shards[contactShardFor(store, name)], name);
+}
+
+bool contactShardsFind(ContactShards *store, const char *name, Contact *out) {
+    return contactSharedFind(&store->shards[contactShardFor(store, name)], name, out);
+}
+
+size_t contactShardsCount(ContactShards *store) {
+    size_t count = 0;
+    for (size_t i = 0; i < store->count; i++) {
+        count += contactSharedCount(&store->shards[i]);
+    }
+    return count;
+}
+
+void contactShardsLockAll(ContactShards *store) {
+    for (size_t i = 0; i < store->count; i++) {
+        store->locked[i] = contactSharedLock(&store->shards[i]);
+    }
+}
+
+void contactShardsUnlockAll(ContactShards *store) {
+    for (size_t i = store->count; i > 0; i--) {
+        contactSharedUnlock(&store->shards[i - 1]);
+        store->locked[i - 1] = NULL;
+    }
+}
+
+void contactShardsIteratorInit(ContactShardsIterator *it, const ContactShards *store) {
+    it->store = store;
+    it->shard = 0;
+    if (store->count > 0) {
+        contactIteratorInit(&it->it, store->locked[0]);
+    }
+}
+
+const Contact *contactShardsIteratorNext(ContactShardsIterator *it) {
+    while (it->shard < it->store->count) {
+        const Contact *contact = contactIteratorNext(&it->it);
+        if (contact != NULL) {
+            return contact;
+        }
+        if (++it->shard < it->store->count) {
+            contactIteratorInit(&it->it, it->store->locked[it->shard]);
+        }
+    }
+    return NULL;
+}
+
+// Writes a packed snapshot (contact_pack.h) of every shard, tags included.
+// Each shard's slots are numbered after the previous shard's, which gives
+// the shards' tags one numbering for the sidecar. Sharded stores have no
+// log, so the snapshot's walSequence is 0.
+bool contactShardsSave(ContactShards *store, const char *filename, size_t *written) {
+    contactShardsLockAll(store);
+    size_t count = 0;
+    for (size_t shard = 0; shard < store->count; shard++) {
+        count += store->locked[shard]->count;
+    }
+
+    Contact *records = (Contact *)malloc((count ? count : 1) * sizeof(Contact));
+    uint32_t *slots = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+    ContactTags tags = {0};
+    bool ok = records != NULL && slots != NULL;
+    if (!ok) {
+        perror("Failed to allocate shard snapshot");
+    }
+
+    size_t filled = 0;
+    uint32_t base = 0;
+    for (size_t shard = 0; shard < store->count && ok; shard++) {
+        const ContactStore *locked = store->locked[shard];
+        ContactIterator it;
+        const Contact *contact;
+        contactIteratorInit(&it, locked);
+        while ((contact = contactIteratorNext(&it)) != NULL) {
+            records[filled] = *contact;
+            slots[filled++] = base + (uint32_t)(it.slot - 1);
+        }
+        ok = locked->tags == NULL || contactTagSetMerge(&tags, locked->tags, base);
+        base += (uint32_t)locked->slotCount;
+    }
+
+    ok = ok && contactPackWriteRecords(records, slots, filled, &tags, filename, 0, written);
+    contactShardsUnlockAll(store);
+    contactTagSetFree(&tags);
+    free(records);
+    free(slots);
+    return ok;
+}
+
+// shardOf holds one entry per record position, page * records per page + i
+typedef struct {
+    const ContactDb *db;
+    const uint16_t *shardOf;
+    uint16_t shard;
+    size_t count;
+} ShardLoad;
+
+static bool loadShard(ContactStore *store, void *arg) {
+    ShardLoad *load = (ShardLoad *)arg;
+    reserveContacts(store, store->count + load->count);
+
+    for (size_t page = 0; page < load->db->header->pageCount; page++) {
+        size_t records;
+        const Contact *stored = contactDbPage(load->db, page, &records);
+        const uint16_t *shardOf = load->shardOf + page * CONTACT_DB_RECORDS_PER_PAGE;
+        Contact batch[CONTACT_DB_RECORDS_PER_PAGE];
+        size_t count = 0;
+        for (size_t i = 0; i < records; i++) {
+            if (shardOf[i] != load->shard) {
+                continue;
+            }
+            Contact *contact = &batch[count++];
+            *contact = stored[i];
+            contact->name[sizeof(contact->name) - 1] = '\0';
+            contact->phone[sizeof(contact->phone) - 1] = '\0';
+            contact->email[sizeof(contact->email) - 1] = '\0';
+        }
+        addContacts(store, batch, count, NULL);
+    }
+    return true;
+}
+
+// Adds the contacts of a paged database, which shards were saved as before
+// packed snapshots.
+static bool loadPaged(ContactShards *store, const ContactDb *db, const char *filename, size_t *loaded) {
+    size_t positions = db->header->pageCount * CONTACT_DB_RECORDS_PER_PAGE;
+    uint16_t *shardOf = (uint16_t *)malloc((positions ? positions : 1) * sizeof(uint16_t));
+    size_t *counts = (size_t *)calloc(store->count, sizeof(size_t));
+    if (shardOf == NULL || counts == NULL) {
+        perror("Failed to allocate shard load buffers");
+        free(shardOf);
+        free(counts);
+        return false;
+    }
+
+    for (size_t page = 0; page < db->header->pageCount; page++) {
+        size_t records;
+        const Contact *batch = contactDbPage(db, page, &records);
+        uint16_t *pageShards = shardOf + page * CONTACT_DB_RECORDS_PER_PAGE;
+        bool valid = contactDbVerifyPage(db, page);
+        if (!valid) {
+            fprintf(stderr, "Skipping damaged page %zu in %s\n", page, filename);
+        }
+
+        for (size_t i = 0; i < CONTACT_DB_RECORDS_PER_PAGE; i++) {
+            pageShards[i] = SHARD_NONE;
+            if (!valid || i >= records) {
+                continue;
+            }
+            char name[sizeof(batch[i].name)];
+            memcpy(name, batch[i].name, sizeof(name));
+            name[sizeof(name) - 1] = '\0';
+            pageShards[i] = (uint16_t)contactShardFor(store, name);
+            counts[pageShards[i]]++;
+        }
+    }
+
+    size_t added = 0;
+    for (size_t shard = 0; shard < store->count; shard++) {
+        if (counts[shard] == 0) {
+            continue;
+        }
+        ShardLoad load = {db, shardOf, (uint16_t)shard, counts[shard]};
+        contactSharedReplace(&store->shards[shard], loadShard, &load);
+        added += counts[shard];
+    }
+
+    free(shardOf);
+    free(counts);
+    if (loaded != NULL) {
+        *loaded = added;
+    }
+    return true;
+}
+
+// One shard's share of a packed snapshot. ranks lists the snapshot
+// positions of the shard's records in order.
+typedef struct {
+    const Contact *records;      // the whole snapshot, by position
+    const uint32_t *ranks;
+    size_t count;
+    const ContactTags *tags;     // tags by position, NULL when none apply
+} PackShardLoad;
+
+static bool loadPackShard(ContactStore *store, void *arg) {
+    PackShardLoad *load = (PackShardLoad *)arg;
+    reserveContacts(store, store->count + load->count);
+
+    Contact batch[SHARD_LOAD_BATCH];
+    ContactHandle handles[SHARD_LOAD_BATCH];
+    for (size_t first = 0; first < load->count; first += SHARD_LOAD_BATCH) {
+        size_t count = load->count - first < SHARD_LOAD_BATCH ? load->count - first : SHARD_LOAD_BATCH;
+        for (size_t i = 0; i < count; i++) {
+            batch[i] = load->records[load->ranks[first + i]];
+        }
+        size_t added = addContacts(store, batch, count, handles);
+        for (size_t i = 0; i < added && load->tags != NULL; i++) {
+            uint32_t slot = (uint32_t)handles[i];
+            if (handles[i] != CONTACT_HANDLE_NONE &&
+                !contactTagsApply(store, load->tags, load->ranks[first + i], &slot, 1)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Decodes every block once, then gives each shard its records in one write.
+// Tags are kept by snapshot position, so they only apply when the shards
+// end up holding exactly the snapshot's contacts.
+static bool loadPacked(ContactShards *store, ContactPack *pack, const char *filename, size_t *loaded) {
+    size_t total = 0;
+    for (size_t block = 0; block < pack->header->blockCount; block++) {
+        total += pack->blocks[block].recordCount;
+    }
+
+    Contact *records = (Contact *)malloc((total ? total : 1) * sizeof(Contact));
+    uint16_t *shardOf = (uint16_t *)malloc((total ? total : 1) * sizeof(uint16_t));
+    uint32_t *ranks = (uint32_t *)malloc((total ? total : 1) * sizeof(uint32_t));
+    size_t *starts = (size_t *)calloc(store->count + 1, sizeof(size_t));
+    if (records == NULL || shardOf == NULL || ranks == NULL || starts == NULL) {
+        perror("Failed to allocate shard load buffers");
+        free(records);
+        free(shardOf);
+        free(ranks);
+        free(starts);
+        return false;
+    }
+
+    bool complete = true;
+    size_t position = 0;
+    for (size_t block = 0; block < pack->header->blockCount; block++) {
+        size_t count = pack->blocks[block].recordCount;
+        size_t decoded;
+        if (!contactPackDecodeBlock(pack, block, records + position, &decoded)) {
+            fprintf(stderr, "Skipping damaged block %zu in %s\n", block, filename);
+            decoded = 0;
+            complete = false;
+        }
+        for (size_t i = 0; i < count; i++, position++) {
+            shardOf[position] = SHARD_NONE;
+            if (i < decoded) {
+                shardOf[position] = (uint16_t)contactShardFor(store, records[position].name);
+                starts[shardOf[position] + 1]++;
+            }
+        }
+    }
+
+    // Bucket the positions by shard, keeping them in name order
+    for (size_t shard = 0; shard < store->count; shard++) {
+        starts[shard + 1] += starts[shard];
+    }
+    size_t *next = (size_t *)malloc((store->count ? store->count : 1) * sizeof(size_t));
+    bool ok = next != NULL;
+    if (ok) {
+        memcpy(next, starts, store->count * sizeof(size_t));
+        for (size_t i = 0; i < total; i++) {
+            if (shardOf[i] != SHARD_NONE) {
+                ranks[next[shardOf[i]]++] = (uint32_t)i;
+            }
+        }
+    } else {
+        perror("Failed to allocate shard load buffers");
+    }
+
+    ContactTags tags = {0};
+    bool tagged = ok && complete && contactShardsCount(store) == 0 && total == contactPackCount(pack) &&
+                  contactTagsRead(filename, pack->header->headerChecksum, total, &tags);
+
+    size_t added = 0;
+    for (size_t shard = 0; shard < store->count && ok; shard++) {
+        PackShardLoad load = {records, ranks + starts[shard], starts[shard + 1] - starts[shard],
+                              tagged ? &tags : NULL};
+        if (load.count == 0) {
+            continue;
+        }
+        contactSharedReplace(&store->shards[shard], loadPackShard, &load);
+        added += load.count;
+    }
+
+    contactTagSetFree(&tags);
+    free(next);
+    free(records);
+    free(shardOf);
+    free(ranks);
+    free(starts);
+    if (ok && loaded != NULL) {
+        *loaded = added;
+    }
+    return ok;
+}
+
+// Adds the contacts of a snapshot file, packed or paged
+bool contactShardsLoad(ContactShards *store, const char *filename, size_t *loaded) {
+    ContactDb db;
+    ContactPack pack;
+    ContactDbStatus status = contactDbOpen(&db, filename);
+    if (status == CONTACT_DB_OK) {
+        bool ok = loadPaged(store, &db, filename, loaded);
+        contactDbClose(&db);
+        return ok;
+    }
+    if (status != CONTACT_DB_PACKED || contactPackOpen(&pack, filename) != CONTACT_DB_OK) {
+        fprintf(stderr, "Cannot open contact database %s\n", filename);
+        return false;
+    }
+    bool ok = loadPacked(store, &pack, filename, loaded);
+    contactPackClose(&pack);
+    return ok;
+}
@@ -0,0 +1,321 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_shared.h"
+#include "../include/contact_lazy.h"
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+
+static atomic_uint nextStripe;
+static _Thread_local unsigned readerStripe;   // stripe + 1, 0 until first read
+
+static unsigned currentStripe(void) {
+    if (readerStripe == 0) {
+        readerStripe = atomic_fetch_add(&nextStripe, 1) % CONTACT_READER_STRIPES + 1;
+    }
+    return readerStripe - 1;
+}
+
+void contactSharedInit(ContactShared *shared) {
+    memset(shared, 0, sizeof(*shared));
+    atomic_init(&shared->active, 0);
+    atomic_init(&shared->version, 0);
+    for (int v = 0; v < 2; v++) {
+        for (int i = 0; i < CONTACT_READER_STRIPES; i++) {
+            atomic_init(&shared->indicators[v][i].readers, 0);
+        }
+    }
+    pthread_mutex_init(&shared->writeLock, NULL);
+}
+
+void contactSharedFree(ContactShared *shared) {
+    freeContacts(&shared->stores[0]);
+    freeContacts(&shared->stores[1]);
+    pthread_mutex_destroy(&shared->writeLock);
+}
+
+const ContactStore *contactReadBegin(ContactShared *shared, ContactReadToken *token) {
+    token->stripe = currentStripe();
+    token->version = atomic_load(&shared->version);
+    atomic_fetch_add(&shared->indicators[token->version][token->stripe].readers, 1);
+    return &shared->stores[atomic_load(&shared->active)];
+}
+
+void contactReadEnd(ContactShared *shared, const ContactReadToken *token) {
+    atomic_fetch_sub_explicit(&shared->indicators[token->version][token->stripe].readers, 1,
+                              memory_order_release);
+}
+
+static void waitForReaders(ContactShared *shared, int version) {
+    for (int i = 0; i < CONTACT_READER_STRIPES; i++) {
+        while (atomic_load(&shared->indicators[version][i].readers) != 0) {
+            sched_yield();
+        }
+    }
+}
+
+// Directs new readers to the standby copy and returns once no reader can
+// still be using the previously active one.
+static void publish(ContactShared *shared, int standby) {
+    atomic_store(&shared->active, standby);
+
+    // Readers that arrived before the switch may be on either indicator;
+    // flip new arrivals to the other one and drain both
+    int version = atomic_load(&shared->version);
+    waitForReaders(shared, !version);
+    atomic_store(&shared->version, !version);
+    waitForReaders(shared, version);
+}
+
+bool contactSharedWriteLocked(ContactShared *shared, ContactWriteFn write, void *arg) {
+    int standby = !atomic_load(&shared->active);
+    bool result = write(&shared->stores[standby], arg);
+    publish(shared, standby);
+
+    ContactStore *other = &shared->stores[!standby];
+    struct ContactWal *wal = other->wal;
+    other->wal = NULL;
+    write(other, arg);
+    other->wal = wal;
+
+    shared->writes++;
+    return result;
+}
+
+bool contactSharedWrite(ContactShared *shared, ContactWriteFn write, void *arg) {
+    pthread_mutex_lock(&shared->writeLock);
+    bool result = contactSharedWriteLocked(shared, write, arg);
+    pthread_mutex_unlock(&shared->writeLock);
+    return result;
+}
+
+bool contactSharedReplace(ContactShared *shared, ContactWriteFn write, void *arg) {
+    pthread_mutex_lock(&shared->writeLock);
+    int standby = !atomic_load(&shared->active);
+    bool result = write(&shared->stores[standby], arg);
+    publish(shared, standby);
+
+    if (!copyContacts(&shared->stores[!standby], &shared->stores[standby])) {
+        fprintf(stderr, "Failed to copy contacts; readers will see the previous list\n");
+    }
+    shared->writes++;
+    pthread_mutex_unlock(&shared->writeLock);
+    return result;
+}
+
+const ContactStore *contactSharedLock(ContactShared *shared) {
+    pthread_mutex_lock(&shared->writeLock);
+    return &shared->stores[atomic_load(&shared->active)];
+}
+
+ContactStore *contactSharedLockViews(ContactShared *shared) {
+    pthread_mutex_lock(&shared->writeLock);
+    return &shared->stores[atomic_load(&shared->active)];
+}
+
+void contactSharedUnlock(ContactShared *shared) {
+    pthread_mutex_unlock(&shared->writeLock);
+}
+
+typedef struct {
+    const char *name;
+    const Contact *contact;
+    ContactHandle handle;
+} SharedChange;
+
+static bool applyAdd(ContactStore *store, void *arg) {
+    SharedChange *change = (SharedChange *)arg;
+    change->handle = addContact(store, change->contact);
+    return change->handle != CONTACT_HANDLE_NONE;
+}
+
+static bool applyUpdate(ContactStore *store, void *arg) {
+    SharedChange *change = (SharedChange *)arg;
+    return updateContact(store, change->name, change->contact);
+}
+
+static bool applyDelete(ContactStore *store, void *arg) {
+    SharedChange *change = (SharedChange *)arg;
+    return deleteContact(store, change->name);
+}
+
+ContactHandle contactSharedAdd(ContactShared *shared, const Contact *contact) {
+    SharedChange change = {NULL, contact, CONTACT_HANDLE_NONE};
+    contactSharedWrite(shared, applyAdd, &change);
+    return change.handle;
+}
+
+bool contactSharedUpdate(ContactShared *shared, const char *name, const Contact *newContact) {
+    SharedChange change = {name, newContact, CONTACT_HANDLE_NONE};
+    return contactSharedWrite(shared, applyUpdate, &change);
+}
+
+bool contactSharedDelete(ContactShared *shared, const char *name) {
+    SharedChange change = {name, NULL, CONTACT_HANDLE_NONE};
+    return contactSharedWrite(shared, applyDelete, &change);
+}
+
+typedef struct {
+    const Contact *contacts;
+    const char *const *names;
+    size_t count;
+    ContactHandle *handles;
+    size_t applied;
+} SharedBatch;
+
+static bool applyAddBatch(ContactStore *store, void *arg) {
+    SharedBatch *batch = (SharedBatch *)arg;
+    batch->applied = addContacts(store, batch->contacts, batch->count, batch->handles);
+    return batch->applied > 0;
+}
+
+static bool applyDeleteBatch(ContactStore *store, void *arg) {
+    SharedBatch *batch = (SharedBatch *)arg;
+    batch->applied = deleteContacts(store, batch->names, batch->count);
+    return batch->applied > 0;
+}
+
+size_t contactSharedAddBatch(ContactShared *shared, const Contact *contacts, size_t count, ContactHandle *handles) {
+    SharedBatch batch = {contacts, NULL, count, handles, 0};
+    contactSharedWrite(shared, applyAddBatch, &batch);
+    return batch.applied;
+}
+
+size_t contactSharedDeleteBatch(ContactShared *shared, const char *const *names, size_t count) {
+    SharedBatch batch = {NULL, names, count, NULL, 0};
+    contactSharedWrite(shared, applyDeleteBatch, &batch);
+    return batch.applied;
+}
+
+typedef struct {
+    const char *name;
+    const char *tag;
+    bool add;
+} SharedTag;
+
+static bool applyTag(ContactStore *store, void *arg) {
+    const SharedTag *change = (const SharedTag *)arg;
+    if (!contactLazyFaultName(store, change->name)) {
+        return false;
+    }
+    ContactHandle handle = findContactHandle(store, change->name);
+    return change->add ? contactTag(store, handle, change->tag) : contactUntag(store, handle, change->tag);
+}
+
+bool contactSharedTag(ContactShared *shared, const char *name, const char *tag) {
+    SharedTag change = {name, tag, true};
+    return contactSharedWrite(shared, applyTag, &change);
+}
+
+bool contactSharedUntag(ContactShared *shared, const char *name, const char *tag) {
+    SharedTag change = {name, tag, false};
+    return contactSharedWrite(shared, applyTag, &change);
+}
+
+bool contactSharedFind(ContactShared *shared, const char *name, Contact *out) {
+    ContactReadToken token;
+    const ContactStore *store = contactReadBegin(shared, &token);
+    bool found = findContact(store, name, out);
+    contactReadEnd(shared, &token);
+    return found;
+}
+
+// Counts the contacts of a lazy store not faulted in yet too
+size_t contactSharedCount(ContactShared *shared) {
+    ContactReadToken token;
+    const ContactStore *store = contactReadBegin(shared, &token);
+    size_t count = store->count + contactLazyPending(store);
+    contactReadEnd(shared, &token);
+    return count;
+}
+
+static bool applyLoadAll(ContactStore *store, void *arg) {
+    (void)arg;
+    return contactLazyLoadAll(store);
+}
+
+bool contactSharedLoadAll(ContactShared *shared) {
+    ContactReadToken token;
+    bool lazy = contactReadBegin(shared, &token)->lazy != NULL;
+    contactReadEnd(shared, &token);
+    return !lazy || contactSharedWrite(shared, applyLoadAll, NULL);
+}
+
+typedef struct {
+    ContactSnapshot *snapshot;
+    ContactTags *tags;
+    bool opened;
+} SharedSnapshot;
+
+// Only the copy with the log knows its sequence, so the first application
+// fills in the snapshot
+static bool applySnapshot(ContactStore *store, void *arg) {
+    SharedSnapshot *open = (SharedSnapshot *)arg;
+    if (!contactLazyLoadAll(store)) {
+        return false;
+    }
+    if (!open->opened && open->tags != NULL) {
+        static const ContactTags none;
+        if (!contactTagSetCopy(open->tags, store->tags != NULL ? store->tags : &none)) {
+            return false;
+        }
+    }
+    ContactSnapshot snapshot;
+    if (!contactSnapshotOpen(store, &snapshot)) {
+        return false;
+    }
+    if (!open->opened) {
+        *open->snapshot = snapshot;
+        open->opened = true;
+    }
+    return true;
+}
+
+static bool applyRelease(ContactStore *store, void *arg) {
+    contactSnapshotClose(store, (const ContactSnapshot *)arg);
+    return true;
+}
+
+bool contactSharedSnapshot(ContactShared *shared, ContactSnapshot *snapshot) {
+    return contactSharedSnapshotTags(shared, snapshot, NULL);
+}
+
+bool contactSharedSnapshotTags(ContactShared *shared, ContactSnapshot *snapshot, ContactTags *tags) {
+    SharedSnapshot open = {snapshot, tags, false};
+    return contactSharedWrite(shared, applySnapshot, &open);
+}
+
+void contactSharedRelease(ContactShared *shared, const ContactSnapshot *snapshot) {
+    contactSharedWrite(shared, applyRelease, (void *)snapshot);
+}
+
+size_t contactSharedScanSlots(ContactShared *shared, const ContactSnapshot *snapshot, ContactSlotVisitor visitor,
+                              void *userData) {
+    // Both copies number their slots the same, so the scan can move
+    // between them from one chunk to the next
+    size_t visited = 0;
+    uint32_t slot = 0;
+    while (slot != CONTACT_SLOT_NONE) {
+        ContactReadToken token;
+        const ContactStore *store = contactReadBegin(shared, &token);
+        visited += contactScanSlotsAt(store, snapshot, &slot, CONTACT_SHARED_SCAN_CHUNK, visitor, userData);
+        contactReadEnd(shared, &token);
+    }
+    return visited;
+}
+
+typedef struct {
+    ContactVisitor visitor;
+    void *userData;
+} SharedScan;
+
+static bool scanContact(uint32_t slot, const Contact *contact, void *userData) {
+    (void)slot;
+    const SharedScan *scan = (const SharedScan *)userData;
+    return scan->visitor(contact, scan->userData);
+}
+
+size_t contactSharedScan(ContactShared *shared, const ContactSnapshot *snapshot, ContactVisitor visitor, void *userData) {
+    SharedScan scan = {visitor, userData};
+    return contactSharedScanSlots(shared, snapshot, scanContact, &scan);
+}
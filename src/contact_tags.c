@@ -0,0 +1,501 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_tags.h"
+#include "../include/contact_db.h"
+#include "../include/security.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static bool validTagName(const char *tag) {
+    if (tag == NULL) {
+        return false;
+    }
+    size_t length = strlen(tag);
+    return length > 0 && length < CONTACT_TAG_NAME_MAX;
+}
+
+static ContactTag *findTag(const ContactTags *tags, const char *name) {
+    if (tags == NULL || name == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < tags->count; i++) {
+        if (strcmp(tags->tags[i].name, name) == 0) {
+            return &tags->tags[i];
+        }
+    }
+    return NULL;
+}
+
+static ContactTag *addTag(ContactTags *tags, const char *name) {
+    if (tags->count == tags->capacity) {
+        size_t capacity = tags->capacity ? tags->capacity * 2 : 8;
+        ContactTag *grown = (ContactTag *)realloc(tags->tags, capacity * sizeof(ContactTag));
+        if (grown == NULL) {
+            perror("Failed to grow contact tags");
+            return NULL;
+        }
+        tags->tags = grown;
+        tags->capacity = capacity;
+    }
+    ContactTag *tag = &tags->tags[tags->count++];
+    memset(tag, 0, sizeof(*tag));
+    snprintf(tag->name, sizeof(tag->name), "%s", name);
+    return tag;
+}
+
+static ContactTag *ensureTag(ContactStore *store, const char *name) {
+    ContactTag *tag = findTag(store->tags, name);
+    if (tag != NULL) {
+        return tag;
+    }
+    if (store->tags == NULL) {
+        store->tags = (ContactTags *)calloc(1, sizeof(ContactTags));
+        if (store->tags == NULL) {
+            perror("Failed to allocate contact tags");
+            return NULL;
+        }
+    }
+    return addTag(store->tags, name);
+}
+
+// Slot of a live contact, else CONTACT_SLOT_NONE
+static uint32_t handleSlot(const ContactStore *store, ContactHandle handle) {
+    return getContact(store, handle, NULL) ? (uint32_t)handle : CONTACT_SLOT_NONE;
+}
+
+bool contactTag(ContactStore *store, ContactHandle handle, const char *tag) {
+    uint32_t slot = handleSlot(store, handle);
+    if (slot == CONTACT_SLOT_NONE || !validTagName(tag)) {
+        return false;
+    }
+    ContactTag *entry = ensureTag(store, tag);
+    return entry != NULL && contactBitmapAdd(&entry->members, slot);
+}
+
+bool contactUntag(ContactStore *store, ContactHandle handle, const char *tag) {
+    uint32_t slot = handleSlot(store, handle);
+    ContactTag *entry = findTag(store->tags, tag);
+    return slot != CONTACT_SLOT_NONE && entry != NULL && contactBitmapRemove(&entry->members, slot);
+}
+
+bool contactHasTag(const ContactStore *store, ContactHandle handle, const char *tag) {
+    uint32_t slot = handleSlot(store, handle);
+    const ContactTag *entry = findTag(store->tags, tag);
+    return slot != CONTACT_SLOT_NONE && entry != NULL && contactBitmapContains(&entry->members, slot);
+}
+
+const ContactBitmap *contactTagged(const ContactStore *store, const char *tag) {
+    const ContactTag *entry = findTag(store->tags, tag);
+    return entry != NULL ? &entry->members : NULL;
+}
+
+size_t contactTagCount(const ContactStore *store, const char *tag) {
+    const ContactTag *entry = findTag(store->tags, tag);
+    return entry != NULL ? contactBitmapCount(&entry->members) : 0;
+}
+
+bool contactDropTag(ContactStore *store, const char *tag) {
+    ContactTag *entry = findTag(store->tags, tag);
+    if (entry == NULL) {
+        return false;
+    }
+    ContactTags *tags = store->tags;
+    contactBitmapFree(&entry->members);
+    size_t index = (size_t)(entry - tags->tags);
+    memmove(entry, entry + 1, (tags->count - index - 1) * sizeof(ContactTag));
+    tags->count--;
+    return true;
+}
+
+typedef struct {
+    const ContactStore *store;
+    ContactVisitor visitor;
+    void *userData;
+    size_t visited;
+} TagVisit;
+
+static bool visitMember(uint32_t slot, void *userData) {
+    TagVisit *visit = (TagVisit *)userData;
+    const ContactStore *store = visit->store;
+    if (slot >= store->slotCount) {
+        return false;
+    }
+    ContactHandle handle = (ContactHandle)contactSlotAt(store, slot)->generation << 32 | slot;
+    Contact contact;
+    if (!getContact(store, handle, &contact)) {
+        return true;
+    }
+    visit->visited++;
+    return visit->visitor(&contact, visit->userData);
+}
+
+size_t contactTagVisit(const ContactStore *store, const ContactBitmap *members, ContactVisitor visitor, void *userData) {
+    TagVisit visit = {store, visitor, userData, 0};
+    contactBitmapVisit(members, visitMember, &visit);
+    return visit.visited;
+}
+
+void contactTagsForget(ContactStore *store, uint32_t slot) {
+    ContactTags *tags = store->tags;
+    if (tags == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < tags->count; i++) {
+        contactBitmapRemove(&tags->tags[i].members, slot);
+    }
+}
+
+bool contactTagSetCopy(ContactTags *dest, const ContactTags *src) {
+    contactTagSetFree(dest);
+    if (src->count == 0) {
+        return true;
+    }
+    dest->tags = (ContactTag *)calloc(src->count, sizeof(ContactTag));
+    if (dest->tags == NULL) {
+        perror("Failed to copy contact tags");
+        return false;
+    }
+    dest->capacity = src->count;
+    for (size_t i = 0; i < src->count; i++) {
+        memcpy(dest->tags[i].name, src->tags[i].name, sizeof(dest->tags[i].name));
+        dest->count++;
+        if (!contactBitmapCopy(&dest->tags[i].members, &src->tags[i].members)) {
+            contactTagSetFree(dest);
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    ContactBitmap *members;
+    uint32_t base;
+} OffsetMembers;
+
+static bool addOffsetMember(uint32_t member, void *userData) {
+    OffsetMembers *offset = (OffsetMembers *)userData;
+    return contactBitmapAdd(offset->members, offset->base + member);
+}
+
+bool contactTagSetMerge(ContactTags *dest, const ContactTags *src, uint32_t base) {
+    for (size_t i = 0; i < src->count; i++) {
+        ContactTag *tag = findTag(dest, src->tags[i].name);
+        if (tag == NULL && (tag = addTag(dest, src->tags[i].name)) == NULL) {
+            return false;
+        }
+        OffsetMembers offset = {&tag->members, base};
+        if (!contactBitmapVisit(&src->tags[i].members, addOffsetMember, &offset)) {
+            perror("Failed to merge contact tags");
+            return false;
+        }
+    }
+    return true;
+}
+
+void contactTagSetFree(ContactTags *tags) {
+    for (size_t i = 0; i < tags->count; i++) {
+        contactBitmapFree(&tags->tags[i].members);
+    }
+    free(tags->tags);
+    memset(tags, 0, sizeof(*tags));
+}
+
+bool contactTagsCopy(ContactStore *dest, const ContactStore *src) {
+    contactTagsFree(dest);
+    if (src->tags == NULL) {
+        return true;
+    }
+    dest->tags = (ContactTags *)calloc(1, sizeof(ContactTags));
+    if (dest->tags == NULL) {
+        perror("Failed to copy contact tags");
+        return false;
+    }
+    if (!contactTagSetCopy(dest->tags, src->tags)) {
+        contactTagsFree(dest);
+        return false;
+    }
+    return true;
+}
+
+void contactTagsFree(ContactStore *store) {
+    if (store->tags == NULL) {
+        return;
+    }
+    contactTagSetFree(store->tags);
+    free(store->tags);
+    store->tags = NULL;
+}
+
+size_t contactTagsBytes(const ContactStore *store) {
+    const ContactTags *tags = store->tags;
+    if (tags == NULL) {
+        return 0;
+    }
+    size_t bytes = sizeof(ContactTags) + tags->capacity * sizeof(ContactTag);
+    for (size_t i = 0; i < tags->count; i++) {
+        bytes += contactBitmapBytes(&tags->tags[i].members);
+    }
+    return bytes;
+}
+
+void contactTagsPath(const char *snapshot, char *path, size_t size) {
+    snprintf(path, size, "%s.tags", snapshot);
+}
+
+static int compareValues(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct {
+    const uint32_t *map;   // value + 1 per member, 0 to drop it
+    size_t mapSize;
+    uint32_t *values;
+    size_t count;
+} Remap;
+
+static bool remapMember(uint32_t member, void *userData) {
+    Remap *remap = (Remap *)userData;
+    if (member < remap->mapSize && remap->map[member] != 0) {
+        remap->values[remap->count++] = remap->map[member] - 1;
+    }
+    return true;
+}
+
+// Rebuilds members under map; the mapped values are sorted first so they
+// go in by appending
+static bool remapBitmap(ContactBitmap *out, const ContactBitmap *members, Remap *remap) {
+    contactBitmapClear(out);
+    remap->count = 0;
+    contactBitmapVisit(members, remapMember, remap);
+    qsort(remap->values, remap->count, sizeof(uint32_t), compareValues);
+    for (size_t i = 0; i < remap->count; i++) {
+        if (!contactBitmapAdd(out, remap->values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writeSidecar(const char *path, const ContactTagsHeader *header, const unsigned char *body) {
+    char tempName[512 + sizeof(".tmp")];
+    snprintf(tempName, sizeof(tempName), "%s.tmp", path);
+    FILE *file = fopen(tempName, "wb");
+    if (file == NULL) {
+        perror("Failed to open tag file for saving");
+        return false;
+    }
+    bool ok = fwrite(header, sizeof(*header), 1, file) == 1 &&
+              (header->bodySize == 0 || fwrite(body, header->bodySize, 1, file) == 1) &&
+              fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tempName, path) != 0 || !contactDbSyncDirectory(path)) {
+        perror("Failed to write contact tags");
+        remove(tempName);
+        return false;
+    }
+    return true;
+}
+
+bool contactTagsSave(const ContactTags *tags, const uint32_t *slots, size_t count,
+                     const char *snapshot, uint32_t packChecksum) {
+    char path[512];
+    contactTagsPath(snapshot, path, sizeof(path));
+    if (tags == NULL || tags->count == 0) {
+        // A sidecar left from an earlier save would not match anyway
+        remove(path);
+        return true;
+    }
+
+    // Position of each slot in the snapshot, + 1
+    size_t slotLimit = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (slots[i] >= slotLimit) {
+            slotLimit = (size_t)slots[i] + 1;
+        }
+    }
+    uint32_t *ranks = (uint32_t *)calloc(slotLimit ? slotLimit : 1, sizeof(uint32_t));
+    Remap remap = {ranks, slotLimit, (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t)), 0};
+    ContactBitmap *positions = (ContactBitmap *)calloc(tags->count, sizeof(ContactBitmap));
+    bool ok = ranks != NULL && remap.values != NULL && positions != NULL;
+    if (!ok) {
+        perror("Failed to allocate tag snapshot");
+    }
+    for (size_t i = 0; i < count && ok; i++) {
+        ranks[slots[i]] = (uint32_t)i + 1;
+    }
+
+    size_t bodySize = 0;
+    for (size_t t = 0; t < tags->count && ok; t++) {
+        ok = remapBitmap(&positions[t], &tags->tags[t].members, &remap);
+        bodySize += 1 + strlen(tags->tags[t].name) + contactBitmapSerializedSize(&positions[t]);
+    }
+    unsigned char *body = ok ? (unsigned char *)malloc(bodySize ? bodySize : 1) : NULL;
+    if (ok && body == NULL) {
+        perror("Failed to allocate tag snapshot");
+        ok = false;
+    }
+
+    if (ok) {
+        unsigned char *p = body;
+        for (size_t t = 0; t < tags->count; t++) {
+            size_t length = strlen(tags->tags[t].name);
+            *p++ = (unsigned char)length;
+            memcpy(p, tags->tags[t].name, length);
+            p = contactBitmapSerialize(&positions[t], p + length);
+        }
+
+        ContactTagsHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CONTACT_TAGS_MAGIC, sizeof(header.magic));
+        header.version = CONTACT_TAGS_VERSION;
+        header.tagCount = (uint32_t)tags->count;
+        header.recordCount = count;
+        header.packChecksum = packChecksum;
+        header.bodySize = bodySize;
+        header.bodyChecksum = checksumData(0, body, bodySize);
+        ok = writeSidecar(path, &header, body);
+    }
+
+    for (size_t t = 0; positions != NULL && t < tags->count; t++) {
+        contactBitmapFree(&positions[t]);
+    }
+    free(positions);
+    free(body);
+    free(remap.values);
+    free(ranks);
+    return ok;
+}
+
+typedef struct {
+    uint32_t *slots;
+    size_t count;
+    size_t limit;
+} SlotOrder;
+
+static bool collectRankSlot(uint32_t slot, void *userData) {
+    SlotOrder *order = (SlotOrder *)userData;
+    if (order->count == order->limit) {
+        return false;
+    }
+    order->slots[order->count++] = slot;
+    return true;
+}
+
+// Reads the header and body; NULL if there is no sidecar, or with a
+// warning if it is damaged
+static unsigned char *readSidecar(const char *path, ContactTagsHeader *header) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    unsigned char *body = NULL;
+    long size = -1;
+    if (fread(header, sizeof(*header), 1, file) == 1 && fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    bool ok = size >= (long)sizeof(*header) &&
+              memcmp(header->magic, CONTACT_TAGS_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == CONTACT_TAGS_VERSION &&
+              header->bodySize == (uint64_t)size - sizeof(*header) &&
+              fseek(file, (long)sizeof(*header), SEEK_SET) == 0;
+    if (ok) {
+        body = (unsigned char *)malloc(header->bodySize ? header->bodySize : 1);
+        ok = body != NULL &&
+             (header->bodySize == 0 || fread(body, header->bodySize, 1, file) == 1) &&
+             checksumData(0, body, header->bodySize) == header->bodyChecksum;
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "Ignoring damaged tag file %s\n", path);
+        free(body);
+        return NULL;
+    }
+    return body;
+}
+
+bool contactTagsRead(const char *snapshot, uint32_t packChecksum, size_t recordCount, ContactTags *ranks) {
+    memset(ranks, 0, sizeof(*ranks));
+    char path[512];
+    contactTagsPath(snapshot, path, sizeof(path));
+    ContactTagsHeader header;
+    unsigned char *body = readSidecar(path, &header);
+    if (body == NULL) {
+        return false;
+    }
+    if (header.packChecksum != packChecksum || header.recordCount != recordCount) {
+        fprintf(stderr, "Ignoring tag file %s: it was not saved with %s\n", path, snapshot);
+        free(body);
+        return false;
+    }
+
+    bool ok = true;
+    const unsigned char *p = body;
+    const unsigned char *end = body + header.bodySize;
+    for (uint32_t t = 0; t < header.tagCount && ok; t++) {
+        char name[CONTACT_TAG_NAME_MAX];
+        size_t length = p < end ? *p++ : 0;
+        if (length == 0 || length >= sizeof(name) || length > (size_t)(end - p)) {
+            ok = false;
+            break;
+        }
+        memcpy(name, p, length);
+        name[length] = '\0';
+        p += length;
+
+        ContactTag *tag = findTag(ranks, name) == NULL ? addTag(ranks, name) : NULL;
+        ok = tag != NULL && (p = contactBitmapDeserialize(&tag->members, p, (size_t)(end - p))) != NULL;
+    }
+    if (!(ok && p == end)) {
+        fprintf(stderr, "Ignoring damaged tag file %s\n", path);
+        contactTagSetFree(ranks);
+        ok = false;
+    }
+    free(body);
+    return ok;
+}
+
+bool contactTagsApply(ContactStore *store, const ContactTags *ranks, uint32_t firstRank,
+                      const uint32_t *slots, size_t count) {
+    for (size_t t = 0; t < ranks->count; t++) {
+        const ContactBitmap *members = &ranks->tags[t].members;
+        ContactTag *tag = NULL;
+        for (size_t i = 0; i < count; i++) {
+            if (!contactBitmapContains(members, firstRank + (uint32_t)i)) {
+                continue;
+            }
+            if ((tag == NULL && (tag = ensureTag(store, ranks->tags[t].name)) == NULL) ||
+                !contactBitmapAdd(&tag->members, slots[i])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool contactTagsLoad(ContactStore *store, const char *snapshot, uint32_t packChecksum) {
+    ContactTags ranks;
+    if (!contactTagsRead(snapshot, packChecksum, store->count, &ranks)) {
+        return false;
+    }
+
+    // The store holds just the snapshot, so its name order is the snapshot's
+    SlotOrder order = {(uint32_t *)malloc((store->count ? store->count : 1) * sizeof(uint32_t)), 0, store->count};
+    bool ok = order.slots != NULL;
+    if (!ok) {
+        perror("Failed to allocate tag order");
+    } else {
+        radixTreeVisitRange(&store->nameTree, NULL, NULL, collectRankSlot, &order);
+        ok = order.count == store->count;
+    }
+    ok = ok && contactTagsApply(store, &ranks, 0, order.slots, order.count);
+
+    contactTagSetFree(&ranks);
+    free(order.slots);
+    return ok;
+}
@@ -0,0 +1,438 @@
+#include "../include/contact_version.h"
+#include "../include/contact_wal.h"
+#include "../include/contact_lazy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STAMP_INITIAL_CAPACITY 64
+
+static size_t stampHome(uint32_t slot, size_t capacity) {
+    // Fibonacci hashing spreads consecutive slots over the table
+    return (size_t)(((uint64_t)slot * 11400714819323198485ULL) >> 32) & (capacity - 1);
+}
+
+static ContactStamp *findStamp(const ContactHistory *history, uint32_t slot) {
+    if (history == NULL || history->stampCount == 0) {
+        return NULL;
+    }
+    size_t mask = history->stampCapacity - 1;
+    for (size_t pos = stampHome(slot, history->stampCapacity); history->stamps[pos].ref != 0; pos = (pos + 1) & mask) {
+        if (history->stamps[pos].ref == slot + 1) {
+            return &history->stamps[pos];
+        }
+    }
+    return NULL;
+}
+
+// Room must have been reserved
+static ContactStamp *addStamp(ContactHistory *history, uint32_t slot) {
+    size_t mask = history->stampCapacity - 1;
+    size_t pos = stampHome(slot, history->stampCapacity);
+    while (history->stamps[pos].ref != 0) {
+        if (history->stamps[pos].ref == slot + 1) {
+            return &history->stamps[pos];
+        }
+        pos = (pos + 1) & mask;
+    }
+    ContactStamp *stamp = &history->stamps[pos];
+    stamp->ref = slot + 1;
+    stamp->newest = 0;
+    stamp->stamp = 0;
+    history->stampCount++;
+    return stamp;
+}
+
+// Rehashes the live stamps into a table of capacity entries.
+static bool resizeStamps(ContactHistory *history, size_t capacity) {
+    ContactStamp *stamps = (ContactStamp *)calloc(capacity, sizeof(ContactStamp));
+    if (stamps == NULL) {
+        perror("Failed to grow version stamps");
+        return false;
+    }
+    ContactStamp *old = history->stamps;
+    size_t oldCapacity = history->stampCapacity;
+    history->stamps = stamps;
+    history->stampCapacity = capacity;
+    history->stampCount = 0;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].ref != 0) {
+            *addStamp(history, old[i].ref - 1) = old[i];
+        }
+    }
+    free(old);
+    return true;
+}
+
+bool contactVersionReserve(ContactStore *store, size_t slots, size_t replaced) {
+    ContactHistory *history = store->history;
+    if (history == NULL) {
+        return true;
+    }
+
+    size_t capacity = history->stampCapacity ? history->stampCapacity : STAMP_INITIAL_CAPACITY;
+    while ((history->stampCount + slots) * 2 > capacity) {
+        capacity *= 2;
+    }
+    if (capacity != history->stampCapacity && !resizeStamps(history, capacity)) {
+        return false;
+    }
+
+    size_t needed = history->versionCount + replaced;
+    if (needed > history->versionCapacity) {
+        size_t newCapacity = history->versionCapacity ? history->versionCapacity : 16;
+        while (newCapacity < needed) {
+            newCapacity *= 2;
+        }
+        ContactVersion *versions = (ContactVersion *)realloc(history->versions, newCapacity * sizeof(ContactVersion));
+        if (versions == NULL) {
+            perror("Failed to grow contact versions");
+            return false;
+        }
+        history->versions = versions;
+        history->versionCapacity = newCapacity;
+    }
+    return true;
+}
+
+void contactVersionStamp(ContactStore *store, uint32_t slot) {
+    if (store->history != NULL) {
+        addStamp(store->history, slot)->stamp = store->version + 1;
+    }
+}
+
+bool contactVersionRetire(ContactStore *store, uint32_t slot, uint32_t record, uint32_t domain) {
+    ContactHistory *history = store->history;
+    if (history == NULL) {
+        return false;
+    }
+    // Snapshots are ascending and all older than this change, so the
+    // newest decides whether any of them can see the old contents
+    const ContactStamp *existing = findStamp(history, slot);
+    uint64_t begin = existing != NULL ? existing->stamp : 0;
+    if (history->snapshots[history->snapshotCount - 1] < begin) {
+        return false;
+    }
+
+    ContactStamp *stamp = addStamp(history, slot);
+    ContactVersion *version = &history->versions[history->versionCount++];
+    version->begin = begin;
+    version->end = store->version + 1;
+    version->record = record;
+    version->domain = domain;
+    version->slot = slot;
+    version->older = stamp->newest;
+    stamp->newest = (uint32_t)history->versionCount;
+    return true;
+}
+
+bool contactSnapshotOpen(ContactStore *store, ContactSnapshot *snapshot) {
+    // Contacts faulted in later would look added after the snapshot
+    if (!contactLazyLoadAll(store)) {
+        return false;
+    }
+    ContactHistory *history = store->history;
+    if (history == NULL) {
+        history = (ContactHistory *)calloc(1, sizeof(ContactHistory));
+        if (history == NULL) {
+            perror("Failed to open snapshot");
+            return false;
+        }
+        store->history = history;
+    }
+    if (history->snapshotCount == history->snapshotCapacity) {
+        size_t newCapacity = history->snapshotCapacity ? history->snapshotCapacity * 2 : 4;
+        uint64_t *snapshots = (uint64_t *)realloc(history->snapshots, newCapacity * sizeof(uint64_t));
+        if (snapshots == NULL) {
+            perror("Failed to open snapshot");
+            if (history->snapshotCount == 0) {
+                contactHistoryFree(store);
+            }
+            return false;
+        }
+        history->snapshots = snapshots;
+        history->snapshotCapacity = newCapacity;
+    }
+
+    // Versions only grow, so appending keeps the list ascending
+    history->snapshots[history->snapshotCount++] = store->version;
+    snapshot->version = store->version;
+    snapshot->count = store->count;
+    snapshot->walSequence = store->wal != NULL ? store->wal->sequence : 0;
+    return true;
+}
+
+static void releaseVersion(ContactStore *store, const ContactVersion *version) {
+    stringArenaRelease(&store->records, contactRecordLength(stringArenaAt(&store->records, version->record)));
+}
+
+// True when an open snapshot falls in [begin, end).
+static bool versionVisible(const ContactHistory *history, uint64_t begin, uint64_t end) {
+    size_t lo = 0;
+    size_t hi = history->snapshotCount;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (history->snapshots[mid] < begin) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < history->snapshotCount && history->snapshots[lo] < end;
+}
+
+// Drops the contents no open snapshot can see, and the stamps every open
+// snapshot is newer than, then relinks what is left.
+static void collectVersions(ContactStore *store) {
+    ContactHistory *history = store->history;
+    uint64_t oldest = history->snapshots[0];
+    size_t kept = 0;
+    for (size_t i = 0; i < history->versionCount; i++) {
+        ContactVersion *version = &history->versions[i];
+        if (versionVisible(history, version->begin, version->end)) {
+            history->versions[kept++] = *version;
+        } else {
+            releaseVersion(store, version);
+        }
+    }
+    history->versionCount = kept;
+
+    // Stamps older than every open snapshot no longer matter. If a fresh
+    // table cannot be allocated they stay, which is harmless
+    ContactStamp *stamps = (ContactStamp *)calloc(history->stampCapacity, sizeof(ContactStamp));
+    if (stamps != NULL) {
+        ContactStamp *old = history->stamps;
+        history->stamps = stamps;
+        history->stampCount = 0;
+        for (size_t i = 0; i < history->stampCapacity; i++) {
+            if (old[i].ref != 0 && old[i].stamp > oldest) {
+                ContactStamp *stamp = addStamp(history, old[i].ref - 1);
+                stamp->stamp = old[i].stamp;
+            }
+        }
+        free(old);
+    } else {
+        for (size_t i = 0; i < history->stampCapacity; i++) {
+            history->stamps[i].newest = 0;
+        }
+    }
+
+    // Kept contents are in change order, so each one links to the last
+    // kept before it on the same slot
+    for (size_t i = 0; i < kept; i++) {
+        ContactVersion *version = &history->versions[i];
+        ContactStamp *stamp = addStamp(history, version->slot);
+        version->older = stamp->newest;
+        stamp->newest = (uint32_t)(i + 1);
+    }
+}
+
+void contactSnapshotClose(ContactStore *store, const ContactSnapshot *snapshot) {
+    ContactHistory *history = store->history;
+    if (history == NULL) {
+        return;
+    }
+    size_t i = 0;
+    while (i < history->snapshotCount && history->snapshots[i] != snapshot->version) {
+        i++;
+    }
+    if (i == history->snapshotCount) {
+        return;
+    }
+    memmove(&history->snapshots[i], &history->snapshots[i + 1], (history->snapshotCount - i - 1) * sizeof(uint64_t));
+    history->snapshotCount--;
+
+    if (history->snapshotCount == 0) {
+        contactHistoryFree(store);
+    } else {
+        collectVersions(store);
+    }
+}
+
+// The record and domain slot held as of version; false if it held no contact.
+static bool resolveSlot(const ContactStore *store, uint32_t slot, uint64_t version, uint32_t *record, uint32_t *domain) {
+    const ContactHistory *history = store->history;
+    const ContactSlot *entry = contactSlotAt(store, slot);
+    const ContactStamp *stamp = findStamp(history, slot);
+    if (entry->live && (stamp == NULL || stamp->stamp <= version)) {
+        *record = entry->record;
+        *domain = entry->domain;
+        return true;
+    }
+
+    // Newest first, so each kept contents ended no later than the one before
+    for (uint32_t i = stamp != NULL ? stamp->newest : 0; i != 0; i = history->versions[i - 1].older) {
+        const ContactVersion *kept = &history->versions[i - 1];
+        if (kept->end <= version) {
+            break;
+        }
+        if (kept->begin <= version) {
+            *record = kept->record;
+            *domain = kept->domain;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *recordName(const ContactStore *store, uint32_t record) {
+    return (const char *)stringArenaAt(&store->records, record) + 1;
+}
+
+static void unpackRecord(const ContactStore *store, uint32_t record, uint32_t domainId, Contact *out) {
+    const char *name = recordName(store, record);
+    const char *phone = name + (unsigned char)name[-1] + 2;
+    const char *local = phone + (unsigned char)phone[-1] + 2;
+    const char *domain = stringPoolGet(&store->domains, domainId);
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out->name, name, (unsigned char)name[-1]);
+    memcpy(out->phone, phone, (unsigned char)phone[-1]);
+    size_t length = (unsigned char)local[-1];
+    memcpy(out->email, local, length);
+    if (domain != NULL) {
+        out->email[length] = '@';
+        memcpy(out->email + length + 1, domain, (unsigned char)domain[-1]);
+    }
+}
+
+// The name index holds current names only: a contact renamed or deleted
+// since the snapshot is found among the kept contents instead.
+bool contactGetAt(const ContactStore *store, const ContactSnapshot *snapshot, const char *name, Contact *out) {
+    uint32_t record;
+    uint32_t domain;
+    uint32_t slot = contactIndexFind(&store->nameIndex, store, name);
+    if (slot != CONTACT_SLOT_NONE && resolveSlot(store, slot, snapshot->version, &record, &domain) &&
+        strcmp(recordName(store, record), name) == 0) {
+        if (out != NULL) {
+            unpackRecord(store, record, domain, out);
+        }
+        return true;
+    }
+
+    const ContactHistory *history = store->history;
+    for (size_t i = 0; history != NULL && i < history->versionCount; i++) {
+        const ContactVersion *kept = &history->versions[i];
+        if (kept->begin <= snapshot->version && snapshot->version < kept->end &&
+            strcmp(recordName(store, kept->record), name) == 0) {
+            if (out != NULL) {
+                unpackRecord(store, kept->record, kept->domain, out);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t contactScanSlotsAt(const ContactStore *store, const ContactSnapshot *snapshot, uint32_t *slot, size_t slots,
+                          ContactSlotVisitor visitor, void *userData) {
+    size_t visited = 0;
+    uint32_t next = *slot;
+    if (next >= store->slotCount) {
+        *slot = CONTACT_SLOT_NONE;
+        return 0;
+    }
+    size_t end = slots < store->slotCount - next ? next + slots : store->slotCount;
+    for (; next < end; next++) {
+        uint32_t record;
+        uint32_t domain;
+        if (!resolveSlot(store, next, snapshot->version, &record, &domain)) {
+            continue;
+        }
+        Contact contact;
+        unpackRecord(store, record, domain, &contact);
+        visited++;
+        if (!visitor(next, &contact, userData)) {
+            *slot = CONTACT_SLOT_NONE;
+            return visited;
+        }
+    }
+    *slot = next < store->slotCount ? next : CONTACT_SLOT_NONE;
+    return visited;
+}
+
+typedef struct {
+    ContactVisitor visitor;
+    void *userData;
+} ScanVisit;
+
+static bool visitContact(uint32_t slot, const Contact *contact, void *userData) {
+    (void)slot;
+    const ScanVisit *visit = (const ScanVisit *)userData;
+    return visit->visitor(contact, visit->userData);
+}
+
+size_t contactScanAt(const ContactStore *store, const ContactSnapshot *snapshot, uint32_t *slot, size_t slots,
+                     ContactVisitor visitor, void *userData) {
+    ScanVisit visit = {visitor, userData};
+    return contactScanSlotsAt(store, snapshot, slot, slots, visitContact, &visit);
+}
+
+size_t contactVersionCount(const ContactStore *store) {
+    return store->history != NULL ? store->history->versionCount : 0;
+}
+
+static void *copyArray(const void *src, size_t count, size_t capacity, size_t size) {
+    if (src == NULL) {
+        return NULL;
+    }
+    void *copy = malloc(capacity * size);
+    if (copy != NULL) {
+        memcpy(copy, src, count * size);
+    }
+    return copy;
+}
+
+// The kept records themselves are copied with the arena.
+bool contactHistoryCopy(ContactStore *dest, const ContactStore *src) {
+    contactHistoryFree(dest);
+    const ContactHistory *from = src->history;
+    if (from == NULL) {
+        return true;
+    }
+
+    ContactHistory *history = (ContactHistory *)calloc(1, sizeof(ContactHistory));
+    if (history == NULL) {
+        perror("Failed to copy contact versions");
+        return false;
+    }
+    dest->history = history;
+    *history = *from;
+    history->snapshots = (uint64_t *)copyArray(from->snapshots, from->snapshotCount, from->snapshotCapacity, sizeof(uint64_t));
+    history->versions = (ContactVersion *)copyArray(from->versions, from->versionCount, from->versionCapacity, sizeof(ContactVersion));
+    history->stamps = (ContactStamp *)copyArray(from->stamps, from->stampCapacity, from->stampCapacity, sizeof(ContactStamp));
+    if ((from->snapshots != NULL && history->snapshots == NULL) ||
+        (from->versions != NULL && history->versions == NULL) ||
+        (from->stamps != NULL && history->stamps == NULL)) {
+        perror("Failed to copy contact versions");
+        history->versionCount = 0;
+        contactHistoryFree(dest);
+        return false;
+    }
+    return true;
+}
+
+// Kept records go back to the arena along with the bookkeeping.
+void contactHistoryFree(ContactStore *store) {
+    ContactHistory *history = store->history;
+    if (history == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < history->versionCount; i++) {
+        releaseVersion(store, &history->versions[i]);
+    }
+    free(history->snapshots);
+    free(history->versions);
+    free(history->stamps);
+    free(history);
+    store->history = NULL;
+}
+
+size_t contactHistoryBytes(const ContactStore *store) {
+    const ContactHistory *history = store->history;
+    if (history == NULL) {
+        return 0;
+    }
+    return sizeof(ContactHistory) + history->snapshotCapacity * sizeof(uint64_t) +
+           history->versionCapacity * sizeof(ContactVersion) + history->stampCapacity * sizeof(ContactStamp);
+}
@@ -0,0 +1,550 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_view.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SORT_RUN 16
+#define CHANGE_LOG_SLACK 1024
+
+static unsigned sortThreads;
+
+void contactSortSetThreads(unsigned threads) {
+    sortThreads = threads;
+}
+
+static unsigned workerCount(size_t count) {
+    if (count < CONTACT_SORT_PARALLEL_MIN) {
+        return 1;
+    }
+    unsigned threads = sortThreads;
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    return threads < CONTACT_SORT_MAX_THREADS ? threads : CONTACT_SORT_MAX_THREADS;
+}
+
+static uint32_t entrySlot(const ContactViewEntry *entry) {
+    return (uint32_t)entry->handle;
+}
+
+static unsigned char foldCase(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c + 'a' - 'A') : c;
+}
+
+// A sort field as up to three pieces read back to back; emails are stored
+// as local part and interned domain, and are compared as "local@domain".
+// Names are read as their stored collation key, already folded.
+typedef struct {
+    const char *pieces[3];
+    int count;
+    int piece;
+    const char *p;
+} SortField;
+
+static void sortField(const ContactStore *store, ContactSortKey key, uint32_t slot, SortField *field) {
+    field->count = 1;
+    field->piece = 0;
+    if (key == CONTACT_SORT_NAME) {
+        field->pieces[0] = contactSlotCollation(store, slot);
+    } else if (key == CONTACT_SORT_PHONE) {
+        field->pieces[0] = contactSlotPhone(store, slot);
+    } else {
+        const char *domain;
+        field->pieces[0] = contactSlotEmail(store, slot, &domain);
+        if (domain != NULL) {
+            field->pieces[1] = "@";
+            field->pieces[2] = domain;
+            field->count = 3;
+        }
+    }
+    field->p = field->pieces[0];
+}
+
+// Next byte of the field, 0 at the end
+static unsigned char nextByte(SortField *field) {
+    while (*field->p == '\0') {
+        if (++field->piece >= field->count) {
+            return 0;
+        }
+        field->p = field->pieces[field->piece];
+    }
+    return (unsigned char)*field->p++;
+}
+
+// Length of the part of the view's shared prefix this slot's field starts with
+static size_t sharedPrefix(const ContactStore *store, const ContactView *view, ContactSortKey key, uint32_t slot) {
+    SortField field;
+    sortField(store, key, slot, &field);
+    size_t length = 0;
+    while (length < view->prefixLength && foldCase(nextByte(&field)) == view->prefix[length]) {
+        length++;
+    }
+    return length;
+}
+
+static uint64_t fieldKey(const ContactStore *store, const ContactView *view, ContactSortKey key, uint32_t slot) {
+    if (key == CONTACT_SORT_PHONE) {
+        // Unparseable numbers sort after every real one
+        PhoneKey phoneKey = contactSlotAt(store, slot)->phoneKey;
+        return phoneKey != PHONE_KEY_NONE ? phoneKey : UINT64_MAX;
+    }
+
+    SortField field;
+    sortField(store, key, slot, &field);
+    for (size_t i = 0; i < view->prefixLength; i++) {
+        nextByte(&field);
+    }
+    uint64_t prefix = 0;
+    for (int i = 0; i < 8; i++) {
+        prefix = prefix << 8 | foldCase(nextByte(&field));
+    }
+    return prefix;
+}
+
+static ContactViewEntry makeEntry(const ContactStore *store, const ContactView *view, ContactSortKey key, uint32_t slot) {
+    ContactViewEntry entry;
+    entry.key = fieldKey(store, view, key, slot);
+    entry.handle = (ContactHandle)contactSlotAt(store, slot)->generation << 32 | slot;
+    return entry;
+}
+
+static int compareFields(const ContactStore *store, ContactSortKey key, uint32_t a, uint32_t b) {
+    int exact = 0;
+    int order;
+    if (key == CONTACT_SORT_NAME) {
+        // Collation keys first; names that only differ in case or accents
+        // fall back to byte order
+        order = strcmp(contactSlotCollation(store, a), contactSlotCollation(store, b));
+        return order != 0 ? order : strcmp(contactSlotName(store, a), contactSlotName(store, b));
+    } else if (key == CONTACT_SORT_PHONE) {
+        return strcmp(contactSlotPhone(store, a), contactSlotPhone(store, b));
+    } else {
+        SortField left;
+        SortField right;
+        sortField(store, key, a, &left);
+        sortField(store, key, b, &right);
+        for (;;) {
+            unsigned char l = nextByte(&left);
+            unsigned char r = nextByte(&right);
+            if (exact == 0) {
+                exact = (int)l - (int)r;
+            }
+            if (foldCase(l) != foldCase(r) || l == 0) {
+                order = (int)foldCase(l) - (int)foldCase(r);
+                break;
+            }
+        }
+    }
+    return order != 0 ? order : exact;
+}
+
+typedef struct {
+    const ContactStore *store;
+    ContactSortKey key;
+} SortContext;
+
+static int compareEntries(const SortContext *ctx, const ContactViewEntry *a, const ContactViewEntry *b) {
+    if (a->key != b->key) {
+        return a->key < b->key ? -1 : 1;
+    }
+
+    // Keys tie: compare whole fields, then slots so the order never depends
+    // on how the view was built
+    uint32_t slotA = entrySlot(a);
+    uint32_t slotB = entrySlot(b);
+    int order = compareFields(ctx->store, ctx->key, slotA, slotB);
+    if (order == 0) {
+        order = slotA < slotB ? -1 : slotA > slotB;
+    }
+    return order;
+}
+
+static void mergeRuns(const SortContext *ctx, const ContactViewEntry *left, size_t leftCount,
+                      const ContactViewEntry *right, size_t rightCount, ContactViewEntry *out) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < leftCount && j < rightCount) {
+        if (compareEntries(ctx, &right[j], &left[i]) < 0) {
+            *out++ = right[j++];
+        } else {
+            *out++ = left[i++];
+        }
+    }
+    memcpy(out, left + i, (leftCount - i) * sizeof(ContactViewEntry));
+    memcpy(out + (leftCount - i), right + j, (rightCount - j) * sizeof(ContactViewEntry));
+}
+
+// Bottom-up merge sort of data on one thread; scratch holds count entries.
+static void sortRange(const SortContext *ctx, ContactViewEntry *data, ContactViewEntry *scratch, size_t count) {
+    for (size_t start = 0; start < count; start += SORT_RUN) {
+        size_t end = start + SORT_RUN < count ? start + SORT_RUN : count;
+        for (size_t i = start + 1; i < end; i++) {
+            ContactViewEntry entry = data[i];
+            size_t j = i;
+            while (j > start && compareEntries(ctx, &entry, &data[j - 1]) < 0) {
+                data[j] = data[j - 1];
+                j--;
+            }
+            data[j] = entry;
+        }
+    }
+
+    ContactViewEntry *from = data;
+    ContactViewEntry *to = scratch;
+    for (size_t width = SORT_RUN; width < count; width *= 2) {
+        for (size_t start = 0; start < count; start += 2 * width) {
+            size_t mid = start + width < count ? start + width : count;
+            size_t end = start + 2 * width < count ? start + 2 * width : count;
+            mergeRuns(ctx, from + start, mid - start, from + mid, end - mid, to + start);
+        }
+        ContactViewEntry *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != data) {
+        memcpy(data, from, count * sizeof(ContactViewEntry));
+    }
+}
+
+// Sorts data[begin, end), or merges data[begin, mid) and data[mid, end)
+// into scratch when mid is set
+typedef struct {
+    const SortContext *ctx;
+    ContactViewEntry *data;
+    ContactViewEntry *scratch;
+    size_t begin;
+    size_t mid;
+    size_t end;
+} SortTask;
+
+static void *sortWorker(void *arg) {
+    SortTask *task = (SortTask *)arg;
+    if (task->mid == 0) {
+        sortRange(task->ctx, task->data + task->begin, task->scratch + task->begin, task->end - task->begin);
+    } else {
+        mergeRuns(task->ctx, task->data + task->begin, task->mid - task->begin,
+                  task->data + task->mid, task->end - task->mid, task->scratch + task->begin);
+    }
+    return NULL;
+}
+
+// Runs every task on its own thread, or inline if a thread cannot start.
+static void runTasks(SortTask *tasks, size_t count) {
+    pthread_t threads[CONTACT_SORT_MAX_THREADS];
+    bool started[CONTACT_SORT_MAX_THREADS];
+    for (size_t i = 0; i < count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, sortWorker, &tasks[i]) == 0;
+        if (!started[i]) {
+            sortWorker(&tasks[i]);
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+// Each worker sorts an equal slice, then neighbouring slices are merged
+// pairwise, one merge per thread, until a single run is left.
+static void sortEntries(const SortContext *ctx, ContactViewEntry *data, ContactViewEntry *scratch, size_t count) {
+    unsigned workers = workerCount(count);
+    if (workers <= 1) {
+        sortRange(ctx, data, scratch, count);
+        return;
+    }
+
+    SortTask tasks[CONTACT_SORT_MAX_THREADS];
+    size_t bounds[CONTACT_SORT_MAX_THREADS + 1];
+    for (unsigned i = 0; i <= workers; i++) {
+        bounds[i] = count * i / workers;
+    }
+    for (unsigned i = 0; i < workers; i++) {
+        tasks[i] = (SortTask){ctx, data, scratch, bounds[i], 0, bounds[i + 1]};
+    }
+    runTasks(tasks, workers);
+
+    ContactViewEntry *from = data;
+    ContactViewEntry *to = scratch;
+    size_t runs = workers;
+    while (runs > 1) {
+        size_t merged = 0;
+        for (size_t r = 0; r < runs; r += 2) {
+            // An odd run out is merged with nothing, which copies it across
+            size_t mid = bounds[r + 1];
+            size_t end = r + 2 <= runs ? bounds[r + 2] : mid;
+            tasks[merged] = (SortTask){ctx, from, to, bounds[r], mid, end};
+            bounds[merged++] = bounds[r];
+        }
+        bounds[merged] = count;
+        runTasks(tasks, merged);
+
+        ContactViewEntry *swap = from;
+        from = to;
+        to = swap;
+        runs = merged;
+    }
+    if (from != data) {
+        memcpy(data, from, count * sizeof(ContactViewEntry));
+    }
+}
+
+static bool reserveEntries(ContactView *view, size_t entries) {
+    if (entries <= view->capacity) {
+        return true;
+    }
+    size_t newCapacity = view->capacity ? view->capacity : 64;
+    while (newCapacity < entries) {
+        newCapacity *= 2;
+    }
+    ContactViewEntry *grown = (ContactViewEntry *)realloc(view->entries, newCapacity * sizeof(ContactViewEntry));
+    if (grown == NULL) {
+        perror("Failed to grow contact view");
+        return false;
+    }
+    view->entries = grown;
+    view->capacity = newCapacity;
+    return true;
+}
+
+static bool buildView(const ContactStore *store, ContactView *view, ContactSortKey key) {
+    if (!reserveEntries(view, store->count)) {
+        return false;
+    }
+
+    // Names and emails often share a start ("user", a company prefix) that
+    // would leave every key equal; find it so keys are taken after it
+    view->prefixLength = 0;
+    bool first = true;
+    for (uint32_t slot = 0; slot < store->slotCount && key != CONTACT_SORT_PHONE; slot++) {
+        if (!contactSlotAt(store, slot)->live) {
+            continue;
+        }
+        if (first) {
+            SortField field;
+            sortField(store, key, slot, &field);
+            unsigned char c;
+            while (view->prefixLength < CONTACT_VIEW_PREFIX_MAX && (c = foldCase(nextByte(&field))) != 0) {
+                view->prefix[view->prefixLength++] = c;
+            }
+            first = false;
+        } else {
+            view->prefixLength = sharedPrefix(store, view, key, slot);
+        }
+    }
+
+    size_t count = 0;
+    for (uint32_t slot = 0; slot < store->slotCount; slot++) {
+        if (contactSlotAt(store, slot)->live) {
+            view->entries[count++] = makeEntry(store, view, key, slot);
+        }
+    }
+
+    ContactViewEntry *scratch = (ContactViewEntry *)malloc((count ? count : 1) * sizeof(ContactViewEntry));
+    if (scratch == NULL) {
+        perror("Failed to sort contact view");
+        return false;
+    }
+    SortContext ctx = {store, key};
+    sortEntries(&ctx, view->entries, scratch, count);
+    free(scratch);
+
+    view->count = count;
+    view->built = true;
+    return true;
+}
+
+// Replaces the entries of every slot changed since the view was last read:
+// the untouched entries are still in order, so only the changed slots are
+// sorted and then merged in.
+static bool catchUp(const ContactStore *store, const ContactViews *views, ContactView *view, ContactSortKey key) {
+    size_t pending = views->changeCount - view->seen;
+    unsigned char *changed = (unsigned char *)calloc(store->slotCount / 8 + 1, 1);
+    ContactViewEntry *fresh = (ContactViewEntry *)malloc(2 * pending * sizeof(ContactViewEntry));
+    ContactViewEntry *merged = (ContactViewEntry *)malloc((view->count + pending) * sizeof(ContactViewEntry));
+    if (changed == NULL || fresh == NULL || merged == NULL) {
+        perror("Failed to update contact view");
+        free(changed);
+        free(fresh);
+        free(merged);
+        return false;
+    }
+
+    for (size_t i = view->seen; i < views->changeCount; i++) {
+        uint32_t slot = views->changes[i];
+        changed[slot / 8] |= (unsigned char)(1u << (slot % 8));
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < view->count; i++) {
+        uint32_t slot = entrySlot(&view->entries[i]);
+        if (!(changed[slot / 8] & (1u << (slot % 8)))) {
+            view->entries[kept++] = view->entries[i];
+        }
+    }
+
+    // A slot may have changed several times; its bit is cleared at the first
+    size_t freshCount = 0;
+    for (size_t i = view->seen; i < views->changeCount; i++) {
+        uint32_t slot = views->changes[i];
+        if (!(changed[slot / 8] & (1u << (slot % 8)))) {
+            continue;
+        }
+        changed[slot / 8] &= (unsigned char)~(1u << (slot % 8));
+        if (contactSlotAt(store, slot)->live) {
+            fresh[freshCount++] = makeEntry(store, view, key, slot);
+        }
+    }
+
+    SortContext ctx = {store, key};
+    sortRange(&ctx, fresh, fresh + pending, freshCount);
+    mergeRuns(&ctx, view->entries, kept, fresh, freshCount, merged);
+
+    free(view->entries);
+    view->entries = merged;
+    view->capacity = view->count + pending;
+    view->count = kept + freshCount;
+    free(changed);
+    free(fresh);
+    return true;
+}
+
+// Changed slots can be merged only if their fields still start with the
+// prefix the view's keys skip
+static bool keepsPrefix(const ContactStore *store, const ContactViews *views, const ContactView *view, ContactSortKey key) {
+    for (size_t i = view->seen; i < views->changeCount && view->prefixLength > 0; i++) {
+        uint32_t slot = views->changes[i];
+        if (contactSlotAt(store, slot)->live && sharedPrefix(store, view, key, slot) < view->prefixLength) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void dropViews(ContactViews *views) {
+    for (int i = 0; i < CONTACT_SORT_KEYS; i++) {
+        views->views[i].built = false;
+        views->views[i].count = 0;
+        views->views[i].seen = 0;
+    }
+    views->changeCount = 0;
+}
+
+// Forgets changes once every built view has merged them.
+static void trimChanges(ContactViews *views) {
+    for (int i = 0; i < CONTACT_SORT_KEYS; i++) {
+        if (views->views[i].built && views->views[i].seen < views->changeCount) {
+            return;
+        }
+    }
+    for (int i = 0; i < CONTACT_SORT_KEYS; i++) {
+        views->views[i].seen = 0;
+    }
+    views->changeCount = 0;
+}
+
+const ContactViewEntry *contactSortedView(ContactStore *store, ContactSortKey key, size_t *count) {
+    *count = 0;
+    if (store->views == NULL) {
+        store->views = (ContactViews *)calloc(1, sizeof(ContactViews));
+        if (store->views == NULL) {
+            perror("Failed to allocate contact views");
+            return NULL;
+        }
+    }
+
+    ContactViews *views = store->views;
+    ContactView *view = &views->views[key];
+    size_t pending = views->changeCount - view->seen;
+    bool ok = true;
+    // When most of the view has changed a full sort is cheaper than merging
+    if (!view->built || (pending > 0 && (pending >= view->count || !keepsPrefix(store, views, view, key)))) {
+        view->built = false;
+        ok = buildView(store, view, key);
+    } else if (pending > 0) {
+        ok = catchUp(store, views, view, key);
+    }
+    if (!ok) {
+        view->built = false;
+        view->count = 0;
+        trimChanges(views);
+        return NULL;
+    }
+
+    view->seen = views->changeCount;
+    trimChanges(views);
+    *count = view->count;
+    return view->count > 0 ? view->entries : NULL;
+}
+
+size_t contactViewPage(ContactStore *store, ContactSortKey key, size_t offset, Contact *out, size_t limit) {
+    size_t count;
+    const ContactViewEntry *entries = contactSortedView(store, key, &count);
+    size_t copied = 0;
+    for (size_t i = offset; i < count && copied < limit; i++) {
+        getContact(store, entries[i].handle, &out[copied++]);
+    }
+    return copied;
+}
+
+void contactViewsNoteChange(ContactStore *store, uint32_t slot) {
+    ContactViews *views = store->views;
+    if (views == NULL) {
+        return;
+    }
+    bool built = false;
+    for (int i = 0; i < CONTACT_SORT_KEYS; i++) {
+        built = built || views->views[i].built;
+    }
+    if (!built) {
+        return;
+    }
+
+    // A log longer than the store is worth less than sorting again
+    if (views->changeCount >= store->count + CHANGE_LOG_SLACK) {
+        dropViews(views);
+        return;
+    }
+    if (views->changeCount == views->changeCapacity) {
+        size_t newCapacity = views->changeCapacity ? views->changeCapacity * 2 : 256;
+        uint32_t *changes = (uint32_t *)realloc(views->changes, newCapacity * sizeof(uint32_t));
+        if (changes == NULL) {
+            perror("Failed to record contact view change");
+            dropViews(views);
+            return;
+        }
+        views->changes = changes;
+        views->changeCapacity = newCapacity;
+    }
+    views->changes[views->changeCount++] = slot;
+}
+
+void contactViewsFree(ContactStore *store) {
+    ContactViews *views = store->views;
+    if (views == NULL) {
+        return;
+    }
+    for (int i = 0; i < CONTACT_SORT_KEYS; i++) {
+        free(views->views[i].entries);
+    }
+    free(views->changes);
+    free(views);
+    store->views = NULL;
+}
+
+size_t contactViewsBytes(const ContactStore *store) {
+    const ContactViews *views = store->views;
+    if (views == NULL) {
+        return 0;
+    }
+    size_t bytes = sizeof(ContactViews) + views->changeCapacity * sizeof(uint32_t);
+    for (int i = 0; i < CONTACT_SORT_KEYS; i++) {
+        bytes += views->views[i].capacity * sizeof(ContactViewEntry);
+    }
+    return bytes;
+}
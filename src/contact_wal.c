@@ -0,0 +1,422 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_wal.h"
+#include "../include/contact_db.h"
+#include "../include/contact_pack.h"
+#include "../include/security.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t recordChecksum(const ContactWalRecord *record) {
+    size_t skip = sizeof(record->checksum);
+    return checksumData(0, (const unsigned char *)record + skip, sizeof(*record) - skip);
+}
+
+// Bytes that follow a batch record: its contacts or the names it deletes
+static size_t payloadSize(const ContactWalRecord *record) {
+    switch (record->op) {
+    case CONTACT_WAL_ADD_BATCH:
+        return (size_t)record->count * sizeof(Contact);
+    case CONTACT_WAL_DELETE_BATCH:
+        return (size_t)record->count * sizeof(record->key);
+    default:
+        return 0;
+    }
+}
+
+static void copyString(char *dest, const char *src, size_t size) {
+    strncpy(dest, src, size - 1);
+    dest[size - 1] = '\0';
+}
+
+static void terminateContact(Contact *contact) {
+    contact->name[sizeof(contact->name) - 1] = '\0';
+    contact->phone[sizeof(contact->phone) - 1] = '\0';
+    contact->email[sizeof(contact->email) - 1] = '\0';
+}
+
+static void applyBatch(ContactStore *store, const ContactWalRecord *record, char *payload) {
+    if (record->op == CONTACT_WAL_ADD_BATCH) {
+        Contact *contacts = (Contact *)payload;
+        for (size_t i = 0; i < record->count; i++) {
+            terminateContact(&contacts[i]);
+        }
+        addContacts(store, contacts, record->count, NULL);
+        return;
+    }
+
+    const char **names = (const char **)malloc(record->count * sizeof(char *));
+    if (names == NULL) {
+        perror("Failed to replay batch delete");
+        return;
+    }
+    for (size_t i = 0; i < record->count; i++) {
+        char *name = payload + i * sizeof(record->key);
+        name[sizeof(record->key) - 1] = '\0';
+        names[i] = name;
+    }
+    deleteContacts(store, names, record->count);
+    free(names);
+}
+
+static void applyRecord(ContactStore *store, ContactWalRecord *record, char *payload) {
+    Contact *contact = &record->contact;
+    record->key[sizeof(record->key) - 1] = '\0';
+    terminateContact(contact);
+
+    switch (record->op) {
+    case CONTACT_WAL_ADD:
+        addContact(store, contact);
+        break;
+    case CONTACT_WAL_UPDATE:
+        updateContact(store, record->key, contact);
+        break;
+    case CONTACT_WAL_DELETE:
+        deleteContact(store, record->key);
+        break;
+    case CONTACT_WAL_ADD_BATCH:
+    case CONTACT_WAL_DELETE_BATCH:
+        applyBatch(store, record, payload);
+        break;
+    }
+}
+
+bool contactWalRecover(ContactWal *wal, ContactStore *store, const char *snapshotPath, const char *logPath) {
+    memset(wal, 0, sizeof(*wal));
+    wal->fd = -1;
+    copyString(wal->snapshotPath, snapshotPath, sizeof(wal->snapshotPath));
+    copyString(wal->logPath, logPath, sizeof(wal->logPath));
+    wal->groupSize = CONTACT_WAL_GROUP_SIZE;
+    wal->groupIntervalMs = CONTACT_WAL_GROUP_INTERVAL_MS;
+    wal->checkpointRecords = CONTACT_WAL_CHECKPOINT_RECORDS;
+
+    // Replayed changes must not be logged a second time
+    store->wal = NULL;
+    loadContacts(store, snapshotPath);
+
+    ContactDb db;
+    ContactPack pack;
+    ContactDbStatus status = contactDbOpen(&db, snapshotPath);
+    if (status == CONTACT_DB_OK) {
+        wal->sequence = db.header->walSequence;
+        contactDbClose(&db);
+    } else if (status == CONTACT_DB_PACKED && contactPackOpen(&pack, snapshotPath) == CONTACT_DB_OK) {
+        wal->sequence = pack.header->walSequence;
+        contactPackClose(&pack);
+    }
+    uint64_t snapshotSequence = wal->sequence;
+
+    int fd = open(logPath, O_RDWR | O_CREAT | O_APPEND, 0600);
+    if (fd < 0) {
+        perror("Failed to open write-ahead log");
+        return false;
+    }
+
+    struct stat st;
+    off_t size = fstat(fd, &st) == 0 ? st.st_size : 0;
+
+    // Records up to the snapshot's sequence are already in it; they are only
+    // present if a checkpoint was interrupted before truncating the log
+    ContactWalRecord record;
+    char *payload = NULL;
+    size_t payloadCapacity = 0;
+    off_t valid = 0;
+    size_t replayed = 0;
+    uint64_t last = 0;
+    while (read(fd, &record, sizeof(record)) == (ssize_t)sizeof(record)) {
+        // A batch whose payload runs past the end of the file is torn
+        size_t length = payloadSize(&record);
+        if (valid + (off_t)(sizeof(record) + length) > size) {
+            break;
+        }
+        if (length > payloadCapacity) {
+            char *grown = (char *)realloc(payload, length);
+            if (grown == NULL) {
+                perror("Failed to replay write-ahead log");
+                break;
+            }
+            payload = grown;
+            payloadCapacity = length;
+        }
+        if (length > 0 && read(fd, payload, length) != (ssize_t)length) {
+            break;
+        }
+
+        uint32_t checksum = checksumData(recordChecksum(&record), payload, length);
+        if (record.checksum != checksum || (valid > 0 && record.sequence != last + 1)) {
+            break;
+        }
+        last = record.sequence;
+        size_t changes = length > 0 ? record.count : 1;
+        if (record.sequence > snapshotSequence) {
+            applyRecord(store, &record, payload);
+            wal->sequence = record.sequence;
+            replayed += changes;
+        }
+        wal->logged += changes;
+        valid += sizeof(record) + length;
+    }
+    free(payload);
+
+    // Drop a torn or corrupt tail so new records follow the last good one
+    if (size > valid) {
+        fprintf(stderr, "Discarding %lld bytes of incomplete log data in %s\n",
+                (long long)(size - valid), logPath);
+        if (ftruncate(fd, valid) != 0) {
+            perror("Failed to truncate write-ahead log");
+            wal->broken = true;
+        }
+    }
+    wal->end = (uint64_t)valid;
+
+    if (replayed > 0) {
+        printf("Replayed %zu changes from %s\n", replayed, logPath);
+    }
+
+    wal->fd = fd;
+    store->wal = wal;
+    return true;
+}
+
+// Writes one whole record. A failed or short write is cut back off the
+// log, so the next record is not written after a torn one that recovery
+// would stop at.
+static bool writeRecord(ContactWal *wal, const void *data, size_t length) {
+    if (wal->broken) {
+        return false;
+    }
+    if (write(wal->fd, data, length) != (ssize_t)length) {
+        perror("Failed to append to write-ahead log");
+        if (ftruncate(wal->fd, (off_t)wal->end) != 0) {
+            perror("Failed to truncate write-ahead log");
+        }
+        wal->broken = true;
+        return false;
+    }
+    wal->end += length;
+    return true;
+}
+
+// Bookkeeping after a record of `changes` changes is written
+static bool appended(ContactWal *wal, size_t changes) {
+    wal->sequence++;
+    wal->logged += changes;
+    if (wal->pending++ == 0) {
+        wal->pendingSince = nowSeconds();
+        if (wal->flushWake != NULL) {
+            pthread_cond_signal(wal->flushWake);
+        }
+    }
+
+    // Group commit: one fsync covers every record written since the last one
+    if (wal->pending >= wal->groupSize ||
+        (nowSeconds() - wal->pendingSince) * 1000 >= wal->groupIntervalMs) {
+        return contactWalSync(wal);
+    }
+    return true;
+}
+
+bool contactWalAppend(ContactWal *wal, ContactWalOp op, const char *key, const Contact *contact) {
+    ContactWalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.op = op;
+    record.sequence = wal->sequence + 1;
+    if (key != NULL) {
+        copyString(record.key, key, sizeof(record.key));
+    }
+    if (contact != NULL) {
+        record.contact = *contact;
+    }
+    record.checksum = recordChecksum(&record);
+
+    if (!writeRecord(wal, &record, sizeof(record))) {
+        return false;
+    }
+    return appended(wal, 1);
+}
+
+bool contactWalAppendBatch(ContactWal *wal, ContactWalOp op, const Contact *contacts,
+                           const char *const *names, size_t count) {
+    ContactWalRecord header;
+    memset(&header, 0, sizeof(header));
+    header.op = op;
+    header.sequence = wal->sequence + 1;
+    header.count = (uint32_t)count;
+
+    // Header and payload go out in a single write, so a crash leaves either
+    // the whole batch or a torn tail that recovery discards
+    size_t length = payloadSize(&header);
+    if (wal->broken) {
+        return false;
+    }
+    char *buffer = (char *)calloc(1, sizeof(header) + length);
+    if (buffer == NULL) {
+        perror("Failed to append to write-ahead log");
+        wal->broken = true;
+        return false;
+    }
+    char *payload = buffer + sizeof(header);
+    for (size_t i = 0; i < count; i++) {
+        if (op == CONTACT_WAL_ADD_BATCH) {
+            memcpy(payload + i * sizeof(Contact), &contacts[i], sizeof(Contact));
+        } else {
+            copyString(payload + i * sizeof(header.key), names[i], sizeof(header.key));
+        }
+    }
+    header.checksum = checksumData(recordChecksum(&header), payload, length);
+    memcpy(buffer, &header, sizeof(header));
+
+    bool written = writeRecord(wal, buffer, sizeof(header) + length);
+    free(buffer);
+    if (!written) {
+        return false;
+    }
+    return appended(wal, count);
+}
+
+bool contactWalSync(ContactWal *wal) {
+    if (wal->pending == 0) {
+        return true;
+    }
+    if (fsync(wal->fd) != 0) {
+        perror("Failed to sync write-ahead log");
+        wal->broken = true;
+        return false;
+    }
+    wal->pending = 0;
+    wal->syncs++;
+    return true;
+}
+
+bool contactWalCheckpoint(ContactWal *wal, const ContactStore *store) {
+    // A broken log is about to be replaced by the snapshot wholesale
+    if (!wal->broken && !contactWalSync(wal)) {
+        return false;
+    }
+    if (!contactPackWrite(store, wal->snapshotPath, wal->sequence, NULL)) {
+        return false;
+    }
+
+    // The snapshot, renamed into place and its directory synced, now carries
+    // every logged change
+    if (ftruncate(wal->fd, 0) != 0 || fsync(wal->fd) != 0) {
+        perror("Failed to truncate write-ahead log");
+        return false;
+    }
+    wal->logged = 0;
+    wal->pending = 0;
+    wal->end = 0;
+    wal->broken = false;
+    wal->checkpoints++;
+    return true;
+}
+
+bool contactWalMaintain(ContactWal *wal, const ContactStore *store) {
+    if (!wal->broken && wal->pending > 0 && (nowSeconds() - wal->pendingSince) * 1000 >= wal->groupIntervalMs) {
+        if (!contactWalSync(wal)) {
+            return false;
+        }
+    }
+    if (wal->broken || wal->logged >= wal->checkpointRecords) {
+        return contactWalCheckpoint(wal, store);
+    }
+    return true;
+}
+
+void contactWalClose(ContactWal *wal, ContactStore *store) {
+    if (wal->fd >= 0) {
+        contactWalSync(wal);
+        close(wal->fd);
+    }
+    if (store != NULL && store->wal == wal) {
+        store->wal = NULL;
+    }
+    wal->fd = -1;
+}
+
+static void *flusherThread(void *arg) {
+    ContactWalFlusher *flusher = (ContactWalFlusher *)arg;
+    ContactWal *wal = flusher->wal;
+
+    pthread_mutex_lock(flusher->lock);
+    while (!flusher->stopping) {
+        if (wal->pending == 0) {
+            pthread_cond_wait(&flusher->wake, flusher->lock);
+            continue;
+        }
+        double due = wal->pendingSince + wal->groupIntervalMs / 1e3;
+        if (!wal->broken && nowSeconds() >= due) {
+            contactWalSync(wal);
+            continue;
+        }
+        // A broken log holds its records until a checkpoint; look again later
+        if (wal->broken) {
+            due = nowSeconds() + wal->groupIntervalMs / 1e3;
+        }
+        struct timespec until;
+        until.tv_sec = (time_t)due;
+        until.tv_nsec = (long)((due - (double)until.tv_sec) * 1e9);
+        pthread_cond_timedwait(&flusher->wake, flusher->lock, &until);
+    }
+    pthread_mutex_unlock(flusher->lock);
+    return NULL;
+}
+
+bool contactWalFlusherStart(ContactWalFlusher *flusher, ContactWal *wal, pthread_mutex_t *lock) {
+    memset(flusher, 0, sizeof(*flusher));
+    flusher->wal = wal;
+    flusher->lock = lock;
+
+    // Deadlines come from nowSeconds, so the wait runs on the same clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&flusher->wake, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_lock(lock);
+    contactWalFlusherAttach(flusher);
+    pthread_mutex_unlock(lock);
+
+    if (pthread_create(&flusher->thread, NULL, flusherThread, flusher) != 0) {
+        perror("Failed to start write-ahead log flusher");
+        pthread_mutex_lock(lock);
+        wal->flushWake = NULL;
+        pthread_mutex_unlock(lock);
+        pthread_cond_destroy(&flusher->wake);
+        return false;
+    }
+    flusher->started = true;
+    return true;
+}
+
+void contactWalFlusherAttach(ContactWalFlusher *flusher) {
+    flusher->wal->flushWake = &flusher->wake;
+    pthread_cond_signal(&flusher->wake);
+}
+
+void contactWalFlusherStop(ContactWalFlusher *flusher) {
+    if (!flusher->started) {
+        return;
+    }
+    pthread_mutex_lock(flusher->lock);
+    flusher->stopping = true;
+    flusher->wal->flushWake = NULL;
+    pthread_cond_signal(&flusher->wake);
+    pthread_mutex_unlock(flusher->lock);
+
+    pthread_join(flusher->thread, NULL);
+    pthread_cond_destroy(&flusher->wake);
+    flusher->started = false;
+}
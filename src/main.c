@@ -1,4 +1,14 @@
 #include "../include/contact_manager.h"
+#include "../include/contact_shared.h"
+#include "../include/contact_cursor.h"
+#include "../include/contact_view.h"
+#include "../include/contact_dedup.h"
+#include "../include/contact_query.h"
+#include "../include/contact_tags.h"
+#include "../include/contact_lazy.h"
+#include "../include/contact_wal.h"
+#include "../include/contact_saver.h"
+#include "../include/contact_io.h"
 #include "../include/memory_allocator.h"
 #include "../include/network_sync.h"
 #include "../include/security.h"
@@ -8,13 +18,26 @@
 #include <string.h>
 #include <signal.h>
 #include <ctype.h>
+#include <time.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
 #define CONTACTS_FILE "contacts.dat"
+#define CONTACTS_LOG_FILE "contacts.wal"
 #define DEFAULT_PORT 8080
-
-static ContactNode *contacts = NULL;
+#define MAX_MENU_CHOICE 17
+#define SEARCH_RESULT_LIMIT 20
+#define DISPLAY_PAGE_SIZE 10
+#define DUPLICATE_GROUP_LIMIT 20
+
+// Shared with the server's client threads
+static ContactShared contacts;
+static ContactWal contactLog;
+static bool logEnabled = false;
+static ContactWalFlusher flusher;
+static bool flusherEnabled = false;
+static ContactSaver saver;
+static bool saverEnabled = false;
 static volatile bool running = true;
 
 void signalHandler(int signal) {
@@ -34,6 +57,89 @@ void clearInputBuffer(void) {
     }
 }
 
+// Asks whether to show another page; false once the user stops.
+static bool morePages(size_t shown) {
+    char input[64];
+    printf("    -- %zu shown. Press Enter for more, q to stop: ", shown);
+    return fgets(input, sizeof(input), stdin) != NULL && tolower((unsigned char)input[0]) != 'q';
+}
+
+// Lists contacts in name order a page at a time. Each page is read in its
+// own read section, so writers are never held up by the user paging.
+static void displayAllContacts(void) {
+    ContactCursor cursor;
+    Contact page[DISPLAY_PAGE_SIZE];
+    size_t shown = 0;
+    contactCursorInit(&cursor, CONTACT_ORDER_NAME);
+
+    while (!cursor.done) {
+        ContactReadToken token;
+        const ContactStore *view = contactReadBegin(&contacts, &token);
+        size_t count = contactPage(view, &cursor, page, DISPLAY_PAGE_SIZE);
+        if (count == 0 && shown == 0) {
+            displayContacts(view);
+        }
+        contactReadEnd(&contacts, &token);
+
+        displayContactCards(page, count, shown + 1);
+        shown += count;
+        if (!cursor.done && !morePages(shown)) {
+            return;
+        }
+    }
+
+    if (shown > 0) {
+        setColor(COLOR_BLUE);
+        printf("    📊 Total Contacts: %zu\n", shown);
+        resetColor();
+    }
+}
+
+// Lists contacts sorted by name, phone or email from the store's cached
+// views, a page at a time. Pages are read by position, so changes made
+// between pages may shift the listing.
+static void sortedContactsMenu(void) {
+    char input[64];
+    printf("Sort by (1) name, (2) phone, (3) email: ");
+    if (fgets(input, sizeof(input), stdin) == NULL) {
+        return;
+    }
+    int choice = atoi(input);
+    if (choice < 1 || choice > 3) {
+        printf("Invalid sort order.\n");
+        return;
+    }
+    ContactSortKey key = choice == 1 ? CONTACT_SORT_NAME : choice == 2 ? CONTACT_SORT_PHONE : CONTACT_SORT_EMAIL;
+
+    Contact page[DISPLAY_PAGE_SIZE];
+    size_t shown = 0;
+    for (;;) {
+        ContactStore *store = contactSharedLockViews(&contacts);
+        size_t total;
+        contactSortedView(store, key, &total);
+        size_t count = contactViewPage(store, key, shown, page, DISPLAY_PAGE_SIZE);
+        if (total == 0) {
+            displayContacts(store);
+        }
+        contactSharedUnlock(&contacts);
+
+        displayContactCards(page, count, shown + 1);
+        shown += count;
+        if (count == 0 || shown >= total) {
+            break;
+        }
+        if (!morePages(shown)) {
+            return;
+        }
+    }
+
+    if (shown > 0) {
+        setColor(COLOR_BLUE);
+        printf("    📊 Total Contacts: %zu\n", shown);
+        resetColor();
+    }
+}
+
 void printLogo(void) {
     int width = getTerminalWidth();
     if (width < 60) width = 60;
@@ -80,6 +186,13 @@ void printMenu(void) {
         "🔄 Sync with Server",
         "📊 Memory Analysis",
         "🔍 Visualize Memory",
+        "🔎 Search Contacts",
+        "📥 Import Contacts",
+        "📤 Export Contacts",
+        "🔀 Sorted Contacts",
+        "🧬 Find Duplicates",
+        "🧮 Query Contacts",
+        "🏷️  Tag Contacts",
         "🚪 Exit Program"
     };
 
@@ -94,11 +207,18 @@ void printMenu(void) {
         "Synchronize with remote server",
         "Show memory usage statistics",
         "Display memory visualization",
+        "Find contacts by name prefix",
+        "Bulk load from a CSV or vCard file",
+        "Write all contacts to CSV or vCard",
+        "List contacts by name, phone or email",
+        "Report groups of likely duplicate contacts",
+        "Filter by name, phone and email conditions",
+        "Group contacts and combine groups",
         "Exit the application"
     };
 
-    for (int i = 0; i < 11; i++) {
-        if (i == 10) {
+    for (int i = 0; i <= MAX_MENU_CHOICE; i++) {
+        if (i == MAX_MENU_CHOICE) {
             setColor(COLOR_RED);
             printf("\n    %2d. %s", 0, menuItems[i]);
         } else {
@@ -115,7 +235,7 @@ void printMenu(void) {
     setColor(COLOR_BOLD);
     setColor(COLOR_GREEN);
     printf("    ══════════════════════════════════════════════════════════════\n");
-    printf("    Enter your choice [0-10]: ");
+    printf("    Enter your choice [0-%d]: ", MAX_MENU_CHOICE);
     resetColor();
 }
 
@@ -146,21 +266,17 @@ void addContactMenu(void) {
     newContact.email[strcspn(newContact.email, "\n")] = '\0';
 
     // Check if contact with same name already exists
-    ContactNode *current = contacts;
-    while (current != NULL) {
-        if (strcmp(current->contact.name, newContact.name) == 0) {
-            printf("A contact with name '%s' already exists.\n", newContact.name);
-            return;
-        }
-        current = current->next;
+    if (contactSharedFind(&contacts, newContact.name, NULL)) {
+        printf("A contact with name '%s' already exists.\n", newContact.name);
+        return;
     }
 
-    addContact(&contacts, &newContact);
+    contactSharedAdd(&contacts, &newContact);
     printf("Contact '%s' added successfully!\n", newContact.name);
 }
 
 void updateContactMenu(void) {
-    if (contacts == NULL) {
+    if (contactSharedCount(&contacts) == 0) {
         printf("No contacts available to update.\n");
         return;
     }
@@ -168,7 +284,7 @@ void updateContactMenu(void) {
     char input[50];
     Contact newContact;
 
-    displayContacts(contacts);
+    displayAllContacts();
     printf("Enter the NAME of contact to update: ");
     if (fgets(input, sizeof(input), stdin) == NULL) {
         clearInputBuffer();
@@ -212,7 +328,7 @@ void updateContactMenu(void) {
     }
     newContact.email[strcspn(newContact.email, "\n")] = '\0';
 
-    if (updateContact(contacts, input, &newContact)) {
+    if (contactSharedUpdate(&contacts, input, &newContact)) {
         printf("Contact updated successfully!\n");
     } else {
         printf("Contact '%s' not found.\n", input);
@@ -220,14 +336,14 @@ void updateContactMenu(void) {
 }
 
 void deleteContactMenu(void) {
-    if (contacts == NULL) {
+    if (contactSharedCount(&contacts) == 0) {
         printf("No contacts available to delete.\n");
         return;
     }
 
     char input[50];
 
-    displayContacts(contacts);
+    displayAllContacts();
     printf("Enter the NAME of contact to delete: ");
     if (fgets(input, sizeof(input), stdin) == NULL) {
         return;
@@ -240,13 +356,292 @@ void deleteContactMenu(void) {
         return;
     }
 
-    if (deleteContact(&contacts, input)) {
+    if (contactSharedDelete(&contacts, input)) {
         printf("Contact '%s' deleted successfully!\n", input);
     } else {
         printf("Contact '%s' not found.\n", input);
     }
 }
 
+static bool printSearchResult(const Contact *contact, void *userData) {
+    (void)userData;
+    printf("  %-30s %-20s %s\n", contact->name, contact->phone, contact->email);
+    return true;
+}
+
+void searchContactsMenu(void) {
+    char prefix[50];
+
+    printf("Enter name prefix: ");
+    if (fgets(prefix, sizeof(prefix), stdin) == NULL) {
+        return;
+    }
+    prefix[strcspn(prefix, "\n")] = '\0';
+
+    ContactReadToken token;
+    const ContactStore *store = contactReadBegin(&contacts, &token);
+    size_t found = searchContactsByPrefix(store, prefix, SEARCH_RESULT_LIMIT, printSearchResult, NULL);
+    contactReadEnd(&contacts, &token);
+    if (found == 0) {
+        printf("No contacts match '%s'.\n", prefix);
+    } else if (found == SEARCH_RESULT_LIMIT) {
+        printf("Showing first %d matches.\n", SEARCH_RESULT_LIMIT);
+    }
+}
+
+static void printDuplicateReasons(unsigned reasons) {
+    const char *separator = "";
+    if (reasons & CONTACT_DUP_PHONE) {
+        printf("same phone");
+        separator = ", ";
+    }
+    if (reasons & CONTACT_DUP_EMAIL) {
+        printf("%ssame email", separator);
+        separator = ", ";
+    }
+    if (reasons & CONTACT_DUP_NAME) {
+        printf("%ssimilar name", separator);
+    }
+}
+
+void findDuplicatesMenu(void) {
+    ContactDuplicates duplicates;
+    ContactReadToken token;
+    const ContactStore *store = contactReadBegin(&contacts, &token);
+    clock_t start = clock();
+    bool found = contactFindDuplicates(store, CONTACT_DUP_ALL, CONTACT_DUP_NAME_THRESHOLD, &duplicates);
+    double ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+    if (!found) {
+        contactReadEnd(&contacts, &token);
+        printf("Duplicate search failed.\n");
+        return;
+    }
+
+    printf("Found %zu duplicate groups (%zu contacts) among %zu contacts in %.1f ms\n",
+           duplicates.clusterCount, duplicates.memberCount, store->count, ms);
+    for (size_t i = 0; i < duplicates.clusterCount && i < DUPLICATE_GROUP_LIMIT; i++) {
+        printf("\nGroup %zu (", i + 1);
+        printDuplicateReasons(duplicates.reasons[i]);
+        printf("):\n");
+        for (size_t m = duplicates.starts[i]; m < duplicates.starts[i + 1]; m++) {
+            Contact contact;
+            if (getContact(store, duplicates.members[m], &contact)) {
+                printSearchResult(&contact, NULL);
+            }
+        }
+    }
+    contactReadEnd(&contacts, &token);
+    if (duplicates.clusterCount > DUPLICATE_GROUP_LIMIT) {
+        printf("\nShowing first %d groups.\n", DUPLICATE_GROUP_LIMIT);
+    }
+    contactDuplicatesFree(&duplicates);
+}
+
+// Reads "=exact", "^prefix", "~substring" or, for emails, "@domain".
+// False when the answer is empty or not understood.
+static bool readCondition(const char *prompt, ContactField field, char *value, size_t size,
+                          ContactPredicate *predicate) {
+    printf("%s", prompt);
+    if (fgets(value, (int)size, stdin) == NULL) {
+        return false;
+    }
+    value[strcspn(value, "\n")] = '\0';
+    switch (value[0]) {
+        case '=': predicate->match = CONTACT_MATCH_EQUALS; break;
+        case '^': predicate->match = CONTACT_MATCH_PREFIX; break;
+        case '~': predicate->match = CONTACT_MATCH_CONTAINS; break;
+        case '@':
+            if (field == CONTACT_FIELD_EMAIL) {
+                predicate->match = CONTACT_MATCH_DOMAIN;
+                break;
+            }
+            // fall through
+        default:
+            if (value[0] != '\0') {
+                printf("Ignoring '%s': start with =, ^ or ~%s.\n", value, field == CONTACT_FIELD_EMAIL ? " (or @)" : "");
+            }
+            return false;
+    }
+    predicate->field = field;
+    predicate->value = value + 1;
+    return true;
+}
+
+void queryContactsMenu(void) {
+    static const char *prompts[CONTACT_FIELD_COUNT] = {
+        "Name (=exact, ^prefix, ~contains, empty for any): ",
+        "Phone (=exact, ^prefix, ~contains, empty for any): ",
+        "Email (=exact, ^prefix, ~contains, @domain, empty for any): "
+    };
+    char values[CONTACT_FIELD_COUNT][64];
+    ContactPredicate predicates[CONTACT_FIELD_COUNT];
+    size_t count = 0;
+    for (int field = 0; field < CONTACT_FIELD_COUNT; field++) {
+        count += readCondition(prompts[field], (ContactField)field, values[field], sizeof(values[field]),
+                               &predicates[count]);
+    }
+
+    ContactQuery query;
+    contactQueryCompile(&query, predicates, count);
+    ContactColumns columns;
+    ContactHandle handles[SEARCH_RESULT_LIMIT];
+    ContactReadToken token;
+    const ContactStore *store = contactReadBegin(&contacts, &token);
+    if (!contactColumnsBuild(&columns, store)) {
+        contactReadEnd(&contacts, &token);
+        printf("Query failed.\n");
+        return;
+    }
+    clock_t start = clock();
+    size_t found = contactQueryRun(&columns, &query, handles, SEARCH_RESULT_LIMIT);
+    double ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+    printf("%zu of %zu contacts match (%.2f ms)\n", found, store->count, ms);
+    for (size_t i = 0; i < found && i < SEARCH_RESULT_LIMIT; i++) {
+        Contact contact;
+        if (getContact(store, handles[i], &contact)) {
+            printSearchResult(&contact, NULL);
+        }
+    }
+    contactReadEnd(&contacts, &token);
+    contactColumnsFree(&columns);
+    if (found > SEARCH_RESULT_LIMIT) {
+        printf("Showing first %d matches.\n", SEARCH_RESULT_LIMIT);
+    }
+}
+
+static bool readFilename(const char *prompt, char *filename, size_t size) {
+    printf("%s", prompt);
+    if (fgets(filename, (int)size, stdin) == NULL) {
+        return false;
+    }
+    filename[strcspn(filename, "\n")] = '\0';
+    return filename[0] != '\0';
+}
+
+typedef struct {
+    size_t shown;
+} TagListing;
+
+static bool printTagMember(const Contact *contact, void *userData) {
+    TagListing *listing = (TagListing *)userData;
+    printSearchResult(contact, NULL);
+    return ++listing->shown < SEARCH_RESULT_LIMIT;
+}
+
+// Tags are kept on the store and saved with it; "a & b", "a | b" and
+// "a - b" combine two tags into a one-off group
+void tagContactsMenu(void) {
+    ContactReadToken token;
+    const ContactStore *store = contactReadBegin(&contacts, &token);
+    const ContactTags *tags = store->tags;
+    if (tags == NULL || tags->count == 0) {
+        printf("No tags yet.\n");
+    }
+    for (size_t i = 0; tags != NULL && i < tags->count; i++) {
+        printf("  %-20s %zu contacts\n", tags->tags[i].name, contactBitmapCount(&tags->tags[i].members));
+    }
+    contactReadEnd(&contacts, &token);
+
+    char action[8];
+    char name[sizeof(((Contact *)0)->name) + 1];
+    char tag[CONTACT_TAG_NAME_MAX + 1];
+    if (!readFilename("Action (t=tag, u=untag, s=show, &=both, |=either, -=first not second): ",
+                      action, sizeof(action))) {
+        return;
+    }
+    if (action[0] == 't' || action[0] == 'u') {
+        if (!readFilename("Contact name: ", name, sizeof(name)) || !readFilename("Tag: ", tag, sizeof(tag))) {
+            return;
+        }
+        bool done = action[0] == 't' ? contactSharedTag(&contacts, name, tag) : contactSharedUntag(&contacts, name, tag);
+        printf(done ? "Done.\n" : "No change: check the contact and tag names.\n");
+        return;
+    }
+
+    char other[CONTACT_TAG_NAME_MAX + 1] = "";
+    bool combine = action[0] != '\0' && strchr("&|-", action[0]) != NULL;
+    if ((action[0] != 's' && !combine) || !readFilename("Tag: ", tag, sizeof(tag)) ||
+        (combine && !readFilename("Second tag: ", other, sizeof(other)))) {
+        return;
+    }
+
+    store = contactReadBegin(&contacts, &token);
+    // Unknown tags act as empty groups
+    static const ContactBitmap none;
+    const ContactBitmap *first = contactTagged(store, tag);
+    const ContactBitmap *second = contactTagged(store, other);
+    first = first != NULL ? first : &none;
+    second = second != NULL ? second : &none;
+    ContactBitmap group = {0};
+    clock_t start = clock();
+    bool ok;
+    switch (action[0]) {
+        case '&': ok = contactBitmapAnd(&group, first, second); break;
+        case '|': ok = contactBitmapOr(&group, first, second); break;
+        case '-': ok = contactBitmapAndNot(&group, first, second); break;
+        default: ok = contactBitmapCopy(&group, first); break;
+    }
+    double ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+    if (ok) {
+        size_t found = contactBitmapCount(&group);
+        TagListing listing = {0};
+        printf("%zu contacts (%.2f ms)\n", found, ms);
+        contactTagVisit(store, &group, printTagMember, &listing);
+        if (found > SEARCH_RESULT_LIMIT) {
+            printf("Showing first %d contacts.\n", SEARCH_RESULT_LIMIT);
+        }
+    } else {
+        printf("Could not combine the tags.\n");
+    }
+    contactReadEnd(&contacts, &token);
+    contactBitmapFree(&group);
+}
+
+typedef struct {
+    const char *filename;
+    ContactIoStats stats;
+} ImportRequest;
+
+static bool importIntoStore(ContactStore *store, void *arg) {
+    ImportRequest *request = (ImportRequest *)arg;
+    return importContacts(store, request->filename, contactFormatForFile(request->filename), &request->stats);
+}
+
+void importContactsMenu(void) {
+    char filename[256];
+    if (!readFilename("Enter file to import (.csv or .vcf): ", filename, sizeof(filename))) {
+        return;
+    }
+
+    ImportRequest request = {.filename = filename};
+    if (!contactSharedReplace(&contacts, importIntoStore, &request)) {
+        return;
+    }
+    const ContactIoStats stats = request.stats;
+    printf("Imported %zu of %zu records (%zu duplicates, %zu invalid) in %.2f s, %.0f records/s\n",
+           stats.imported, stats.records, stats.duplicates, stats.invalid,
+           stats.seconds, stats.recordsPerSecond);
+}
+
+void exportContactsMenu(void) {
+    char filename[256];
+    if (!readFilename("Enter file to export to (.csv or .vcf): ", filename, sizeof(filename))) {
+        return;
+    }
+
+    ContactIoStats stats;
+    ContactReadToken token;
+    const ContactStore *store = contactReadBegin(&contacts, &token);
+    bool exported = exportContacts(store, filename, contactFormatForFile(filename), &stats);
+    contactReadEnd(&contacts, &token);
+    if (!exported) {
+        return;
+    }
+    printf("Exported %zu contacts to %s in %.2f s, %.0f records/s\n",
+           stats.records, filename, stats.seconds, stats.recordsPerSecond);
+}
+
 void startServerMenu(void) {
     int port;
     printf("Enter port number (default %d): ", DEFAULT_PORT);
@@ -262,7 +657,25 @@ void startServerMenu(void) {
         }
     }
 
-    startServer(port);
+    startServer(port, &contacts);
+}
+
+typedef struct {
+    const char *serverIP;
+    int port;
+} SyncRequest;
+
+static bool syncIntoStore(ContactStore *store, void *arg) {
+    SyncRequest *request = (SyncRequest *)arg;
+    if (!syncContacts(request->serverIP, request->port, store)) {
+        return false;
+    }
+    // The log holds changes to the list sync just replaced; the snapshot
+    // must take its place before anything new is logged over it
+    if (logEnabled && !contactWalCheckpoint(&contactLog, store)) {
+        contactLog.broken = true;
+    }
+    return true;
 }
 
 void syncWithServerMenu(void) {
@@ -293,13 +706,28 @@ void syncWithServerMenu(void) {
         }
     }
 
-    if (syncContacts(serverIP, port, &contacts)) {
+    // The checkpoint after a sync must not race a background save
+    if (saverEnabled) {
+        contactSaverWait(&saver);
+    }
+    SyncRequest request = {serverIP, port};
+    if (contactSharedReplace(&contacts, syncIntoStore, &request)) {
         printf("Synchronization completed successfully!\n");
     } else {
         printf("Synchronization failed.\n");
     }
 }
 
+static void onSaveComplete(const ContactSaveResult *result, void *userData) {
+    (void)userData;
+    if (result->ok) {
+        printf("\n💾 Saved %zu contacts to %s in %.1f ms (copied in %.2f ms)\n",
+               result->count, result->filename, result->totalMs, result->captureMs);
+    } else {
+        printf("\n❌ Background save to %s failed\n", result->filename);
+    }
+}
+
 void memoryAnalysisMenu(void) {
     size_t totalFree, largestBlock;
     int fragmentCount;
@@ -315,6 +743,42 @@ void memoryAnalysisMenu(void) {
         printf("Fragmentation level: %s\n",
                fragmentCount > 5 ? "High" : fragmentCount > 2 ? "Medium" : "Low");
     }
+
+    ContactBloomStats stats;
+    contactBloomStats(&stats);
+    const ContactStore *store = contactSharedLock(&contacts);
+    const ContactBloom *filter = &store->nameFilter;
+    printf("\n=== Name Filter ===\n");
+    printf("Size: %zu bytes for %zu names (%zu stale), %u hashes per name\n",
+           contactBloomBytes(filter), filter->names, filter->stale, filter->hashes);
+    printf("Expected false positive rate: %.3f%%\n", contactBloomFalsePositiveRate(filter) * 100.0);
+    contactSharedUnlock(&contacts);
+
+    uint64_t misses = stats.skipped + stats.falsePositives;
+    printf("Lookups: %llu, found: %llu\n", (unsigned long long)stats.lookups,
+           (unsigned long long)(stats.lookups - misses));
+    printf("Misses answered by the filter: %llu of %llu (%.1f%%), false positives: %llu\n",
+           (unsigned long long)stats.skipped, (unsigned long long)misses,
+           misses ? 100.0 * (double)stats.skipped / (double)misses : 0.0,
+           (unsigned long long)stats.falsePositives);
+}
+
+static bool recoverIntoStore(ContactStore *store, void *arg) {
+    (void)arg;
+    logEnabled = contactWalRecover(&contactLog, store, CONTACTS_FILE, CONTACTS_LOG_FILE);
+    // A log reopened by a sync goes back to the running flusher
+    if (flusherEnabled) {
+        contactWalFlusherAttach(&flusher);
+    }
+    return logEnabled;
+}
+
+static bool reloadIntoStore(ContactStore *store, void *arg) {
+    if (logEnabled) {
+        contactWalClose(&contactLog, store);
+    }
+    freeContacts(store);
+    return recoverIntoStore(store, arg);
 }
 
 int main(void) {
@@ -322,34 +786,46 @@ int main(void) {
     signal(SIGTERM, signalHandler);
 
     initializeMemory();
-    loadContacts(&contacts, CONTACTS_FILE);
+    contactSharedInit(&contacts);
+    // Only the file's index is read now; contacts come in as they are used
+    contactLazySetEnabled(true);
+    contactSharedReplace(&contacts, recoverIntoStore, NULL);
+    // Appends run under the write lock, from this thread and the server's
+    flusherEnabled = contactWalFlusherStart(&flusher, &contactLog, &contacts.writeLock);
+    saverEnabled = contactSaverStart(&saver);
 
     printf("EchoNull Contact Manager started!\n");
-    printf("Loaded %d contacts from %s\n",
-           contacts ? 1 : 0, CONTACTS_FILE);
+    printf("Loaded %zu contacts from %s\n",
+           contactSharedCount(&contacts), CONTACTS_FILE);
 
     int choice;
     while (running) {
         printMenu();
 
         if (scanf("%d", &choice) != 1) {
-            printf("Invalid input. Please enter a number between 0 and 10.\n");
+            printf("Invalid input. Please enter a number between 0 and %d.\n", MAX_MENU_CHOICE);
             clearInputBuffer();
             continue;
         }
         clearInputBuffer();
 
-        if (choice < 0 || choice > 10) {
-            printf("Invalid choice. Please enter a number between 0 and 10.\n");
+        if (choice < 0 || choice > MAX_MENU_CHOICE) {
+            printf("Invalid choice. Please enter a number between 0 and %d.\n", MAX_MENU_CHOICE);
             continue;
         }
 
+        // Adding a contact faults in only the part of the file its name
+        // falls in; every other action on the list needs all of it
+        if (choice != 0 && choice != 1 && choice != 6 && choice != 10) {
+            contactSharedLoadAll(&contacts);
+        }
+
         switch (choice) {
             case 1:
                 addContactMenu();
                 break;
             case 2:
-                displayContacts(contacts);
+                displayAllContacts();
                 break;
             case 3:
                 updateContactMenu();
@@ -357,12 +833,30 @@ int main(void) {
             case 4:
                 deleteContactMenu();
                 break;
-            case 5:
-                saveContacts(contacts, CONTACTS_FILE);
+            case 5: {
+                // Copied as of a snapshot, so writers carry on meanwhile
+                if (saverEnabled && saveSharedContactsAsync(&saver, &contacts, CONTACTS_FILE, onSaveComplete, NULL)) {
+                    printf("Saving contacts in the background...\n");
+                    break;
+                }
+                const ContactStore *store = contactSharedLock(&contacts);
+                if (saverEnabled && saveContactsAsync(&saver, store, CONTACTS_FILE, onSaveComplete, NULL)) {
+                    printf("Saving %zu contacts in the background...\n", store->count);
+                } else if (logEnabled && contactWalCheckpoint(&contactLog, store)) {
+                    printf("Saved %zu contacts to %s\n", store->count, CONTACTS_FILE);
+                } else if (!logEnabled) {
+                    saveContacts(store, CONTACTS_FILE);
+                }
+                contactSharedUnlock(&contacts);
                 break;
+            }
             case 6:
-                freeContacts(&contacts);
-                loadContacts(&contacts, CONTACTS_FILE);
+                if (saverEnabled) {
+                    contactSaverWait(&saver);
+                }
+                // Clients of a running server read the whole list
+                contactLazySetEnabled(!isServerRunning());
+                contactSharedReplace(&contacts, reloadIntoStore, NULL);
                 printf("Contacts reloaded from file.\n");
                 break;
             case 7:
@@ -377,17 +871,83 @@ int main(void) {
             case 10:
                 visualizeMemory();
                 break;
+            case 11:
+                searchContactsMenu();
+                break;
+            case 12:
+                importContactsMenu();
+                break;
+            case 13:
+                exportContactsMenu();
+                break;
+            case 14:
+                sortedContactsMenu();
+                break;
+            case 15:
+                findDuplicatesMenu();
+                break;
+            case 16:
+                queryContactsMenu();
+                break;
+            case 17:
+                tagContactsMenu();
+                break;
             case 0:
                 running = false;
                 break;
             default:
                 printf("Invalid choice. Please try again.\n");
         }
+
+        if (logEnabled) {
+            // Server threads append to the log under the same lock
+            const ContactStore *store = contactSharedLock(&contacts);
+            // A broken log is repaired by checkpointing the whole list
+            if (contactLog.broken || contactLog.logged >= contactLog.checkpointRecords) {
+                // Loading takes the lock itself; maintenance re-checks once it is back
+                contactSharedUnlock(&contacts);
+                contactSharedLoadAll(&contacts);
+                store = contactSharedLock(&contacts);
+                // A checkpoint must not race a background save of the same file
+                if (saverEnabled) {
+                    contactSaverWait(&saver);
+                }
+            }
+            contactWalMaintain(&contactLog, store);
+            bool broken = contactLog.broken;
+            contactSharedUnlock(&contacts);
+            if (broken) {
+                printf("Warning: changes are not being logged and will be lost on a crash until contacts are saved.\n");
+            }
+        }
+    }
+
+    if (saverEnabled) {
+        ContactSaveStats stats;
+        contactSaverStop(&saver);
+        contactSaverStats(&saver, &stats);
+        if (stats.saves > 0) {
+            printf("Background saves: %zu (avg %.1f ms, max %.1f ms, max pause %.2f ms)\n",
+                   stats.saves, stats.totalMs / stats.saves, stats.maxMs, stats.maxCaptureMs);
+        }
     }
 
-    saveContacts(contacts, CONTACTS_FILE);
-    freeContacts(&contacts);
+    // Stop serving clients before the store they share is freed
     stopServer();
+    if (flusherEnabled) {
+        contactWalFlusherStop(&flusher);
+    }
+
+    contactSharedLoadAll(&contacts);
+    const ContactStore *store = contactSharedLock(&contacts);
+    if (logEnabled) {
+        contactWalCheckpoint(&contactLog, store);
+        contactWalClose(&contactLog, NULL);
+    } else {
+        saveContacts(store, CONTACTS_FILE);
+    }
+    contactSharedUnlock(&contacts);
+    contactSharedFree(&contacts);
 
     printf("Goodbye!\n");
     return 0;
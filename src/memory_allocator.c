@@ -1,146 +1,329 @@
+#define _DEFAULT_SOURCE 1
+
 #include "../include/memory_allocator.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MEMORY_ARENA_SIZE (64 * 1024)
+#define MEMORY_ARENA_MAX_SIZE (4 * 1024 * 1024)
+#define ALIGNMENT 16
+
+#define ARENA_HEADER alignSize(sizeof(MemoryArena))
+#define BLOCK_HEADER alignSize(sizeof(MemoryBlock))
+// Larger requests could overflow the arena size computation
+#define MEMORY_MAX_REQUEST (SIZE_MAX / 2)
 
-#define MEMORY_POOL_SIZE 4096
-#define ALIGNMENT 8
+// Free blocks keep their free-list links in their data bytes, which is why
+// no block holds less than ALIGNMENT bytes
+typedef struct {
+    MemoryBlock *prev;
+    MemoryBlock *next;
+} FreeLinks;
 
-static char memoryPool[MEMORY_POOL_SIZE];
-static MemoryBlock *head = NULL;
+static MemoryArena *arenas = NULL;      // in mapping order
+static MemoryArena *lastFreed = NULL;   // checked first when freeing
+static MemoryArena *lastUsed = NULL;    // tried first when allocating
+static size_t arenaCount = 0;
 static bool initialized = false;
+static pthread_mutex_t memoryLock = PTHREAD_MUTEX_INITIALIZER;
 
 static size_t alignSize(size_t size) {
-    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    return (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
 }
 
-void initializeMemory(void) {
-    if (initialized) {
-        return;
-    }
+static MemoryBlock *firstBlock(MemoryArena *arena) {
+    return (MemoryBlock *)((char *)arena + ARENA_HEADER);
+}
 
-    head = (MemoryBlock *)memoryPool;
-    head->size = MEMORY_POOL_SIZE - sizeof(MemoryBlock);
-    head->free = true;
-    head->next = NULL;
+static FreeLinks *freeLinks(MemoryBlock *block) {
+    return (FreeLinks *)((char *)block + BLOCK_HEADER);
+}
 
-    initialized = true;
-    printf("Memory allocator initialized with %d bytes\n", MEMORY_POOL_SIZE);
+static void pushFree(MemoryArena *arena, MemoryBlock *block) {
+    block->free = true;
+    freeLinks(block)->prev = NULL;
+    freeLinks(block)->next = arena->freeList;
+    if (arena->freeList != NULL) {
+        freeLinks(arena->freeList)->prev = block;
+    }
+    arena->freeList = block;
+    if (block->size > arena->largestFree) {
+        arena->largestFree = block->size;
+    }
 }
 
-void *myMalloc(size_t size) {
-    if (!initialized) {
-        initializeMemory();
+static void unlinkFree(MemoryArena *arena, MemoryBlock *block) {
+    FreeLinks *links = freeLinks(block);
+    if (links->prev != NULL) {
+        freeLinks(links->prev)->next = links->next;
+    } else {
+        arena->freeList = links->next;
+    }
+    if (links->next != NULL) {
+        freeLinks(links->next)->prev = links->prev;
+    }
+    block->free = false;
+}
+
+// Maps an arena with room for a block of size data bytes. Each arena mapped
+// while others are in use is twice the size of the last, up to the cap, so
+// large heaps take few arenas and small ones stay small.
+static MemoryArena *mapArena(size_t size) {
+    size_t bytes = MEMORY_ARENA_SIZE;
+    for (size_t i = 0; i < arenaCount && bytes < MEMORY_ARENA_MAX_SIZE; i++) {
+        bytes *= 2;
+    }
+    size_t needed = ARENA_HEADER + BLOCK_HEADER + size;
+    if (needed > bytes) {
+        long page = sysconf(_SC_PAGESIZE);
+        size_t pageSize = page > 0 ? (size_t)page : 4096;
+        bytes = (needed + pageSize - 1) / pageSize * pageSize;
     }
 
-    if (size == 0) {
+    void *region = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        perror("Failed to map memory arena");
         return NULL;
     }
 
-    size = alignSize(size);
-    MemoryBlock *current = head;
-
-    while (current != NULL) {
-        if (current->free && current->size >= size) {
-            if (current->size > size + sizeof(MemoryBlock) + ALIGNMENT) {
-                MemoryBlock *newBlock = (MemoryBlock *)((char *)current + sizeof(MemoryBlock) + size);
-                newBlock->size = current->size - size - sizeof(MemoryBlock);
-                newBlock->free = true;
-                newBlock->next = current->next;
-
-                current->size = size;
-                current->next = newBlock;
-            }
+    MemoryArena *arena = (MemoryArena *)region;
+    arena->size = bytes;
+    arena->largestFree = 0;
+    arena->freeList = NULL;
+    arena->next = NULL;
+    MemoryBlock *block = firstBlock(arena);
+    block->size = bytes - ARENA_HEADER - BLOCK_HEADER;
+    block->prev = NULL;
+    block->next = NULL;
+    pushFree(arena, block);
 
-            current->free = false;
-            return (char *)current + sizeof(MemoryBlock);
-        }
-        current = current->next;
+    MemoryArena **tail = &arenas;
+    while (*tail != NULL) {
+        tail = &(*tail)->next;
+    }
+    *tail = arena;
+    arenaCount++;
+    return arena;
+}
+
+static void releaseArena(MemoryArena *arena) {
+    MemoryArena **link = &arenas;
+    while (*link != arena) {
+        link = &(*link)->next;
+    }
+    *link = arena->next;
+    arenaCount--;
+    if (lastFreed == arena) {
+        lastFreed = NULL;
+    }
+    if (lastUsed == arena) {
+        lastUsed = NULL;
     }
+    munmap(arena, arena->size);
+}
+
+// First fit over the arena's free blocks. A miss records the largest free
+// block actually there, so the arena is skipped for requests it cannot hold.
+static void *allocateFrom(MemoryArena *arena, size_t size) {
+    size_t largest = 0;
+    for (MemoryBlock *block = arena->freeList; block != NULL; block = freeLinks(block)->next) {
+        if (block->size < size) {
+            largest = block->size > largest ? block->size : largest;
+            continue;
+        }
 
+        unlinkFree(arena, block);
+        if (block->size >= size + BLOCK_HEADER + ALIGNMENT) {
+            MemoryBlock *rest = (MemoryBlock *)((char *)block + BLOCK_HEADER + size);
+            rest->size = block->size - size - BLOCK_HEADER;
+            rest->prev = block;
+            rest->next = block->next;
+            if (rest->next != NULL) {
+                rest->next->prev = rest;
+            }
+            block->size = size;
+            block->next = rest;
+            pushFree(arena, rest);
+        }
+        return (char *)block + BLOCK_HEADER;
+    }
+    arena->largestFree = largest;
     return NULL;
 }
 
-void myFree(void *ptr) {
-    if (ptr == NULL || !initialized) {
+// The arena ptr was handed out from, NULL for pointers not from myMalloc
+static MemoryArena *arenaOf(const void *ptr) {
+    const char *p = (const char *)ptr;
+    MemoryArena *arena = lastFreed;
+    if (arena == NULL || p < (char *)arena + ARENA_HEADER + BLOCK_HEADER || p >= (char *)arena + arena->size) {
+        for (arena = arenas; arena != NULL; arena = arena->next) {
+            if (p >= (char *)arena + ARENA_HEADER + BLOCK_HEADER && p < (char *)arena + arena->size) {
+                break;
+            }
+        }
+    }
+    lastFreed = arena != NULL ? arena : lastFreed;
+    return arena;
+}
+
+// Caller holds memoryLock
+static void initializeLocked(void) {
+    if (initialized || mapArena(0) == NULL) {
         return;
     }
+    initialized = true;
+    printf("Memory allocator initialized with %zu bytes\n", arenas->size);
+}
+
+void initializeMemory(void) {
+    pthread_mutex_lock(&memoryLock);
+    initializeLocked();
+    pthread_mutex_unlock(&memoryLock);
+}
+
+void *myMalloc(size_t size) {
+    if (size == 0 || size > MEMORY_MAX_REQUEST) {
+        return NULL;
+    }
+    size = alignSize(size);
 
-    MemoryBlock *block = (MemoryBlock *)((char *)ptr - sizeof(MemoryBlock));
+    pthread_mutex_lock(&memoryLock);
+    initializeLocked();
+    // Runs of allocations keep coming from one arena instead of walking
+    // past every full one before it
+    MemoryArena *arena = lastUsed;
+    void *data = NULL;
+    if (arena != NULL && arena->largestFree >= size) {
+        data = allocateFrom(arena, size);
+    }
+    for (arena = arenas; arena != NULL && data == NULL; arena = arena->next) {
+        if (arena->largestFree >= size && (data = allocateFrom(arena, size)) != NULL) {
+            lastUsed = arena;
+        }
+    }
+    if (data == NULL && (arena = mapArena(size)) != NULL) {
+        data = allocateFrom(arena, size);
+        lastUsed = arena;
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return data;
+}
 
-    if (block < (MemoryBlock *)memoryPool ||
-        (char *)block >= memoryPool + MEMORY_POOL_SIZE) {
+void myFree(void *ptr) {
+    if (ptr == NULL) {
         return;
     }
 
-    block->free = true;
+    pthread_mutex_lock(&memoryLock);
+    MemoryArena *arena = arenaOf(ptr);
+    MemoryBlock *block = (MemoryBlock *)((char *)ptr - BLOCK_HEADER);
+    if (arena == NULL || block->free) {
+        pthread_mutex_unlock(&memoryLock);
+        return;
+    }
 
-    MemoryBlock *current = head;
-    while (current != NULL && current->next != NULL) {
-        if (current->free && current->next->free) {
-            current->size += current->next->size + sizeof(MemoryBlock);
-            current->next = current->next->next;
-        } else {
-            current = current->next;
+    // Merge with free neighbours, so free blocks never sit side by side
+    MemoryBlock *next = block->next;
+    if (next != NULL && next->free) {
+        unlinkFree(arena, next);
+        block->size += BLOCK_HEADER + next->size;
+        block->next = next->next;
+        if (block->next != NULL) {
+            block->next->prev = block;
         }
     }
+    MemoryBlock *prev = block->prev;
+    if (prev != NULL && prev->free) {
+        unlinkFree(arena, prev);
+        prev->size += BLOCK_HEADER + block->size;
+        prev->next = block->next;
+        if (prev->next != NULL) {
+            prev->next->prev = prev;
+        }
+        block = prev;
+    }
+
+    if (block->prev == NULL && block->next == NULL && arena != arenas) {
+        releaseArena(arena);
+    } else {
+        pushFree(arena, block);
+    }
+    pthread_mutex_unlock(&memoryLock);
 }
 
 void visualizeMemory(void) {
+    pthread_mutex_lock(&memoryLock);
     if (!initialized) {
+        pthread_mutex_unlock(&memoryLock);
         printf("Memory allocator not initialized\n");
         return;
     }
 
     printf("\n=== Memory Visualization ===\n");
-    MemoryBlock *current = head;
+    int arenaNum = 1;
     int blockNum = 1;
     size_t usedSpace = 0;
     size_t freeSpace = 0;
+    size_t largestFree = 0;
+    size_t totalSpace = 0;
 
-    while (current != NULL) {
-        char status = current->free ? 'F' : 'U';
-        size_t totalSize = current->size + sizeof(MemoryBlock);
+    for (MemoryArena *arena = arenas; arena != NULL; arena = arena->next) {
+        printf("Arena %d: %zu bytes mapped\n", arenaNum++, arena->size);
+        totalSpace += arena->size;
+        for (MemoryBlock *current = firstBlock(arena); current != NULL; current = current->next) {
+            char status = current->free ? 'F' : 'U';
+            size_t totalSize = current->size + BLOCK_HEADER;
 
-        printf("Block %d: %c (Size: %zu bytes, Data: %zu bytes)\n",
-               blockNum++, status, totalSize, current->size);
+            printf("Block %d: %c (Size: %zu bytes, Data: %zu bytes)\n",
+                   blockNum++, status, totalSize, current->size);
 
-        if (current->free) {
-            freeSpace += current->size;
-        } else {
-            usedSpace += current->size;
+            if (current->free) {
+                freeSpace += current->size;
+                largestFree = current->size > largestFree ? current->size : largestFree;
+            } else {
+                usedSpace += current->size;
+            }
         }
-        current = current->next;
     }
+    pthread_mutex_unlock(&memoryLock);
 
-    printf("\nSummary: Used: %zu bytes, Free: %zu bytes, Total: %d bytes\n",
-           usedSpace, freeSpace, MEMORY_POOL_SIZE);
+    // Headers make up the rest of the total
+    printf("\nSummary: Used: %zu bytes, Free: %zu bytes, Total: %zu bytes in %d arenas\n",
+           usedSpace, freeSpace, totalSpace, arenaNum - 1);
+    // Share of the free space outside the largest free block
     printf("Fragmentation: %.2f%%\n",
-           freeSpace > 0 ? (float)(freeSpace - (freeSpace / (freeSpace / usedSpace + 1))) * 100 / freeSpace : 0);
+           freeSpace > 0 ? (double)(freeSpace - largestFree) * 100 / (double)freeSpace : 0.0);
 }
 
 void analyzeMemory(size_t *totalFree, size_t *largestBlock, int *fragmentCount) {
-    if (!initialized) {
-        *totalFree = 0;
-        *largestBlock = 0;
-        *fragmentCount = 0;
-        return;
-    }
-
     *totalFree = 0;
     *largestBlock = 0;
     *fragmentCount = 0;
 
-    MemoryBlock *current = head;
-    while (current != NULL) {
-        if (current->free) {
+    pthread_mutex_lock(&memoryLock);
+    for (MemoryArena *arena = arenas; arena != NULL; arena = arena->next) {
+        for (MemoryBlock *current = arena->freeList; current != NULL; current = freeLinks(current)->next) {
             *totalFree += current->size;
             (*fragmentCount)++;
             if (current->size > *largestBlock) {
                 *largestBlock = current->size;
             }
         }
-        current = current->next;
     }
-}
\ No newline at end of file
+    pthread_mutex_unlock(&memoryLock);
+}
+
+void memoryArenaStats(size_t *count, size_t *mappedBytes) {
+    pthread_mutex_lock(&memoryLock);
+    *count = arenaCount;
+    *mappedBytes = 0;
+    for (MemoryArena *arena = arenas; arena != NULL; arena = arena->next) {
+        *mappedBytes += arena->size;
+    }
+    pthread_mutex_unlock(&memoryLock);
+}
@@ -1,4 +1,5 @@
 #include "../include/network_sync.h"
+#include "../include/contact_cursor.h"
 #include "../include/security.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,25 +14,29 @@
 #define MAX_CLIENTS 10
 #define BUFFER_SIZE 4096
 #define DEFAULT_PORT 8080
+#define PAGE_LIMIT 500       // most contacts a GET_PAGE reply carries
+#define SYNC_PAGE_SIZE 100
 
 static int serverSocket = -1;
 static ClientInfo *clients = NULL;
 static pthread_mutex_t clientsMutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_t serverThread;
 static volatile bool serverRunning = false;
+static ContactShared *sharedContacts = NULL;
 
 static void *acceptConnections(void *arg);
 static void *clientHandler(void *arg);
 static void broadcastToClients(const char *message, int senderSocket);
 static void addClient(int socket, struct sockaddr_in address);
 static void removeClient(int socket);
-static void handleClientCommand(int clientSocket, const char *command, ContactNode **serverContacts);
+static void handleClientCommand(int clientSocket, const char *command);
 
-void startServer(int port) {
+void startServer(int port, ContactShared *contacts) {
     if (serverRunning) {
         printf("Server is already running on port %d\n", port);
         return;
     }
+    sharedContacts = contacts;
 
     serverSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (serverSocket < 0) {
@@ -111,7 +116,6 @@ void *acceptConnections(void *arg) {
 void *clientHandler(void *arg) {
     int clientSocket = *(int *)arg;
     char buffer[BUFFER_SIZE];
-    ContactNode *serverContacts = NULL;
 
     while (serverRunning) {
         ssize_t bytesRead = recv(clientSocket, buffer, BUFFER_SIZE - 1, 0);
@@ -124,8 +128,9 @@ void *clientHandler(void *arg) {
 
         char decrypted[BUFFER_SIZE];
         decryptData(buffer, decrypted, bytesRead);
+        decrypted[bytesRead] = '\0';
 
-        handleClientCommand(clientSocket, decrypted, &serverContacts);
+        handleClientCommand(clientSocket, decrypted);
     }
 
     removeClient(clientSocket);
@@ -134,7 +139,58 @@ void *clientHandler(void *arg) {
     return NULL;
 }
 
-void handleClientCommand(int clientSocket, const char *command, ContactNode **serverContacts) {
+// GET_PAGE:<limit>:<token> answers PAGE:<token>;<contacts> while more
+// remain and LAST:<token>;<contacts> for the final page. An empty token
+// starts at the first name; the returned one resumes after this page.
+static void buildPage(const char *request, char *response, size_t size) {
+    unsigned limit;
+    int offset = 0;
+    ContactCursor cursor;
+    if (sscanf(request, "%u:%n", &limit, &offset) != 1 || offset == 0) {
+        snprintf(response, size, "Invalid page request");
+        return;
+    }
+    const char *start = request + offset;
+    if (*start == '\0') {
+        contactCursorInit(&cursor, CONTACT_ORDER_NAME);
+    } else if (!contactCursorDecode(&cursor, start)) {
+        snprintf(response, size, "Invalid page token");
+        return;
+    }
+    if (limit == 0 || limit > PAGE_LIMIT) {
+        limit = PAGE_LIMIT;
+    }
+
+    char entries[BUFFER_SIZE - CONTACT_CURSOR_TOKEN_SIZE - 8] = "";
+    size_t used = 0;
+    ContactReadToken token;
+    const ContactStore *view = contactReadBegin(sharedContacts, &token);
+    for (unsigned sent = 0; sent < limit; sent++) {
+        // One contact at a time, so the cursor only moves past contacts
+        // that fit in the reply
+        ContactCursor next = cursor;
+        Contact contact;
+        if (contactPage(view, &next, &contact, 1) == 0) {
+            cursor.done = true;
+            break;
+        }
+        int length = snprintf(entries + used, sizeof(entries) - used, "%s,%s,%s|",
+                              contact.name, contact.phone, contact.email);
+        if (length < 0 || (size_t)length >= sizeof(entries) - used) {
+            entries[used] = '\0';
+            break;
+        }
+        used += (size_t)length;
+        cursor = next;
+    }
+    contactReadEnd(sharedContacts, &token);
+
+    char resume[CONTACT_CURSOR_TOKEN_SIZE];
+    contactCursorEncode(&cursor, resume, sizeof(resume));
+    snprintf(response, size, "%s:%s;%s", cursor.done ? "LAST" : "PAGE", resume, entries);
+}
+
+void handleClientCommand(int clientSocket, const char *command) {
     char response[BUFFER_SIZE];
     memset(response, 0, sizeof(response));
 
@@ -142,22 +198,32 @@ void handleClientCommand(int clientSocket, const char *command, ContactNode **se
         Contact newContact;
         if (sscanf(command + 12, "%49[^,],%19[^,],%49s",
                    newContact.name, newContact.phone, newContact.email) == 3) {
-            addContact(serverContacts, &newContact);
+            contactSharedAdd(sharedContacts, &newContact);
             snprintf(response, sizeof(response), "Contact added: %s", newContact.name);
         } else {
             strcpy(response, "Invalid contact format");
         }
     } else if (strncmp(command, "GET_CONTACTS", 12) == 0) {
         char tempBuffer[BUFFER_SIZE - 100] = "";
-        const ContactNode *current = *serverContacts;
-        while (current != NULL) {
-            char contactStr[200];
-            snprintf(contactStr, sizeof(contactStr), "%s,%s,%s|",
-                     current->contact.name, current->contact.phone, current->contact.email);
-            strcat(tempBuffer, contactStr);
-            current = current->next;
+        ContactIterator it;
+        const Contact *current;
+        ContactReadToken token;
+        contactIteratorInit(&it, contactReadBegin(sharedContacts, &token));
+        size_t used = 0;
+        while ((current = contactIteratorNext(&it)) != NULL) {
+            // The shared list can outgrow one response; send what fits
+            int length = snprintf(tempBuffer + used, sizeof(tempBuffer) - used, "%s,%s,%s|",
+                                  current->name, current->phone, current->email);
+            if (length < 0 || (size_t)length >= sizeof(tempBuffer) - used) {
+                tempBuffer[used] = '\0';
+                break;
+            }
+            used += (size_t)length;
         }
+        contactReadEnd(sharedContacts, &token);
         snprintf(response, sizeof(response), "CONTACTS:%s", tempBuffer);
+    } else if (strncmp(command, "GET_PAGE:", 9) == 0) {
+        buildPage(command + 9, response, sizeof(response));
     } else if (strncmp(command, "SYNC:", 5) == 0) {
         snprintf(response, sizeof(response), "SYNC_READY");
     } else {
@@ -165,11 +231,91 @@ void handleClientCommand(int clientSocket, const char *command, ContactNode **se
     }
 
     char encryptedResponse[BUFFER_SIZE];
-    encryptData(response, encryptedResponse, strlen(response));
-    send(clientSocket, encryptedResponse, strlen(encryptedResponse), 0);
+    // Ciphertext can hold zero bytes, so its length is the plaintext's
+    size_t length = strlen(response);
+    encryptData(response, encryptedResponse, length);
+    send(clientSocket, encryptedResponse, length, 0);
+}
+
+// Sends request and reads the server's decrypted reply into reply
+static bool exchange(int sock, const char *request, char *reply) {
+    char encrypted[BUFFER_SIZE];
+    size_t length = strlen(request);
+    encryptData(request, encrypted, length);
+    send(sock, encrypted, length, 0);
+
+    char buffer[BUFFER_SIZE];
+    ssize_t bytesRead = recv(sock, buffer, BUFFER_SIZE - 1, 0);
+    if (bytesRead <= 0) {
+        return false;
+    }
+    buffer[bytesRead] = '\0';
+    decryptData(buffer, reply, bytesRead);
+    reply[bytesRead] = '\0';
+    return true;
 }
 
-bool syncContacts(const char *serverIP, int port, ContactNode **localContacts) {
+static void decodeContacts(char *data, ContactStore *store) {
+    char *contact = strtok(data, "|");
+    while (contact != NULL) {
+        Contact newContact;
+        if (sscanf(contact, "%49[^,],%19[^,],%49s",
+                   newContact.name, newContact.phone, newContact.email) == 3) {
+            addContact(store, &newContact);
+        }
+        contact = strtok(NULL, "|");
+    }
+}
+
+// Pulls the server's contacts a page at a time into a scratch store, which
+// replaces the local list only once the last page is in. A server without
+// paging sends the whole list in one GET_CONTACTS reply instead.
+static bool fetchPages(int sock, ContactStore *localContacts) {
+    ContactStore pages = {0};
+    char token[CONTACT_CURSOR_TOKEN_SIZE] = "";
+    bool first = true;
+    bool last = false;
+    bool ok = true;
+
+    while (ok && !last) {
+        char request[BUFFER_SIZE];
+        char reply[BUFFER_SIZE];
+        snprintf(request, sizeof(request), "GET_PAGE:%d:%s", SYNC_PAGE_SIZE, token);
+        if (!exchange(sock, request, reply)) {
+            ok = false;
+            break;
+        }
+
+        if (first && strcmp(reply, "Unknown command") == 0) {
+            ok = exchange(sock, "GET_CONTACTS", reply) && strncmp(reply, "CONTACTS:", 9) == 0;
+            if (ok) {
+                decodeContacts(reply + 9, &pages);
+            }
+            break;
+        }
+        first = false;
+
+        char *separator = strchr(reply, ';');
+        if ((strncmp(reply, "PAGE:", 5) != 0 && strncmp(reply, "LAST:", 5) != 0) ||
+            separator == NULL || (size_t)(separator - reply - 5) >= sizeof(token)) {
+            ok = false;
+            break;
+        }
+        last = reply[0] == 'L';
+        *separator = '\0';
+        strcpy(token, reply + 5);
+        decodeContacts(separator + 1, &pages);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Server sent an incomplete contact list; keeping the local one\n");
+    }
+    ok = ok && replaceContacts(localContacts, &pages);
+    freeContacts(&pages);
+    return ok;
+}
+
+bool syncContacts(const char *serverIP, int port, ContactStore *localContacts) {
     int sock = socket(AF_INET, SOCK_STREAM, 0);
     if (sock < 0) {
         perror("Failed to create client socket");
@@ -199,44 +345,26 @@ bool syncContacts(const char *serverIP, int port, ContactNode **localContacts) {
     strcpy(buffer, "SYNC:");
     char encrypted[BUFFER_SIZE];
     encryptData(buffer, encrypted, strlen(buffer));
-    send(sock, encrypted, strlen(encrypted), 0);
+    send(sock, encrypted, strlen(buffer), 0);
 
+    bool synced = false;
     ssize_t bytesRead = recv(sock, buffer, BUFFER_SIZE - 1, 0);
     if (bytesRead > 0) {
         buffer[bytesRead] = '\0';
         char decrypted[BUFFER_SIZE];
         decryptData(buffer, decrypted, bytesRead);
+        decrypted[bytesRead] = '\0';
 
         if (strcmp(decrypted, "SYNC_READY") == 0) {
-            strcpy(buffer, "GET_CONTACTS");
-            encryptData(buffer, encrypted, strlen(buffer));
-            send(sock, encrypted, strlen(encrypted), 0);
-
-            bytesRead = recv(sock, buffer, BUFFER_SIZE - 1, 0);
-            if (bytesRead > 0) {
-                buffer[bytesRead] = '\0';
-                decryptData(buffer, decrypted, bytesRead);
-
-                if (strncmp(decrypted, "CONTACTS:", 9) == 0) {
-                    freeContacts(localContacts);
-                    char *contactsData = decrypted + 9;
-                    char *contact = strtok(contactsData, "|");
-                    while (contact != NULL) {
-                        Contact newContact;
-                        if (sscanf(contact, "%49[^,],%19[^,],%49s",
-                                   newContact.name, newContact.phone, newContact.email) == 3) {
-                            addContact(localContacts, &newContact);
-                        }
-                        contact = strtok(NULL, "|");
-                    }
-                }
-            }
+            synced = fetchPages(sock, localContacts);
         }
     }
 
     close(sock);
-    printf("Synchronization completed\n");
-    return true;
+    if (synced) {
+        printf("Synchronization completed\n");
+    }
+    return synced;
 }
 
 void addClient(int socket, struct sockaddr_in address) {
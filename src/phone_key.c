@@ -0,0 +1,73 @@
+#include "../include/phone_key.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+PhoneKey normalizePhone(const char *phone) {
+    char digits[PHONE_KEY_MAX_DIGITS + 2];
+    size_t count = 0;
+    bool international = false;
+
+    while (isspace((unsigned char)*phone)) {
+        phone++;
+    }
+    if (*phone == '+') {
+        international = true;
+        phone++;
+    }
+
+    for (; *phone != '\0'; phone++) {
+        if (isdigit((unsigned char)*phone)) {
+            if (count == sizeof(digits)) {
+                return PHONE_KEY_NONE;
+            }
+            digits[count++] = *phone;
+        } else if (strchr(" -().", *phone) == NULL) {
+            return PHONE_KEY_NONE;
+        }
+    }
+
+    size_t start = 0;
+    if (!international && count > 2 && digits[0] == '0' && digits[1] == '0') {
+        // 00 international call prefix
+        start = 2;
+        international = true;
+    }
+
+    PhoneKey key = 0;
+    int shift = 60;
+    if (!international && count == PHONE_NATIONAL_DIGITS) {
+        for (const char *cc = PHONE_DEFAULT_COUNTRY_CODE; *cc != '\0'; cc++, shift -= 4) {
+            key |= (PhoneKey)(*cc - '0' + 1) << shift;
+        }
+    }
+
+    if (count == start || (size_t)((60 - shift) / 4) + count - start > PHONE_KEY_MAX_DIGITS) {
+        return PHONE_KEY_NONE;
+    }
+
+    for (size_t i = start; i < count; i++, shift -= 4) {
+        key |= (PhoneKey)(digits[i] - '0' + 1) << shift;
+    }
+    return key;
+}
+
+size_t formatPhoneKey(PhoneKey key, char *out, size_t size) {
+    char buffer[18];
+    size_t len = 0;
+
+    if (key != PHONE_KEY_NONE) {
+        buffer[len++] = '+';
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            unsigned nibble = (unsigned)(key >> shift) & 0xF;
+            if (nibble == 0) {
+                break;
+            }
+            buffer[len++] = (char)('0' + nibble - 1);
+        }
+    }
+    buffer[len] = '\0';
+
+    return (size_t)snprintf(out, size, "%s", buffer);
+}
@@ -0,0 +1,494 @@
+#include "../include/radix_tree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Leaves are the bulk of a tree, so a node is allocated together with its
+// label and keeps a single slot inline: one allocation per new leaf.
+static RadixNode *createNode(const char *label, size_t labelLen) {
+    RadixNode *node = (RadixNode *)calloc(1, sizeof(RadixNode) + labelLen);
+    if (node == NULL) {
+        return NULL;
+    }
+
+    node->label = (char *)(node + 1);
+    memcpy(node->label, label, labelLen);
+    node->labelLen = labelLen;
+    return node;
+}
+
+static bool ownsLabel(const RadixNode *node) {
+    return node->label != (const char *)(node + 1);
+}
+
+static uint32_t *nodeSlots(RadixNode *node) {
+    return node->slotCapacity > 1 ? node->slots : &node->slot;
+}
+
+static const uint32_t *constSlots(const RadixNode *node) {
+    return node->slotCapacity > 1 ? node->slots : &node->slot;
+}
+
+static void freeNode(RadixNode *node) {
+    for (size_t i = 0; i < node->childCount; i++) {
+        freeNode(node->children[i]);
+        free(node->children[i]);
+    }
+    free(node->children);
+    if (node->slotCapacity > 1) {
+        free(node->slots);
+    }
+    if (ownsLabel(node)) {
+        free(node->label);
+    }
+}
+
+// Index of the child whose label starts with c, or of the position where
+// such a child would be inserted (found reports which).
+static size_t findChild(const RadixNode *node, unsigned char c, bool *found) {
+    size_t lo = 0;
+    size_t hi = node->childCount;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        unsigned char first = (unsigned char)node->children[mid]->label[0];
+        if (first == c) {
+            *found = true;
+            return mid;
+        }
+        if (first < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = false;
+    return lo;
+}
+
+static bool insertChild(RadixNode *node, size_t pos, RadixNode *child) {
+    if (node->childCount == node->childCapacity) {
+        size_t newCapacity = node->childCapacity ? node->childCapacity * 2 : 2;
+        RadixNode **newChildren = (RadixNode **)realloc(node->children, newCapacity * sizeof(RadixNode *));
+        if (newChildren == NULL) {
+            return false;
+        }
+        node->children = newChildren;
+        node->childCapacity = newCapacity;
+    }
+
+    memmove(&node->children[pos + 1], &node->children[pos],
+            (node->childCount - pos) * sizeof(RadixNode *));
+    node->children[pos] = child;
+    node->childCount++;
+    return true;
+}
+
+static void removeChild(RadixNode *node, size_t pos) {
+    memmove(&node->children[pos], &node->children[pos + 1],
+            (node->childCount - pos - 1) * sizeof(RadixNode *));
+    node->childCount--;
+}
+
+static bool addSlot(RadixNode *node, uint32_t slot) {
+    if (node->slotCapacity == 0) {
+        node->slotCapacity = 1;
+    }
+    if (node->slotCount == node->slotCapacity) {
+        size_t newCapacity = node->slotCapacity * 2;
+        uint32_t *heap = node->slotCapacity > 1 ? node->slots : NULL;
+        uint32_t *newSlots = (uint32_t *)realloc(heap, newCapacity * sizeof(uint32_t));
+        if (newSlots == NULL) {
+            return false;
+        }
+        if (heap == NULL) {
+            newSlots[0] = node->slot;
+        }
+        node->slots = newSlots;
+        node->slotCapacity = newCapacity;
+    }
+
+    nodeSlots(node)[node->slotCount++] = slot;
+    return true;
+}
+
+static bool removeSlot(RadixNode *node, uint32_t slot) {
+    uint32_t *slots = nodeSlots(node);
+    for (size_t i = 0; i < node->slotCount; i++) {
+        if (slots[i] == slot) {
+            memmove(&slots[i], &slots[i + 1], (node->slotCount - i - 1) * sizeof(uint32_t));
+            node->slotCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Split child so that its label is exactly the first `at` bytes, moving the
+// remainder of the label (and everything below) into a new grandchild.
+static RadixNode *splitChild(RadixNode *parent, size_t pos, size_t at) {
+    RadixNode *child = parent->children[pos];
+    RadixNode *mid = createNode(child->label, at);
+    if (mid == NULL || !insertChild(mid, 0, child)) {
+        if (mid != NULL) {
+            freeNode(mid);
+            free(mid);
+        }
+        return NULL;
+    }
+
+    memmove(child->label, child->label + at, child->labelLen - at);
+    child->labelLen -= at;
+    parent->children[pos] = mid;
+    return mid;
+}
+
+// Fold a slot-less node with a single child into that child's label.
+static bool mergeWithChild(RadixNode *node) {
+    RadixNode *child = node->children[0];
+    char *label = (char *)malloc(node->labelLen + child->labelLen);
+    if (label == NULL) {
+        return false;
+    }
+
+    memcpy(label, node->label, node->labelLen);
+    memcpy(label + node->labelLen, child->label, child->labelLen);
+    if (ownsLabel(node)) {
+        free(node->label);
+    }
+    node->label = label;
+    node->labelLen += child->labelLen;
+
+    free(node->children);
+    if (node->slotCapacity > 1) {
+        free(node->slots);
+    }
+    node->children = child->children;
+    node->childCount = child->childCount;
+    node->childCapacity = child->childCapacity;
+    node->slots = child->slots;
+    node->slot = child->slot;
+    node->slotCount = child->slotCount;
+    node->slotCapacity = child->slotCapacity;
+
+    if (ownsLabel(child)) {
+        free(child->label);
+    }
+    free(child);
+    return true;
+}
+
+bool radixTreeInsert(RadixTree *tree, const char *key, uint32_t slot) {
+    RadixNode *node = &tree->root;
+    size_t keyLen = strlen(key);
+
+    while (keyLen > 0) {
+        bool found;
+        size_t pos = findChild(node, (unsigned char)key[0], &found);
+
+        if (!found) {
+            RadixNode *leaf = createNode(key, keyLen);
+            if (leaf == NULL || !addSlot(leaf, slot) || !insertChild(node, pos, leaf)) {
+                if (leaf != NULL) {
+                    freeNode(leaf);
+                    free(leaf);
+                }
+                return false;
+            }
+            tree->count++;
+            return true;
+        }
+
+        RadixNode *child = node->children[pos];
+        size_t common = 0;
+        while (common < child->labelLen && common < keyLen && child->label[common] == key[common]) {
+            common++;
+        }
+
+        if (common < child->labelLen) {
+            child = splitChild(node, pos, common);
+            if (child == NULL) {
+                return false;
+            }
+        }
+
+        node = child;
+        key += common;
+        keyLen -= common;
+    }
+
+    if (!addSlot(node, slot)) {
+        return false;
+    }
+    tree->count++;
+    return true;
+}
+
+static bool removeFrom(RadixNode *node, const char *key, uint32_t slot) {
+    if (*key == '\0') {
+        return removeSlot(node, slot);
+    }
+
+    bool found;
+    size_t pos = findChild(node, (unsigned char)key[0], &found);
+    if (!found) {
+        return false;
+    }
+
+    RadixNode *child = node->children[pos];
+    if (strncmp(child->label, key, child->labelLen) != 0) {
+        return false;
+    }
+    if (!removeFrom(child, key + child->labelLen, slot)) {
+        return false;
+    }
+
+    // Prune empty leaves and re-compress pass-through nodes
+    if (child->slotCount == 0 && child->childCount == 0) {
+        removeChild(node, pos);
+        freeNode(child);
+        free(child);
+    } else if (child->slotCount == 0 && child->childCount == 1) {
+        mergeWithChild(child);
+    }
+    return true;
+}
+
+bool radixTreeRemove(RadixTree *tree, const char *key, uint32_t slot) {
+    if (!removeFrom(&tree->root, key, slot)) {
+        return false;
+    }
+    tree->count--;
+    return true;
+}
+
+static bool visitSubtree(const RadixNode *node, RadixVisitor visitor, void *userData) {
+    const uint32_t *slots = constSlots(node);
+    for (size_t i = 0; i < node->slotCount; i++) {
+        if (!visitor(slots[i], userData)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < node->childCount; i++) {
+        if (!visitSubtree(node->children[i], visitor, userData)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void radixTreeVisitPrefix(const RadixTree *tree, const char *prefix, RadixVisitor visitor, void *userData) {
+    const RadixNode *node = &tree->root;
+    size_t prefixLen = strlen(prefix);
+
+    while (prefixLen > 0) {
+        bool found;
+        size_t pos = findChild(node, (unsigned char)prefix[0], &found);
+        if (!found) {
+            return;
+        }
+
+        const RadixNode *child = node->children[pos];
+        size_t n = prefixLen < child->labelLen ? prefixLen : child->labelLen;
+        if (memcmp(child->label, prefix, n) != 0) {
+            return;
+        }
+
+        node = child;
+        prefix += n;
+        prefixLen -= n;
+    }
+
+    visitSubtree(node, visitor, userData);
+}
+
+// Order of the path so far against a bound: -1 below it, +1 above it, 0
+// while the path is still a prefix of the bound.
+static int compareLabel(int state, const char *bound, size_t depth, const char *label, size_t len) {
+    if (state != 0) {
+        return state;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char b = (unsigned char)bound[depth + i];
+        if (b == '\0') {
+            return 1;
+        }
+        if ((unsigned char)label[i] != b) {
+            return (unsigned char)label[i] < b ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+typedef struct {
+    const char *from;
+    const char *to;
+    RadixVisitor visitor;
+    void *userData;
+} RangeWalk;
+
+static bool visitRange(const RadixNode *node, size_t depth, int fromState, int toState, const RangeWalk *walk) {
+    if (fromState < 0) {
+        return true;
+    }
+    // Path equal to `to` or above it: nothing further can be in range
+    if (toState > 0 || (toState == 0 && walk->to[depth] == '\0')) {
+        return false;
+    }
+
+    bool aboveFrom = fromState > 0 || walk->from[depth] == '\0';
+    if (aboveFrom) {
+        const uint32_t *slots = constSlots(node);
+        for (size_t i = 0; i < node->slotCount; i++) {
+            if (!walk->visitor(slots[i], walk->userData)) {
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < node->childCount; i++) {
+        const RadixNode *child = node->children[i];
+        int childFrom = compareLabel(fromState, walk->from, depth, child->label, child->labelLen);
+        int childTo = compareLabel(toState, walk->to, depth, child->label, child->labelLen);
+        if (!visitRange(child, depth + child->labelLen, childFrom, childTo, walk)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void radixTreeVisitRange(const RadixTree *tree, const char *from, const char *to, RadixVisitor visitor, void *userData) {
+    RangeWalk walk = {from, to, visitor, userData};
+    visitRange(&tree->root, 0, from != NULL ? 0 : 1, to != NULL ? 0 : -1, &walk);
+}
+
+// Deep-copies everything below src's label into dest, which already holds
+// that label; on failure dest holds a partial copy that freeNode can release.
+static bool copyNode(RadixNode *dest, const RadixNode *src) {
+    if (src->slotCount > 1) {
+        dest->slots = (uint32_t *)malloc(src->slotCount * sizeof(uint32_t));
+        if (dest->slots == NULL) {
+            return false;
+        }
+        memcpy(dest->slots, src->slots, src->slotCount * sizeof(uint32_t));
+    } else {
+        dest->slot = constSlots(src)[0];
+    }
+    dest->slotCount = dest->slotCapacity = src->slotCount;
+
+    if (src->childCount > 0) {
+        dest->children = (RadixNode **)malloc(src->childCount * sizeof(RadixNode *));
+        if (dest->children == NULL) {
+            return false;
+        }
+        dest->childCapacity = src->childCount;
+        for (size_t i = 0; i < src->childCount; i++) {
+            const RadixNode *from = src->children[i];
+            RadixNode *child = createNode(from->label, from->labelLen);
+            if (child == NULL) {
+                return false;
+            }
+            dest->children[dest->childCount++] = child;
+            if (!copyNode(child, from)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool radixTreeCopy(RadixTree *dest, const RadixTree *src) {
+    memset(dest, 0, sizeof(*dest));
+    if (!copyNode(&dest->root, &src->root)) {
+        radixTreeFree(dest);
+        return false;
+    }
+    dest->count = src->count;
+    return true;
+}
+
+static void shiftSlots(RadixNode *node, uint32_t offset) {
+    uint32_t *slots = nodeSlots(node);
+    for (size_t i = 0; i < node->slotCount; i++) {
+        slots[i] += offset;
+    }
+    for (size_t i = 0; i < node->childCount; i++) {
+        shiftSlots(node->children[i], offset);
+    }
+}
+
+static bool mergeNodes(RadixNode *dest, RadixNode *src, uint32_t offset);
+
+// Puts child, and everything below it, under parent, merging it with the
+// child that shares its first byte. Takes ownership of child either way.
+static bool mergeChild(RadixNode *parent, RadixNode *child, uint32_t offset) {
+    bool found;
+    size_t pos = findChild(parent, (unsigned char)child->label[0], &found);
+    if (!found) {
+        shiftSlots(child, offset);
+        if (!insertChild(parent, pos, child)) {
+            freeNode(child);
+            free(child);
+            return false;
+        }
+        return true;
+    }
+
+    RadixNode *existing = parent->children[pos];
+    size_t common = 0;
+    while (common < existing->labelLen && common < child->labelLen && existing->label[common] == child->label[common]) {
+        common++;
+    }
+    if (common < existing->labelLen) {
+        existing = splitChild(parent, pos, common);
+        if (existing == NULL) {
+            freeNode(child);
+            free(child);
+            return false;
+        }
+    }
+    if (common < child->labelLen) {
+        memmove(child->label, child->label + common, child->labelLen - common);
+        child->labelLen -= common;
+        return mergeChild(existing, child, offset);
+    }
+
+    bool merged = mergeNodes(existing, child, offset);
+    freeNode(child);
+    free(child);
+    return merged;
+}
+
+// Moves src's slots, after dest's, and children into dest, which stands for
+// the same key. src is left without children.
+static bool mergeNodes(RadixNode *dest, RadixNode *src, uint32_t offset) {
+    const uint32_t *slots = constSlots(src);
+    bool merged = true;
+    for (size_t i = 0; i < src->slotCount && merged; i++) {
+        merged = addSlot(dest, slots[i] + offset);
+    }
+    for (size_t i = 0; i < src->childCount; i++) {
+        if (merged) {
+            merged = mergeChild(dest, src->children[i], offset);
+        } else {
+            freeNode(src->children[i]);
+            free(src->children[i]);
+        }
+    }
+    src->childCount = 0;
+    return merged;
+}
+
+bool radixTreeMerge(RadixTree *dest, RadixTree *src, uint32_t offset) {
+    size_t count = src->count;
+    bool merged = mergeNodes(&dest->root, &src->root, offset);
+    radixTreeFree(src);
+    if (merged) {
+        dest->count += count;
+    }
+    return merged;
+}
+
+void radixTreeFree(RadixTree *tree) {
+    freeNode(&tree->root);
+    memset(tree, 0, sizeof(*tree));
+}
@@ -12,4 +12,22 @@ void encryptData(const char *input, char *output, size_t length) {
 
 void decryptData(const char *input, char *output, size_t length) {
     encryptData(input, output, length);
+}
+
+uint32_t checksumData(uint32_t crc, const void *data, size_t length) {
+    // CRC-32 (IEEE), one nibble at a time
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xF] ^ (crc >> 4);
+        crc = table[(crc ^ (bytes[i] >> 4)) & 0xF] ^ (crc >> 4);
+    }
+    return ~crc;
 }
\ No newline at end of file
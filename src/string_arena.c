@@ -0,0 +1,260 @@
+#include "../include/string_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POOL_INITIAL_CAPACITY 16
+
+uint32_t stringArenaAlloc(StringArena *arena, size_t size) {
+    if (size == 0 || size > STRING_ARENA_CHUNK_SIZE) {
+        return STRING_REF_NONE;
+    }
+
+    if (arena->chunkCount == 0 || arena->used + size > STRING_ARENA_CHUNK_SIZE) {
+        if ((uint64_t)(arena->chunkCount + 1) * STRING_ARENA_CHUNK_SIZE > STRING_REF_NONE) {
+            return STRING_REF_NONE;
+        }
+        if (arena->chunkCount == arena->chunkCapacity) {
+            size_t newCapacity = arena->chunkCapacity ? arena->chunkCapacity * 2 : 4;
+            unsigned char **chunks = (unsigned char **)realloc(arena->chunks, newCapacity * sizeof(unsigned char *));
+            if (chunks == NULL) {
+                perror("Failed to grow string arena");
+                return STRING_REF_NONE;
+            }
+            arena->chunks = chunks;
+            arena->chunkCapacity = newCapacity;
+        }
+
+        unsigned char *chunk = (unsigned char *)malloc(STRING_ARENA_CHUNK_SIZE);
+        if (chunk == NULL) {
+            perror("Failed to allocate string arena chunk");
+            return STRING_REF_NONE;
+        }
+        // The unused tail of the previous chunk can never be handed out
+        if (arena->chunkCount > 0) {
+            arena->garbageBytes += STRING_ARENA_CHUNK_SIZE - arena->used;
+        }
+        arena->chunks[arena->chunkCount++] = chunk;
+        arena->used = 0;
+    }
+
+    uint32_t ref = (uint32_t)((arena->chunkCount - 1) * STRING_ARENA_CHUNK_SIZE + arena->used);
+    arena->used += size;
+    arena->liveBytes += size;
+    return ref;
+}
+
+void stringArenaRelease(StringArena *arena, size_t size) {
+    arena->liveBytes -= size;
+    arena->garbageBytes += size;
+}
+
+size_t stringArenaCapacity(const StringArena *arena) {
+    return arena->chunkCount * STRING_ARENA_CHUNK_SIZE;
+}
+
+bool stringArenaCopy(StringArena *dest, const StringArena *src) {
+    memset(dest, 0, sizeof(*dest));
+    if (src->chunkCount == 0) {
+        return true;
+    }
+
+    dest->chunks = (unsigned char **)calloc(src->chunkCapacity, sizeof(unsigned char *));
+    if (dest->chunks == NULL) {
+        perror("Failed to copy string arena");
+        return false;
+    }
+    dest->chunkCapacity = src->chunkCapacity;
+    for (size_t i = 0; i < src->chunkCount; i++) {
+        dest->chunks[i] = (unsigned char *)malloc(STRING_ARENA_CHUNK_SIZE);
+        if (dest->chunks[i] == NULL) {
+            perror("Failed to copy string arena");
+            stringArenaFree(dest);
+            return false;
+        }
+        dest->chunkCount++;
+        // Only the used part of the last chunk holds data
+        memcpy(dest->chunks[i], src->chunks[i], i + 1 < src->chunkCount ? STRING_ARENA_CHUNK_SIZE : src->used);
+    }
+    dest->used = src->used;
+    dest->liveBytes = src->liveBytes;
+    dest->garbageBytes = src->garbageBytes;
+    return true;
+}
+
+uint32_t stringArenaAppend(StringArena *dest, StringArena *src) {
+    if (src->chunkCount == 0) {
+        return 0;
+    }
+    size_t chunks = dest->chunkCount + src->chunkCount;
+    if ((uint64_t)chunks * STRING_ARENA_CHUNK_SIZE > STRING_REF_NONE) {
+        return STRING_REF_NONE;
+    }
+    if (chunks > dest->chunkCapacity) {
+        unsigned char **grown = (unsigned char **)realloc(dest->chunks, chunks * sizeof(unsigned char *));
+        if (grown == NULL) {
+            perror("Failed to grow string arena");
+            return STRING_REF_NONE;
+        }
+        dest->chunks = grown;
+        dest->chunkCapacity = chunks;
+    }
+
+    uint32_t offset = (uint32_t)(dest->chunkCount * STRING_ARENA_CHUNK_SIZE);
+    // As in stringArenaAlloc, the tail of dest's last chunk is now unreachable
+    if (dest->chunkCount > 0) {
+        dest->garbageBytes += STRING_ARENA_CHUNK_SIZE - dest->used;
+    }
+    memcpy(dest->chunks + dest->chunkCount, src->chunks, src->chunkCount * sizeof(unsigned char *));
+    dest->chunkCount = chunks;
+    dest->used = src->used;
+    dest->liveBytes += src->liveBytes;
+    dest->garbageBytes += src->garbageBytes;
+
+    free(src->chunks);
+    memset(src, 0, sizeof(*src));
+    return offset;
+}
+
+void stringArenaFree(StringArena *arena) {
+    for (size_t i = 0; i < arena->chunkCount; i++) {
+        free(arena->chunks[i]);
+    }
+    free(arena->chunks);
+    memset(arena, 0, sizeof(*arena));
+}
+
+static uint64_t hashString(const char *string, size_t length) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)string[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool poolEntryMatches(const StringPool *pool, uint32_t id, const char *string, size_t length) {
+    const unsigned char *entry = stringArenaAt(&pool->arena, pool->refs[id - 1]);
+    return entry[0] == length && memcmp(entry + 1, string, length) == 0;
+}
+
+static void poolPlace(uint32_t *table, size_t capacity, uint32_t id, uint64_t hash) {
+    size_t mask = capacity - 1;
+    size_t pos = hash & mask;
+    while (table[pos] != 0) {
+        pos = (pos + 1) & mask;
+    }
+    table[pos] = id;
+}
+
+static bool growPool(StringPool *pool) {
+    if (pool->count == pool->capacity) {
+        uint32_t newCapacity = pool->capacity ? pool->capacity * 2 : POOL_INITIAL_CAPACITY;
+        uint32_t *refs = (uint32_t *)realloc(pool->refs, newCapacity * sizeof(uint32_t));
+        if (refs == NULL) {
+            return false;
+        }
+        pool->refs = refs;
+        pool->capacity = newCapacity;
+    }
+
+    // Keep the hash table at most half full
+    if ((pool->count + 1) * 2 > pool->tableCapacity) {
+        size_t newCapacity = pool->tableCapacity ? pool->tableCapacity * 2 : POOL_INITIAL_CAPACITY * 2;
+        uint32_t *table = (uint32_t *)calloc(newCapacity, sizeof(uint32_t));
+        if (table == NULL) {
+            return false;
+        }
+        for (uint32_t id = 1; id <= pool->count; id++) {
+            const unsigned char *entry = stringArenaAt(&pool->arena, pool->refs[id - 1]);
+            poolPlace(table, newCapacity, id, hashString((const char *)entry + 1, entry[0]));
+        }
+        free(pool->table);
+        pool->table = table;
+        pool->tableCapacity = newCapacity;
+    }
+    return true;
+}
+
+uint32_t stringPoolFind(const StringPool *pool, const char *string, size_t length) {
+    if (pool->count == 0) {
+        return 0;
+    }
+
+    size_t mask = pool->tableCapacity - 1;
+    size_t pos = hashString(string, length) & mask;
+    while (pool->table[pos] != 0) {
+        if (poolEntryMatches(pool, pool->table[pos], string, length)) {
+            return pool->table[pos];
+        }
+        pos = (pos + 1) & mask;
+    }
+    return 0;
+}
+
+uint32_t stringPoolIntern(StringPool *pool, const char *string, size_t length) {
+    uint32_t id = stringPoolFind(pool, string, length);
+    if (id != 0) {
+        return id;
+    }
+    if (length > STRING_MAX_LENGTH || !growPool(pool)) {
+        return 0;
+    }
+
+    uint32_t ref = stringArenaAlloc(&pool->arena, length + 2);
+    if (ref == STRING_REF_NONE) {
+        return 0;
+    }
+    unsigned char *entry = stringArenaAt(&pool->arena, ref);
+    entry[0] = (unsigned char)length;
+    memcpy(entry + 1, string, length);
+    entry[length + 1] = '\0';
+
+    pool->refs[pool->count++] = ref;
+    poolPlace(pool->table, pool->tableCapacity, pool->count, hashString(string, length));
+    return pool->count;
+}
+
+const char *stringPoolGet(const StringPool *pool, uint32_t id) {
+    if (id == 0 || id > pool->count) {
+        return NULL;
+    }
+    return (const char *)stringArenaAt(&pool->arena, pool->refs[id - 1]) + 1;
+}
+
+size_t stringPoolBytes(const StringPool *pool) {
+    return stringArenaCapacity(&pool->arena) + pool->capacity * sizeof(uint32_t) +
+           pool->tableCapacity * sizeof(uint32_t);
+}
+
+bool stringPoolCopy(StringPool *dest, const StringPool *src) {
+    memset(dest, 0, sizeof(*dest));
+    if (src->count == 0) {
+        return true;
+    }
+    if (!stringArenaCopy(&dest->arena, &src->arena)) {
+        return false;
+    }
+
+    dest->refs = (uint32_t *)malloc(src->capacity * sizeof(uint32_t));
+    dest->table = (uint32_t *)malloc(src->tableCapacity * sizeof(uint32_t));
+    if (dest->refs == NULL || dest->table == NULL) {
+        perror("Failed to copy string pool");
+        stringPoolFree(dest);
+        return false;
+    }
+    memcpy(dest->refs, src->refs, src->count * sizeof(uint32_t));
+    memcpy(dest->table, src->table, src->tableCapacity * sizeof(uint32_t));
+    dest->count = src->count;
+    dest->capacity = src->capacity;
+    dest->tableCapacity = src->tableCapacity;
+    return true;
+}
+
+void stringPoolFree(StringPool *pool) {
+    stringArenaFree(&pool->arena);
+    free(pool->refs);
+    free(pool->table);
+    memset(pool, 0, sizeof(*pool));
+}
@@ -0,0 +1,3 @@
+#include "../src/memory_allocator.c"
+#include <stdio.h>
+int main() { initializeMemory(); visualizeMemory(); return 0; }
@@ -0,0 +1,28 @@
+#include "../src/memory_allocator.c"
+#include <stdio.h>
+
+int main() {
+    initializeMemory();
+
+    void *ptrs[100];
+    int allocated = 0;
+
+    // Test memory exhaustion
+    for (int i = 0; i < 100; i++) {
+        ptrs[i] = myMalloc(50);
+        if (ptrs[i]) allocated++;
+        else break;
+    }
+
+    printf("Successfully allocated %d blocks of 50 bytes each\n", allocated);
+
+    // Test fragmentation handling
+    for (int i = 0; i < allocated; i += 2) {
+        myFree(ptrs[i]);
+    }
+
+    void *large = myMalloc(allocated * 25);
+    printf("Large allocation after fragmentation: %s\n", large ? "SUCCESS" : "FAILED");
+
+    return 0;
+}
@@ -0,0 +1,32 @@
+#include "../src/contact_manager.c"
+#include "../src/contact_index.c"
+#include "../src/contact_bloom.c"
+#include "../src/radix_tree.c"
+#include "../src/phone_key.c"
+#include "../src/string_arena.c"
+#include "../src/contact_db.c"
+#include "../src/contact_pack.c"
+#include "../src/contact_load.c"
+#include "../src/contact_version.c"
+#include "../src/contact_wal.c"
+#include "../src/contact_view.c"
+#include "../src/contact_bitmap.c"
+#include "../src/contact_tags.c"
+#include "../src/contact_lazy.c"
+#include "../src/contact_collate.c"
+#include "../src/security.c"
+#include "../src/ui_utils.c"
+#include "../src/memory_allocator.c"
+#include <stdio.h>
+#include <time.h>
+int main() {
+    initializeMemory(); ContactStore contacts = {0};
+    clock_t start = clock();
+    for (int i = 0; i < 1000; i++) {
+        Contact c = {"PerfTest", "123", "perf@test.com"};
+        addContact(&contacts, &c);
+    }
+    clock_t end = clock();
+    double time = ((double)(end - start)) / CLOCKS_PER_SEC;
+    printf("Performance: %.1f operations/second\n", 1000.0/time);
+    freeContacts(&contacts); return 0; }
@@ -0,0 +1,1216 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/contact_manager.h"
+#include "../include/contact_db.h"
+#include "../include/contact_pack.h"
+#include "../include/contact_load.h"
+#include "../include/contact_wal.h"
+#include "../include/contact_saver.h"
+#include "../include/contact_io.h"
+#include "../include/contact_shared.h"
+#include "../include/contact_shards.h"
+#include "../include/contact_cursor.h"
+#include "../include/contact_view.h"
+#include "../include/contact_dedup.h"
+#include "../include/contact_query.h"
+#include "../include/contact_tags.h"
+#include "../include/contact_lazy.h"
+#include "../include/contact_collate.h"
+#include "../include/memory_allocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define LOOKUPS_PER_ROUND 1000000
+#define READ_BENCH_SECONDS 0.25
+#define MAX_READ_THREADS 16
+#define READ_BENCH_KEYS 4096
+#define MAX_INSERT_THREADS 32
+#define FILTER_BENCH_KEYS 65536
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void makeContact(Contact *contact, size_t i) {
+    snprintf(contact->name, sizeof(contact->name), "Contact %zu", i);
+    snprintf(contact->phone, sizeof(contact->phone), "+1555%07zu", i);
+    snprintf(contact->email, sizeof(contact->email), "user%zu@example.com", i);
+}
+
+static void fillStore(ContactStore *store, size_t from, size_t to) {
+    reserveContacts(store, to);
+    for (size_t i = from; i < to; i++) {
+        Contact contact;
+        makeContact(&contact, i);
+        addContact(store, &contact);
+    }
+}
+
+// Secondary index lookups should cost the same at 10k and at millions of
+// contacts; the scan column shows what they replace.
+static void benchmarkSecondaryLookups(size_t maxContacts) {
+    printf("\n=== Secondary Index Lookups ===\n");
+    printf("%12s %14s %14s %14s %14s\n", "contacts", "name ns/op", "phone ns/op", "email ns/op", "scan ns/op");
+
+    ContactStore store = {0};
+    enableContactIndexes(&store, CONTACT_INDEX_PHONE | CONTACT_INDEX_EMAIL);
+
+    size_t filled = 0;
+    unsigned seed = 12345;
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        fillStore(&store, filled, size);
+        filled = size;
+
+        char keys[3][LOOKUPS_PER_ROUND / 1000][50];
+        for (size_t i = 0; i < LOOKUPS_PER_ROUND / 1000; i++) {
+            Contact contact;
+            makeContact(&contact, (size_t)rand_r(&seed) % size);
+            strcpy(keys[0][i], contact.name);
+            strcpy(keys[1][i], contact.phone);
+            strcpy(keys[2][i], contact.email);
+        }
+
+        double results[4];
+        size_t hits = 0;
+        for (int field = 0; field < 3; field++) {
+            double start = nowSeconds();
+            for (size_t i = 0; i < LOOKUPS_PER_ROUND; i++) {
+                const char *key = keys[field][i % (LOOKUPS_PER_ROUND / 1000)];
+                bool found = field == 0 ? findContact(&store, key, NULL)
+                           : field == 1 ? findByPhone(&store, key, NULL)
+                                        : findByEmail(&store, key, NULL);
+                hits += found;
+            }
+            results[field] = (nowSeconds() - start) * 1e9 / LOOKUPS_PER_ROUND;
+        }
+
+        // A handful of unindexed lookups for comparison
+        ContactStore unindexed = store;
+        unindexed.indexFlags = 0;
+        double start = nowSeconds();
+        for (int i = 0; i < 20; i++) {
+            hits += findByPhone(&unindexed, keys[1][i], NULL);
+        }
+        results[3] = (nowSeconds() - start) * 1e9 / 20;
+
+        printf("%12zu %14.1f %14.1f %14.1f %14.0f\n", size, results[0], results[1], results[2], results[3]);
+        if (hits != 3 * LOOKUPS_PER_ROUND + 20) {
+            printf("  warning: %zu lookups missed\n", 3 * LOOKUPS_PER_ROUND + 20 - hits);
+        }
+    }
+
+    freeContacts(&store);
+}
+
+// Names that are not stored should mostly be answered by the filter
+// without touching the index; the unfiltered column is the same store with
+// the filter switched off.
+static void benchmarkNameFilter(size_t maxContacts) {
+    printf("\n=== Name Filter ===\n");
+    printf("%12s %10s %14s %14s %14s %10s\n", "contacts", "filter KB", "miss ns/op",
+           "unfiltered", "hit ns/op", "false pos");
+
+    char (*missing)[50] = malloc(FILTER_BENCH_KEYS * sizeof(*missing));
+    char (*present)[50] = malloc(FILTER_BENCH_KEYS * sizeof(*present));
+    if (missing == NULL || present == NULL) {
+        free(missing);
+        free(present);
+        return;
+    }
+
+    ContactStore store = {0};
+    size_t filled = 0;
+    unsigned seed = 777;
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        fillStore(&store, filled, size);
+        filled = size;
+        for (size_t i = 0; i < FILTER_BENCH_KEYS; i++) {
+            snprintf(missing[i], sizeof(missing[i]), "Contact %zu", size + (size_t)rand_r(&seed) % size);
+            snprintf(present[i], sizeof(present[i]), "Contact %zu", (size_t)rand_r(&seed) % size);
+        }
+
+        ContactStore unfiltered = store;
+        memset(&unfiltered.nameFilter, 0, sizeof(unfiltered.nameFilter));
+        const ContactStore *stores[2] = {&store, &unfiltered};
+        double results[3];
+        size_t hits = 0;
+        ContactBloomStats stats;
+        for (int run = 0; run < 3; run++) {
+            contactBloomResetStats();
+            double start = nowSeconds();
+            for (size_t i = 0; i < LOOKUPS_PER_ROUND; i++) {
+                const char *key = run < 2 ? missing[i % FILTER_BENCH_KEYS] : present[i % FILTER_BENCH_KEYS];
+                hits += findContact(stores[run == 1], key, NULL);
+            }
+            results[run] = (nowSeconds() - start) * 1e9 / LOOKUPS_PER_ROUND;
+            if (run == 0) {
+                contactBloomStats(&stats);
+            }
+        }
+
+        printf("%12zu %10zu %14.1f %14.1f %14.1f %9.2f%%\n", size, contactBloomBytes(&store.nameFilter) / 1024,
+               results[0], results[1], results[2], 100.0 * stats.falsePositives / stats.lookups);
+        if (hits != LOOKUPS_PER_ROUND) {
+            printf("  warning: %zu lookups gave the wrong answer\n", hits > LOOKUPS_PER_ROUND ? hits - LOOKUPS_PER_ROUND
+                                                                                         : LOOKUPS_PER_ROUND - hits);
+        }
+    }
+
+    freeContacts(&store);
+    free(missing);
+    free(present);
+}
+
+// Opening the mapped database only reads the header page; a full load still
+// has to copy every record into the store and its indexes.
+static void benchmarkDatabaseOpen(size_t maxContacts) {
+    printf("\n=== Database Open / Load ===\n");
+    printf("%12s %12s %12s %12s %12s\n", "contacts", "save ms", "open ms", "verify ms", "load ms");
+
+    const char *filename = "bench_contacts.dat";
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+
+        double start = nowSeconds();
+        contactDbWrite(&store, filename, 0, NULL);
+        double saveMs = (nowSeconds() - start) * 1e3;
+        freeContacts(&store);
+
+        ContactDb db;
+        start = nowSeconds();
+        ContactDbStatus status = contactDbOpen(&db, filename);
+        double openMs = (nowSeconds() - start) * 1e3;
+
+        start = nowSeconds();
+        bool valid = status == CONTACT_DB_OK && contactDbVerify(&db);
+        double verifyMs = (nowSeconds() - start) * 1e3;
+        contactDbClose(&db);
+
+        start = nowSeconds();
+        loadContacts(&store, filename);
+        double loadMs = (nowSeconds() - start) * 1e3;
+
+        printf("%12zu %12.2f %12.3f %12.2f %12.2f\n", size, saveMs, openMs, verifyMs, loadMs);
+        if (!valid || store.count != size) {
+            printf("  warning: database round trip failed\n");
+        }
+        freeContacts(&store);
+    }
+    remove(filename);
+}
+
+static long fileSize(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// The packed snapshot against the paged database: file size and the time
+// to save and to load each into an empty store.
+static void benchmarkPackedSnapshot(size_t maxContacts) {
+    printf("\n=== Packed Snapshot vs Paged Database ===\n");
+    printf("%12s %12s %12s %8s %12s %12s %12s %12s\n", "contacts", "paged KB", "packed KB", "ratio",
+           "paged save", "packed save", "paged load", "packed load");
+
+    const char *paged = "bench_paged.dat";
+    const char *packed = "bench_packed.dat";
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+
+        double times[4];
+        double start = nowSeconds();
+        contactDbWrite(&store, paged, 0, NULL);
+        times[0] = (nowSeconds() - start) * 1e3;
+        start = nowSeconds();
+        contactPackWrite(&store, packed, 0, NULL);
+        times[1] = (nowSeconds() - start) * 1e3;
+        freeContacts(&store);
+
+        size_t counts[2];
+        const char *files[2] = {paged, packed};
+        for (int format = 0; format < 2; format++) {
+            start = nowSeconds();
+            loadContacts(&store, files[format]);
+            times[2 + format] = (nowSeconds() - start) * 1e3;
+            counts[format] = store.count;
+            freeContacts(&store);
+        }
+
+        long pagedSize = fileSize(paged);
+        long packedSize = fileSize(packed);
+        printf("%12zu %12ld %12ld %7.1fx %12.2f %12.2f %12.2f %12.2f\n", size, pagedSize / 1024, packedSize / 1024,
+               packedSize > 0 ? (double)pagedSize / packedSize : 0.0, times[0], times[1], times[2], times[3]);
+        if (counts[0] != size || counts[1] != size) {
+            printf("  warning: snapshot round trip failed\n");
+        }
+    }
+    remove(paged);
+    remove(packed);
+}
+
+// Cold load of a packed snapshot on 1, 2, 4 and 8 workers; each column is
+// milliseconds to an indexed, searchable store. Gains need as many cores.
+static void benchmarkParallelLoad(size_t maxContacts) {
+    printf("\n=== Parallel Snapshot Load (%ld CPUs) ===\n", sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%12s %12s %12s %12s %12s\n", "contacts", "1 thread", "2 threads", "4 threads", "8 threads");
+
+    const char *packed = "bench_parallel.dat";
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+        contactPackWrite(&store, packed, 0, NULL);
+        freeContacts(&store);
+
+        double times[4];
+        bool complete = true;
+        for (int i = 0; i < 4; i++) {
+            contactLoadSetThreads(1u << i);
+            double start = nowSeconds();
+            loadContacts(&store, packed);
+            times[i] = (nowSeconds() - start) * 1e3;
+            complete = complete && store.count == size;
+            freeContacts(&store);
+        }
+        printf("%12zu %12.2f %12.2f %12.2f %12.2f\n", size, times[0], times[1], times[2], times[3]);
+        if (!complete) {
+            printf("  warning: parallel load lost contacts\n");
+        }
+    }
+    contactLoadSetThreads(0);
+    remove(packed);
+}
+
+// Time to a usable store: an eager load decodes every block, a lazy open
+// reads only the first name of each. The later columns are what the lazy
+// store pays when it is used: a lookup from the file, an add that faults
+// in one block, and loading the rest.
+static void benchmarkLazyOpen(size_t maxContacts) {
+    printf("\n=== Lazy Snapshot Open ===\n");
+    printf("%12s %12s %12s %12s %12s %12s\n", "contacts", "eager ms", "lazy ms", "lookup us", "add ms", "rest ms");
+
+    const char *packed = "bench_lazy.dat";
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+        contactPackWrite(&store, packed, 0, NULL);
+        freeContacts(&store);
+
+        double times[5];
+        double start = nowSeconds();
+        loadContacts(&store, packed);
+        times[0] = (nowSeconds() - start) * 1e3;
+        freeContacts(&store);
+
+        contactLazySetEnabled(true);
+        start = nowSeconds();
+        loadContacts(&store, packed);
+        times[1] = (nowSeconds() - start) * 1e3;
+        contactLazySetEnabled(false);
+
+        Contact contact;
+        makeContact(&contact, size / 2);
+        start = nowSeconds();
+        bool found = findContact(&store, contact.name, NULL);
+        times[2] = (nowSeconds() - start) * 1e6;
+        makeContact(&contact, size);
+        start = nowSeconds();
+        addContact(&store, &contact);
+        times[3] = (nowSeconds() - start) * 1e3;
+        start = nowSeconds();
+        contactLazyLoadAll(&store);
+        times[4] = (nowSeconds() - start) * 1e3;
+
+        printf("%12zu %12.2f %12.3f %12.1f %12.3f %12.2f\n", size, times[0], times[1], times[2], times[3], times[4]);
+        if (!found || store.count != size + 1) {
+            printf("  warning: lazy open lost contacts\n");
+        }
+        freeContacts(&store);
+    }
+    remove(packed);
+}
+
+// Cost of persisting one change: rewriting the snapshot grows with the
+// store, appending to the log does not; group commit amortizes the fsync.
+static void benchmarkWriteAheadLog(size_t maxContacts) {
+    printf("\n=== Write-Ahead Log ===\n");
+    printf("%12s %16s %16s %16s %16s\n", "contacts", "rewrite us/op", "fsync-1 us/op", "group-32 us/op", "group-128 us/op");
+
+    const char *snapshot = "bench_wal.dat";
+    const char *logFile = "bench_wal.log";
+    const size_t changes = 2000;
+    const size_t groups[] = {1, 32, 128};
+
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+
+        double start = nowSeconds();
+        contactDbWrite(&store, snapshot, 0, NULL);
+        double rewriteUs = (nowSeconds() - start) * 1e6;
+
+        double results[3];
+        for (int g = 0; g < 3; g++) {
+            remove(logFile);
+            ContactWal wal;
+            freeContacts(&store);
+            contactWalRecover(&wal, &store, snapshot, logFile);
+            wal.groupSize = groups[g];
+            wal.checkpointRecords = SIZE_MAX;
+
+            start = nowSeconds();
+            for (size_t i = 0; i < changes; i++) {
+                Contact contact;
+                makeContact(&contact, size + i);
+                addContact(&store, &contact);
+            }
+            contactWalSync(&wal);
+            results[g] = (nowSeconds() - start) * 1e6 / changes;
+            contactWalClose(&wal, &store);
+        }
+
+        printf("%12zu %16.1f %16.1f %16.1f %16.1f\n", size, rewriteUs, results[0], results[1], results[2]);
+        freeContacts(&store);
+    }
+    remove(snapshot);
+    remove(logFile);
+}
+
+// Batch inserts skip per-contact growth and rehashing; the logged column
+// writes one log record per 1000 contacts.
+static void benchmarkBatchInserts(size_t maxContacts) {
+    printf("\n=== Batch Inserts (records/s) ===\n");
+    printf("%12s %14s %14s %14s\n", "contacts", "addContact", "addContacts", "logged batch");
+
+    const char *snapshot = "bench_batch.dat";
+    const char *logFile = "bench_batch.log";
+    const size_t batchSize = 1000;
+
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        Contact *contacts = (Contact *)malloc(size * sizeof(Contact));
+        for (size_t i = 0; i < size; i++) {
+            makeContact(&contacts[i], i);
+        }
+
+        ContactStore store = {0};
+        double start = nowSeconds();
+        for (size_t i = 0; i < size; i++) {
+            addContact(&store, &contacts[i]);
+        }
+        double single = size / (nowSeconds() - start);
+        freeContacts(&store);
+
+        start = nowSeconds();
+        addContacts(&store, contacts, size, NULL);
+        double batch = size / (nowSeconds() - start);
+        freeContacts(&store);
+
+        remove(snapshot);
+        remove(logFile);
+        ContactWal wal;
+        contactWalRecover(&wal, &store, snapshot, logFile);
+        wal.checkpointRecords = SIZE_MAX;
+        start = nowSeconds();
+        for (size_t i = 0; i < size; i += batchSize) {
+            addContacts(&store, &contacts[i], size - i < batchSize ? size - i : batchSize, NULL);
+        }
+        contactWalSync(&wal);
+        double logged = size / (nowSeconds() - start);
+        contactWalClose(&wal, &store);
+        freeContacts(&store);
+
+        printf("%12zu %14.0f %14.0f %14.0f\n", size, single, batch, logged);
+        free(contacts);
+    }
+    remove(snapshot);
+    remove(logFile);
+}
+
+// A page should cost the same wherever the cursor is; the walk column pages
+// through the whole store 1000 contacts at a time.
+static void benchmarkPagination(size_t maxContacts) {
+    printf("\n=== Cursor Pages (100 contacts) ===\n");
+    printf("%12s %14s %14s %14s %14s\n", "contacts", "name first us", "name mid us", "insert mid us", "walk ms");
+
+    const int rounds = 1000;
+    Contact *page = (Contact *)malloc(1000 * sizeof(Contact));
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+
+        ContactCursor cursors[3];
+        contactCursorInit(&cursors[0], CONTACT_ORDER_NAME);
+        contactCursorInit(&cursors[1], CONTACT_ORDER_NAME);
+        snprintf(cursors[1].name, sizeof(cursors[1].name), "Contact %zu", size / 2);
+        contactCursorInit(&cursors[2], CONTACT_ORDER_INSERTION);
+        cursors[2].sequence = size / 2;
+
+        double results[3];
+        for (int c = 0; c < 3; c++) {
+            double start = nowSeconds();
+            for (int r = 0; r < rounds; r++) {
+                ContactCursor cursor = cursors[c];
+                contactPage(&store, &cursor, page, 100);
+            }
+            results[c] = (nowSeconds() - start) * 1e6 / rounds;
+        }
+
+        ContactCursor cursor;
+        contactCursorInit(&cursor, CONTACT_ORDER_NAME);
+        double start = nowSeconds();
+        while (!cursor.done) {
+            contactPage(&store, &cursor, page, 1000);
+        }
+        double walkMs = (nowSeconds() - start) * 1e3;
+
+        printf("%12zu %14.1f %14.1f %14.1f %14.1f\n", size, results[0], results[1], results[2], walkMs);
+        freeContacts(&store);
+    }
+    free(page);
+}
+
+static int compareNames(const void *a, const void *b) {
+    return strcmp(((const Contact *)a)->name, ((const Contact *)b)->name);
+}
+
+static double timeFullSort(ContactStore *store, ContactSortKey key, unsigned threads) {
+    contactSortSetThreads(threads);
+    contactViewsFree(store);
+    size_t count;
+    double start = nowSeconds();
+    contactSortedView(store, key, &count);
+    return (nowSeconds() - start) * 1e3;
+}
+
+// Full sorts on one thread and on every CPU against qsort with strcmp over
+// Contact copies; the refresh column merges 1000 changes into a built view.
+static void benchmarkSortedViews(size_t maxContacts) {
+    printf("\n=== Sorted Views (ms) ===\n");
+    printf("%12s %12s %12s %12s %12s %12s %12s\n",
+           "contacts", "qsort name", "name 1 thr", "name all", "phone all", "email all", "refresh 1k");
+
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+
+        Contact *copies = (Contact *)malloc(size * sizeof(Contact));
+        ContactIterator it;
+        const Contact *contact;
+        size_t n = 0;
+        contactIteratorInit(&it, &store);
+        while ((contact = contactIteratorNext(&it)) != NULL) {
+            copies[n++] = *contact;
+        }
+        double start = nowSeconds();
+        qsort(copies, n, sizeof(Contact), compareNames);
+        double qsortMs = (nowSeconds() - start) * 1e3;
+        free(copies);
+
+        double serialMs = timeFullSort(&store, CONTACT_SORT_NAME, 1);
+        double nameMs = timeFullSort(&store, CONTACT_SORT_NAME, 0);
+        double phoneMs = timeFullSort(&store, CONTACT_SORT_PHONE, 0);
+        double emailMs = timeFullSort(&store, CONTACT_SORT_EMAIL, 0);
+
+        size_t count;
+        contactSortedView(&store, CONTACT_SORT_NAME, &count);
+        for (size_t i = 0; i < 1000; i++) {
+            char name[50];
+            snprintf(name, sizeof(name), "Contact %zu", i * 7);
+            deleteContact(&store, name);
+            Contact added;
+            makeContact(&added, size + i);
+            addContact(&store, &added);
+        }
+        start = nowSeconds();
+        contactSortedView(&store, CONTACT_SORT_NAME, &count);
+        double refreshMs = (nowSeconds() - start) * 1e3;
+
+        printf("%12zu %12.1f %12.1f %12.1f %12.1f %12.1f %12.2f\n",
+               size, qsortMs, serialMs, nameMs, phoneMs, emailMs, refreshMs);
+        freeContacts(&store);
+    }
+}
+
+static int compareFoldedNames(const void *a, const void *b) {
+    const char *left = ((const Contact *)a)->name;
+    const char *right = ((const Contact *)b)->name;
+    char leftKey[sizeof(((Contact *)0)->name)];
+    char rightKey[sizeof(((Contact *)0)->name)];
+    contactCollate(left, strlen(left), leftKey);
+    contactCollate(right, strlen(right), rightKey);
+    return strcmp(leftKey, rightKey);
+}
+
+static int compareKeys(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Sorting by folding both names on every comparison against sorting the
+// keys stored at insert time, and updates naming a contact exactly against
+// ones that only match ignoring case and accents.
+static void benchmarkCollation(size_t maxContacts) {
+    printf("\n=== Collation ===\n");
+    printf("%12s %12s %12s %12s %12s %12s\n",
+           "contacts", "fold ms", "stored ms", "view ms", "exact ns", "folded ns");
+
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        Contact *copies = (Contact *)malloc(size * sizeof(Contact));
+        const char **keys = (const char **)malloc(size * sizeof(char *));
+        for (size_t i = 0; i < size; i++) {
+            // Every other name starts with an accented capital
+            makeContact(&copies[i], i);
+            snprintf(copies[i].name, sizeof(copies[i].name), i % 2 ? "\xC3\x87ontact %zu" : "Contact %zu", i);
+        }
+        addContacts(&store, copies, size, NULL);
+
+        double start = nowSeconds();
+        qsort(copies, size, sizeof(Contact), compareFoldedNames);
+        double foldMs = (nowSeconds() - start) * 1e3;
+        for (uint32_t slot = 0; slot < size; slot++) {
+            keys[slot] = contactSlotCollation(&store, slot);
+        }
+        start = nowSeconds();
+        qsort(keys, size, sizeof(char *), compareKeys);
+        double storedMs = (nowSeconds() - start) * 1e3;
+        double viewMs = timeFullSort(&store, CONTACT_SORT_NAME, 1);
+        contactViewsFree(&store);
+
+        double times[2];
+        size_t updated = 0;
+        for (int folded = 0; folded < 2; folded++) {
+            start = nowSeconds();
+            for (size_t i = 0; i < 1000; i++) {
+                size_t n = (i * 7919) % size;
+                Contact contact;
+                makeContact(&contact, n);
+                snprintf(contact.name, sizeof(contact.name), n % 2 ? "\xC3\x87ontact %zu" : "Contact %zu", n);
+                char upper[sizeof(contact.name)];
+                snprintf(upper, sizeof(upper), "CONTACT %zu", n);
+                updated += updateContact(&store, folded ? upper : contact.name, &contact);
+            }
+            times[folded] = (nowSeconds() - start) * 1e6;
+        }
+
+        printf("%12zu %12.1f %12.1f %12.1f %12.0f %12.0f\n",
+               size, foldMs, storedMs, viewMs, times[0], times[1]);
+        if (updated != 2000) {
+            printf("  warning: %zu of 2000 updates matched\n", updated);
+        }
+        free(copies);
+        free(keys);
+        freeContacts(&store);
+    }
+}
+
+// One contact in ten gets a near duplicate: its name in upper case with
+// doubled spaces, its phone in another format and a different email.
+// Runtime should grow close to linearly with the store.
+static void benchmarkDuplicates(size_t maxContacts) {
+    printf("\n=== Duplicate Detection ===\n");
+    printf("%12s %12s %12s %14s\n", "contacts", "groups", "ms", "contacts/s");
+
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        reserveContacts(&store, size + size / 10);
+        for (size_t i = 0; i < size; i++) {
+            Contact contact;
+            makeContact(&contact, i);
+            addContact(&store, &contact);
+            if (i % 10 == 0) {
+                snprintf(contact.name, sizeof(contact.name), "CONTACT  %zu", i);
+                snprintf(contact.phone, sizeof(contact.phone), "+1 (555) %07zu", i);
+                snprintf(contact.email, sizeof(contact.email), "dup%zu@example.org", i);
+                addContact(&store, &contact);
+            }
+        }
+
+        ContactDuplicates duplicates;
+        double start = nowSeconds();
+        contactFindDuplicates(&store, CONTACT_DUP_ALL, CONTACT_DUP_NAME_THRESHOLD, &duplicates);
+        double seconds = nowSeconds() - start;
+        printf("%12zu %12zu %12.1f %14.0f\n", store.count, duplicates.clusterCount,
+               seconds * 1e3, store.count / seconds);
+        contactDuplicatesFree(&duplicates);
+        freeContacts(&store);
+    }
+}
+
+typedef struct {
+    const char *label;
+    ContactPredicate predicates[2];
+    size_t count;
+} QueryBench;
+
+static bool naiveMatch(const Contact *contact, const ContactPredicate *predicate) {
+    const char *field = predicate->field == CONTACT_FIELD_NAME ? contact->name
+                        : predicate->field == CONTACT_FIELD_PHONE ? contact->phone : contact->email;
+    switch (predicate->match) {
+        case CONTACT_MATCH_EQUALS: return strcmp(field, predicate->value) == 0;
+        case CONTACT_MATCH_PREFIX: return strncmp(field, predicate->value, strlen(predicate->value)) == 0;
+        case CONTACT_MATCH_CONTAINS: return strstr(field, predicate->value) != NULL;
+        default: {
+            const char *at = strchr(contact->email, '@');
+            return at != NULL && strcmp(at + 1, predicate->value) == 0;
+        }
+    }
+}
+
+// Filters over a columnar copy against iterating the store and comparing
+// strings by hand, at each instruction set.
+static void benchmarkColumnQueries(size_t maxContacts) {
+    const QueryBench queries[] = {
+        {"domain", {{CONTACT_FIELD_EMAIL, CONTACT_MATCH_DOMAIN, "d7.example.com"}}, 1},
+        {"domain+phone^", {{CONTACT_FIELD_EMAIL, CONTACT_MATCH_DOMAIN, "d7.example.com"},
+                           {CONTACT_FIELD_PHONE, CONTACT_MATCH_PREFIX, "+1555001"}}, 2},
+        {"name~", {{CONTACT_FIELD_NAME, CONTACT_MATCH_CONTAINS, "4242"}}, 1},
+        {"email=", {{CONTACT_FIELD_EMAIL, CONTACT_MATCH_EQUALS, "user4242@d42.example.com"}}, 1},
+    };
+    size_t queryCount = sizeof(queries) / sizeof(queries[0]);
+
+    printf("\n=== Column Queries ===\n");
+    printf("%12s %14s %10s %10s %10s %10s %10s %10s\n", "contacts", "query", "matches", "build ms",
+           "naive ms", "scalar ms", "sse2 ms", "avx2 ms");
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        reserveContacts(&store, size);
+        for (size_t i = 0; i < size; i++) {
+            Contact contact;
+            makeContact(&contact, i);
+            snprintf(contact.email, sizeof(contact.email), "user%zu@d%zu.example.com", i, i % 50);
+            addContact(&store, &contact);
+        }
+
+        ContactColumns columns;
+        double start = nowSeconds();
+        contactColumnsBuild(&columns, &store);
+        double buildMs = (nowSeconds() - start) * 1e3;
+
+        for (size_t q = 0; q < queryCount; q++) {
+            start = nowSeconds();
+            ContactIterator it;
+            const Contact *contact;
+            size_t naive = 0;
+            contactIteratorInit(&it, &store);
+            while ((contact = contactIteratorNext(&it)) != NULL) {
+                bool holds = true;
+                for (size_t i = 0; holds && i < queries[q].count; i++) {
+                    holds = naiveMatch(contact, &queries[q].predicates[i]);
+                }
+                naive += holds;
+            }
+            double naiveMs = (nowSeconds() - start) * 1e3;
+
+            ContactQuery query;
+            contactQueryCompile(&query, queries[q].predicates, queries[q].count);
+            double levelMs[3];
+            size_t matches = 0;
+            for (int level = CONTACT_SIMD_SCALAR; level <= CONTACT_SIMD_AVX2; level++) {
+                if (contactQuerySetSimd((ContactSimd)level) != (ContactSimd)level) {
+                    levelMs[level] = 0;
+                    continue;
+                }
+                start = nowSeconds();
+                matches = contactQueryRun(&columns, &query, NULL, 0);
+                levelMs[level] = (nowSeconds() - start) * 1e3;
+            }
+            contactQuerySetSimd(CONTACT_SIMD_AVX2);
+            printf("%12zu %14s %10zu %10.2f %10.2f %10.2f %10.2f %10.2f%s\n", size, queries[q].label, matches,
+                   buildMs, naiveMs, levelMs[0], levelMs[1], levelMs[2], matches == naive ? "" : "  MISMATCH");
+        }
+        contactColumnsFree(&columns);
+        freeContacts(&store);
+    }
+}
+
+// Tag set operations against the same sets kept as one flag per slot, which
+// every operation has to walk in full. Half the contacts are in "even", a
+// hundredth in "rare"; "half" covers the first half of the slots.
+static void benchmarkTagSets(size_t maxContacts) {
+    printf("\n=== Tag Sets ===\n");
+    printf("%12s %10s %10s %12s %12s %12s %12s %12s\n", "contacts", "op", "matches", "bitmap ms", "flags ms",
+           "tag KB", "flags KB", "save ms");
+    const char *names[] = {"even", "rare", "half"};
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+        unsigned char *flags = (unsigned char *)calloc(size, 3);
+        ContactIterator it;
+        contactIteratorInit(&it, &store);
+        for (size_t i = 0; contactIteratorNext(&it) != NULL; i++) {
+            bool member[3] = {i % 2 == 0, i % 100 == 0, i < size / 2};
+            for (int t = 0; t < 3; t++) {
+                if (member[t]) {
+                    contactTag(&store, it.handle, names[t]);
+                    flags[(uint32_t)it.handle * 3 + t] = 1;
+                }
+            }
+        }
+
+        double start = nowSeconds();
+        contactPackWrite(&store, "bench_tags.dat", 0, NULL);
+        double saveMs = (nowSeconds() - start) * 1e3;
+
+        const ContactBitmap *even = contactTagged(&store, "even");
+        const ContactBitmap *rare = contactTagged(&store, "rare");
+        const ContactBitmap *half = contactTagged(&store, "half");
+        const char *ops[] = {"even&half", "even|rare", "half-even", "#even&half"};
+        for (int op = 0; op < 4; op++) {
+            ContactBitmap out = {0};
+            size_t matches = 0;
+            start = nowSeconds();
+            switch (op) {
+                case 0: contactBitmapAnd(&out, even, half); break;
+                case 1: contactBitmapOr(&out, even, rare); break;
+                case 2: contactBitmapAndNot(&out, half, even); break;
+                default: matches = contactBitmapAndCount(even, half); break;
+            }
+            matches = op < 3 ? contactBitmapCount(&out) : matches;
+            double bitmapMs = (nowSeconds() - start) * 1e3;
+
+            start = nowSeconds();
+            size_t naive = 0;
+            for (size_t slot = 0; slot < size; slot++) {
+                const unsigned char *f = &flags[slot * 3];
+                naive += op == 1 ? (f[0] | f[1]) : op == 2 ? (f[2] & !f[0]) : (f[0] & f[2]);
+            }
+            double flagsMs = (nowSeconds() - start) * 1e3;
+            printf("%12zu %10s %10zu %12.3f %12.3f %12.1f %12.1f %12.2f%s\n", size, ops[op], matches, bitmapMs,
+                   flagsMs, contactTagsBytes(&store) / 1024.0, size * 3 / 1024.0, saveMs,
+                   matches == naive ? "" : "  MISMATCH");
+            contactBitmapFree(&out);
+        }
+        free(flags);
+        freeContacts(&store);
+    }
+    remove("bench_tags.dat");
+    remove("bench_tags.dat.tags");
+}
+
+// How long the caller is blocked by a save: the whole write for a
+// synchronous save, only the buffer copy for a background one.
+static void benchmarkAsyncSave(size_t maxContacts) {
+    printf("\n=== Background Saves ===\n");
+    printf("%12s %14s %14s %14s\n", "contacts", "sync ms", "pause ms", "async total ms");
+
+    const char *filename = "bench_async.dat";
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+
+        double start = nowSeconds();
+        contactDbWrite(&store, filename, 0, NULL);
+        double syncMs = (nowSeconds() - start) * 1e3;
+
+        ContactSaver saver;
+        ContactSaveStats stats;
+        contactSaverStart(&saver);
+        saveContactsAsync(&saver, &store, filename, NULL, NULL);
+        contactSaverStop(&saver);
+        contactSaverStats(&saver, &stats);
+
+        printf("%12zu %14.2f %14.2f %14.2f\n", size, syncMs, stats.lastCaptureMs, stats.lastMs);
+        freeContacts(&store);
+    }
+    remove(filename);
+}
+
+static void benchmarkImportExport(size_t maxContacts) {
+    printf("\n=== Bulk Import / Export (records/s) ===\n");
+    printf("%12s %14s %14s %14s %14s\n", "contacts", "csv export", "csv import", "vcf export", "vcf import");
+
+    const char *files[] = {"bench_contacts.csv", "bench_contacts.vcf"};
+    const ContactFormat formats[] = {CONTACT_FORMAT_CSV, CONTACT_FORMAT_VCARD};
+
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactStore store = {0};
+        fillStore(&store, 0, size);
+
+        double rates[4];
+        bool complete = true;
+        for (int f = 0; f < 2; f++) {
+            ContactIoStats stats;
+            exportContacts(&store, files[f], formats[f], &stats);
+            rates[f * 2] = stats.recordsPerSecond;
+
+            ContactStore imported = {0};
+            importContacts(&imported, files[f], formats[f], &stats);
+            rates[f * 2 + 1] = stats.recordsPerSecond;
+            complete = complete && stats.imported == size;
+            freeContacts(&imported);
+            remove(files[f]);
+        }
+
+        printf("%12zu %14.0f %14.0f %14.0f %14.0f\n", size, rates[0], rates[1], rates[2], rates[3]);
+        if (!complete) {
+            printf("  warning: import lost records\n");
+        }
+        freeContacts(&store);
+    }
+}
+
+// Bytes held per contact by slots, packed records and interned domains,
+// against the fixed-size Contact the store used to keep in every slot.
+static void benchmarkMemoryFootprint(size_t maxContacts) {
+    printf("\n=== Memory Footprint ===\n");
+    printf("%12s %16s %16s %16s\n", "contacts", "bytes/contact", "sizeof(Contact)", "scan ns/contact");
+
+    ContactStore store = {0};
+    size_t filled = 0;
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        fillStore(&store, filled, size);
+        filled = size;
+
+        ContactIterator it;
+        const Contact *contact;
+        size_t checksum = 0;
+        double start = nowSeconds();
+        contactIteratorInit(&it, &store);
+        while ((contact = contactIteratorNext(&it)) != NULL) {
+            checksum += (unsigned char)contact->email[0];
+        }
+        double scanNs = (nowSeconds() - start) * 1e9 / size;
+
+        printf("%12zu %16.1f %16zu %16.1f\n", size, (double)contactStoreBytes(&store) / size,
+               sizeof(Contact), scanNs + (checksum == 0));
+    }
+    freeContacts(&store);
+}
+
+// One Contact-sized block per contact from myMalloc against malloc, with
+// the arenas mapped at the peak and what is still mapped once all are freed.
+static void benchmarkAllocator(size_t maxContacts) {
+    printf("\n=== Arena Allocator ===\n");
+    printf("%12s %12s %12s %12s %12s %12s %12s\n",
+           "contacts", "malloc ms", "free ms", "myMalloc ms", "myFree ms", "arenas", "left KB");
+
+    void **blocks = (void **)malloc(maxContacts * sizeof(void *));
+    initializeMemory();
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        double times[4];
+        double start = nowSeconds();
+        for (size_t i = 0; i < size; i++) {
+            blocks[i] = malloc(sizeof(Contact));
+        }
+        times[0] = (nowSeconds() - start) * 1e3;
+        start = nowSeconds();
+        for (size_t i = 0; i < size; i++) {
+            free(blocks[i]);
+        }
+        times[1] = (nowSeconds() - start) * 1e3;
+
+        size_t failed = 0;
+        start = nowSeconds();
+        for (size_t i = 0; i < size; i++) {
+            blocks[i] = myMalloc(sizeof(Contact));
+            failed += blocks[i] == NULL;
+        }
+        times[2] = (nowSeconds() - start) * 1e3;
+        size_t arenas, mappedBytes;
+        memoryArenaStats(&arenas, &mappedBytes);
+        start = nowSeconds();
+        for (size_t i = 0; i < size; i++) {
+            myFree(blocks[i]);
+        }
+        times[3] = (nowSeconds() - start) * 1e3;
+        size_t leftArenas, leftBytes;
+        memoryArenaStats(&leftArenas, &leftBytes);
+
+        printf("%12zu %12.2f %12.2f %12.2f %12.2f %12zu %12zu\n",
+               size, times[0], times[1], times[2], times[3], arenas, leftBytes / 1024);
+        if (failed > 0) {
+            printf("  warning: %zu allocations failed\n", failed);
+        }
+    }
+    free(blocks);
+}
+
+typedef struct {
+    ContactShared *shared;
+    ContactStore *store;         // used with lock instead of shared
+    pthread_rwlock_t *lock;
+    char (*keys)[50];
+    atomic_bool *stop;
+    size_t offset;
+    size_t ops;
+} ReadBench;
+
+static void *readLoop(void *arg) {
+    ReadBench *bench = (ReadBench *)arg;
+    size_t i = bench->offset;
+    while (!atomic_load_explicit(bench->stop, memory_order_relaxed)) {
+        const char *name = bench->keys[i++ % READ_BENCH_KEYS];
+        if (bench->shared != NULL) {
+            ContactReadToken token;
+            findContact(contactReadBegin(bench->shared, &token), name, NULL);
+            contactReadEnd(bench->shared, &token);
+        } else {
+            pthread_rwlock_rdlock(bench->lock);
+            findContact(bench->store, name, NULL);
+            pthread_rwlock_unlock(bench->lock);
+        }
+        bench->ops++;
+    }
+    return NULL;
+}
+
+// Rewrites phone numbers in a loop, so readers always share with a writer
+static void *writeLoop(void *arg) {
+    ReadBench *bench = (ReadBench *)arg;
+    size_t i = 0;
+    while (!atomic_load_explicit(bench->stop, memory_order_relaxed)) {
+        Contact contact;
+        makeContact(&contact, i % READ_BENCH_KEYS);
+        snprintf(contact.phone, sizeof(contact.phone), "+1666%07zu", i++);
+        if (bench->shared != NULL) {
+            contactSharedUpdate(bench->shared, contact.name, &contact);
+        } else {
+            pthread_rwlock_wrlock(bench->lock);
+            updateContact(bench->store, contact.name, &contact);
+            pthread_rwlock_unlock(bench->lock);
+        }
+        bench->ops++;
+    }
+    return NULL;
+}
+
+// Runs readers lookups against one writer; returns reads/s, *writes gets writes/s
+static double runReaders(ReadBench *base, int readers, double *writes) {
+    atomic_bool stop = false;
+    ReadBench benches[MAX_READ_THREADS + 1];
+    pthread_t threads[MAX_READ_THREADS + 1];
+    for (int t = 0; t <= readers; t++) {
+        benches[t] = *base;
+        benches[t].stop = &stop;
+        benches[t].offset = (size_t)t * 997;
+        pthread_create(&threads[t], NULL, t == 0 ? writeLoop : readLoop, &benches[t]);
+    }
+
+    struct timespec pause = {0, (long)(READ_BENCH_SECONDS * 1e9)};
+    double start = nowSeconds();
+    nanosleep(&pause, NULL);
+    atomic_store(&stop, true);
+
+    size_t reads = 0;
+    for (int t = 0; t <= readers; t++) {
+        pthread_join(threads[t], NULL);
+        reads += t > 0 ? benches[t].ops : 0;
+    }
+    double elapsed = nowSeconds() - start;
+    *writes = benches[0].ops / elapsed;
+    return reads / elapsed;
+}
+
+// Lock-free readers should scale with cores; a reader-writer lock makes
+// every lookup bounce the lock's cache line between them.
+static void benchmarkSharedReads(size_t maxContacts) {
+    size_t size = maxContacts < 100000 ? maxContacts : 100000;
+    if (size < READ_BENCH_KEYS) {
+        size = READ_BENCH_KEYS;
+    }
+    printf("\n=== Concurrent Reads (%zu contacts, one writer, %ld cores) ===\n",
+           size, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%8s %16s %16s %16s %16s\n", "readers", "shared reads/s", "shared writes/s",
+           "rwlock reads/s", "rwlock writes/s");
+
+    static char keys[READ_BENCH_KEYS][50];
+    for (size_t i = 0; i < READ_BENCH_KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "Contact %zu", i * (size / READ_BENCH_KEYS));
+    }
+
+    ContactShared shared;
+    contactSharedInit(&shared);
+    ContactStore locked = {0};
+    pthread_rwlock_t lock;
+    pthread_rwlock_init(&lock, NULL);
+    fillStore(&shared.stores[0], 0, size);
+    copyContacts(&shared.stores[1], &shared.stores[0]);
+    fillStore(&locked, 0, size);
+
+    for (int readers = 1; readers <= MAX_READ_THREADS; readers *= 2) {
+        ReadBench sharedBench = {.shared = &shared, .keys = keys};
+        ReadBench lockedBench = {.store = &locked, .lock = &lock, .keys = keys};
+        double sharedWrites, lockedWrites;
+        double sharedReads = runReaders(&sharedBench, readers, &sharedWrites);
+        double lockedReads = runReaders(&lockedBench, readers, &lockedWrites);
+        printf("%8d %16.0f %16.0f %16.0f %16.0f\n", readers, sharedReads, sharedWrites, lockedReads, lockedWrites);
+    }
+
+    pthread_rwlock_destroy(&lock);
+    freeContacts(&locked);
+    contactSharedFree(&shared);
+}
+
+typedef struct {
+    ContactShared *shared;
+    size_t size;
+    atomic_bool stop;
+    double maxWaitMs;
+    size_t writes;
+} ScanWriter;
+
+// Rewrites phones and tracks the slowest write
+static void *scanWriter(void *arg) {
+    ScanWriter *writer = (ScanWriter *)arg;
+    size_t i = 0;
+    while (!atomic_load(&writer->stop)) {
+        Contact contact;
+        makeContact(&contact, (i * 7919) % writer->size);
+        snprintf(contact.phone, sizeof(contact.phone), "+1777%07zu", i++);
+        double start = nowSeconds();
+        contactSharedUpdate(writer->shared, contact.name, &contact);
+        double waitMs = (nowSeconds() - start) * 1e3;
+        if (waitMs > writer->maxWaitMs) {
+            writer->maxWaitMs = waitMs;
+        }
+        writer->writes++;
+    }
+    return NULL;
+}
+
+static bool countVisit(const Contact *contact, void *userData) {
+    (void)contact;
+    (*(size_t *)userData)++;
+    return true;
+}
+
+// Full scans alongside a writer: under the write lock the writer waits for
+// the whole scan; at a snapshot it only waits for one chunk.
+static void benchmarkVersionedScan(size_t maxContacts) {
+    printf("\n=== Scans During Writes ===\n");
+    printf("%12s %14s %14s %14s %14s %14s\n", "contacts", "locked ms", "locked wait ms",
+           "snapshot ms", "snap wait ms", "kept versions");
+
+    for (size_t size = 10000; size <= maxContacts; size *= 10) {
+        ContactShared shared;
+        contactSharedInit(&shared);
+        fillStore(&shared.stores[0], 0, size);
+        copyContacts(&shared.stores[1], &shared.stores[0]);
+
+        double ms[2];
+        double waitMs[2];
+        size_t kept = 0;
+        for (int mode = 0; mode < 2; mode++) {
+            ScanWriter writer = {.shared = &shared, .size = size};
+            atomic_init(&writer.stop, false);
+            pthread_t thread;
+            pthread_create(&thread, NULL, scanWriter, &writer);
+
+            size_t visited = 0;
+            double start = nowSeconds();
+            if (mode == 0) {
+                ContactIterator it;
+                const ContactStore *store = contactSharedLock(&shared);
+                contactIteratorInit(&it, store);
+                while (contactIteratorNext(&it) != NULL) {
+                    visited++;
+                }
+                contactSharedUnlock(&shared);
+            } else {
+                ContactSnapshot snapshot;
+                contactSharedSnapshot(&shared, &snapshot);
+                contactSharedScan(&shared, &snapshot, countVisit, &visited);
+                kept = contactVersionCount(&shared.stores[0]);
+                contactSharedRelease(&shared, &snapshot);
+            }
+            ms[mode] = (nowSeconds() - start) * 1e3;
+
+            atomic_store(&writer.stop, true);
+            pthread_join(thread, NULL);
+            waitMs[mode] = writer.maxWaitMs;
+        }
+
+        printf("%12zu %14.2f %14.2f %14.2f %14.2f %14zu\n", size, ms[0], waitMs[0], ms[1], waitMs[1], kept);
+        contactSharedFree(&shared);
+    }
+}
+
+typedef struct {
+    ContactShards *store;
+    size_t from;
+    size_t to;
+} InsertBench;
+
+static void *insertLoop(void *arg) {
+    InsertBench *bench = (InsertBench *)arg;
+    for (size_t i = bench->from; i < bench->to; i++) {
+        Contact contact;
+        makeContact(&contact, i);
+        contactShardsAdd(bench->store, &contact);
+    }
+    return NULL;
+}
+
+static double timeInserts(size_t shards, int threads, size_t total) {
+    ContactShards store;
+    contactShardsInit(&store, shards);
+
+    InsertBench benches[MAX_INSERT_THREADS];
+    pthread_t ids[MAX_INSERT_THREADS];
+    double start = nowSeconds();
+    for (int t = 0; t < threads; t++) {
+        benches[t] = (InsertBench){&store, total * t / threads, total * (t + 1) / threads};
+        pthread_create(&ids[t], NULL, insertLoop, &benches[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    double elapsed = nowSeconds() - start;
+
+    contactShardsFree(&store);
+    return total / elapsed;
+}
+
+// One shard is the single-writer-lock store; with CONTACT_SHARD_COUNT
+// shards concurrent inserts rarely meet on a lock.
+static void benchmarkShardedInserts(size_t maxContacts) {
+    size_t total = maxContacts < 200000 ? maxContacts : 200000;
+    printf("\n=== Concurrent Inserts (%zu contacts, %ld cores) ===\n", total, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%8s %16s %16s\n", "threads", "1 shard ins/s", "sharded ins/s");
+    for (int threads = 1; threads <= MAX_INSERT_THREADS; threads *= 2) {
+        double single = timeInserts(1, threads, total);
+        double sharded = timeInserts(CONTACT_SHARD_COUNT, threads, total);
+        printf("%8d %16.0f %16.0f\n", threads, single, sharded);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t maxContacts = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+
+    printf("=== EchoNull Benchmarks (up to %zu contacts) ===\n", maxContacts);
+    benchmarkSecondaryLookups(maxContacts);
+    benchmarkNameFilter(maxContacts);
+    benchmarkMemoryFootprint(maxContacts);
+    benchmarkAllocator(maxContacts);
+    benchmarkPagination(maxContacts);
+    benchmarkSortedViews(maxContacts);
+    benchmarkCollation(maxContacts);
+    benchmarkDuplicates(maxContacts);
+    benchmarkColumnQueries(maxContacts);
+    benchmarkTagSets(maxContacts);
+    benchmarkDatabaseOpen(maxContacts);
+    benchmarkPackedSnapshot(maxContacts);
+    benchmarkParallelLoad(maxContacts);
+    benchmarkLazyOpen(maxContacts);
+    benchmarkWriteAheadLog(maxContacts);
+    benchmarkBatchInserts(maxContacts);
+    benchmarkAsyncSave(maxContacts);
+    benchmarkImportExport(maxContacts);
+    benchmarkSharedReads(maxContacts);
+    benchmarkVersionedScan(maxContacts);
+    benchmarkShardedInserts(maxContacts);
+    return 0;
+}
@@ -6,24 +6,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <time.h>
 
+// Iterators hand out an unpacked copy, so the iterator must outlive the result
+static const Contact *firstContact(const ContactStore *store) {
+    static ContactIterator it;
+    contactIteratorInit(&it, store);
+    return contactIteratorNext(&it);
+}
+
 // Contact Manager Tests
 TEST(test_contact_add_single) {
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
     Contact test = {"John Doe", "1234567890", "john@example.com"};
 
     addContact(&contacts, &test);
-    ASSERT_NOT_NULL(contacts);
-    ASSERT_STR_EQ("John Doe", contacts->contact.name);
+    ASSERT_NOT_NULL(firstContact(&contacts));
+    ASSERT_STR_EQ("John Doe", firstContact(&contacts)->name);
 
     freeContacts(&contacts);
-    ASSERT_NULL(contacts);
+    ASSERT_NULL(firstContact(&contacts));
     return TEST_PASS;
 }
 
 TEST(test_contact_add_multiple) {
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
     Contact contacts_data[3] = {
         {"Alice", "111", "alice@a.com"},
         {"Bob", "222", "bob@b.com"},
@@ -34,54 +42,55 @@ TEST(test_contact_add_multiple) {
         addContact(&contacts, &contacts_data[i]);
     }
 
-    ASSERT_NOT_NULL(contacts);
-    ASSERT_STR_EQ("Charlie", contacts->contact.name); // Head insertion
+    ASSERT_NOT_NULL(firstContact(&contacts));
+    ASSERT_STR_EQ("Alice", firstContact(&contacts)->name); // Insertion order
+    ASSERT_EQ(3, contacts.count);
 
     freeContacts(&contacts);
     return TEST_PASS;
 }
 
 TEST(test_contact_update_existing) {
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
     Contact original = {"Original", "123", "original@o.com"};
     Contact updated = {"Updated", "456", "updated@u.com"};
 
     addContact(&contacts, &original);
-    bool result = updateContact(contacts, "Original", &updated);
+    bool result = updateContact(&contacts, "Original", &updated);
 
     ASSERT_TRUE(result);
-    ASSERT_STR_EQ("Updated", contacts->contact.name);
+    ASSERT_STR_EQ("Updated", firstContact(&contacts)->name);
 
     freeContacts(&contacts);
     return TEST_PASS;
 }
 
 TEST(test_contact_update_nonexistent) {
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
     Contact updated = {"Updated", "456", "updated@u.com"};
 
-    bool result = updateContact(contacts, "Nonexistent", &updated);
+    bool result = updateContact(&contacts, "Nonexistent", &updated);
     ASSERT_FALSE(result);
 
     return TEST_PASS;
 }
 
 TEST(test_contact_delete_existing) {
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
     Contact test = {"ToDelete", "123", "delete@d.com"};
 
     addContact(&contacts, &test);
-    ASSERT_NOT_NULL(contacts);
+    ASSERT_NOT_NULL(firstContact(&contacts));
 
     bool result = deleteContact(&contacts, "ToDelete");
     ASSERT_TRUE(result);
-    ASSERT_NULL(contacts);
+    ASSERT_NULL(firstContact(&contacts));
 
     return TEST_PASS;
 }
 
 TEST(test_contact_delete_nonexistent) {
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
 
     bool result = deleteContact(&contacts, "Nonexistent");
     ASSERT_FALSE(result);
@@ -89,18 +98,93 @@ TEST(test_contact_delete_nonexistent) {
     return TEST_PASS;
 }
 
+TEST(test_contact_find_by_name) {
+    ContactStore contacts = {0};
+    Contact alice = {"Alice", "111", "alice@a.com"};
+    Contact bob = {"Bob", "222", "bob@b.com"};
+    Contact found;
+
+    addContact(&contacts, &alice);
+    addContact(&contacts, &bob);
+
+    ASSERT_TRUE(findContact(&contacts, "Alice", &found));
+    ASSERT_STR_EQ("111", found.phone);
+    ASSERT_FALSE(findContact(&contacts, "Carol", NULL));
+
+    deleteContact(&contacts, "Alice");
+    ASSERT_FALSE(findContact(&contacts, "Alice", NULL));
+    ASSERT_TRUE(findContact(&contacts, "Bob", NULL));
+
+    freeContacts(&contacts);
+    return TEST_PASS;
+}
+
+TEST(test_contact_stale_handle) {
+    ContactStore contacts = {0};
+    Contact first = {"First", "111", "first@f.com"};
+    Contact second = {"Second", "222", "second@s.com"};
+    Contact out;
+
+    ContactHandle handle = addContact(&contacts, &first);
+    ASSERT_TRUE(getContact(&contacts, handle, &out));
+    ASSERT_STR_EQ("First", out.name);
+
+    deleteContact(&contacts, "First");
+    ContactHandle reused = addContact(&contacts, &second);
+
+    ASSERT_EQ((uint32_t)handle, (uint32_t)reused); // Tombstoned slot reused
+    ASSERT_FALSE(getContact(&contacts, handle, &out));
+    ASSERT_TRUE(getContact(&contacts, reused, &out));
+    ASSERT_STR_EQ("Second", out.name);
+
+    freeContacts(&contacts);
+    return TEST_PASS;
+}
+
+static bool countMatch(const Contact *contact, void *userData) {
+    (void)contact;
+    (*(int *)userData)++;
+    return true;
+}
+
+TEST(test_contact_prefix_search) {
+    ContactStore contacts = {0};
+    char name[50];
+
+    for (int i = 0; i < 500; i++) {
+        Contact contact = {"", "555", "prefix@p.com"};
+        snprintf(name, sizeof(name), "%s %03d", i % 2 ? "Smith" : "Smythe", i);
+        strcpy(contact.name, name);
+        addContact(&contacts, &contact);
+    }
+
+    int matches = 0;
+    searchContactsByPrefix(&contacts, "Smith", 0, countMatch, &matches);
+    ASSERT_EQ(250, matches);
+
+    matches = 0;
+    searchContactsByPrefix(&contacts, "Sm", 0, countMatch, &matches);
+    ASSERT_EQ(500, matches);
+
+    matches = 0;
+    ASSERT_EQ(10, searchContactsByPrefix(&contacts, "Smy", 10, countMatch, &matches));
+
+    freeContacts(&contacts);
+    return TEST_PASS;
+}
+
 TEST(test_contact_file_operations) {
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
     Contact test = {"FileTest", "123", "file@f.com"};
 
     addContact(&contacts, &test);
-    saveContacts(contacts, "test_contacts.dat");
+    saveContacts(&contacts, "test_contacts.dat");
 
-    ContactNode *loaded = NULL;
+    ContactStore loaded = {0};
     loadContacts(&loaded, "test_contacts.dat");
 
-    ASSERT_NOT_NULL(loaded);
-    ASSERT_STR_EQ("FileTest", loaded->contact.name);
+    ASSERT_NOT_NULL(firstContact(&loaded));
+    ASSERT_STR_EQ("FileTest", firstContact(&loaded)->name);
 
     freeContacts(&contacts);
     freeContacts(&loaded);
@@ -147,7 +231,8 @@ TEST(test_memory_allocation_large) {
 TEST(test_memory_allocation_too_large) {
     initializeMemory();
 
-    void *ptr = myMalloc(10000);
+    // Arenas grow on demand; only sizes no mapping can hold fail
+    void *ptr = myMalloc(SIZE_MAX);
     ASSERT_NULL(ptr);
 
     return TEST_PASS;
@@ -178,7 +263,7 @@ TEST(test_memory_fragmentation) {
 TEST(test_encryption_basic) {
     const char *original = "Hello, World!";
     char encrypted[100];
-    char decrypted[100];
+    char decrypted[100] = {0};   // decryptData does not terminate the string
 
     encryptData(original, encrypted, strlen(original));
     decryptData(encrypted, decrypted, strlen(original));
@@ -209,33 +294,33 @@ TEST(test_encryption_empty) {
 
 // Integration Tests
 TEST(test_full_contact_lifecycle) {
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
 
     // Add
     Contact contact = {"Integration", "1234567890", "integration@test.com"};
     addContact(&contacts, &contact);
-    ASSERT_NOT_NULL(contacts);
+    ASSERT_NOT_NULL(firstContact(&contacts));
 
     // Display (should not crash)
-    displayContacts(contacts);
+    displayContacts(&contacts);
 
     // Update
     Contact updated = {"IntegrationUpdated", "0987654321", "updated@test.com"};
-    bool update_result = updateContact(contacts, "Integration", &updated);
+    bool update_result = updateContact(&contacts, "Integration", &updated);
     ASSERT_TRUE(update_result);
 
     // Save and Load
-    saveContacts(contacts, "integration_test.dat");
-    ContactNode *loaded = NULL;
+    saveContacts(&contacts, "integration_test.dat");
+    ContactStore loaded = {0};
     loadContacts(&loaded, "integration_test.dat");
 
-    ASSERT_NOT_NULL(loaded);
-    ASSERT_STR_EQ("IntegrationUpdated", loaded->contact.name);
+    ASSERT_NOT_NULL(firstContact(&loaded));
+    ASSERT_STR_EQ("IntegrationUpdated", firstContact(&loaded)->name);
 
     // Delete
     bool delete_result = deleteContact(&loaded, "IntegrationUpdated");
     ASSERT_TRUE(delete_result);
-    ASSERT_NULL(loaded);
+    ASSERT_NULL(firstContact(&loaded));
 
     // Cleanup
     freeContacts(&contacts);
@@ -276,7 +361,7 @@ TEST(test_memory_stress) {
 
 // Performance Tests
 TIMER_TEST(timer_contact_add_1000) {
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
     Contact contact = {"PerfTest", "1234567890", "perf@test.com"};
 
     clock_t start = clock();
@@ -317,6 +402,9 @@ int main(void) {
     addTestCase(contact_suite, "Update Nonexistent Contact", test_test_contact_update_nonexistent, NULL);
     addTestCase(contact_suite, "Delete Existing Contact", test_test_contact_delete_existing, NULL);
     addTestCase(contact_suite, "Delete Nonexistent Contact", test_test_contact_delete_nonexistent, NULL);
+    addTestCase(contact_suite, "Find Contact By Name", test_test_contact_find_by_name, NULL);
+    addTestCase(contact_suite, "Stale Handle After Delete", test_test_contact_stale_handle, NULL);
+    addTestCase(contact_suite, "Prefix Search", test_test_contact_prefix_search, NULL);
     addTestCase(contact_suite, "File Operations", test_test_contact_file_operations, NULL);
 
     // Memory Allocator Test Suite
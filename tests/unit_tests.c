@@ -1,10 +1,33 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "../include/contact_manager.h"
+#include "../include/contact_db.h"
+#include "../include/contact_pack.h"
+#include "../include/contact_load.h"
+#include "../include/contact_wal.h"
+#include "../include/contact_saver.h"
+#include "../include/contact_io.h"
+#include "../include/contact_shared.h"
+#include "../include/contact_version.h"
+#include "../include/contact_shards.h"
+#include "../include/contact_cursor.h"
+#include "../include/contact_view.h"
+#include "../include/contact_dedup.h"
+#include "../include/contact_query.h"
+#include "../include/contact_tags.h"
+#include "../include/contact_lazy.h"
+#include "../include/contact_collate.h"
 #include "../include/memory_allocator.h"
 #include "../include/security.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
 
 static int testsRun = 0;
 static int testsPassed = 0;
@@ -22,40 +45,287 @@ static int testsPassed = 0;
 
 void testContactOperations(void) {
     printf("\n=== Testing Contact Operations ===\n");
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
+    ContactIterator it;
 
     Contact test1 = {"John Doe", "1234567890", "john@example.com"};
     Contact test2 = {"Jane Smith", "9876543210", "jane@example.com"};
 
     addContact(&contacts, &test1);
-    ASSERT(contacts != NULL, "Add first contact");
-    ASSERT(strcmp(contacts->contact.name, "John Doe") == 0, "Contact name matches");
+    contactIteratorInit(&it, &contacts);
+    const Contact *first = contactIteratorNext(&it);
+    ASSERT(first != NULL, "Add first contact");
+    ASSERT(strcmp(first->name, "John Doe") == 0, "Contact name matches");
 
     addContact(&contacts, &test2);
-    ASSERT(strcmp(contacts->contact.name, "Jane Smith") == 0, "Second contact name matches (head insertion)");
+    contactIteratorInit(&it, &contacts);
+    contactIteratorNext(&it);
+    const Contact *second = contactIteratorNext(&it);
+    ASSERT(second != NULL && strcmp(second->name, "Jane Smith") == 0, "Second contact name matches (insertion order)");
 
     Contact updated = {"John Updated", "1111111111", "john@updated.com"};
-    bool updateResult = updateContact(contacts, "John Doe", &updated);
+    bool updateResult = updateContact(&contacts, "John Doe", &updated);
     ASSERT(updateResult == true, "Update existing contact");
 
-    ContactNode *current = contacts;
-    while (current != NULL && strcmp(current->contact.name, "John Updated") != 0) {
-        current = current->next;
+    const Contact *current;
+    contactIteratorInit(&it, &contacts);
+    while ((current = contactIteratorNext(&it)) != NULL) {
+        if (strcmp(current->name, "John Updated") == 0) {
+            break;
+        }
     }
-    ASSERT(current != NULL, "Updated contact found in list");
+    ASSERT(current != NULL, "Updated contact found in store");
 
-    bool updateNonExistent = updateContact(contacts, "Nonexistent", &updated);
+    bool updateNonExistent = updateContact(&contacts, "Nonexistent", &updated);
     ASSERT(updateNonExistent == false, "Update nonexistent contact fails");
 
     bool deleteResult = deleteContact(&contacts, "Jane Smith");
     ASSERT(deleteResult == true, "Delete existing contact");
-    ASSERT(contacts->next == NULL, "Contact removed from list");
+    contactIteratorInit(&it, &contacts);
+    contactIteratorNext(&it);
+    ASSERT(contactIteratorNext(&it) == NULL, "Contact removed from store");
 
     bool deleteNonExistent = deleteContact(&contacts, "Nonexistent");
     ASSERT(deleteNonExistent == false, "Delete nonexistent contact fails");
 
     freeContacts(&contacts);
-    ASSERT(contacts == NULL, "Free all contacts");
+    contactIteratorInit(&it, &contacts);
+    ASSERT(contacts.count == 0 && contactIteratorNext(&it) == NULL, "Free all contacts");
+}
+
+void testNameIndex(void) {
+    printf("\n=== Testing Name Index ===\n");
+    ContactStore contacts = {0};
+    Contact found;
+
+    for (int i = 0; i < 1000; i++) {
+        Contact contact = {"", "555", "bulk@example.com"};
+        snprintf(contact.name, sizeof(contact.name), "Contact %d", i);
+        addContact(&contacts, &contact);
+    }
+    ASSERT(contacts.count == 1000 && contacts.nameIndex.count == 1000, "Index tracks every added contact");
+
+    ASSERT(findContact(&contacts, "Contact 742", &found) && strcmp(found.name, "Contact 742") == 0,
+           "Find contact by name");
+    ASSERT(!findContact(&contacts, "Contact 1000", NULL), "Find missing contact fails");
+
+    Contact renamed = {"Renamed", "556", "renamed@example.com"};
+    updateContact(&contacts, "Contact 11", &renamed);
+    ASSERT(!findContact(&contacts, "Contact 11", NULL), "Old name leaves index after rename");
+    ASSERT(findContact(&contacts, "Renamed", &found) && strcmp(found.phone, "556") == 0,
+           "New name indexed after rename");
+
+    for (int i = 0; i < 1000; i += 2) {
+        char name[50];
+        snprintf(name, sizeof(name), "Contact %d", i);
+        deleteContact(&contacts, name);
+    }
+    ASSERT(!findContact(&contacts, "Contact 500", NULL), "Deleted contact leaves index");
+    ASSERT(findContact(&contacts, "Contact 501", NULL), "Neighbouring contacts survive deletes");
+    ASSERT(contacts.count == 500 && contacts.nameIndex.count == 500, "Index count follows deletes");
+
+    freeContacts(&contacts);
+    ASSERT(!findContact(&contacts, "Contact 501", NULL), "Index emptied by freeContacts");
+}
+
+void testSlabStore(void) {
+    printf("\n=== Testing Slab Store ===\n");
+    ContactStore contacts = {0};
+    int total = CONTACT_SLAB_SIZE * 2 + 10;
+
+    ASSERT(reserveContacts(&contacts, CONTACT_SLAB_SIZE * 3) && contacts.slabCount == 3, "Reserve preallocates slabs");
+
+    ContactHandle lastHandle = CONTACT_HANDLE_NONE;
+    for (int i = 0; i < total; i++) {
+        Contact contact = {"", "555", "slab@example.com"};
+        snprintf(contact.name, sizeof(contact.name), "Slab %d", i);
+        lastHandle = addContact(&contacts, &contact);
+    }
+    ASSERT(contacts.slabCount == 3, "Adds within reservation allocate no slabs");
+
+    for (int i = 0; i < total; i += 3) {
+        char name[50];
+        snprintf(name, sizeof(name), "Slab %d", i);
+        deleteContact(&contacts, name);
+    }
+
+    ContactIterator it;
+    const Contact *current;
+    int seen = 0;
+    bool ordered = true;
+    int previous = -1;
+    contactIteratorInit(&it, &contacts);
+    while ((current = contactIteratorNext(&it)) != NULL) {
+        int number = atoi(current->name + 5);
+        ordered = ordered && number > previous && number % 3 != 0;
+        previous = number;
+        seen++;
+    }
+    ASSERT(seen == (int)contacts.count && ordered, "Iteration skips tombstones across slabs");
+
+    Contact out;
+    ASSERT(getContact(&contacts, lastHandle, &out) && strcmp(out.name, "Slab 2057") == 0, "Handle resolves to contact");
+
+    Contact replacement = {"Replacement", "1", "r@example.com"};
+    size_t slotsBefore = contacts.slotCount;
+    addContact(&contacts, &replacement);
+    ASSERT(contacts.slotCount == slotsBefore, "Deleted slot is reused");
+
+    freeContacts(&contacts);
+}
+
+typedef struct {
+    char names[16][50];
+    int count;
+} NameCollector;
+
+static bool collectName(const Contact *contact, void *userData) {
+    NameCollector *collector = (NameCollector *)userData;
+    if (collector->count < 16) {
+        strcpy(collector->names[collector->count], contact->name);
+    }
+    collector->count++;
+    return true;
+}
+
+void testPrefixSearch(void) {
+    printf("\n=== Testing Prefix Search ===\n");
+    ContactStore contacts = {0};
+    const char *names[] = {"Anna", "Annabel", "Andrew", "Bob", "Annie", "Ann", "Zoe", "Andy"};
+    NameCollector collector;
+
+    for (int i = 0; i < 8; i++) {
+        Contact contact = {"", "555", "search@example.com"};
+        strcpy(contact.name, names[i]);
+        addContact(&contacts, &contact);
+    }
+
+    memset(&collector, 0, sizeof(collector));
+    searchContactsByPrefix(&contacts, "Ann", 0, collectName, &collector);
+    ASSERT(collector.count == 4, "Prefix search finds every match");
+    ASSERT(strcmp(collector.names[0], "Ann") == 0 && strcmp(collector.names[1], "Anna") == 0 &&
+           strcmp(collector.names[2], "Annabel") == 0 && strcmp(collector.names[3], "Annie") == 0,
+           "Prefix matches come back in name order");
+
+    memset(&collector, 0, sizeof(collector));
+    ASSERT(searchContactsByPrefix(&contacts, "An", 2, collectName, &collector) == 2 && collector.count == 2,
+           "Prefix search honours limit");
+
+    memset(&collector, 0, sizeof(collector));
+    searchContactsByPrefix(&contacts, "Annx", 0, collectName, &collector);
+    ASSERT(collector.count == 0, "Unmatched prefix finds nothing");
+
+    memset(&collector, 0, sizeof(collector));
+    searchContactsByRange(&contacts, "Andy", "Annie", 0, collectName, &collector);
+    ASSERT(collector.count == 4 && strcmp(collector.names[0], "Andy") == 0 &&
+           strcmp(collector.names[3], "Annabel") == 0, "Range search is half-open and ordered");
+
+    Contact renamed = {"Bobby", "556", "bobby@example.com"};
+    updateContact(&contacts, "Annabel", &renamed);
+    deleteContact(&contacts, "Anna");
+    memset(&collector, 0, sizeof(collector));
+    searchContactsByPrefix(&contacts, "Ann", 0, collectName, &collector);
+    ASSERT(collector.count == 2, "Tree follows rename and delete");
+
+    memset(&collector, 0, sizeof(collector));
+    searchContactsByRange(&contacts, NULL, NULL, 0, collectName, &collector);
+    ASSERT(collector.count == 7 && strcmp(collector.names[0], "Andrew") == 0 &&
+           strcmp(collector.names[6], "Zoe") == 0, "Open range walks all names in order");
+
+    Contact onto = {"Zoe", "557", "zoe2@example.com"};
+    ASSERT(updateContact(&contacts, "Andy", &onto), "Rename onto an existing name");
+    memset(&collector, 0, sizeof(collector));
+    searchContactsByPrefix(&contacts, "Zoe", 0, collectName, &collector);
+    ASSERT(collector.count == 2, "Both contacts stay in the tree under the shared name");
+    memset(&collector, 0, sizeof(collector));
+    searchContactsByPrefix(&contacts, "And", 0, collectName, &collector);
+    ASSERT(collector.count == 1 && strcmp(collector.names[0], "Andrew") == 0,
+           "Old name leaves the tree after the rename");
+
+    freeContacts(&contacts);
+}
+
+void testSecondaryIndexes(void) {
+    printf("\n=== Testing Phone/Email Indexes ===\n");
+    ContactStore contacts = {0};
+    Contact alice = {"Alice", "5550001", "alice@example.com"};
+    Contact bob = {"Bob", "5550002", "bob@example.com"};
+    Contact found;
+
+    addContact(&contacts, &alice);
+    ASSERT(findByPhone(&contacts, "5550001", &found) && strcmp(found.name, "Alice") == 0,
+           "Phone lookup works before indexes are enabled");
+
+    ASSERT(enableContactIndexes(&contacts, CONTACT_INDEX_PHONE | CONTACT_INDEX_EMAIL), "Enable phone/email indexes");
+    ASSERT(contacts.phoneIndex.count == 1 && contacts.emailIndex.count == 1, "Indexes built from existing contacts");
+
+    addContact(&contacts, &bob);
+    ASSERT(findByEmail(&contacts, "bob@example.com", &found) && strcmp(found.name, "Bob") == 0,
+           "Email index covers new contacts");
+
+    Contact movedBob = {"Bob", "5550003", "robert@example.com"};
+    updateContact(&contacts, "Bob", &movedBob);
+    ASSERT(!findByPhone(&contacts, "5550002", NULL) && findByPhone(&contacts, "5550003", NULL),
+           "Phone index follows update");
+    ASSERT(!findByEmail(&contacts, "bob@example.com", NULL) && findByEmail(&contacts, "robert@example.com", NULL),
+           "Email index follows update");
+
+    deleteContact(&contacts, "Alice");
+    ASSERT(!findByPhone(&contacts, "5550001", NULL) && !findByEmail(&contacts, "alice@example.com", NULL),
+           "Secondary indexes follow delete");
+
+    freeContacts(&contacts);
+    ASSERT(contacts.indexFlags == 0 && !findByEmail(&contacts, "robert@example.com", NULL),
+           "freeContacts drops secondary indexes");
+}
+
+void testPhoneNormalization(void) {
+    printf("\n=== Testing Phone Normalization ===\n");
+    PhoneKey key = normalizePhone("+1 (555) 010-0000");
+    char formatted[32];
+
+    ASSERT(key != PHONE_KEY_NONE && key == normalizePhone("15550100000"), "Formatting differences normalize to one key");
+    ASSERT(key == normalizePhone("555.010.0000") && key == normalizePhone("0015550100000"),
+           "National and 00-prefixed numbers get the country code");
+    ASSERT(normalizePhone("555-0100 ext 7") == PHONE_KEY_NONE && normalizePhone("") == PHONE_KEY_NONE,
+           "Unparseable numbers have no key");
+    ASSERT(normalizePhone("+1234567890123456") == PHONE_KEY_NONE, "Numbers longer than E.164 rejected");
+
+    formatPhoneKey(key, formatted, sizeof(formatted));
+    ASSERT(strcmp(formatted, "+15550100000") == 0, "Key formats back to E.164");
+    ASSERT(normalizePhone("+44 20 7946 0000") < normalizePhone("+44 20 7946 0001") &&
+           normalizePhone("+44") < normalizePhone("+440"), "Key order matches digit order");
+
+    ContactStore contacts = {0};
+    Contact alice = {"Alice", "(555) 010-0000", "alice@example.com"};
+    Contact found;
+    ContactHandle handle = addContact(&contacts, &alice);
+    ASSERT(contactPhoneKey(&contacts, handle) == key, "Store keeps normalized key beside the phone");
+    ASSERT(findByPhone(&contacts, "+1-555-010-0000", &found) && strcmp(found.name, "Alice") == 0,
+           "Phone scan matches across formats");
+    enableContactIndexes(&contacts, CONTACT_INDEX_PHONE);
+    ASSERT(findByPhone(&contacts, "1 555 010 0000", NULL), "Phone index matches across formats");
+
+    Contact moved = {"Alice", "+44 20 7946 0000", "alice@example.com"};
+    updateContact(&contacts, "Alice", &moved);
+    ASSERT(!findByPhone(&contacts, "5550100000", NULL) && findByPhone(&contacts, "00442079460000", NULL),
+           "Update re-normalizes the phone key");
+    freeContacts(&contacts);
+}
+
+static void *allocateLoop(void *arg) {
+    size_t *failed = (size_t *)arg;
+    void *blocks[500];
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 500; i++) {
+            blocks[i] = myMalloc((size_t)(i % 7 + 1) * 40);
+            *failed += blocks[i] == NULL;
+        }
+        for (int i = 0; i < 500; i++) {
+            myFree(blocks[i]);
+        }
+    }
+    return NULL;
 }
 
 void testMemoryAllocator(void) {
@@ -69,10 +339,12 @@ void testMemoryAllocator(void) {
     ASSERT(ptr2 != NULL, "Allocate 200 bytes");
 
     void *ptr3 = myMalloc(4096);
-    ASSERT(ptr3 == NULL, "Allocate too much memory fails");
+    ASSERT(ptr3 != NULL, "Allocate 4096 bytes");
+    ASSERT(myMalloc(SIZE_MAX) == NULL, "Allocate too much memory fails");
 
     myFree(ptr1);
     myFree(ptr2);
+    myFree(ptr3);
 
     void *ptr4 = myMalloc(300);
     ASSERT(ptr4 != NULL, "Allocate after coalescing");
@@ -84,6 +356,58 @@ void testMemoryAllocator(void) {
     analyzeMemory(&totalFree, &largestBlock, &fragmentCount);
     ASSERT(totalFree > 0, "Memory analysis shows free space");
     ASSERT(largestBlock > 0, "Largest block detected");
+
+    // Far more than the first arena holds: more arenas are mapped
+    size_t baseArenas, baseBytes;
+    memoryArenaStats(&baseArenas, &baseBytes);
+    void *blocks[2000];
+    bool allAllocated = true;
+    for (int i = 0; i < 2000; i++) {
+        blocks[i] = myMalloc(1000);
+        allAllocated = allAllocated && blocks[i] != NULL;
+        if (blocks[i] != NULL) {
+            memset(blocks[i], i & 0xFF, 1000);
+        }
+    }
+    size_t arenas, mappedBytes;
+    memoryArenaStats(&arenas, &mappedBytes);
+    ASSERT(allAllocated && arenas > baseArenas && mappedBytes >= 2000 * 1000, "Allocator grows by mapping arenas");
+
+    bool intact = true;
+    for (int i = 0; i < 2000; i++) {
+        intact = intact && ((unsigned char *)blocks[i])[999] == (i & 0xFF);
+    }
+    ASSERT(intact, "Blocks in different arenas do not overlap");
+
+    void *large = myMalloc(8 * 1024 * 1024);
+    memoryArenaStats(&arenas, &mappedBytes);
+    ASSERT(large != NULL && mappedBytes >= 2000 * 1000 + 8 * 1024 * 1024, "Large blocks get an arena of their own");
+    myFree(large);
+
+    for (int i = 0; i < 2000; i += 2) {
+        myFree(blocks[i]);
+    }
+    analyzeMemory(&totalFree, &largestBlock, &fragmentCount);
+    ASSERT(fragmentCount >= 1000 && totalFree >= 1000 * 1000, "Analysis covers every arena");
+    for (int i = 1; i < 2000; i += 2) {
+        myFree(blocks[i]);
+    }
+    memoryArenaStats(&arenas, &mappedBytes);
+    analyzeMemory(&totalFree, &largestBlock, &fragmentCount);
+    ASSERT(arenas == baseArenas && mappedBytes == baseBytes && fragmentCount == 1,
+           "Free arenas are returned to the OS");
+
+    pthread_t threads[4];
+    size_t failed[4] = {0};
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, allocateLoop, &failed[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    memoryArenaStats(&arenas, &mappedBytes);
+    ASSERT(failed[0] + failed[1] + failed[2] + failed[3] == 0 && arenas == baseArenas,
+           "Threads can allocate and free concurrently");
 }
 
 void testSecurity(void) {
@@ -109,7 +433,7 @@ void testSecurity(void) {
 
 void testFileOperations(void) {
     printf("\n=== Testing File Operations ===\n");
-    ContactNode *contacts = NULL;
+    ContactStore contacts = {0};
 
     Contact test1 = {"Alice", "1234567890", "alice@test.com"};
     Contact test2 = {"Bob", "0987654321", "bob@test.com"};
@@ -117,12 +441,1851 @@ void testFileOperations(void) {
     addContact(&contacts, &test1);
     addContact(&contacts, &test2);
 
-    saveContacts(contacts, "test_contacts.dat");
+    saveContacts(&contacts, "test_contacts.dat");
     ASSERT(remove("test_contacts.dat") == 0, "Save contacts creates file");
 
-    ContactNode *loadedContacts = NULL;
+    ContactStore loadedContacts = {0};
     loadContacts(&loadedContacts, "test_contacts.dat");
-    ASSERT(loadedContacts == NULL, "Load non-existent file creates empty list");
+    ASSERT(loadedContacts.count == 0, "Load non-existent file creates empty list");
+
+    freeContacts(&contacts);
+}
+
+void testContactDatabase(void) {
+    printf("\n=== Testing Contact Database ===\n");
+    ContactStore contacts = {0};
+
+    for (int i = 0; i < 100; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Contact %d", i);
+        snprintf(contact.phone, sizeof(contact.phone), "555-%04d", i);
+        snprintf(contact.email, sizeof(contact.email), "c%d@test.com", i);
+        addContact(&contacts, &contact);
+    }
+    contactDbWrite(&contacts, "test_db.dat", 0, NULL);
+
+    ContactDb db;
+    ASSERT(contactDbOpen(&db, "test_db.dat") == CONTACT_DB_OK, "Saved file opens as a database");
+    ASSERT(contactDbCount(&db) == 100, "Database header records contact count");
+    ASSERT(db.header->pageCount == (100 + CONTACT_DB_RECORDS_PER_PAGE - 1) / CONTACT_DB_RECORDS_PER_PAGE,
+           "Records are packed into fixed-size pages");
+    const Contact *record = contactDbRecord(&db, 42);
+    ASSERT(record != NULL && strcmp(record->name, "Contact 42") == 0, "Records are addressable in place");
+    ASSERT(contactDbRecord(&db, 100) == NULL, "Out-of-range record is rejected");
+    ASSERT(contactDbVerify(&db), "Checksums verify on a clean file");
+    contactDbClose(&db);
+
+    ContactStore loaded = {0};
+    loadContacts(&loaded, "test_db.dat");
+    ASSERT(loaded.count == 100 && findContact(&loaded, "Contact 99", NULL), "Database round-trips through load");
+    freeContacts(&loaded);
+
+    // Flip a byte inside the second data page
+    FILE *file = fopen("test_db.dat", "r+b");
+    fseek(file, 2 * CONTACT_DB_PAGE_SIZE + 10, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, 2 * CONTACT_DB_PAGE_SIZE + 10, SEEK_SET);
+    fputc(byte ^ 0xFF, file);
+    fclose(file);
+
+    ASSERT(contactDbOpen(&db, "test_db.dat") == CONTACT_DB_OK, "Header survives data corruption");
+    ASSERT(contactDbVerifyPage(&db, 0) && !contactDbVerifyPage(&db, 1), "Damaged page fails its checksum");
+    ASSERT(!contactDbVerify(&db), "Corruption is detected");
+    contactDbClose(&db);
+
+    loadContacts(&loaded, "test_db.dat");
+    ASSERT(loaded.count == 100 - CONTACT_DB_RECORDS_PER_PAGE, "Load skips only the damaged page");
+    freeContacts(&loaded);
+
+    // Files written before the versioned format are still readable
+    file = fopen("test_db.dat", "wb");
+    ContactIterator it;
+    const Contact *current;
+    contactIteratorInit(&it, &contacts);
+    while ((current = contactIteratorNext(&it)) != NULL) {
+        fwrite(current, sizeof(Contact), 1, file);
+    }
+    fclose(file);
+
+    ASSERT(contactDbOpen(&db, "test_db.dat") == CONTACT_DB_LEGACY, "Raw record file is detected as legacy");
+    loadContacts(&loaded, "test_db.dat");
+    ASSERT(loaded.count == 100, "Legacy file loads");
+    freeContacts(&loaded);
+
+    file = fopen("test_db.dat", "wb");
+    fputs("ECHO", file);
+    fclose(file);
+    ASSERT(contactDbOpen(&db, "test_db.dat") == CONTACT_DB_LEGACY, "Short file is detected as legacy");
+    file = fopen("test_db.dat", "wb");
+    fclose(file);
+    ASSERT(contactDbOpen(&db, "test_db.dat") == CONTACT_DB_LEGACY, "Empty file is detected as legacy");
+
+    remove("test_db.dat");
+    freeContacts(&contacts);
+}
+
+void testPackedSnapshot(void) {
+    printf("\n=== Testing Packed Snapshots ===\n");
+    ContactStore contacts = {0};
+    Contact edge[] = {
+        {"Zero Lead", "0044123", "zero@lead.org"},
+        {"Plus Sign", "+15551234567", "plus@example.com"},
+        {"Formatted", "(555) 010-0000", "formatted@example.com"},
+        {"No Phone", "", "nophone@example.com"},
+        {"Longest Number", "+999999999999999999", "long@example.com"},
+        {"No Domain", "5550001", "local-only"},
+        {"Trailing At", "5550002", "trailing@"},
+        {"No Email", "5550003", ""},
+        {"Nineteen Digits", "1234567890123456789", "n@example.com"},
+        {"A Name That Is Exactly Forty-Nine Characters Long", "1", "x@y.z"}
+    };
+    size_t edgeCount = sizeof(edge) / sizeof(edge[0]);
+    for (size_t i = 0; i < edgeCount; i++) {
+        addContact(&contacts, &edge[i]);
+    }
+    for (int i = 0; i < 1500; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Packed %d", i);
+        snprintf(contact.phone, sizeof(contact.phone), "+1555%07d", i * 7);
+        snprintf(contact.email, sizeof(contact.email), "p%d@%s", i, i % 3 ? "example.com" : "mail.org");
+        addContact(&contacts, &contact);
+    }
+
+    saveContacts(&contacts, "test_pack.dat");
+    contactDbWrite(&contacts, "test_paged.dat", 0, NULL);
+    ContactPack pack;
+    ASSERT(contactPackOpen(&pack, "test_pack.dat") == CONTACT_DB_OK &&
+           contactPackCount(&pack) == contacts.count && pack.domainCount == 4,
+           "Save writes a packed snapshot with a domain dictionary");
+    ASSERT(pack.header->blockCount == (contacts.count + CONTACT_PACK_BLOCK_RECORDS - 1) / CONTACT_PACK_BLOCK_RECORDS,
+           "Records are split into blocks");
+    ASSERT(pack.domains[0].length == 11 && memcmp(pack.domains[0].string, "example.com", 11) == 0,
+           "Most used domain gets the first id");
+
+    Contact block[CONTACT_PACK_BLOCK_RECORDS];
+    size_t count;
+    bool sorted = true;
+    ASSERT(contactPackDecodeBlock(&pack, 1, block, &count) && count == CONTACT_PACK_BLOCK_RECORDS,
+           "A block decodes on its own");
+    for (size_t i = 1; i < count; i++) {
+        sorted = sorted && strcmp(block[i - 1].name, block[i].name) < 0;
+    }
+    ASSERT(sorted, "Names are stored in order");
+    contactPackClose(&pack);
+
+    FILE *file = fopen("test_pack.dat", "rb");
+    fseek(file, 0, SEEK_END);
+    long packedSize = ftell(file);
+    fclose(file);
+    file = fopen("test_paged.dat", "rb");
+    fseek(file, 0, SEEK_END);
+    long pagedSize = ftell(file);
+    fclose(file);
+    ASSERT(packedSize * 4 < pagedSize, "Packed snapshot is a fraction of the paged size");
+
+    ContactStore loaded = {0};
+    loadContacts(&loaded, "test_pack.dat");
+    bool same = loaded.count == contacts.count;
+    ContactIterator it;
+    const Contact *current;
+    contactIteratorInit(&it, &contacts);
+    while (same && (current = contactIteratorNext(&it)) != NULL) {
+        Contact found;
+        same = findContact(&loaded, current->name, &found) && memcmp(&found, current, sizeof(found)) == 0;
+    }
+    ASSERT(same, "Every field round-trips exactly");
+    freeContacts(&loaded);
+
+    // Damage the second block: only its records are lost
+    ASSERT(contactPackOpen(&pack, "test_pack.dat") == CONTACT_DB_OK, "Snapshot reopens");
+    long damaged = (long)pack.blocks[1].offset + 5;
+    contactPackClose(&pack);
+    file = fopen("test_pack.dat", "r+b");
+    fseek(file, damaged, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, damaged, SEEK_SET);
+    fputc(byte ^ 0xFF, file);
+    fclose(file);
+    ASSERT(contactPackOpen(&pack, "test_pack.dat") == CONTACT_DB_OK && !contactPackVerifyBlock(&pack, 1) &&
+           contactPackVerifyBlock(&pack, 0) && !contactPackDecodeBlock(&pack, 1, block, &count),
+           "Damaged block fails its checksum");
+    contactPackClose(&pack);
+    loadContacts(&loaded, "test_pack.dat");
+    ASSERT(loaded.count == contacts.count - CONTACT_PACK_BLOCK_RECORDS, "Load skips only the damaged block");
+    freeContacts(&loaded);
+
+    remove("test_pack.dat");
+    remove("test_paged.dat");
+    freeContacts(&contacts);
+}
+
+void testParallelLoad(void) {
+    printf("\n=== Testing Parallel Load ===\n");
+    ContactStore contacts = {0};
+    size_t total = CONTACT_LOAD_PARALLEL_MIN + 3000;
+    for (size_t i = 0; i < total; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Loader %05zu", i);
+        snprintf(contact.phone, sizeof(contact.phone), "+1666%07zu", i);
+        snprintf(contact.email, sizeof(contact.email), "l%zu@host%zu.org", i, i % 37);
+        addContact(&contacts, &contact);
+    }
+    saveContacts(&contacts, "test_parallel.dat");
+
+    ContactStore serial = {0};
+    ContactStore parallel = {0};
+    contactLoadSetThreads(1);
+    loadContacts(&serial, "test_parallel.dat");
+    contactLoadSetThreads(4);
+    enableContactIndexes(&parallel, CONTACT_INDEX_PHONE | CONTACT_INDEX_EMAIL);
+    loadContacts(&parallel, "test_parallel.dat");
+    ASSERT(serial.count == total && parallel.count == total, "Serial and parallel loads find every contact");
+
+    bool same = true;
+    ContactIterator serialIt;
+    ContactIterator parallelIt;
+    contactIteratorInit(&serialIt, &serial);
+    contactIteratorInit(&parallelIt, &parallel);
+    for (size_t i = 0; same && i <= total; i++) {
+        const Contact *expected = contactIteratorNext(&serialIt);
+        const Contact *actual = contactIteratorNext(&parallelIt);
+        same = expected == NULL ? actual == NULL : actual != NULL && memcmp(expected, actual, sizeof(Contact)) == 0;
+    }
+    ASSERT(same, "Parallel load keeps the file's order and every field");
+
+    Contact found;
+    ASSERT(findContact(&parallel, "Loader 00007", &found) && strcmp(found.email, "l7@host7.org") == 0 &&
+           findContact(&parallel, "Loader 19000", &found) && !findContact(&parallel, "Loader", &found),
+           "Merged name index and filter find every part's contacts");
+    ASSERT(findByPhone(&parallel, "+16660012345", &found) && strcmp(found.name, "Loader 12345") == 0 &&
+           findByEmail(&parallel, "l18000@host18.org", &found) && strcmp(found.name, "Loader 18000") == 0,
+           "Secondary indexes survive the merge");
+    NameCollector collector = {0};
+    searchContactsByPrefix(&parallel, "Loader 1", 0, collectName, &collector);
+    ASSERT(collector.count == (int)(total - 10000) && strcmp(collector.names[0], "Loader 10000") == 0 &&
+           parallel.orderCount == total, "Name tree and insertion order cover the merged store");
+
+    Contact extra = {"Loader Extra", "555", "extra@host0.org"};
+    ASSERT(deleteContact(&parallel, "Loader 00100") && addContact(&parallel, &extra) != CONTACT_HANDLE_NONE &&
+           findContact(&parallel, "Loader Extra", &found) && !findContact(&parallel, "Loader 00100", &found) &&
+           parallel.count == total, "Merged store accepts changes");
+    freeContacts(&serial);
+    freeContacts(&parallel);
+
+    ContactPack pack;
+    contactPackOpen(&pack, "test_parallel.dat");
+    long damaged = (long)pack.blocks[3].offset + 5;
+    contactPackClose(&pack);
+    FILE *file = fopen("test_parallel.dat", "r+b");
+    fseek(file, damaged, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, damaged, SEEK_SET);
+    fputc(byte ^ 0xFF, file);
+    fclose(file);
+    loadContacts(&parallel, "test_parallel.dat");
+    ASSERT(parallel.count == total - CONTACT_PACK_BLOCK_RECORDS && !findContact(&parallel, "Loader 01600", &found) &&
+           findContact(&parallel, "Loader 02100", &found), "Parallel load skips only the damaged block");
+    freeContacts(&parallel);
+
+    contactLoadSetThreads(0);
+    remove("test_parallel.dat");
+    freeContacts(&contacts);
+}
+
+void testWriteAheadLog(void) {
+    printf("\n=== Testing Write-Ahead Log ===\n");
+    remove("test_wal.dat");
+    remove("test_wal.log");
+
+    ContactStore contacts = {0};
+    ContactWal wal;
+    ASSERT(contactWalRecover(&wal, &contacts, "test_wal.dat", "test_wal.log"), "Log opens without a snapshot");
+    ASSERT(contacts.wal == &wal && contacts.count == 0, "Store starts empty with log attached");
+
+    Contact alice = {"Alice", "555-0001", "alice@test.com"};
+    Contact bob = {"Bob", "555-0002", "bob@test.com"};
+    Contact carol = {"Carol", "555-0003", "carol@test.com"};
+    Contact alice2 = {"Alice", "555-9999", "alice@new.com"};
+    addContact(&contacts, &alice);
+    addContact(&contacts, &bob);
+    addContact(&contacts, &carol);
+    updateContact(&contacts, "Alice", &alice2);
+    deleteContact(&contacts, "Bob");
+    ASSERT(wal.sequence == 5 && wal.logged == 5, "Each change appends one record");
+
+    // Drop the store without saving, as a crash would
+    contactWalClose(&wal, &contacts);
+    freeContacts(&contacts);
+
+    ASSERT(contactWalRecover(&wal, &contacts, "test_wal.dat", "test_wal.log"), "Log reopens");
+    Contact found;
+    ASSERT(contacts.count == 2, "Replay restores unsaved changes");
+    ASSERT(findContact(&contacts, "Alice", &found) && strcmp(found.phone, "555-9999") == 0, "Replay applies updates");
+    ASSERT(!findContact(&contacts, "Bob", NULL), "Replay applies deletes");
+    ASSERT(wal.sequence == 5, "Sequence resumes after replay");
+
+    // Saving without truncating the log must not replay it twice
+    saveContacts(&contacts, "test_wal.dat");
+    contactWalClose(&wal, &contacts);
+    freeContacts(&contacts);
+    contactWalRecover(&wal, &contacts, "test_wal.dat", "test_wal.log");
+    ASSERT(contacts.count == 2, "Records already in the snapshot are skipped");
+
+    ASSERT(contactWalCheckpoint(&wal, &contacts), "Checkpoint succeeds");
+    FILE *file = fopen("test_wal.log", "rb");
+    fseek(file, 0, SEEK_END);
+    ASSERT(ftell(file) == 0 && wal.logged == 0, "Checkpoint truncates the log");
+    fclose(file);
+
+    addContact(&contacts, &bob);
+    contactWalClose(&wal, &contacts);
+    freeContacts(&contacts);
+
+    // A record cut off mid-write is discarded
+    file = fopen("test_wal.log", "ab");
+    fwrite("torn", 1, 4, file);
+    fclose(file);
+
+    contactWalRecover(&wal, &contacts, "test_wal.dat", "test_wal.log");
+    ASSERT(contacts.count == 3 && findContact(&contacts, "Bob", NULL), "Log after checkpoint replays over snapshot");
+    file = fopen("test_wal.log", "rb");
+    fseek(file, 0, SEEK_END);
+    ASSERT(ftell(file) == (long)sizeof(ContactWalRecord), "Torn tail is truncated");
+    fclose(file);
+
+    // An append cut short by the file size limit is cut off the log again
+    struct rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    struct rlimit lowered = limit;
+    lowered.rlim_cur = (rlim_t)(sizeof(ContactWalRecord) * 3 / 2);
+    signal(SIGXFSZ, SIG_IGN);
+    setrlimit(RLIMIT_FSIZE, &lowered);
+    Contact dave = {"Dave", "555-0004", "dave@test.com"};
+    addContact(&contacts, &dave);
+    setrlimit(RLIMIT_FSIZE, &limit);
+    signal(SIGXFSZ, SIG_DFL);
+    ASSERT(wal.broken && wal.sequence == 6, "Short append marks the log broken");
+    file = fopen("test_wal.log", "rb");
+    fseek(file, 0, SEEK_END);
+    ASSERT(ftell(file) == (long)sizeof(ContactWalRecord), "Short append is truncated");
+    fclose(file);
+
+    Contact erin = {"Erin", "555-0005", "erin@test.com"};
+    addContact(&contacts, &erin);
+    ASSERT(wal.sequence == 6 && contacts.count == 5, "Broken log takes no more records");
+    ASSERT(contactWalMaintain(&wal, &contacts) && !wal.broken, "Checkpoint repairs a broken log");
+    deleteContact(&contacts, "Erin");
+    contactWalClose(&wal, &contacts);
+    freeContacts(&contacts);
+
+    contactWalRecover(&wal, &contacts, "test_wal.dat", "test_wal.log");
+    ASSERT(contacts.count == 4 && findContact(&contacts, "Dave", NULL) && !findContact(&contacts, "Erin", NULL),
+           "Changes around a failed append survive recovery");
+
+    // A synced list replaces the contacts but not the log or the indexes
+    ContactStore synced = {0};
+    addContact(&synced, &erin);
+    enableContactIndexes(&contacts, CONTACT_INDEX_PHONE);
+    ASSERT(replaceContacts(&contacts, &synced) && contacts.count == 1 && contacts.wal == &wal &&
+           findByPhone(&contacts, "555-0005", NULL), "Replacing the list keeps its log and indexes");
+    freeContacts(&synced);
+
+    // A record left idle is still synced once it is an interval old
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    ContactWalFlusher flusher;
+    ASSERT(contactWalFlusherStart(&flusher, &wal, &lock), "Log flusher starts");
+    pthread_mutex_lock(&lock);
+    size_t syncs = wal.syncs;
+    addContact(&contacts, &dave);
+    bool waiting = wal.pending == 1;
+    pthread_mutex_unlock(&lock);
+    struct timespec pause = {0, (long)wal.groupIntervalMs * 3 * 1000000L};
+    nanosleep(&pause, NULL);
+    pthread_mutex_lock(&lock);
+    ASSERT(waiting && wal.syncs == syncs + 1 && wal.pending == 0, "Flusher syncs an idle record after the interval");
+    pthread_mutex_unlock(&lock);
+    contactWalFlusherStop(&flusher);
+
+    contactWalClose(&wal, &contacts);
+    freeContacts(&contacts);
+    remove("test_wal.dat");
+    remove("test_wal.log");
+}
+
+static void countSave(const ContactSaveResult *result, void *userData) {
+    if (result->ok) {
+        (*(int *)userData)++;
+    }
+}
+
+void testAsyncSave(void) {
+    printf("\n=== Testing Background Saves ===\n");
+    ContactStore contacts = {0};
+    for (int i = 0; i < 500; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Contact %d", i);
+        snprintf(contact.phone, sizeof(contact.phone), "555-%04d", i);
+        snprintf(contact.email, sizeof(contact.email), "c%d@test.com", i);
+        addContact(&contacts, &contact);
+    }
+
+    ContactSaver saver;
+    int completed = 0;
+    ASSERT(contactSaverStart(&saver), "Writer thread starts");
+    ASSERT(saveContactsAsync(&saver, &contacts, "test_async.dat", countSave, &completed), "Save is queued");
+
+    // Changes made while the save runs stay out of the snapshot
+    Contact extra = {"Late Arrival", "555-9999", "late@test.com"};
+    addContact(&contacts, &extra);
+    deleteContact(&contacts, "Contact 0");
+    contactSaverWait(&saver);
+    ASSERT(completed == 1, "Completion callback runs");
+
+    ContactPack pack;
+    ASSERT(contactPackOpen(&pack, "test_async.dat") == CONTACT_DB_OK && contactPackCount(&pack) == 500,
+           "Snapshot holds the store as of the request");
+    bool verified = true;
+    for (size_t block = 0; block < pack.header->blockCount; block++) {
+        verified = verified && contactPackVerifyBlock(&pack, block);
+    }
+    ASSERT(verified, "Background snapshot verifies");
+    contactPackClose(&pack);
+
+    // Back-to-back saves use both buffers
+    saveContactsAsync(&saver, &contacts, "test_async.dat", countSave, &completed);
+    saveContactsAsync(&saver, &contacts, "test_async.dat", countSave, &completed);
+    saveContactsAsync(&saver, &contacts, "test_async.dat", countSave, &completed);
+    contactSaverStop(&saver);
+    ASSERT(completed == 4, "Queued saves finish before stop returns");
+
+    ContactSaveStats stats;
+    contactSaverStats(&saver, &stats);
+    ASSERT(stats.saves == 4 && stats.failures == 0 && stats.maxMs >= stats.lastMs, "Save latency is tracked");
+
+    ContactStore loaded = {0};
+    loadContacts(&loaded, "test_async.dat");
+    ASSERT(loaded.count == 500 && findContact(&loaded, "Late Arrival", NULL) && !findContact(&loaded, "Contact 0", NULL),
+           "Latest snapshot replaces the file");
+    freeContacts(&loaded);
+
+    remove("test_async.dat");
+    freeContacts(&contacts);
+}
+
+void testImportExport(void) {
+    printf("\n=== Testing Import/Export ===\n");
+    FILE *file = fopen("test_import.csv", "w");
+    fputs("Name,Phone,Email\r\n"
+          "Alice,555-0001,alice@test.com\r\n"
+          "\"Smith, Bob\",555-0002,bob@test.com\n"
+          "\"Carol \"\"CJ\"\" Jones\",,carol@test.com\n"
+          "Alice,555-9999,other@test.com\n"
+          "missing,fields\n"
+          "\n"
+          "Dave,555-0004,dave@test.com", file);
+    fclose(file);
+
+    ContactStore contacts = {0};
+    ContactIoStats stats;
+    ASSERT(importContacts(&contacts, "test_import.csv", CONTACT_FORMAT_CSV, &stats), "CSV import runs");
+    ASSERT(stats.records == 5 && stats.imported == 4, "CSV rows are imported");
+    ASSERT(stats.duplicates == 1 && stats.invalid == 1, "Duplicates and malformed rows are counted");
+    ASSERT(findContact(&contacts, "Smith, Bob", NULL), "Quoted field keeps its comma");
+    Contact found;
+    ASSERT(findContact(&contacts, "Carol \"CJ\" Jones", &found) && found.phone[0] == '\0',
+           "Escaped quotes and empty fields parse");
+    ASSERT(findContact(&contacts, "Dave", NULL), "Last line without newline is read");
+
+    ContactStore reloaded = {0};
+    ASSERT(exportContacts(&contacts, "test_export.vcf", CONTACT_FORMAT_VCARD, &stats) && stats.records == 4,
+           "vCard export writes every contact");
+    importContacts(&reloaded, "test_export.vcf", CONTACT_FORMAT_VCARD, &stats);
+    ASSERT(stats.imported == 4 && findContact(&reloaded, "Smith, Bob", &found) &&
+           strcmp(found.email, "bob@test.com") == 0, "vCard round-trips");
+    freeContacts(&reloaded);
+
+    exportContacts(&contacts, "test_export.csv", CONTACT_FORMAT_CSV, &stats);
+    importContacts(&reloaded, "test_export.csv", CONTACT_FORMAT_CSV, &stats);
+    ASSERT(stats.imported == 4 && findContact(&reloaded, "Carol \"CJ\" Jones", NULL), "CSV round-trips");
+    freeContacts(&reloaded);
+
+    file = fopen("test_import.vcf", "w");
+    fputs("BEGIN:VCARD\nVERSION:3.0\nFN:Eve\nTEL;TYPE=cell:555-0005\nTEL:555-0006\n"
+          "item1.EMAIL;TYPE=work:eve@test.com\nEND:VCARD\n"
+          "BEGIN:VCARD\nVERSION:3.0\nTEL:555-0007\nEND:VCARD\n", file);
+    fclose(file);
+    importContacts(&contacts, "test_import.vcf", CONTACT_FORMAT_VCARD, &stats);
+    ASSERT(stats.imported == 1 && stats.invalid == 1, "Cards without a name are rejected");
+    ASSERT(findContact(&contacts, "Eve", &found) && strcmp(found.phone, "555-0005") == 0 &&
+           strcmp(found.email, "eve@test.com") == 0, "vCard parameters and groups are handled");
+
+    ASSERT(contactFormatForFile("people.VCF") == CONTACT_FORMAT_VCARD &&
+           contactFormatForFile("people.csv") == CONTACT_FORMAT_CSV, "Format follows the file extension");
+
+    remove("test_import.csv");
+    remove("test_import.vcf");
+    remove("test_export.csv");
+    remove("test_export.vcf");
+    freeContacts(&contacts);
+}
+
+void testCompactStorage(void) {
+    printf("\n=== Testing Compact Storage ===\n");
+    ContactStore contacts = {0};
+
+    for (int i = 0; i < 5000; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Person %d", i);
+        snprintf(contact.phone, sizeof(contact.phone), "555-%04d", i);
+        snprintf(contact.email, sizeof(contact.email), "p%d@%s.com", i, i % 2 ? "example" : "test");
+        addContact(&contacts, &contact);
+    }
+    ASSERT(contacts.domains.count == 2, "Email domains are interned once");
+    ASSERT(sizeof(ContactSlot) <= 32 && contactStoreBytes(&contacts) / contacts.count < sizeof(Contact),
+           "Stored contacts take less than sizeof(Contact)");
+
+    Contact found;
+    ASSERT(findContact(&contacts, "Person 4321", &found) && strcmp(found.email, "p4321@example.com") == 0 &&
+           strcmp(found.phone, "555-4321") == 0, "Contacts unpack to the original fields");
+    ASSERT(findByEmail(&contacts, "p17@example.com", NULL) && !findByEmail(&contacts, "p17@test.com", NULL),
+           "Email scan matches local part and domain");
+    enableContactIndexes(&contacts, CONTACT_INDEX_EMAIL);
+    ASSERT(findByEmail(&contacts, "p18@test.com", &found) && strcmp(found.name, "Person 18") == 0,
+           "Email index matches split emails");
+    ASSERT(!findByEmail(&contacts, "p18@test.co", NULL) && !findByEmail(&contacts, "p18", NULL),
+           "Partial emails do not match");
+
+    Contact odd = {"", "", ""};
+    memset(odd.name, 'x', sizeof(odd.name));
+    strcpy(odd.email, "no-domain@");
+    addContact(&contacts, &odd);
+    char truncated[sizeof(odd.name)];
+    memset(truncated, 'x', sizeof(truncated) - 1);
+    truncated[sizeof(truncated) - 1] = '\0';
+    ASSERT(findContact(&contacts, truncated, &found) && strcmp(found.email, "no-domain@") == 0 &&
+           found.phone[0] == '\0', "Unterminated and empty fields are stored safely");
+
+    // Churn the store so dead records get compacted away
+    for (int round = 0; round < 5; round++) {
+        for (int i = 0; i < 5000; i += 2) {
+            Contact contact;
+            snprintf(contact.name, sizeof(contact.name), "Person %d", i);
+            snprintf(contact.phone, sizeof(contact.phone), "555-%04d-%d", i, round);
+            snprintf(contact.email, sizeof(contact.email), "p%d@example.com", i);
+            updateContact(&contacts, contact.name, &contact);
+        }
+    }
+    ASSERT(contacts.records.garbageBytes <= contacts.records.liveBytes + STRING_ARENA_CHUNK_SIZE,
+           "Dead records are compacted");
+    ASSERT(findContact(&contacts, "Person 2000", &found) && strcmp(found.phone, "555-2000-4") == 0 &&
+           findByEmail(&contacts, "p2000@example.com", NULL), "Compaction keeps records and indexes intact");
+
+    freeContacts(&contacts);
+}
+
+typedef struct {
+    ContactShared *shared;
+    atomic_bool *stop;
+    size_t reads;
+    size_t misses;
+    size_t torn;
+} SharedReader;
+
+static void *readShared(void *arg) {
+    SharedReader *reader = (SharedReader *)arg;
+    while (!*reader->stop || reader->reads == 0) {
+        ContactReadToken token;
+        const ContactStore *store = contactReadBegin(reader->shared, &token);
+        char name[50];
+        snprintf(name, sizeof(name), "Anchor %zu", reader->reads % 100);
+        if (!findContact(store, name, NULL)) {
+            reader->misses++;
+        }
+
+        // A reader's copy never changes under it
+        ContactIterator it;
+        size_t seen = 0;
+        contactIteratorInit(&it, store);
+        while (contactIteratorNext(&it) != NULL) {
+            seen++;
+        }
+        if (seen != store->count) {
+            reader->torn++;
+        }
+        contactReadEnd(reader->shared, &token);
+        reader->reads++;
+    }
+    return NULL;
+}
+
+static bool loadSharedLog(ContactStore *store, void *arg) {
+    return contactWalRecover((ContactWal *)arg, store, "test_shared.dat", "test_shared.log");
+}
+
+void testSharedStore(void) {
+    printf("\n=== Testing Shared Store ===\n");
+    remove("test_shared.dat");
+    remove("test_shared.log");
+
+    ContactShared shared;
+    ContactWal wal;
+    contactSharedInit(&shared);
+    ASSERT(contactSharedReplace(&shared, loadSharedLog, &wal), "Bulk load runs once and is copied");
+    ASSERT(shared.stores[0].wal == &wal && shared.stores[1].wal == &wal, "Both copies share the log");
+
+    for (int i = 0; i < 100; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Anchor %d", i);
+        snprintf(contact.phone, sizeof(contact.phone), "555-%04d", i);
+        snprintf(contact.email, sizeof(contact.email), "a%d@test.com", i);
+        contactSharedAdd(&shared, &contact);
+    }
+    ASSERT(wal.logged == 100, "Each change is logged once");
+    ASSERT(shared.stores[0].count == 100 && shared.stores[1].count == 100, "Changes reach both copies");
+    ASSERT(findContactHandle(&shared.stores[0], "Anchor 42") == findContactHandle(&shared.stores[1], "Anchor 42"),
+           "Handles agree between copies");
+
+    atomic_bool stop = false;
+    SharedReader readers[4];
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        readers[i] = (SharedReader){&shared, &stop, 0, 0, 0};
+        pthread_create(&threads[i], NULL, readShared, &readers[i]);
+    }
+
+    // Churn the store while the readers run
+    for (int round = 0; round < 300; round++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Churn %d", round);
+        snprintf(contact.phone, sizeof(contact.phone), "555-9%03d", round);
+        snprintf(contact.email, sizeof(contact.email), "c%d@churn.com", round);
+        contactSharedAdd(&shared, &contact);
+        snprintf(contact.name, sizeof(contact.name), "Anchor %d", round % 100);
+        contactSharedUpdate(&shared, contact.name, &contact);
+        if (round % 3 == 0) {
+            snprintf(contact.name, sizeof(contact.name), "Churn %d", round);
+            contactSharedDelete(&shared, contact.name);
+        }
+    }
+    stop = true;
+
+    size_t reads = 0, misses = 0, torn = 0;
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        reads += readers[i].reads;
+        misses += readers[i].misses;
+        torn += readers[i].torn;
+    }
+    ASSERT(reads > 0 && misses == 0, "Readers always find existing contacts");
+    ASSERT(torn == 0, "Readers never see a half-applied change");
+
+    Contact found;
+    ASSERT(contactSharedCount(&shared) == 300 && contactSharedFind(&shared, "Anchor 7", &found) &&
+           strcmp(found.email, "c207@churn.com") == 0 && strcmp(found.phone, "555-9207") == 0,
+           "Final state matches the writes");
+    ASSERT(shared.stores[0].count == shared.stores[1].count, "Copies converge");
+
+    contactWalClose(&wal, NULL);
+    contactSharedFree(&shared);
+    remove("test_shared.dat");
+    remove("test_shared.log");
+}
+
+typedef struct {
+    size_t count;
+    size_t churned;   // contacts written after the snapshot
+} SnapshotTally;
+
+static bool tallyContact(const Contact *contact, void *userData) {
+    SnapshotTally *tally = (SnapshotTally *)userData;
+    tally->count++;
+    if (strstr(contact->email, "@churn.com") != NULL) {
+        tally->churned++;
+    }
+    return true;
+}
+
+static size_t scanSnapshot(const ContactStore *store, const ContactSnapshot *snapshot, SnapshotTally *tally) {
+    uint32_t slot = 0;
+    size_t visited = 0;
+    tally->count = 0;
+    tally->churned = 0;
+    while (slot != CONTACT_SLOT_NONE) {
+        visited += contactScanAt(store, snapshot, &slot, 64, tallyContact, tally);
+    }
+    return visited;
+}
+
+static void *churnShared(void *arg) {
+    ContactShared *shared = (ContactShared *)arg;
+    for (int round = 0; round < 300; round++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Churn %d", round);
+        snprintf(contact.phone, sizeof(contact.phone), "555-9%03d", round);
+        snprintf(contact.email, sizeof(contact.email), "c%d@churn.com", round);
+        contactSharedAdd(shared, &contact);
+        snprintf(contact.name, sizeof(contact.name), "Version %d", round);
+        contactSharedUpdate(shared, contact.name, &contact);
+        snprintf(contact.name, sizeof(contact.name), "Version %d", 999 - round);
+        contactSharedDelete(shared, contact.name);
+    }
+    return NULL;
+}
+
+void testVersionedReads(void) {
+    printf("\n=== Testing Versioned Reads ===\n");
+    ContactStore contacts = {0};
+    for (int i = 0; i < 200; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Version %d", i);
+        snprintf(contact.phone, sizeof(contact.phone), "555-%04d", i);
+        snprintf(contact.email, sizeof(contact.email), "v%d@test.com", i);
+        addContact(&contacts, &contact);
+    }
+    ASSERT(contacts.version == 200 && contacts.history == NULL, "Each change commits a version; no history without snapshots");
+
+    ContactSnapshot first;
+    ASSERT(contactSnapshotOpen(&contacts, &first) && first.version == 200 && first.count == 200, "Snapshot opens at the current version");
+
+    Contact changed = {"Version 1", "555-1111", "changed@test.com"};
+    Contact renamed = {"Renamed 3", "555-3333", "v3@test.com"};
+    Contact newcomer = {"Newcomer", "555-7777", "new@test.com"};
+    updateContact(&contacts, "Version 1", &changed);
+    deleteContact(&contacts, "Version 2");
+    updateContact(&contacts, "Version 3", &renamed);
+    addContact(&contacts, &newcomer);
+    ASSERT(contactVersionCount(&contacts) == 3, "Replaced and deleted contents are kept for the snapshot");
+
+    Contact found;
+    ASSERT(contactGetAt(&contacts, &first, "Version 1", &found) && strcmp(found.phone, "555-0001") == 0 &&
+           strcmp(found.email, "v1@test.com") == 0, "Snapshot sees the contact before the update");
+    ASSERT(findContact(&contacts, "Version 1", &found) && strcmp(found.phone, "555-1111") == 0,
+           "Current reads see the update");
+    ASSERT(contactGetAt(&contacts, &first, "Version 2", NULL) && !findContact(&contacts, "Version 2", NULL),
+           "Snapshot still sees a deleted contact");
+    ASSERT(contactGetAt(&contacts, &first, "Version 3", &found) && !contactGetAt(&contacts, &first, "Renamed 3", &found),
+           "Snapshot sees the name before a rename");
+    ASSERT(!contactGetAt(&contacts, &first, "Newcomer", &found), "Snapshot does not see later additions");
+
+    SnapshotTally tally;
+    ASSERT(scanSnapshot(&contacts, &first, &tally) == 200 && tally.count == first.count,
+           "Scan at a snapshot visits exactly its contacts");
+
+    ContactSnapshot second;
+    contactSnapshotOpen(&contacts, &second);
+    Contact again = {"Version 1", "555-2222", "again@test.com"};
+    updateContact(&contacts, "Version 1", &again);
+    ASSERT(contactGetAt(&contacts, &second, "Version 1", &found) && strcmp(found.phone, "555-1111") == 0 &&
+           contactGetAt(&contacts, &first, "Version 1", &found) && strcmp(found.phone, "555-0001") == 0,
+           "Each snapshot sees its own version");
+
+    contactSnapshotClose(&contacts, &first);
+    ASSERT(contactVersionCount(&contacts) == 1, "Closing the oldest snapshot collects what only it could see");
+
+    // Enough rewrites to compact the arena while the second snapshot is open
+    for (int i = 0; i < 20000; i++) {
+        Contact contact = {"Version 10", "", "rewritten@test.com"};
+        snprintf(contact.phone, sizeof(contact.phone), "555-%05d", i);
+        updateContact(&contacts, "Version 10", &contact);
+    }
+    ASSERT(contactVersionCount(&contacts) == 2, "Rewrites no snapshot can see are not kept");
+    ASSERT(contactGetAt(&contacts, &second, "Version 1", &found) && strcmp(found.phone, "555-1111") == 0 &&
+           contactGetAt(&contacts, &second, "Version 10", &found) && strcmp(found.phone, "555-0010") == 0,
+           "Kept contents survive compaction");
+
+    ContactStore copy = {0};
+    ASSERT(copyContacts(&copy, &contacts) && contactGetAt(&copy, &second, "Version 1", &found) &&
+           strcmp(found.phone, "555-1111") == 0, "Copies keep the open snapshots");
+    freeContacts(&copy);
+
+    contactSnapshotClose(&contacts, &second);
+    ASSERT(contacts.history == NULL && contactVersionCount(&contacts) == 0, "Closing the last snapshot frees the history");
+    freeContacts(&contacts);
+
+    // Shared store: a scan runs alongside a writer and sees one version
+    ContactShared shared;
+    contactSharedInit(&shared);
+    for (int i = 0; i < 1000; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Version %d", i);
+        snprintf(contact.phone, sizeof(contact.phone), "555-%04d", i);
+        snprintf(contact.email, sizeof(contact.email), "v%d@test.com", i);
+        contactSharedAdd(&shared, &contact);
+    }
+
+    ContactSnapshot snapshot;
+    ASSERT(contactSharedSnapshot(&shared, &snapshot) && snapshot.count == 1000, "Shared snapshot opens on both copies");
+    pthread_t writer;
+    pthread_create(&writer, NULL, churnShared, &shared);
+    size_t scans = 0;
+    bool consistent = true;
+    for (int i = 0; i < 20; i++) {
+        SnapshotTally sharedTally = {0, 0};
+        consistent = consistent && contactSharedScan(&shared, &snapshot, tallyContact, &sharedTally) == 1000 &&
+                     sharedTally.churned == 0;
+        scans++;
+    }
+    pthread_join(writer, NULL);
+    SnapshotTally sharedTally = {0, 0};
+    consistent = consistent && contactSharedScan(&shared, &snapshot, tallyContact, &sharedTally) == 1000 &&
+                 sharedTally.churned == 0;
+    ASSERT(scans == 20 && consistent, "Scans during writes see only the snapshot");
+    contactSharedRelease(&shared, &snapshot);
+    ASSERT(shared.stores[0].history == NULL && shared.stores[1].history == NULL, "Released on both copies");
+
+    ContactSaver saver;
+    int completed = 0;
+    contactSaverStart(&saver);
+    ASSERT(saveSharedContactsAsync(&saver, &shared, "test_versioned.dat", countSave, &completed),
+           "Shared save copies from a snapshot");
+    contactSaverStop(&saver);
+    ContactPack pack;
+    ASSERT(completed == 1 && contactPackOpen(&pack, "test_versioned.dat") == CONTACT_DB_OK &&
+           contactPackCount(&pack) == contactSharedCount(&shared), "Snapshot save holds the whole store");
+    contactPackClose(&pack);
+    ASSERT(shared.stores[0].history == NULL, "Save releases its snapshot");
+
+    remove("test_versioned.dat");
+    contactSharedFree(&shared);
+}
+
+typedef struct {
+    ContactShards *store;
+    int thread;
+} ShardWriter;
+
+static void *writeShards(void *arg) {
+    ShardWriter *writer = (ShardWriter *)arg;
+    for (int i = 0; i < 500; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Writer %d-%d", writer->thread, i);
+        snprintf(contact.phone, sizeof(contact.phone), "555-%d%03d", writer->thread, i);
+        snprintf(contact.email, sizeof(contact.email), "w%d.%d@test.com", writer->thread, i);
+        contactShardsAdd(writer->store, &contact);
+    }
+    return NULL;
+}
+
+void testShardedStore(void) {
+    printf("\n=== Testing Sharded Store ===\n");
+    ContactShards store;
+    ASSERT(contactShardsInit(&store, 8), "Sharded store initializes");
+
+    ShardWriter writers[4];
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        writers[i] = (ShardWriter){&store, i};
+        pthread_create(&threads[i], NULL, writeShards, &writers[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    ASSERT(contactShardsCount(&store) == 2000, "Concurrent inserts all land");
+
+    size_t used = 0;
+    for (size_t i = 0; i < store.count; i++) {
+        used += contactSharedCount(&store.shards[i]) > 0;
+    }
+    ASSERT(used == store.count, "Names spread over every shard");
+
+    // Renames that change shard move the contact
+    Contact renamed = {"Renamed", "555-0000", "renamed@test.com"};
+    const char *oldName = "Writer 0-0";
+    for (int i = 1; contactShardFor(&store, oldName) == contactShardFor(&store, renamed.name); i++) {
+        snprintf(renamed.name, sizeof(renamed.name), "Renamed %d", i);
+    }
+    Contact found;
+    ASSERT(contactShardsUpdate(&store, oldName, &renamed) && !contactShardsFind(&store, oldName, NULL) &&
+           contactShardsFind(&store, renamed.name, &found) && strcmp(found.phone, "555-0000") == 0,
+           "Cross-shard rename moves the contact");
+    ASSERT(!contactShardsUpdate(&store, "Nobody", &renamed) && contactShardsCount(&store) == 2000,
+           "Renaming a missing contact changes nothing");
+    ASSERT(contactShardFor(&store, "WRITER 0-1") == contactShardFor(&store, "Writer 0-1"),
+           "Names differing in case share a shard");
+    Contact recased = {"Recased", "555-0001", "recased@test.com"};
+    for (int i = 1; contactShardFor(&store, "Writer 0-1") == contactShardFor(&store, recased.name); i++) {
+        snprintf(recased.name, sizeof(recased.name), "Recased %d", i);
+    }
+    ASSERT(contactShardsUpdate(&store, "WRITER 0-1", &recased) && !contactShardsFind(&store, "Writer 0-1", NULL) &&
+           contactShardsFind(&store, recased.name, NULL) && contactShardsCount(&store) == 2000,
+           "Cross-shard renames match names ignoring case");
+    ASSERT(contactShardsDelete(&store, renamed.name) && contactShardsCount(&store) == 1999, "Delete from shard");
+
+    contactSharedTag(&store.shards[contactShardFor(&store, "Writer 1-7")], "Writer 1-7", "vip");
+    contactSharedTag(&store.shards[contactShardFor(&store, "Writer 2-9")], "Writer 2-9", "vip");
+
+    size_t written = 0;
+    ASSERT(contactShardsSave(&store, "test_shards.dat", &written) && written == 1999, "Save walks every shard");
+    ContactDb db;
+    ASSERT(contactDbOpen(&db, "test_shards.dat") == CONTACT_DB_PACKED, "Shards save a packed snapshot");
+
+    ContactShards loaded;
+    contactShardsInit(&loaded, 4);
+    size_t count = 0;
+    ASSERT(contactShardsLoad(&loaded, "test_shards.dat", &count) && count == 1999 &&
+           contactShardsCount(&loaded) == 1999, "Load spreads records over a different shard count");
+    ASSERT(contactShardsFind(&loaded, "Writer 3-499", &found) && strcmp(found.email, "w3.499@test.com") == 0,
+           "Loaded contacts are found in their shard");
+    size_t tagged = 0;
+    for (size_t i = 0; i < loaded.count; i++) {
+        const ContactStore *shard = contactSharedLock(&loaded.shards[i]);
+        tagged += contactTagCount(shard, "vip");
+        if (contactHasTag(shard, findContactHandle(shard, "Writer 1-7"), "vip")) {
+            tagged += 10;
+        }
+        contactSharedUnlock(&loaded.shards[i]);
+    }
+    ASSERT(tagged == 12, "Tags survive a save and load across shard counts");
+    contactShardsFree(&loaded);
+
+    // The store's own snapshot loads into shards too
+    ContactStore contacts = {0};
+    Contact single = {"Single", "555-1234", "single@test.com"};
+    addContact(&contacts, &single);
+    saveContacts(&contacts, "test_shards.dat");
+    contactShardsInit(&loaded, 4);
+    ASSERT(contactShardsLoad(&loaded, "test_shards.dat", &count) && count == 1 &&
+           contactShardsFind(&loaded, "Single", NULL), "Shards load the file saveContacts writes");
+    contactShardsFree(&loaded);
+    contactDbWriteRecords(&single, 1, "test_shards.dat", 0, NULL);
+    contactShardsInit(&loaded, 4);
+    ASSERT(contactShardsLoad(&loaded, "test_shards.dat", &count) && count == 1 &&
+           contactShardsFind(&loaded, "Single", NULL), "Shards still load paged files");
+    contactShardsFree(&loaded);
+    freeContacts(&contacts);
+    contactShardsFree(&store);
+    remove("test_shards.dat");
+    remove("test_shards.dat.tags");
+}
+
+void testBatchMutations(void) {
+    printf("\n=== Testing Batch Mutations ===\n");
+    remove("test_batch.dat");
+    remove("test_batch.log");
+
+    ContactStore contacts = {0};
+    ContactWal wal;
+    contactWalRecover(&wal, &contacts, "test_batch.dat", "test_batch.log");
+    enableContactIndexes(&contacts, CONTACT_INDEX_PHONE | CONTACT_INDEX_EMAIL);
+
+    Contact batch[1000];
+    ContactHandle handles[1000];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(batch[i].name, sizeof(batch[i].name), "Batch %d", i);
+        snprintf(batch[i].phone, sizeof(batch[i].phone), "555-%04d", i);
+        snprintf(batch[i].email, sizeof(batch[i].email), "batch%d@test.com", i);
+    }
+    ASSERT(addContacts(&contacts, batch, 1000, handles) == 1000 && contacts.count == 1000, "Batch add stores every contact");
+    ASSERT(contacts.nameIndex.capacity * 3 >= contacts.nameIndex.count * 4 && contacts.nameIndex.count == 1000,
+           "Indexes are sized for the batch");
+    size_t capacity = contacts.nameIndex.capacity;
+
+    Contact found;
+    ASSERT(getContact(&contacts, handles[999], &found) && strcmp(found.name, "Batch 999") == 0,
+           "Batch add returns a handle per contact");
+    ASSERT(findByPhone(&contacts, "555-0500", &found) && strcmp(found.name, "Batch 500") == 0 &&
+           findByEmail(&contacts, "batch7@test.com", NULL), "Batch contacts are in secondary indexes");
+    NameCollector collector;
+    memset(&collector, 0, sizeof(collector));
+    searchContactsByPrefix(&contacts, "Batch 99", 0, collectName, &collector);
+    ASSERT(collector.count == 11 && strcmp(collector.names[0], "Batch 99") == 0, "Batch contacts are in the name tree");
+
+    const char *names[] = {"Batch 1", "Batch 2", "Nobody", "Batch 3"};
+    ASSERT(deleteContacts(&contacts, names, 4) == 3 && contacts.count == 997, "Batch delete skips missing names");
+    ASSERT(!findContact(&contacts, "Batch 2", NULL) && !getContact(&contacts, handles[2], NULL),
+           "Deleted contacts are gone");
+
+    // Refill the freed slots: the reserved index should not grow again
+    addContacts(&contacts, &batch[1], 3, NULL);
+    ASSERT(contacts.nameIndex.capacity == capacity && contacts.count == 1000, "Refilling reuses the reserved index");
+    ASSERT(wal.sequence == 3 && wal.logged == 1007, "Each batch is one log record");
+
+    // Drop the store without saving, as a crash would
+    contactWalClose(&wal, &contacts);
+    freeContacts(&contacts);
+    contactWalRecover(&wal, &contacts, "test_batch.dat", "test_batch.log");
+    ASSERT(contacts.count == 1000 && wal.sequence == 3, "Batch records replay after a crash");
+    ASSERT(findContact(&contacts, "Batch 2", NULL) && findContact(&contacts, "Batch 999", NULL),
+           "Replayed batches restore contacts");
+    contactWalClose(&wal, &contacts);
+    freeContacts(&contacts);
+
+    // A batch cut off mid-write is discarded as a whole
+    static char log[1 << 17];
+    FILE *file = fopen("test_batch.log", "rb");
+    size_t size = fread(log, 1, sizeof(log), file);
+    fclose(file);
+    file = fopen("test_batch.log", "wb");
+    fwrite(log, 1, size - 10, file);
+    fclose(file);
+    contactWalRecover(&wal, &contacts, "test_batch.dat", "test_batch.log");
+    ASSERT(contacts.count == 997 && !findContact(&contacts, "Batch 2", NULL), "Torn batch is not replayed");
+
+    ContactShared shared;
+    contactSharedInit(&shared);
+    ASSERT(contactSharedAddBatch(&shared, batch, 1000, handles) == 1000 &&
+           contactSharedDeleteBatch(&shared, names, 4) == 3 &&
+           shared.stores[0].count == 997 && shared.stores[1].count == 997, "Shared batches reach both copies");
+    contactSharedFree(&shared);
+
+    contactWalClose(&wal, &contacts);
+    freeContacts(&contacts);
+    remove("test_batch.dat");
+    remove("test_batch.log");
+}
+
+void testCursorPagination(void) {
+    printf("\n=== Testing Cursor Pagination ===\n");
+    ContactStore contacts = {0};
+
+    // Added out of name order, with a run of duplicates around the middle
+    for (int i = 0; i < 250; i++) {
+        Contact contact = {"", "555", "page@test.com"};
+        snprintf(contact.name, sizeof(contact.name), "Page %03d", (i * 97) % 250);
+        addContact(&contacts, &contact);
+    }
+    for (int i = 0; i < 5; i++) {
+        Contact twin = {"Page 100", "556", "twin@test.com"};
+        addContact(&contacts, &twin);
+    }
+
+    ContactCursor cursor;
+    Contact page[128];
+    contactCursorInit(&cursor, CONTACT_ORDER_NAME);
+    size_t total = 0;
+    int pages = 0;
+    bool ordered = true;
+    char previous[50] = "";
+    while (!cursor.done) {
+        size_t count = contactPage(&contacts, &cursor, page, 100);
+        for (size_t i = 0; i < count; i++) {
+            ordered = ordered && strcmp(previous, page[i].name) <= 0;
+            strcpy(previous, page[i].name);
+        }
+        total += count;
+        pages++;
+    }
+    ASSERT(total == 255 && pages == 3 && ordered, "Name pages cover every contact in order");
+
+    // Stop inside the duplicate run: 100 names below "Page 100", then 3 of its 6
+    contactCursorInit(&cursor, CONTACT_ORDER_NAME);
+    contactPage(&contacts, &cursor, page, 103);
+    ASSERT(strcmp(cursor.name, "Page 100") == 0 && cursor.skip == 3 && !cursor.done, "Cursor stops inside duplicates");
+
+    // Changes between pages: a name behind the cursor, one ahead of it, and
+    // a delete of a contact not yet returned
+    char token[CONTACT_CURSOR_TOKEN_SIZE];
+    ASSERT(contactCursorEncode(&cursor, token, sizeof(token)), "Cursor encodes to a token");
+    Contact behind = {"Page 000a", "557", "behind@test.com"};
+    Contact ahead = {"Page 200a", "558", "ahead@test.com"};
+    addContact(&contacts, &behind);
+    addContact(&contacts, &ahead);
+    deleteContact(&contacts, "Page 150");
+
+    ContactCursor resumed;
+    ASSERT(contactCursorDecode(&resumed, token) && resumed.skip == 3 &&
+           strcmp(resumed.name, "Page 100") == 0, "Token decodes to the same position");
+    size_t rest = 0;
+    bool sawAhead = false;
+    bool sawBehind = false;
+    while (!resumed.done) {
+        size_t count = contactPage(&contacts, &resumed, page, 100);
+        for (size_t i = 0; i < count; i++) {
+            sawAhead = sawAhead || strcmp(page[i].name, "Page 200a") == 0;
+            sawBehind = sawBehind || strcmp(page[i].name, "Page 000a") == 0;
+        }
+        rest += count;
+    }
+    // 3 twins left of 6 "Page 100"s, 149 names above it less the deleted one, plus "Page 200a"
+    ASSERT(rest == 3 + 148 + 1 && sawAhead && !sawBehind, "Resumed pages see inserts ahead and skip those behind");
+
+    // Insertion order follows adds even as slots are reused
+    deleteContact(&contacts, "Page 000");
+    Contact late = {"Late", "559", "late@test.com"};
+    addContact(&contacts, &late);
+    contactCursorInit(&cursor, CONTACT_ORDER_INSERTION);
+    contactPage(&contacts, &cursor, page, 3);
+    ASSERT(strcmp(page[0].name, "Page 097") == 0 && strcmp(page[1].name, "Page 194") == 0,
+           "Insertion order starts with the first add");
+    ContactCursor tail = cursor;
+    while (!tail.done) {
+        size_t count = contactPage(&contacts, &tail, page, 100);
+        if (count > 0) {
+            strcpy(previous, page[count - 1].name);
+        }
+    }
+    ASSERT(strcmp(previous, "Late") == 0, "Reused slot comes last in insertion order");
+
+    ASSERT(contactCursorEncode(&cursor, token, sizeof(token)) && contactCursorDecode(&resumed, token) &&
+           resumed.order == CONTACT_ORDER_INSERTION && resumed.sequence == cursor.sequence,
+           "Insertion tokens round-trip");
+    ASSERT(!contactCursorDecode(&resumed, "N1:4") && !contactCursorDecode(&resumed, "X"),
+           "Malformed tokens are rejected");
+    freeContacts(&contacts);
+
+    // Compacting the order after mass deletes keeps cursors valid
+    for (int i = 0; i < 3000; i++) {
+        Contact contact = {"", "555", "order@test.com"};
+        snprintf(contact.name, sizeof(contact.name), "Order %d", i);
+        addContact(&contacts, &contact);
+    }
+    contactCursorInit(&cursor, CONTACT_ORDER_INSERTION);
+    contactPage(&contacts, &cursor, page, 100);
+    for (int i = 100; i < 2100; i++) {
+        char name[50];
+        snprintf(name, sizeof(name), "Order %d", i);
+        deleteContact(&contacts, name);
+    }
+    ASSERT(contacts.orderCount < 3000, "Dead order entries are compacted");
+    contactPage(&contacts, &cursor, page, 1);
+    ASSERT(strcmp(page[0].name, "Order 2100") == 0, "Cursor resumes after compaction");
+
+    freeContacts(&contacts);
+}
+
+static int foldedCompare(const char *a, const char *b) {
+    for (;; a++, b++) {
+        int l = tolower((unsigned char)*a);
+        int r = tolower((unsigned char)*b);
+        if (l != r || l == 0) {
+            return l - r;
+        }
+    }
+}
+
+// A view kept up to date by merging changes must match a fresh full sort
+static bool viewMatchesFullSort(ContactStore *store, ContactSortKey key) {
+    ContactStore copy = {0};
+    copyContacts(&copy, store);
+    size_t count;
+    size_t fullCount;
+    const ContactViewEntry *view = contactSortedView(store, key, &count);
+    const ContactViewEntry *full = contactSortedView(&copy, key, &fullCount);
+    bool same = count == fullCount && count == store->count;
+    for (size_t i = 0; same && i < count; i++) {
+        same = view[i].handle == full[i].handle;
+    }
+    freeContacts(&copy);
+    return same;
+}
+
+void testSortedViews(void) {
+    printf("\n=== Testing Sorted Views ===\n");
+    ContactStore contacts = {0};
+
+    // Enough contacts for the parallel sort, with mixed-case names and some
+    // phone numbers that cannot be normalized
+    contactSortSetThreads(4);
+    size_t total = CONTACT_SORT_PARALLEL_MIN + 1000;
+    for (size_t i = 0; i < total; i++) {
+        Contact contact;
+        size_t n = (i * 7919) % total;
+        snprintf(contact.name, sizeof(contact.name), "%s %05zu", i % 3 == 0 ? "sort" : "Sort", n);
+        if (i % 10 == 0) {
+            strcpy(contact.phone, "n/a");
+        } else {
+            snprintf(contact.phone, sizeof(contact.phone), "+1 555 %07zu", (n * 31) % 10000000);
+        }
+        snprintf(contact.email, sizeof(contact.email), "User%zu@Domain%zu.com", n % 977, n % 7);
+        addContact(&contacts, &contact);
+    }
+
+    size_t count;
+    const ContactViewEntry *byName = contactSortedView(&contacts, CONTACT_SORT_NAME, &count);
+    bool ordered = count == total;
+    Contact previous;
+    Contact current;
+    for (size_t i = 0; ordered && i < count; i++) {
+        ordered = getContact(&contacts, byName[i].handle, &current) &&
+                  (i == 0 || foldedCompare(previous.name, current.name) <= 0);
+        previous = current;
+    }
+    ASSERT(ordered, "Name view is sorted case-insensitively");
+
+    const ContactViewEntry *byPhone = contactSortedView(&contacts, CONTACT_SORT_PHONE, &count);
+    ordered = count == total;
+    for (size_t i = 1; ordered && i < count; i++) {
+        PhoneKey a = contactPhoneKey(&contacts, byPhone[i - 1].handle);
+        PhoneKey b = contactPhoneKey(&contacts, byPhone[i].handle);
+        ordered = b == PHONE_KEY_NONE || (a != PHONE_KEY_NONE && a <= b);
+    }
+    ASSERT(ordered, "Phone view is sorted by number, unparseable last");
+
+    const ContactViewEntry *byEmail = contactSortedView(&contacts, CONTACT_SORT_EMAIL, &count);
+    ordered = count == total;
+    for (size_t i = 0; ordered && i < count; i++) {
+        ordered = getContact(&contacts, byEmail[i].handle, &current) &&
+                  (i == 0 || foldedCompare(previous.email, current.email) <= 0);
+        previous = current;
+    }
+    ASSERT(ordered, "Email view is sorted case-insensitively");
+
+    // Adds, renames, phone changes and deletes are merged into the views.
+    // New names keep the shared "sort " prefix, new emails do not, which
+    // makes the email view sort again from scratch.
+    static char names[250][50];
+    for (int i = 0; i < 250; i++) {
+        getContact(&contacts, byName[i * 100].handle, &current);
+        strcpy(names[i], current.name);
+    }
+    for (int i = 0; i < 100; i++) {
+        Contact contact = {"", "+1 555 0000000", "aaa@first.com"};
+        snprintf(contact.name, sizeof(contact.name), "Sort added %d", i);
+        addContact(&contacts, &contact);
+    }
+    for (int i = 0; i < 50; i++) {
+        Contact renamed = {"", "+44 20 7946 0000", "zzz@last.com"};
+        snprintf(renamed.name, sizeof(renamed.name), "SORT renamed %d", i);
+        updateContact(&contacts, names[i], &renamed);
+    }
+    for (int i = 50; i < 250; i++) {
+        deleteContact(&contacts, names[i]);
+    }
+    ASSERT(contacts.views->changeCount == 350, "Changes are recorded for the views");
+    ASSERT(viewMatchesFullSort(&contacts, CONTACT_SORT_NAME) &&
+           viewMatchesFullSort(&contacts, CONTACT_SORT_PHONE) &&
+           viewMatchesFullSort(&contacts, CONTACT_SORT_EMAIL), "Merged views match a full sort");
+    ASSERT(contacts.views->changeCount == 0, "Change log is trimmed once every view has caught up");
+    ASSERT(contacts.views->views[CONTACT_SORT_NAME].prefixLength == 5 &&
+           contacts.views->views[CONTACT_SORT_EMAIL].prefixLength == 0, "Keys skip the prefix every entry shares");
+
+    Contact page[3];
+    ASSERT(contactViewPage(&contacts, CONTACT_SORT_EMAIL, 0, page, 3) == 3 &&
+           strcmp(page[0].email, "aaa@first.com") == 0, "Pages are read from the view");
+    ASSERT(contactViewPage(&contacts, CONTACT_SORT_NAME, contacts.count - 1, page, 3) == 1,
+           "Last page is short");
+
+    // Copies do not share the cache
+    ContactStore copy = {0};
+    copyContacts(&copy, &contacts);
+    ASSERT(copy.views == NULL, "Copied store builds its own views");
+    freeContacts(&copy);
+
+    contactSortSetThreads(0);
+    freeContacts(&contacts);
+}
+
+// Cluster holding handle, or clusterCount if it is in none
+static size_t clusterOf(const ContactDuplicates *duplicates, ContactHandle handle) {
+    for (size_t i = 0; i < duplicates->clusterCount; i++) {
+        for (size_t m = duplicates->starts[i]; m < duplicates->starts[i + 1]; m++) {
+            if (duplicates->members[m] == handle) {
+                return i;
+            }
+        }
+    }
+    return duplicates->clusterCount;
+}
+
+static bool sameCluster(const ContactDuplicates *duplicates, ContactHandle a, ContactHandle b, unsigned reason) {
+    size_t cluster = clusterOf(duplicates, a);
+    return cluster < duplicates->clusterCount && cluster == clusterOf(duplicates, b) &&
+           duplicates->starts[cluster + 1] - duplicates->starts[cluster] == 2 &&
+           (duplicates->reasons[cluster] & reason);
+}
+
+void testDuplicateDetection(void) {
+    printf("\n=== Testing Duplicate Detection ===\n");
+    ASSERT(contactNameSimilarity("John  Smith", "john smith") == 1.0, "Name similarity ignores case and spacing");
+    ASSERT(contactNameSimilarity("Katherine Johnson", "Katherine Jonson") >= CONTACT_DUP_NAME_THRESHOLD &&
+           contactNameSimilarity("Alice", "Bob") == 0.0, "Similar names score above the threshold");
+
+    ContactStore contacts = {0};
+    Contact samePhoneA = {"John Smith", "+1 415 555 0101", "john@home.com"};
+    Contact samePhoneB = {"Jon Smyth", "(415) 555-0101", "jsmyth@work.com"};
+    Contact sameEmailA = {"Mary Major", "+1 415 555 0102", "mary@example.com"};
+    Contact sameEmailB = {"M. Major", "+1 415 555 0103", " MARY@Example.com "};
+    Contact similarA = {"Katherine Johnson", "+1 415 555 0104", "kj@one.com"};
+    Contact similarB = {"Katherine Jonson", "+1 415 555 0105", "kathy@two.com"};
+    Contact numberedA = {"Flat 2 Tenant", "+1 415 555 0106", "flat2@example.com"};
+    Contact numberedB = {"Flat 3 Tenant", "+1 415 555 0107", "flat3@example.com"};
+    ContactHandle phoneA = addContact(&contacts, &samePhoneA);
+    ContactHandle phoneB = addContact(&contacts, &samePhoneB);
+    ContactHandle emailA = addContact(&contacts, &sameEmailA);
+    ContactHandle emailB = addContact(&contacts, &sameEmailB);
+    ContactHandle nameA = addContact(&contacts, &similarA);
+    ContactHandle nameB = addContact(&contacts, &similarB);
+    ContactHandle flatA = addContact(&contacts, &numberedA);
+    ContactHandle flatB = addContact(&contacts, &numberedB);
+    for (int i = 0; i < 200; i++) {
+        Contact filler;
+        snprintf(filler.name, sizeof(filler.name), "Member %d", i);
+        snprintf(filler.phone, sizeof(filler.phone), "+1 212 555 %04d", i);
+        snprintf(filler.email, sizeof(filler.email), "person%d@example.com", i);
+        addContact(&contacts, &filler);
+    }
+
+    ContactDuplicates duplicates;
+    ASSERT(contactFindDuplicates(&contacts, CONTACT_DUP_ALL, CONTACT_DUP_NAME_THRESHOLD, &duplicates),
+           "Duplicate search runs");
+    ASSERT(duplicates.clusterCount == 3 && duplicates.memberCount == 6, "Only the near duplicates are clustered");
+    ASSERT(sameCluster(&duplicates, phoneA, phoneB, CONTACT_DUP_PHONE), "Same phone in another format is a duplicate");
+    ASSERT(sameCluster(&duplicates, emailA, emailB, CONTACT_DUP_EMAIL), "Email case and whitespace variants are duplicates");
+    ASSERT(sameCluster(&duplicates, nameA, nameB, CONTACT_DUP_NAME), "Similar names are duplicates");
+    ASSERT(clusterOf(&duplicates, flatA) == duplicates.clusterCount &&
+           clusterOf(&duplicates, flatB) == duplicates.clusterCount, "Names differing in numbers are not duplicates");
+    contactDuplicatesFree(&duplicates);
+
+    ASSERT(contactFindDuplicates(&contacts, CONTACT_DUP_PHONE, CONTACT_DUP_NAME_THRESHOLD, &duplicates) &&
+           duplicates.clusterCount == 1, "Rules can be chosen");
+    contactDuplicatesFree(&duplicates);
+
+    // Many spelling variants: every pair must land in one LSH bucket
+    for (int i = 0; i < 5000; i++) {
+        Contact original;
+        Contact variant;
+        snprintf(original.name, sizeof(original.name), "Scale Person %d", i);
+        snprintf(original.phone, sizeof(original.phone), "+1 303 %07d", i);
+        snprintf(original.email, sizeof(original.email), "scale%d@a.com", i);
+        snprintf(variant.name, sizeof(variant.name), "scale  PERSON %d", i);
+        snprintf(variant.phone, sizeof(variant.phone), "+1 720 %07d", i);
+        snprintf(variant.email, sizeof(variant.email), "variant%d@b.com", i);
+        addContact(&contacts, &original);
+        addContact(&contacts, &variant);
+    }
+    ASSERT(contactFindDuplicates(&contacts, CONTACT_DUP_NAME, CONTACT_DUP_NAME_THRESHOLD, &duplicates) &&
+           duplicates.clusterCount == 5001 && duplicates.memberCount == 10002, "Name variants are found at scale");
+    contactDuplicatesFree(&duplicates);
+
+    freeContacts(&contacts);
+}
+
+static bool predicateHolds(const Contact *contact, const ContactPredicate *predicate) {
+    const char *field = predicate->field == CONTACT_FIELD_NAME ? contact->name
+                        : predicate->field == CONTACT_FIELD_PHONE ? contact->phone : contact->email;
+    size_t length = strlen(predicate->value);
+    switch (predicate->match) {
+        case CONTACT_MATCH_EQUALS: return strcmp(field, predicate->value) == 0;
+        case CONTACT_MATCH_PREFIX: return strncmp(field, predicate->value, length) == 0;
+        case CONTACT_MATCH_CONTAINS: return strstr(field, predicate->value) != NULL;
+        default: {
+            const char *at = strchr(contact->email, '@');
+            const char *domain = predicate->value + (predicate->value[0] == '@');
+            if (at == NULL || strlen(at + 1) != strlen(domain)) {
+                return false;
+            }
+            for (size_t i = 0; domain[i] != '\0'; i++) {
+                if (tolower((unsigned char)at[1 + i]) != tolower((unsigned char)domain[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+}
+
+// Matches found by checking every contact one by one
+static size_t referenceQuery(const ContactStore *store, const ContactPredicate *predicates, size_t count,
+                             ContactHandle *out) {
+    ContactIterator it;
+    const Contact *contact;
+    size_t matches = 0;
+    contactIteratorInit(&it, store);
+    while ((contact = contactIteratorNext(&it)) != NULL) {
+        bool holds = true;
+        for (size_t i = 0; holds && i < count; i++) {
+            holds = predicateHolds(contact, &predicates[i]);
+        }
+        if (holds) {
+            out[matches++] = it.handle;
+        }
+    }
+    return matches;
+}
+
+static int compareHandles(const void *a, const void *b) {
+    ContactHandle x = *(const ContactHandle *)a;
+    ContactHandle y = *(const ContactHandle *)b;
+    return x < y ? -1 : x > y;
+}
+
+void testColumnQueries(void) {
+    printf("\n=== Testing Column Queries ===\n");
+    const char *domains[] = {"example.com", "Example.COM", "test.org", "mail.net", ""};
+    ContactStore contacts = {0};
+    for (int i = 0; i < 3000; i++) {
+        Contact contact;
+        if (i % 7 == 0) {
+            snprintf(contact.name, sizeof(contact.name), "Extraordinarily Long Person Name %d", i);
+        } else {
+            snprintf(contact.name, sizeof(contact.name), "Person %d", i);
+        }
+        snprintf(contact.phone, sizeof(contact.phone), i % 3 == 0 ? "+44 20 %05d" : "+1555%07d", i);
+        if (domains[i % 5][0] != '\0') {
+            snprintf(contact.email, sizeof(contact.email), "user%d@%s", i, domains[i % 5]);
+        } else {
+            snprintf(contact.email, sizeof(contact.email), "user%d", i);
+        }
+        addContact(&contacts, &contact);
+    }
+    for (int i = 0; i < 3000; i += 11) {
+        char name[50];
+        snprintf(name, sizeof(name), i % 7 == 0 ? "Extraordinarily Long Person Name %d" : "Person %d", i);
+        deleteContact(&contacts, name);
+    }
+
+    ContactColumns columns;
+    ASSERT(contactColumnsBuild(&columns, &contacts) && columns.rows == contacts.count, "Columns hold every live contact");
+
+    const ContactPredicate queries[][3] = {
+        {{CONTACT_FIELD_EMAIL, CONTACT_MATCH_DOMAIN, "example.com"}},
+        {{CONTACT_FIELD_EMAIL, CONTACT_MATCH_DOMAIN, "@EXAMPLE.com"}, {CONTACT_FIELD_PHONE, CONTACT_MATCH_PREFIX, "+44"}},
+        {{CONTACT_FIELD_NAME, CONTACT_MATCH_CONTAINS, "12"}, {CONTACT_FIELD_PHONE, CONTACT_MATCH_CONTAINS, "7"}},
+        {{CONTACT_FIELD_NAME, CONTACT_MATCH_PREFIX, "Extraordinarily Long Person Name 2"}},
+        {{CONTACT_FIELD_EMAIL, CONTACT_MATCH_EQUALS, "user1233@mail.net"}},
+        {{CONTACT_FIELD_NAME, CONTACT_MATCH_EQUALS, "Extraordinarily Long Person Name 1400"}},
+        {{CONTACT_FIELD_EMAIL, CONTACT_MATCH_CONTAINS, "e.COM"}, {CONTACT_FIELD_NAME, CONTACT_MATCH_CONTAINS, "Name 2"}},
+        {{CONTACT_FIELD_PHONE, CONTACT_MATCH_CONTAINS, "0"}, {CONTACT_FIELD_EMAIL, CONTACT_MATCH_EQUALS, "user4"}},
+    };
+    const size_t queryCounts[] = {1, 2, 2, 1, 1, 1, 2, 2};
+    size_t queryTotal = sizeof(queryCounts) / sizeof(queryCounts[0]);
+
+    ContactHandle *expected = (ContactHandle *)malloc(contacts.count * sizeof(ContactHandle));
+    ContactHandle *actual = (ContactHandle *)malloc(contacts.count * sizeof(ContactHandle));
+    bool agree = true;
+    bool nonEmpty = true;
+    ContactSimd levels[] = {CONTACT_SIMD_SCALAR, CONTACT_SIMD_SSE2, CONTACT_SIMD_AVX2};
+    for (int level = 0; level < 3; level++) {
+        contactQuerySetSimd(levels[level]);
+        for (size_t q = 0; q < queryTotal; q++) {
+            ContactQuery query;
+            contactQueryCompile(&query, queries[q], queryCounts[q]);
+            size_t want = referenceQuery(&contacts, queries[q], queryCounts[q], expected);
+            size_t got = contactQueryRun(&columns, &query, actual, contacts.count);
+            qsort(expected, want, sizeof(ContactHandle), compareHandles);
+            qsort(actual, got, sizeof(ContactHandle), compareHandles);
+            agree = agree && got == want && memcmp(expected, actual, want * sizeof(ContactHandle)) == 0;
+            nonEmpty = nonEmpty && want > 0;
+        }
+    }
+    contactQuerySetSimd(CONTACT_SIMD_AVX2);
+    ASSERT(nonEmpty, "Test queries select some contacts");
+    ASSERT(agree, "Scalar, SSE2 and AVX2 scans match a contact-by-contact check");
+
+    ContactQuery query;
+    ContactPredicate tooLong = {CONTACT_FIELD_PHONE, CONTACT_MATCH_CONTAINS, "+1555000000000000000000"};
+    ASSERT(contactQueryCompile(&query, &tooLong, 1) && query.empty && contactQueryRun(&columns, &query, NULL, 0) == 0,
+           "Values longer than the field match nothing");
+    ContactPredicate anything = {CONTACT_FIELD_NAME, CONTACT_MATCH_PREFIX, ""};
+    ASSERT(contactQueryCompile(&query, &anything, 1) && contactQueryRun(&columns, &query, NULL, 0) == contacts.count,
+           "An empty prefix matches every contact");
+    ContactPredicate first[2] = {{CONTACT_FIELD_NAME, CONTACT_MATCH_CONTAINS, "Person"},
+                                 {CONTACT_FIELD_EMAIL, CONTACT_MATCH_DOMAIN, "test.org"}};
+    ASSERT(contactQueryCompile(&query, first, 2) && query.steps[0].match == CONTACT_MATCH_DOMAIN,
+           "Cheap predicates run first");
+    ContactHandle handle;
+    Contact found;
+    ContactPredicate exact = {CONTACT_FIELD_NAME, CONTACT_MATCH_EQUALS, "Person 2999"};
+    contactQueryCompile(&query, &exact, 1);
+    ASSERT(contactQueryRun(&columns, &query, &handle, 1) == 1 && getContact(&contacts, handle, &found) &&
+           strcmp(found.name, "Person 2999") == 0, "Matches come back as store handles");
+
+    free(expected);
+    free(actual);
+    contactColumnsFree(&columns);
+    freeContacts(&contacts);
+}
+
+static bool collectMember(uint32_t value, void *userData) {
+    ContactBitmap *copy = (ContactBitmap *)userData;
+    return contactBitmapAdd(copy, value);
+}
+
+static bool sameTags(const ContactStore *a, const ContactStore *b, const char *tag) {
+    if (contactTagged(a, tag) == NULL || contactTagged(b, tag) == NULL ||
+        contactTagCount(a, tag) != contactTagCount(b, tag)) {
+        return false;
+    }
+    // Slots may differ between the stores, so compare by name
+    ContactIterator it;
+    const Contact *contact;
+    contactIteratorInit(&it, a);
+    while ((contact = contactIteratorNext(&it)) != NULL) {
+        if (contactHasTag(a, it.handle, tag) != contactHasTag(b, findContactHandle(b, contact->name), tag)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testContactTags(void) {
+    printf("\n=== Testing Contact Tags ===\n");
+    remove("test_tags.dat");
+    remove("test_tags.dat.tags");
+
+    // Sets spanning sparse and dense containers, checked against plain flags
+    enum { RANGE = 300000 };
+    bool *inA = (bool *)calloc(RANGE, sizeof(bool));
+    bool *inB = (bool *)calloc(RANGE, sizeof(bool));
+    ContactBitmap a = {0}, b = {0}, out = {0};
+    srand(7);
+    for (uint32_t v = 0; v < RANGE; v++) {
+        bool dense = v < 65536;
+        if ((dense && v % 3 != 0) || (!dense && rand() % 40 == 0)) {
+            inA[v] = contactBitmapAdd(&a, v);
+        }
+        if ((v >= 40000 && v < 140000 && v % 2 == 0) || rand() % 60 == 0) {
+            inB[v] = contactBitmapAdd(&b, v);
+        }
+    }
+    for (uint32_t v = 0; v < RANGE; v += 5) {
+        if (inA[v]) {
+            contactBitmapRemove(&a, v);
+            inA[v] = false;
+        }
+    }
+    size_t countA = 0, both = 0, either = 0, only = 0;
+    bool members = true;
+    for (uint32_t v = 0; v < RANGE; v++) {
+        countA += inA[v];
+        both += inA[v] && inB[v];
+        either += inA[v] || inB[v];
+        only += inA[v] && !inB[v];
+        members = members && contactBitmapContains(&a, v) == inA[v];
+    }
+    ASSERT(members && contactBitmapCount(&a) == countA, "Bitmap membership matches after adds and removes");
+    ASSERT(a.containers[0].words != NULL, "A crowded container switches to words");
+
+    bool agree = contactBitmapAnd(&out, &a, &b) && contactBitmapCount(&out) == both &&
+                 contactBitmapAndCount(&a, &b) == both;
+    for (uint32_t v = 0; v < RANGE && agree; v += 7) {
+        agree = contactBitmapContains(&out, v) == (inA[v] && inB[v]);
+    }
+    agree = agree && contactBitmapOr(&out, &a, &b) && contactBitmapCount(&out) == either;
+    for (uint32_t v = 0; v < RANGE && agree; v += 7) {
+        agree = contactBitmapContains(&out, v) == (inA[v] || inB[v]);
+    }
+    agree = agree && contactBitmapAndNot(&out, &a, &b) && contactBitmapCount(&out) == only;
+    for (uint32_t v = 0; v < RANGE && agree; v += 7) {
+        agree = contactBitmapContains(&out, v) == (inA[v] && !inB[v]);
+    }
+    ASSERT(agree, "And, or and and-not match the plain sets");
+
+    ContactBitmap visited = {0};
+    contactBitmapVisit(&a, collectMember, &visited);
+    size_t size = contactBitmapSerializedSize(&a);
+    unsigned char *bytes = (unsigned char *)malloc(size);
+    ContactBitmap restored = {0};
+    ASSERT(contactBitmapSerialize(&a, bytes) == bytes + size &&
+           contactBitmapDeserialize(&restored, bytes, size) == bytes + size &&
+           contactBitmapAndCount(&restored, &a) == countA && contactBitmapCount(&restored) == countA &&
+           contactBitmapCount(&visited) == countA, "Bitmaps survive a visit and a serialize round trip");
+    bytes[size - 1] ^= 0xFF;
+    ASSERT(contactBitmapDeserialize(&restored, bytes, size - 1) == NULL, "Truncated bitmaps are rejected");
+    ASSERT(contactBitmapBytes(&a) < RANGE / 8 + 65536 / 8 * 2, "Sparse members take less than a flat bitmap");
+    free(bytes);
+    free(inA);
+    free(inB);
+    contactBitmapFree(&a);
+    contactBitmapFree(&b);
+    contactBitmapFree(&out);
+    contactBitmapFree(&visited);
+    contactBitmapFree(&restored);
+
+    ContactStore contacts = {0};
+    ContactHandle handles[2000];
+    for (int i = 0; i < 2000; i++) {
+        Contact contact;
+        snprintf(contact.name, sizeof(contact.name), "Tagged %04d", 1999 - i);
+        snprintf(contact.phone, sizeof(contact.phone), "555-%04d", i);
+        snprintf(contact.email, sizeof(contact.email), "tagged%d@example.com", i);
+        handles[i] = addContact(&contacts, &contact);
+        if (i % 2 == 0) {
+            contactTag(&contacts, handles[i], "even");
+        }
+        if (i % 5 == 0) {
+            contactTag(&contacts, handles[i], "fives");
+        }
+    }
+    ASSERT(contactTagCount(&contacts, "even") == 1000 && contactTagCount(&contacts, "fives") == 400 &&
+           contactTagCount(&contacts, "missing") == 0 && contactTagged(&contacts, "missing") == NULL,
+           "Tags count their members");
+    ASSERT(contactBitmapAndCount(contactTagged(&contacts, "even"), contactTagged(&contacts, "fives")) == 200,
+           "Intersections count shared members");
+    ASSERT(contactTag(&contacts, handles[0], "even") && contactTagCount(&contacts, "even") == 1000 &&
+           !contactTag(&contacts, handles[1], "") &&
+           !contactTag(&contacts, handles[1], "a tag name far too long to be kept as one") &&
+           !contactTag(&contacts, CONTACT_HANDLE_NONE, "even"), "Tagging twice, bad names and bad handles change nothing");
+
+    Contact renamed = {"Tagged renamed", "555-0000", "renamed@example.com"};
+    updateContact(&contacts, "Tagged 1999", &renamed);
+    ASSERT(contactHasTag(&contacts, handles[0], "even") && contactHasTag(&contacts, handles[0], "fives"),
+           "Contacts keep their tags through updates");
+    deleteContact(&contacts, "Tagged 1989");   // i = 10
+    Contact fresh = {"Untagged", "555-9999", "fresh@example.com"};
+    ContactHandle reused = addContact(&contacts, &fresh);
+    ASSERT((uint32_t)reused == (uint32_t)handles[10] && !contactHasTag(&contacts, reused, "even") &&
+           contactTagCount(&contacts, "even") == 999 && contactTagCount(&contacts, "fives") == 399,
+           "Deleted contacts lose their tags, and a reused slot starts untagged");
+    ASSERT(contactUntag(&contacts, handles[2], "even") && !contactUntag(&contacts, handles[2], "even") &&
+           contactTagCount(&contacts, "even") == 998, "Untagging removes one member");
+
+    ContactStore copy = {0};
+    ASSERT(copyContacts(&copy, &contacts) && sameTags(&contacts, &copy, "even") && sameTags(&contacts, &copy, "fives"),
+           "Copies keep their tags");
+    freeContacts(&copy);
+
+    saveContacts(&contacts, "test_tags.dat");
+    ContactStore loaded = {0};
+    loadContacts(&loaded, "test_tags.dat");
+    ASSERT(loaded.count == contacts.count && sameTags(&contacts, &loaded, "even") && sameTags(&contacts, &loaded, "fives"),
+           "Tags are saved next to the snapshot and loaded with it");
+    freeContacts(&loaded);
+
+    // A sidecar saved with another snapshot is not applied
+    rename("test_tags.dat.tags", "test_tags.old");
+    contactDropTag(&contacts, "even");
+    contactDropTag(&contacts, "fives");
+    saveContacts(&contacts, "test_tags.dat");
+    FILE *sidecar = fopen("test_tags.dat.tags", "rb");
+    ASSERT(sidecar == NULL, "Saving without tags removes the sidecar");
+    if (sidecar != NULL) {
+        fclose(sidecar);
+    }
+    deleteContact(&contacts, "Tagged 0000");
+    saveContacts(&contacts, "test_tags.dat");
+    rename("test_tags.old", "test_tags.dat.tags");
+    loadContacts(&loaded, "test_tags.dat");
+    ASSERT(loaded.count == contacts.count && contactTagged(&loaded, "even") == NULL, "Stale sidecars are ignored");
+    freeContacts(&loaded);
+    freeContacts(&contacts);
+
+    // Background saves of a shared store take the tags as of their snapshot
+    ContactShared shared;
+    contactSharedInit(&shared);
+    Contact batch[300];
+    for (int i = 0; i < 300; i++) {
+        snprintf(batch[i].name, sizeof(batch[i].name), "Shared %03d", 299 - i);
+        snprintf(batch[i].phone, sizeof(batch[i].phone), "555-%04d", i);
+        snprintf(batch[i].email, sizeof(batch[i].email), "shared%d@example.com", i);
+    }
+    contactSharedAddBatch(&shared, batch, 300, NULL);
+    for (int i = 0; i < 300; i += 3) {
+        contactSharedTag(&shared, batch[i].name, "thirds");
+    }
+    ContactSaver saver;
+    int completed = 0;
+    contactSaverStart(&saver);
+    ASSERT(saveSharedContactsAsync(&saver, &shared, "test_tags.dat", countSave, &completed), "Shared save is queued");
+    contactSharedTag(&shared, batch[1].name, "thirds");
+    contactSaverWait(&saver);
+    contactSaverStop(&saver);
+    loadContacts(&loaded, "test_tags.dat");
+    ContactHandle first = findContactHandle(&loaded, batch[0].name);
+    ContactHandle second = findContactHandle(&loaded, batch[1].name);
+    ASSERT(completed == 1 && contactTagCount(&loaded, "thirds") == 100 && contactHasTag(&loaded, first, "thirds") &&
+           !contactHasTag(&loaded, second, "thirds"), "Background saves write the tags they copied");
+    freeContacts(&loaded);
+    contactSharedFree(&shared);
+
+    remove("test_tags.dat");
+    remove("test_tags.dat.tags");
+}
+
+static bool loadLazily(ContactStore *store, void *arg) {
+    loadContacts(store, (const char *)arg);
+    return true;
+}
+
+void testLazyOpen(void) {
+    printf("\n=== Testing Lazy Open ===\n");
+    ContactStore contacts = {0};
+    Contact batch[3000];
+    for (int i = 0; i < 3000; i++) {
+        snprintf(batch[i].name, sizeof(batch[i].name), "Lazy %04d", i);
+        snprintf(batch[i].phone, sizeof(batch[i].phone), "555%07d", i);
+        snprintf(batch[i].email, sizeof(batch[i].email), "lazy%d@example.com", i);
+    }
+    ContactHandle handles[3000];
+    addContacts(&contacts, batch, 3000, handles);
+    for (int i = 0; i < 3000; i += 5) {
+        contactTag(&contacts, handles[i], "fives");
+    }
+    saveContacts(&contacts, "test_lazy.dat");
+    freeContacts(&contacts);
+
+    contactLazySetEnabled(true);
+    ContactStore lazy = {0};
+    loadContacts(&lazy, "test_lazy.dat");
+    ASSERT(lazy.lazy != NULL && lazy.count == 0 && contactLazyPending(&lazy) == 3000,
+           "Opening lazily decodes no contacts");
+
+    Contact found;
+    ASSERT(findContact(&lazy, "Lazy 2345", &found) && strcmp(found.phone, "5550002345") == 0 &&
+           strcmp(found.email, "lazy2345@example.com") == 0 && !findContact(&lazy, "Lazy 2345x", NULL) &&
+           !findContact(&lazy, "Absent", NULL) && lazy.count == 0, "Lookups read unfaulted contacts from the file");
+
+    Contact fresh = {"Lazy 0100a", "5559999999", "fresh@example.com"};
+    ContactHandle added = addContact(&lazy, &fresh);
+    ASSERT(added != CONTACT_HANDLE_NONE && lazy.count == CONTACT_PACK_BLOCK_RECORDS + 1 &&
+           contactLazyPending(&lazy) == 3000 - CONTACT_PACK_BLOCK_RECORDS,
+           "An add faults in only the block its name falls in");
+    ASSERT(contactHasTag(&lazy, findContactHandle(&lazy, "Lazy 0005"), "fives") &&
+           !contactHasTag(&lazy, findContactHandle(&lazy, "Lazy 0006"), "fives") &&
+           !contactHasTag(&lazy, added, "fives"), "Faulted contacts get their saved tags");
+
+    Contact renamed = {"Lazy 2999 renamed", "5550000001", "renamed@example.com"};
+    ASSERT(updateContact(&lazy, "Lazy 2999", &renamed) && deleteContact(&lazy, "Lazy 1500") &&
+           !deleteContact(&lazy, "Lazy 1500") && !findContact(&lazy, "Lazy 1500", NULL) &&
+           !findContact(&lazy, "Lazy 2999", NULL) && findContact(&lazy, "Lazy 2999 renamed", NULL),
+           "Updates and deletes fault in the contacts they change");
+    Contact recased = {"Lazy 0777", "5550007777", "lazy777@example.com"};
+    size_t pending = contactLazyPending(&lazy);
+    ASSERT(updateContact(&lazy, "LAZY 0777", &recased) && lazy.lazy != NULL &&
+           contactLazyPending(&lazy) == pending - CONTACT_PACK_BLOCK_RECORDS,
+           "Names matched ignoring case fault in only their block");
+    ASSERT(!contactPackWrite(&lazy, "test_lazy_partial.dat", 0, NULL), "A partly loaded store is not saved");
+
+    ContactStore copy = {0};
+    ASSERT(copyContacts(&copy, &lazy) && contactLazyPending(&copy) == contactLazyPending(&lazy) &&
+           contactLazyLoadAll(&copy) && copy.lazy == NULL && copy.count == 3000, "Copies fault in on their own");
+    freeContacts(&copy);
+    ASSERT(findContact(&lazy, "Lazy 2000", NULL), "The file outlives a freed copy");
+
+    ASSERT(contactLazyLoadAll(&lazy) && lazy.lazy == NULL && lazy.count == 3000 &&
+           contactTagCount(&lazy, "fives") == 599 && findContact(&lazy, "Lazy 2000", NULL) &&
+           findContact(&lazy, "Lazy 0100a", NULL), "Loading the rest gives the whole store");
+    freeContacts(&lazy);
+
+    ContactSnapshot snapshot;
+    loadContacts(&lazy, "test_lazy.dat");
+    ASSERT(contactSnapshotOpen(&lazy, &snapshot) && lazy.lazy == NULL && snapshot.count == 3000,
+           "Opening a snapshot loads every contact first");
+    contactSnapshotClose(&lazy, &snapshot);
+    freeContacts(&lazy);
+
+    ContactShared shared;
+    contactSharedInit(&shared);
+    contactSharedReplace(&shared, loadLazily, "test_lazy.dat");
+    ASSERT(contactSharedCount(&shared) == 3000 && contactSharedFind(&shared, "Lazy 0042", NULL),
+           "Shared stores count and find unfaulted contacts");
+    ASSERT(contactSharedLoadAll(&shared) && contactSharedCount(&shared) == 3000 &&
+           shared.stores[0].lazy == NULL && shared.stores[1].lazy == NULL, "Shared stores load both copies");
+    contactSharedFree(&shared);
+    contactLazySetEnabled(false);
+
+    remove("test_lazy.dat");
+    remove("test_lazy.dat.tags");
+}
+
+static bool collatesTo(const char *name, const char *expected) {
+    char key[64];
+    return contactCollate(name, strlen(name), key) == strlen(expected) && strcmp(key, expected) == 0;
+}
+
+void testCollation(void) {
+    printf("\n=== Testing Collation ===\n");
+    ASSERT(collatesTo("\xC3\x89mile", "emile") && collatesTo("EMILE", "emile") &&
+           collatesTo("e\xCC\x81mile", "emile"), "Case, accents and combining marks are folded");
+    ASSERT(collatesTo("Stra\xC3\x9F" "e", "strasse") && collatesTo("STRASSE", "strasse") &&
+           collatesTo("\xC3\x85ngstr\xC3\xB6m", "angstrom") && collatesTo("\xC5\x81ukasz", "lukasz"),
+           "Latin letters fold to their base letters");
+    ASSERT(collatesTo("\xD0\x96\xD0\x90\xD0\x9D\xD0\x9D\xD0\x90", "\xD0\xB6\xD0\xB0\xD0\xBD\xD0\xBD\xD0\xB0") &&
+           collatesTo("\xCE\x86\xCE\xBB\xCF\x86\xCE\xB1", "\xCE\xB1\xCE\xBB\xCF\x86\xCE\xB1"),
+           "Cyrillic and Greek letters fold too");
+    ASSERT(collatesTo("Bad \xFF\xC3", "bad \xFF\xC3") && collatesTo("\xC0\xAF", "\xC0\xAF"),
+           "Invalid UTF-8 is kept as it is");
+
+    ContactStore contacts = {0};
+    Contact batch[] = {
+        {"Alice", "5550000001", "alice@example.com"},
+        {"\xC3\x89mile", "5550000002", "emile@example.com"},
+        {"Emma", "5550000003", "emma@example.com"},
+        {"Emil", "5550000004", "emil@example.com"},
+        {"Bob", "5550000005", "bob@example.com"},
+        {"bob", "5550000006", "bob2@example.com"}
+    };
+    addContacts(&contacts, batch, 6, NULL);
+    ASSERT(!findContact(&contacts, "alice", NULL), "Lookups stay exact");
+
+    Contact updated = {"Alice", "5551111111", "alice@example.com"};
+    Contact found;
+    ASSERT(updateContact(&contacts, "alice", &updated) && findContact(&contacts, "Alice", &found) &&
+           strcmp(found.phone, "5551111111") == 0, "Updates match names ignoring case");
+    ASSERT(!updateContact(&contacts, "BOB", &updated) && !deleteContact(&contacts, "BOB") && contacts.count == 6,
+           "Names matching several contacts change none");
+    ASSERT(deleteContact(&contacts, "bob") && findContact(&contacts, "Bob", NULL),
+           "An exact match is preferred");
+
+    size_t count;
+    const ContactViewEntry *entries = contactSortedView(&contacts, CONTACT_SORT_NAME, &count);
+    const char *expected[] = {"Alice", "Bob", "Emil", "\xC3\x89mile", "Emma"};
+    bool ordered = count == 5;
+    for (size_t i = 0; ordered && i < count; i++) {
+        ordered = strcmp(contactSlotName(&contacts, (uint32_t)entries[i].handle), expected[i]) == 0;
+    }
+    ASSERT(ordered, "Name views sort accented names with their base letters");
+
+    ASSERT(deleteContact(&contacts, "\xC3\x89MILE") && !findContact(&contacts, "\xC3\x89mile", NULL) &&
+           deleteContacts(&contacts, (const char *const[]){"EMMA", "emil"}, 2) == 2 && contacts.count == 2,
+           "Deletes match names ignoring case and accents");
+    freeContacts(&contacts);
+}
+
+void testNameFilter(void) {
+    printf("\n=== Testing Name Filter ===\n");
+    ContactStore contacts = {0};
+    Contact batch[4000];
+    for (int i = 0; i < 4000; i++) {
+        snprintf(batch[i].name, sizeof(batch[i].name), "Filtered %d", i);
+        snprintf(batch[i].phone, sizeof(batch[i].phone), "555%07d", i);
+        snprintf(batch[i].email, sizeof(batch[i].email), "f%d@example.com", i);
+    }
+    addContacts(&contacts, batch, 2000, NULL);
+    for (int i = 2000; i < 4000; i++) {
+        addContact(&contacts, &batch[i]);
+    }
+
+    bool allFound = true;
+    for (int i = 0; i < 4000; i++) {
+        allFound = allFound && contactBloomMayContain(&contacts.nameFilter, batch[i].name) &&
+                   findContact(&contacts, batch[i].name, NULL);
+    }
+    ASSERT(allFound, "Filter never rejects a stored name");
+
+    contactBloomResetStats();
+    char name[50];
+    for (int i = 0; i < 4000; i++) {
+        snprintf(name, sizeof(name), "Absent %d", i);
+        findContact(&contacts, name, NULL);
+    }
+    findContact(&contacts, "Filtered 7", NULL);
+    ContactBloomStats stats;
+    contactBloomStats(&stats);
+    ASSERT(stats.lookups == 4001 && stats.skipped + stats.falsePositives == 4000,
+           "Lookups, filter rejections and false positives are counted");
+    ASSERT(stats.falsePositives < 200, "Most absent names skip the index");
+
+    // Deleting a quarter of the names rebuilds the filter without them
+    for (int i = 0; i < 1000; i++) {
+        deleteContact(&contacts, batch[i].name);
+    }
+    size_t rejected = 0;
+    for (int i = 0; i < 1000; i++) {
+        rejected += !contactBloomMayContain(&contacts.nameFilter, batch[i].name);
+    }
+    ASSERT(contacts.nameFilter.stale == 0 && contacts.nameFilter.names == 3000 && rejected > 900,
+           "Deletes rebuild the filter from the live names");
+
+    Contact renamed = {"Renamed Contact", "5550000000", "renamed@example.com"};
+    ASSERT(updateContact(&contacts, batch[1000].name, &renamed) &&
+           findContact(&contacts, "Renamed Contact", NULL) && !findContact(&contacts, batch[1000].name, NULL),
+           "Renames are looked up under the new name");
+
+    ContactStore copy = {0};
+    ASSERT(copyContacts(&copy, &contacts) && findContact(&copy, "Renamed Contact", NULL) &&
+           copy.nameFilter.names == contacts.nameFilter.names, "Copies carry the filter");
+    freeContacts(&copy);
+
+    // Fewer bits per name take less space and let more through
+    contactBloomSetBitsPerName(2);
+    ContactStore small = {0};
+    addContacts(&small, batch, 4000, NULL);
+    contactBloomSetBitsPerName(0);
+    ASSERT(contactBloomBytes(&small.nameFilter) < contactBloomBytes(&contacts.nameFilter) &&
+           contactBloomFalsePositiveRate(&small.nameFilter) > contactBloomFalsePositiveRate(&contacts.nameFilter),
+           "Bits per name trade size for false positives");
+    freeContacts(&small);
 
     freeContacts(&contacts);
 }
@@ -131,9 +2294,33 @@ void runAllTests(void) {
     printf("=== EchoNull Unit Tests ===\n");
 
     testContactOperations();
+    testNameIndex();
+    testSlabStore();
+    testCompactStorage();
+    testPrefixSearch();
+    testCursorPagination();
+    testSortedViews();
+    testDuplicateDetection();
+    testColumnQueries();
+    testContactTags();
+    testLazyOpen();
+    testCollation();
+    testNameFilter();
+    testSecondaryIndexes();
+    testPhoneNormalization();
     testMemoryAllocator();
     testSecurity();
     testFileOperations();
+    testContactDatabase();
+    testPackedSnapshot();
+    testParallelLoad();
+    testWriteAheadLog();
+    testBatchMutations();
+    testAsyncSave();
+    testImportExport();
+    testSharedStore();
+    testVersionedReads();
+    testShardedStore();
 
     printf("\n=== Test Results ===\n");
     printf("Tests run: %d\n", testsRun);